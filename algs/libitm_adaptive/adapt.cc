@@ -0,0 +1,195 @@
+#include "libitm_i.h"
+
+// [transmem] Runtime algorithm selection
+//
+// This library links NOrec, lazy (commit-time locking) and ml_wt (eager,
+// encounter-time locking) together, and a sampling monitor picks which one
+// is the default dispatch for multithreaded execution.
+//
+// Each thread counts its commits, writer commits, conflict aborts (from
+// restart_reason[]), and read/write set sizes.  Every ADAPT_PERIOD commits it
+// publishes its counts to a set of global totals.  Once the totals cover
+// ADAPT_SAMPLE commits, whoever published last takes a snapshot, resets the
+// totals, and picks the method that best fits the sample:
+//
+//  - NOrec, when writer commits are rare relative to the number of threads
+//    (every writer commit makes all concurrent transactions revalidate) and
+//    read sets are small enough to validate by value.
+//  - ml_wt, when aborts are rare and write sets are small, since eager
+//    locking then costs less than buffering and a redo log lookup per read.
+//  - lazy otherwise, since commit-time locking keeps the window in which
+//    transactions conflict small, and copes best with long transactions.
+//
+// To avoid flapping, each threshold is relaxed by half for the method that
+// is already in use, and a different method must win ADAPT_HYSTERESIS
+// consecutive samples before we switch.  The switch itself happens in
+// serial mode, via set_default_dispatch(), which runs the method groups'
+// fini() and init().  The monitor only runs between transactions, so the
+// thread that decides holds no locks when it asks for the serial lock.
+//
+// Setting ITM_DEFAULT_METHOD pins the method and disables the monitor.
+
+namespace GTM HIDDEN {
+
+bool adapt_enabled = false;
+
+// The number of commits a thread accumulates before publishing them, and
+// the number of commits in a sample
+static const uint32_t ADAPT_PERIOD = 256;
+static const uint64_t ADAPT_SAMPLE = 8192;
+
+// The number of consecutive samples a new method must win
+static const unsigned ADAPT_HYSTERESIS = 3;
+
+// Thresholds for choosing NOrec: writer commits per 100 commits, times the
+// thread count; and read set size in 16-byte stripes
+static const uint64_t ADAPT_NOREC_WRITERS = 100;
+static const uint64_t ADAPT_NOREC_READS = 512;
+
+// Thresholds for choosing ml_wt: aborts per 100 attempts; and write set size
+// in 16-byte stripes
+static const uint64_t ADAPT_ML_ABORTS = 10;
+static const uint64_t ADAPT_ML_WRITES = 32;
+
+// The totals that threads publish to.  Each counter is reset when a sample
+// is taken, so a sample may include a few counts that arrive concurrently;
+// that is fine for a heuristic.
+static struct
+{
+  atomic<uint64_t> commits;
+  atomic<uint64_t> writers;
+  atomic<uint64_t> aborts;
+  atomic<uint64_t> reads;
+  atomic<uint64_t> writes;
+} adapt_totals __attribute__((aligned(HW_CACHELINE_SIZE)));
+
+// Only one thread evaluates a sample at a time.  The fields below are
+// protected by adapt_busy, except that adapt_current is also read by
+// number_of_threads_changed().
+static atomic<bool> adapt_busy;
+static atomic<abi_dispatch*> adapt_current;
+static abi_dispatch* adapt_candidate;
+static unsigned adapt_votes;
+
+} // namespace GTM
+
+using namespace GTM;
+
+// Returns the STM the monitor currently prefers.  Until the first sample,
+// that is ml_wt, which is also what libitm uses by default.
+abi_dispatch *
+GTM::adapt_dispatch ()
+{
+  abi_dispatch *disp = adapt_current.load (memory_order_relaxed);
+  return disp ? disp : dispatch_ml_wt ();
+}
+
+// Relax threshold X if the method it favors is the current one
+static inline uint64_t
+band (uint64_t x, bool current)
+{
+  return current ? x + x / 2 : x;
+}
+
+// Pick the method that best fits a sample
+static abi_dispatch *
+adapt_choose (uint64_t commits, uint64_t writers, uint64_t aborts,
+              uint64_t reads, uint64_t writes, unsigned threads)
+{
+  abi_dispatch *cur = adapt_dispatch ();
+  uint64_t avg_reads = reads / commits;
+  uint64_t avg_writes = writers ? writes / writers : 0;
+  uint64_t writer_pct = writers * 100 / commits;
+  uint64_t abort_pct = aborts * 100 / (commits + aborts);
+
+  abi_dispatch *norec = dispatch_norec ();
+  if (writer_pct * threads <= band (ADAPT_NOREC_WRITERS, cur == norec)
+      && avg_reads <= band (ADAPT_NOREC_READS, cur == norec))
+    return norec;
+
+  abi_dispatch *ml = dispatch_ml_wt ();
+  if (abort_pct <= band (ADAPT_ML_ABORTS, cur == ml)
+      && avg_writes <= band (ADAPT_ML_WRITES, cur == ml))
+    return ml;
+
+  return dispatch_lazy ();
+}
+
+// Make DISP the default dispatch.  Must be called outside of transactions.
+void
+gtm_thread::adapt_switch (abi_dispatch *disp)
+{
+  serial_lock.write_lock ();
+  if (disp->supports (number_of_threads))
+    set_default_dispatch (disp);
+  serial_lock.write_unlock ();
+}
+
+// Take a sample from the totals, and switch methods if warranted
+void
+gtm_thread::adapt_decide ()
+{
+  uint64_t commits = adapt_totals.commits.exchange (0, memory_order_relaxed);
+  uint64_t writers = adapt_totals.writers.exchange (0, memory_order_relaxed);
+  uint64_t aborts = adapt_totals.aborts.exchange (0, memory_order_relaxed);
+  uint64_t reads = adapt_totals.reads.exchange (0, memory_order_relaxed);
+  uint64_t writes = adapt_totals.writes.exchange (0, memory_order_relaxed);
+  if (commits == 0)
+    return;
+
+  // The thread count is only stable in serial mode, but a racy read is
+  // good enough for a heuristic; adapt_switch() checks again.
+  abi_dispatch *disp = adapt_choose (commits, writers, aborts, reads, writes,
+                                     number_of_threads);
+  if (disp == adapt_dispatch ())
+    {
+      adapt_votes = 0;
+      return;
+    }
+  if (disp != adapt_candidate)
+    {
+      adapt_candidate = disp;
+      adapt_votes = 0;
+    }
+  if (++adapt_votes < ADAPT_HYSTERESIS)
+    return;
+
+  adapt_votes = 0;
+  adapt_current.store (disp, memory_order_relaxed);
+  adapt_switch (disp);
+}
+
+// Called after each commit, with the read and write set sizes of the
+// transaction.  The transaction must be inactive.
+void
+gtm_thread::adapt_commit (size_t reads, size_t writes)
+{
+  adapt_commits++;
+  adapt_writers += (writes != 0);
+  adapt_reads += reads;
+  adapt_writes += writes;
+  if (adapt_commits < ADAPT_PERIOD)
+    return;
+
+  uint32_t conflicts = cm_conflicts ();
+  adapt_totals.writers.fetch_add (adapt_writers, memory_order_relaxed);
+  adapt_totals.aborts.fetch_add (conflicts - adapt_aborts_base,
+                                 memory_order_relaxed);
+  adapt_totals.reads.fetch_add (adapt_reads, memory_order_relaxed);
+  adapt_totals.writes.fetch_add (adapt_writes, memory_order_relaxed);
+  uint64_t total = adapt_totals.commits.fetch_add (adapt_commits,
+                                                   memory_order_relaxed)
+    + adapt_commits;
+  adapt_commits = 0;
+  adapt_writers = 0;
+  adapt_aborts_base = conflicts;
+  adapt_reads = 0;
+  adapt_writes = 0;
+
+  if (total >= ADAPT_SAMPLE && !adapt_busy.load (memory_order_relaxed)
+      && !adapt_busy.exchange (true, memory_order_acquire))
+    {
+      adapt_decide ();
+      adapt_busy.store (false, memory_order_release);
+    }
+}
@@ -0,0 +1,644 @@
+/* Copyright (C) 2008-2015 Free Software Foundation, Inc.
+   Contributed by Richard Henderson <rth@redhat.com>.
+
+   This file is part of the GNU Transactional Memory Library (libitm).
+
+   Libitm is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   Libitm is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   Under Section 7 of GPL version 3, you are granted additional
+   permissions described in the GCC Runtime Library Exception, version
+   3.1, as published by the Free Software Foundation.
+
+   You should have received a copy of the GNU General Public License and
+   a copy of the GCC Runtime Library Exception along with this program;
+   see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include "libitm_i.h"
+#include <pthread.h>
+
+
+using namespace GTM;
+
+#if !defined(HAVE_ARCH_GTM_THREAD) || !defined(HAVE_ARCH_GTM_THREAD_DISP)
+extern __thread gtm_thread_tls _gtm_thr_tls;
+#endif
+
+gtm_rwlock GTM::gtm_thread::serial_lock;
+gtm_thread *GTM::gtm_thread::list_of_threads = 0;
+unsigned GTM::gtm_thread::number_of_threads = 0;
+
+gtm_stmlock GTM::gtm_stmlock_array[LOCK_ARRAY_SIZE];
+atomic<gtm_version> GTM::gtm_clock;
+
+/* ??? Move elsewhere when we figure out library initialization.  */
+uint64_t GTM::gtm_spin_count_var = 1000;
+
+#ifdef HAVE_64BIT_SYNC_BUILTINS
+static atomic<_ITM_transactionId_t> global_tid;
+#else
+static _ITM_transactionId_t global_tid;
+static pthread_mutex_t global_tid_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+// Provides a on-thread-exit callback used to release per-thread data.
+static pthread_key_t thr_release_key;
+static pthread_once_t thr_release_once = PTHREAD_ONCE_INIT;
+
+/* Allocate a transaction structure.  */
+void *
+GTM::gtm_thread::operator new (size_t s)
+{
+  void *tx;
+
+  assert(s == sizeof(gtm_thread));
+
+  tx = xmalloc (sizeof (gtm_thread), true);
+  memset (tx, 0, sizeof (gtm_thread));
+
+  return tx;
+}
+
+/* Free the given transaction. Raises an error if the transaction is still
+   in use.  [transmem] Other threads may still read it, so reap_threads()
+   frees it later (see reclaim.cc).  */
+void
+GTM::gtm_thread::operator delete(void *tx)
+{
+  bury ((gtm_thread *) tx);
+}
+
+static void
+thread_exit_handler(void *)
+{
+  gtm_thread *thr = gtm_thr();
+  if (thr)
+    delete thr;
+  set_gtm_thr(0);
+}
+
+static void
+thread_exit_init()
+{
+  if (pthread_key_create(&thr_release_key, thread_exit_handler))
+    GTM_fatal("Creating thread release TLS key failed.");
+}
+
+
+GTM::gtm_thread::~gtm_thread()
+{
+  if (nesting > 0)
+    GTM_fatal("Thread exit while a transaction is still active.");
+  // [transmem] Let the next thread adopt our profiles (see profile.cc)
+  profile_detach ();
+
+  // Deregister this transaction.
+  serial_lock.write_lock ();
+  gtm_thread **prev = &list_of_threads;
+  for (; *prev; prev = &(*prev)->next_thread)
+    {
+      if (*prev == this)
+    {
+      *prev = (*prev)->next_thread;
+      break;
+    }
+    }
+  number_of_threads--;
+  number_of_threads_changed(number_of_threads + 1, number_of_threads);
+  // [transmem] No transaction is active, so nobody can read the memory
+  // that we freed anymore.
+  arena.reclaim (~(gtm_word) 0, 0);
+  reap_threads ();
+  serial_lock.write_unlock ();
+}
+
+GTM::gtm_thread::gtm_thread ()
+{
+  // This object's memory has been set to zero by operator new, so no need
+  // to initialize any of the other primitive-type members that do not have
+  // constructors.
+  shared_state.store(-1, memory_order_relaxed);
+  cm_reset ();
+
+  // Register this transaction with the list of all threads' transactions.
+  serial_lock.write_lock ();
+  next_thread = list_of_threads;
+  list_of_threads = this;
+  number_of_threads++;
+  number_of_threads_changed(number_of_threads - 1, number_of_threads);
+  reap_threads ();
+  serial_lock.write_unlock ();
+
+  if (pthread_once(&thr_release_once, thread_exit_init))
+    GTM_fatal("Initializing thread release TLS key failed.");
+  // Any non-null value is sufficient to trigger destruction of this
+  // transaction when the current thread terminates.
+  if (pthread_setspecific(thr_release_key, this))
+    GTM_fatal("Setting thread release TLS key failed.");
+}
+
+static inline uint32_t
+choose_code_path(uint32_t prop, abi_dispatch *disp)
+{
+  // [transmem] The inevitable transaction runs nested transactions that only
+  // have uninstrumented code (see method-serial.cc).
+  if ((prop & pr_uninstrumentedCode)
+      && (disp->can_run_uninstrumented_code()
+          || !(prop & pr_instrumentedCode)))
+    return a_runUninstrumentedCode;
+  else
+    return a_runInstrumentedCode;
+}
+
+uint32_t
+GTM::gtm_thread::begin_transaction (uint32_t prop, const gtm_jmpbuf *jb)
+{
+  static const _ITM_transactionId_t tid_block_size = 1 << 16;
+
+  gtm_thread *tx;
+  abi_dispatch *disp;
+  uint32_t ret;
+
+  // ??? pr_undoLogCode is not properly defined in the ABI. Are barriers
+  // omitted because they are not necessary (e.g., a transaction on thread-
+  // local data) or because the compiler thinks that some kind of global
+  // synchronization might perform better?
+  if (unlikely(prop & pr_undoLogCode))
+    GTM_fatal("pr_undoLogCode not supported");
+
+  tx = gtm_thr();
+  if (unlikely(tx == NULL))
+    {
+      // Create the thread object. The constructor will also set up automatic
+      // deletion on thread termination.
+      tx = new gtm_thread();
+      set_gtm_thr(tx);
+    }
+
+  if (tx->nesting > 0)
+    {
+      // This is a nested transaction.
+      // Check prop compatibility:
+      // The ABI requires pr_hasNoFloatUpdate, pr_hasNoVectorUpdate,
+      // pr_hasNoIrrevocable, pr_aWBarriersOmitted, pr_RaRBarriersOmitted, and
+      // pr_hasNoSimpleReads to hold for the full dynamic scope of a
+      // transaction. We could check that these are set for the nested
+      // transaction if they are also set for the parent transaction, but the
+      // ABI does not require these flags to be set if they could be set,
+      // so the check could be too strict.
+      // ??? For pr_readOnly, lexical or dynamic scope is unspecified.
+
+      if (prop & pr_hasNoAbort)
+    {
+      // We can use flat nesting, so elide this transaction.
+      if (!(prop & pr_instrumentedCode))
+        {
+          if (!(tx->state & STATE_SERIAL) ||
+          !(tx->state & STATE_IRREVOCABLE))
+        tx->serialirr_mode();
+        }
+      // Increment nesting level after checking that we have a method that
+      // allows us to continue.
+      tx->nesting++;
+      return choose_code_path(prop, abi_disp());
+    }
+
+      // The transaction might abort, so use closed nesting if possible.
+      // pr_hasNoAbort has lexical scope, so the compiler should really have
+      // generated an instrumented code path.
+      assert(prop & pr_instrumentedCode);
+
+      // [transmem] A serial-irrevocable transaction cannot roll back.  It
+      // may be one only because it restarted serially (see
+      // decide_retry_strategy()), which assumes that it cannot cancel, since
+      // it only checks the properties of the outermost transaction.  We hold
+      // the serial lock, so continue in serial mode, which logs the writes
+      // from here on, so that this transaction can be rolled back.
+      if ((tx->state & STATE_IRREVOCABLE) && (tx->state & STATE_SERIAL))
+        {
+          tx->state = STATE_SERIAL;
+          set_abi_disp (dispatch_serial ());
+        }
+
+      // Create a checkpoint of the current transaction.
+      gtm_transaction_cp *cp = tx->parent_txns.push();
+      cp->save(tx);
+
+      // Check whether the current method actually supports closed nesting.
+      // If not, we assume that actual aborts are infrequent, and rather
+      // restart in _ITM_abortTransaction when we really have to.
+      disp = abi_disp();
+    }
+  else
+    {
+      // Outermost transaction
+      // [transmem] The call site, for read-only prediction (see retry.cc)
+#ifdef __x86_64__
+      tx->site = jb->rip;
+#else
+      tx->site = jb->eip;
+#endif
+      if (unlikely (profile_enabled))
+        tx->profile_begin ();
+      disp = tx->decide_begin_dispatch (prop);
+      set_abi_disp (disp);
+    }
+
+  // Initialization that is common for outermost and nested transactions.
+  tx->prop = prop;
+  tx->nesting++;
+
+  tx->jb = *jb;
+
+  // As long as we have not exhausted a previously allocated block of TIDs,
+  // we can avoid an atomic operation on a shared cacheline.
+  if (tx->local_tid & (tid_block_size - 1))
+    tx->id = tx->local_tid++;
+  else
+    {
+#ifdef HAVE_64BIT_SYNC_BUILTINS
+      // We don't really care which block of TIDs we get but only that we
+      // acquire one atomically; therefore, relaxed memory order is
+      // sufficient.
+      tx->id = global_tid.fetch_add(tid_block_size, memory_order_relaxed);
+      tx->local_tid = tx->id + 1;
+#else
+      pthread_mutex_lock (&global_tid_lock);
+      global_tid += tid_block_size;
+      tx->id = global_tid;
+      tx->local_tid = tx->id + 1;
+      pthread_mutex_unlock (&global_tid_lock);
+#endif
+    }
+
+  // Run dispatch-specific restart code. Retry until we succeed.
+  // [transmem] A closed nested transaction continues with the snapshot of
+  // its parent.
+  GTM::gtm_restart_reason rr;
+  if (tx->parent_txns.size() == 0)
+    while ((rr = disp->begin_or_restart()) != NO_RESTART)
+      {
+        tx->decide_retry_strategy(rr);
+        disp = abi_disp();
+      }
+
+  // Determine the code path to run. Only irrevocable transactions cannot be
+  // restarted, so all other transactions need to save live variables.
+  ret = choose_code_path(prop, disp);
+  if (!(tx->state & STATE_IRREVOCABLE))
+    ret |= a_saveLiveVariables;
+  return ret;
+}
+
+void
+GTM::gtm_transaction_cp::save(gtm_thread* tx)
+{
+  // [transmem] Move the parent's deltas to the redo log, so that the scope
+  // covers all of its writes (see delta.cc).
+  while (!tx->deltas.empty())
+    tx->fold_deltas (tx->deltas.entries.begin()->addr, sizeof(uint64_t));
+
+  // Save everything that we might have to restore on restarts or aborts.
+  jb = tx->jb;
+  undolog_size = tx->undolog.size();
+  redolog_scope = tx->redolog.begin_scope();
+  alloc_scope = tx->arena.begin_scope();
+  user_actions_size = tx->user_actions.size();
+  id = tx->id;
+  prop = tx->prop;
+  cxa_catch_count = tx->cxa_catch_count;
+  cxa_unthrown = tx->cxa_unthrown;
+  nesting = tx->nesting;
+}
+
+void
+GTM::gtm_transaction_cp::commit(gtm_thread* tx)
+{
+  // Restore state that is not persistent across commits. Exception handling,
+  // information, nesting level, and any logs do not need to be restored on
+  // commits of nested transactions. The scopes of the logs are merged into
+  // the parent's.
+  tx->jb = jb;
+  tx->redolog.commit_scope(redolog_scope);
+  tx->arena.commit_scope();
+  tx->id = id;
+  tx->prop = prop;
+}
+
+void
+GTM::gtm_thread::rollback (gtm_transaction_cp *cp, bool aborting)
+{
+  // The undo log is special in that it used for both thread-local and shared
+  // data. Because of the latter, we have to roll it back before any
+  // dispatch-specific rollback (which handles synchronization with other
+  // transactions).
+  undolog.rollback (this, cp ? cp->undolog_size : 0);
+
+  // Perform dispatch-specific rollback.  [transmem] A closed nested
+  // transaction only has to drop its scope of the redo log, since nothing
+  // that it wrote is visible to other transactions.
+  if (cp)
+    redolog.rollback_scope (cp->redolog_scope);
+  else
+    abi_disp()->rollback ();
+
+  // Roll back all actions that are supposed to happen around the transaction.
+  rollback_user_actions (cp ? cp->user_actions_size : 0);
+  if (cp)
+    arena.rollback_scope (cp->alloc_scope);
+  else
+    commit_allocations (true);
+  revert_cpp_exceptions (cp);
+
+  if (cp)
+    {
+      // We do not yet handle restarts of nested transactions. To do that, we
+      // would have to restore some state (jb, id, prop, nesting) not to the
+      // checkpoint but to the transaction that was started from this
+      // checkpoint (e.g., nesting = cp->nesting + 1);
+      assert(aborting);
+      // Roll back the rest of the state to the checkpoint.
+      jb = cp->jb;
+      id = cp->id;
+      prop = cp->prop;
+      nesting = cp->nesting;
+    }
+  else
+    {
+      // Roll back to the outermost transaction.
+      // Restore the jump buffer and transaction properties, which we will
+      // need for the longjmp used to restart or abort the transaction.
+      if (parent_txns.size() > 0)
+        {
+          jb = parent_txns[0].jb;
+          id = parent_txns[0].id;
+          prop = parent_txns[0].prop;
+        }
+      privatizing = false;
+      elastic.reset ();
+      // Reset the transaction. Do not reset this->state, which is handled by
+      // the callers. Note that if we are not aborting, we reset the
+      // transaction to the point after having executed begin_transaction
+      // (we will return from it), so the nesting level must be one, not zero.
+      nesting = (aborting ? 0 : 1);
+      parent_txns.clear();
+    }
+
+  if (this->eh_in_flight)
+    {
+      _Unwind_DeleteException ((_Unwind_Exception *) this->eh_in_flight);
+      this->eh_in_flight = NULL;
+    }
+}
+
+void ITM_REGPARM
+_ITM_abortTransaction (_ITM_abortReason reason)
+{
+  gtm_thread *tx = gtm_thr();
+
+  assert (reason == userAbort || reason == (userAbort | outerAbort));
+  assert ((tx->prop & pr_hasNoAbort) == 0);
+
+  if (tx->state & gtm_thread::STATE_IRREVOCABLE)
+    abort ();
+
+  // Roll back to innermost transaction.
+  if (tx->parent_txns.size() > 0 && !(reason & outerAbort))
+    {
+      // If the current method does not support closed nesting but we are
+      // nested and must only roll back the innermost transaction, then
+      // restart with a method that supports closed nesting.
+      abi_dispatch *disp = abi_disp();
+      if (!disp->closed_nesting())
+        tx->restart(RESTART_CLOSED_NESTING);
+
+      // The innermost transaction is a closed nested transaction.
+      gtm_transaction_cp *cp = tx->parent_txns.pop();
+      uint32_t longjmp_prop = tx->prop;
+      gtm_jmpbuf longjmp_jb = tx->jb;
+
+      tx->rollback (cp, true);
+
+      // Jump to nested transaction (use the saved jump buffer).
+      GTM_longjmp (a_abortTransaction | a_restoreLiveVariables,
+                   &longjmp_jb, longjmp_prop);
+    }
+
+      // There is no nested transaction or an abort of the outermost
+      // transaction was requested, so roll back to the outermost transaction.
+      tx->rollback (0, true);
+
+      // Aborting an outermost transaction finishes execution of the whole
+      // transaction. Therefore, reset transaction state.
+      if (tx->state & gtm_thread::STATE_SERIAL)
+    gtm_thread::serial_lock.write_unlock ();
+      else
+    gtm_thread::serial_lock.read_unlock (tx);
+      tx->state = 0;
+      if (tx->cm_priority)
+        tx->cm_release_priority ();
+
+      GTM_longjmp (a_abortTransaction | a_restoreLiveVariables,
+           &tx->jb, tx->prop);
+}
+
+bool
+GTM::gtm_thread::trycommit ()
+{
+  nesting--;
+
+  // Skip any real commit for elided transactions.
+  if (nesting > 0 && (parent_txns.size() == 0 ||
+      nesting > parent_txns[parent_txns.size() - 1].nesting))
+    return true;
+
+  if (nesting > 0)
+    {
+      // Commit of a closed-nested transaction. Remove one checkpoint and add
+      // any effects of this transaction to the parent transaction.
+      gtm_transaction_cp *cp = parent_txns.pop();
+      cp->commit(this);
+      return true;
+    }
+
+  // [transmem] Measure the read and write sets for the algorithm selection
+  // monitor now, since the dispatch clears its logs when it commits.  To
+  // compare methods, we count in 16-byte stripes, which is what one orec
+  // covers in the readlog and writelog; a redo log slab is 4 stripes.
+  // Serial transactions say nothing about how the STMs would fare.
+  bool sample = adapt_enabled && !(state & STATE_SERIAL);
+  size_t reads = 0, writes = 0;
+  if (sample)
+    {
+      reads = readlog.size() + valuelog.size() / 16;
+      writes = writelog.size() + redolog.slabcount() * 4;
+    }
+
+  // [transmem] Remember whether the call site wrote (see retry.cc).  The
+  // dispatch clears its logs when it commits, so check them now.  The
+  // read-only variants restart if the transaction writes, so there is
+  // nothing to learn from them, and neither is there from the inevitable
+  // transaction, which writes in place.
+  bool note_site = !(state & (STATE_SERIAL | STATE_IRREVOCABLE))
+    && !abi_disp()->read_only();
+  bool read_only = redolog.isEmpty() && deltas.empty() && writelog.size() == 0;
+
+  // [transmem] Measure the read and write sets for the profile now, since
+  // the dispatch clears its logs when it commits.
+  size_t profile_reads = 0, profile_writes = 0;
+  if (unlikely (profile_enabled))
+    {
+      profile_reads = readlog.size() + valuelog.size() / sizeof (gtm_word);
+      profile_writes = writelog.size() + redolog.slabcount()
+        + deltas.entries.size();
+    }
+
+  // Commit of an outermost transaction.  [transmem] The reclamation
+  // generation cannot change while we are active (see reclaim.cc).
+  gtm_word priv_time = 0;
+  gtm_word generation = reclaim_generation.load (memory_order_relaxed);
+  if (abi_disp()->trycommit (priv_time))
+    {
+      // The transaction is now inactive. Everything that we still have to do
+      // will not synchronize with other transactions anymore.
+      if (state & gtm_thread::STATE_SERIAL)
+        {
+          gtm_thread::serial_lock.write_unlock ();
+          // There are no other active transactions, so there's no need to
+          // enforce privatization safety.
+          priv_time = 0;
+        }
+      else
+    gtm_thread::serial_lock.read_unlock (this);
+      // [transmem] Let the transactions that wait for us go ahead.  We may
+      // have become serial since we took the token (see serialirr_mode()).
+      if (inevitable_owner.load (memory_order_relaxed) == this)
+        release_inevitable ();
+      if (unlikely (profile_enabled))
+        profile_commit (profile_reads, profile_writes);
+      state = 0;
+
+      // We can commit the undo log after dispatch-specific commit and after
+      // making the transaction inactive because we only have to reset
+      // gtm_thread state.
+      undolog.commit ();
+      // Reset further transaction state.
+      cxa_catch_count = 0;
+      cxa_unthrown = NULL;
+      restart_total = 0;
+      if (note_site)
+        note_read_only (read_only);
+      if (cm_policy != CM_IMMEDIATE)
+        cm_commit ();
+      // [transmem] Let the writers that yielded to us go ahead.
+      if (cm_priority)
+        cm_release_priority ();
+
+      // Ensure privatization safety, if necessary.  [transmem] If we skip
+      // quiescence, memory that we freed is reclaimed after RECLAIM_TIME.
+      gtm_word reclaim_time = priv_time;
+      if (priv_time && skip_quiescence ())
+        priv_time = 0;
+      privatizing = false;
+      elastic.reset ();
+      mv_writer = false;
+      if (priv_time)
+        {
+          // There must be a seq_cst fence between the following loads of the
+          // other transactions' shared_state and the dispatch-specific stores
+          // that signal updates by this transaction (e.g., lock
+          // acquisitions).  This ensures that if we read prior to other
+          // reader transactions setting their shared_state to 0, then those
+          // readers will observe our updates.  We can reuse the seq_cst fence
+          // in serial_lock.read_unlock() however, so we don't need another
+          // one here.
+          quiesce (priv_time);
+        }
+
+      // After ensuring privatization safety, we execute potentially
+      // privatizing actions (e.g., calling free()). User actions are first.
+      commit_user_actions ();
+      if (priv_time)
+        reclaim_time = 0;
+      commit_allocations (false, reclaim_time, generation);
+
+      if (sample)
+        adapt_commit (reads, writes);
+
+      return true;
+    }
+  return false;
+}
+
+void ITM_NORETURN
+GTM::gtm_thread::restart (gtm_restart_reason r, bool finish_serial_upgrade)
+{
+  // Roll back to outermost transaction. Do not reset transaction state because
+  // we will continue executing this transaction.
+  rollback ();
+
+  // If we have to restart while an upgrade of the serial lock is happening,
+  // we need to finish this here, after rollback (to ensure privatization
+  // safety despite undo writes) and before deciding about the retry strategy
+  // (which could switch to/from serial mode).
+  // [transmem] The dispatch may also restart us from within trycommit()
+  // during the upgrade (e.g., lazy when it cannot lock its orecs), in which
+  // case we are serial but still marked as a reader.  Retry as
+  // serialirr_mode() would have, instead of running the dispatch again while
+  // holding the serial lock.
+  if (!finish_serial_upgrade && (state & STATE_SERIAL)
+      && shared_state.load (memory_order_relaxed) != ~(gtm_word)0)
+    {
+      finish_serial_upgrade = true;
+      r = RESTART_SERIAL_IRR;
+    }
+  if (finish_serial_upgrade)
+    gtm_thread::serial_lock.write_upgrade_finish(this);
+
+  decide_retry_strategy (r);
+
+  // Run dispatch-specific restart code. Retry until we succeed.
+  abi_dispatch* disp = abi_disp();
+  GTM::gtm_restart_reason rr;
+  while ((rr = disp->begin_or_restart()) != NO_RESTART)
+    {
+      decide_retry_strategy(rr);
+      disp = abi_disp();
+    }
+
+  // [transmem] We have a new snapshot, which may be what a committer in
+  // quiesce() is waiting for.
+  atomic_thread_fence (memory_order_seq_cst);
+  quiesce_notify ();
+
+  GTM_longjmp (choose_code_path(prop, disp) | a_restoreLiveVariables,
+           &jb, prop);
+}
+
+void ITM_REGPARM
+_ITM_commitTransaction(void)
+{
+  gtm_thread *tx = gtm_thr();
+  if (!tx->trycommit ())
+    tx->restart (RESTART_VALIDATE_COMMIT);
+}
+
+void ITM_REGPARM
+_ITM_commitTransactionEH(void *exc_ptr)
+{
+  gtm_thread *tx = gtm_thr();
+  if (!tx->trycommit ())
+    {
+      tx->eh_in_flight = exc_ptr;
+      tx->restart (RESTART_VALIDATE_COMMIT);
+    }
+}
@@ -0,0 +1,107 @@
+#include "libitm_i.h"
+
+// [transmem] Commutative updates (_ITM_addU8 and _ITM_addF8)
+//
+// Counters that many transactions increment (statistics, reference counts,
+// ticket dispensers) make otherwise disjoint transactions conflict, because
+// each increment reads the counter.  These functions instead log the delta
+// (see delta.h), and methods that support it (commutative_updates()) add it
+// to memory at commit, while they own the word: NOrec under its sequence
+// lock, lazy after acquiring the orecs.  Thus, two transactions that only add
+// to a word both commit.
+//
+// A delta is folded into the redo log, as a read and a write of the word, as
+// soon as the transaction reads or writes the word, so that it sees its own
+// updates.  Adds are done through the barriers right away if the method does
+// not support deltas (including the read-only variants, which restart), if
+// the word is unaligned, on the stack or in the redo log already, in serial
+// mode, and in closed nested transactions, which fold the deltas of their
+// parent when they begin, so that rolling them back only has to roll back the
+// redo log.  Outside of transactions, they are plain adds.
+//
+// The deltas of a transaction to a double are summed before they are added
+// to memory, which may round differently than adding them one at a time.
+
+using namespace GTM;
+
+namespace {
+
+// Add BITS to the word at ADDR with reads and writes through DISP.
+void
+add_through (abi_dispatch *disp, uint64_t *addr, uint64_t bits,
+             gtm_delta_kind kind)
+{
+  if (kind == DELTA_U8)
+    disp->ITM_WU8 (addr, disp->ITM_RU8 (addr) + bits);
+  else
+    {
+      double *p = (double *) addr;
+      double d;
+      __builtin_memcpy (&d, &bits, sizeof (d));
+      disp->ITM_WD (p, disp->ITM_RD (p) + d);
+    }
+}
+
+void
+add (uint64_t *addr, uint64_t bits, gtm_delta_kind kind)
+{
+  gtm_thread *tx = gtm_thr ();
+  if (tx == 0 || tx->nesting == 0)
+    {
+      *addr = gtm_delta_log::combine (*addr, bits, kind);
+      return;
+    }
+
+  abi_dispatch *disp = abi_disp ();
+  uint8_t *a = (uint8_t *) addr;
+  uint64_t v;
+  if (!disp->commutative_updates ()
+      || tx->parent_txns.size () != 0
+      || ((uintptr_t) addr & 7) != 0
+      || (a <= (uint8_t *) mask_stack_top (tx)
+          && a + sizeof (uint64_t) > (uint8_t *) mask_stack_bottom (tx))
+      || (!tx->redolog.isEmpty () && tx->redolog.find (addr, v) != 0))
+    {
+      add_through (disp, addr, bits, kind);
+      return;
+    }
+
+  if (!tx->deltas.add (addr, bits, kind))
+    {
+      // The word has a delta of the other type.
+      tx->fold_deltas (addr, sizeof (uint64_t));
+      add_through (disp, addr, bits, kind);
+    }
+}
+
+} // anon namespace
+
+// Move the deltas that overlap [ADDR, ADDR + LEN) to the redo log.  Called by
+// the barriers of methods that support deltas, before they access the range.
+void
+gtm_thread::fold_deltas (const void *addr, size_t len)
+{
+  abi_dispatch *disp = abi_disp ();
+  gtm_delta *d;
+  while ((d = deltas.find (addr, len)) != 0)
+    {
+      // Remove the delta first, so that the barriers do not fold it again.
+      gtm_delta f = *d;
+      deltas.remove (d);
+      add_through (disp, f.addr, f.bits, f.kind);
+    }
+}
+
+void ITM_REGPARM
+_ITM_addU8 (uint64_t *addr, uint64_t val)
+{
+  add (addr, val, DELTA_U8);
+}
+
+void ITM_REGPARM
+_ITM_addF8 (double *addr, double val)
+{
+  uint64_t bits;
+  __builtin_memcpy (&bits, &val, sizeof (bits));
+  add ((uint64_t *) addr, bits, DELTA_F8);
+}
@@ -0,0 +1,131 @@
+#ifndef LIBITM_DELTA_H
+#define LIBITM_DELTA_H 1
+
+// [transmem] The delta log used by _ITM_addU8 and _ITM_addF8 (see delta.cc)
+//
+// A commutative update adds a value to an aligned 8-byte word without reading
+// it, so it does not conflict with other transactions that add to the same
+// word.  The transaction logs the sum of its deltas per word, and the TM
+// method adds them to memory while it writes back the redo log.  A word is
+// never both in the delta log and in the redo log: a transaction that reads or
+// writes a word with a pending delta first folds the delta into the redo log
+// (see gtm_thread::fold_deltas()).
+//
+// The barriers check the filter, which has a bit for each word with a
+// pending delta (modulo 64), so that they only search the log if an access
+// may overlap a delta.  The filter is zero iff the log is empty.
+
+namespace GTM HIDDEN {
+
+enum gtm_delta_kind
+{
+  DELTA_U8, // uint64_t, wraps around
+  DELTA_F8  // double
+};
+
+struct gtm_delta
+{
+  uint64_t *addr;
+  // The sum of the deltas, as a uint64_t or as the bits of a double
+  uint64_t bits;
+  gtm_delta_kind kind;
+};
+
+struct gtm_delta_log
+{
+  vector<gtm_delta> entries;
+  uint64_t filter;
+
+  gtm_delta_log() : filter(0) { }
+
+  bool empty() const { return filter == 0; }
+
+  // The filter bits of the words that [ADDR, ADDR + LEN) overlaps
+  static uint64_t filter_bits (const void *addr, size_t len)
+  {
+    uintptr_t first = (uintptr_t) addr >> 3;
+    uintptr_t n = (((uintptr_t) addr + len - 1) >> 3) - first + 1;
+    if (n >= 64)
+      return ~(uint64_t) 0;
+    uint64_t m = ((uint64_t) 1 << n) - 1;
+    unsigned s = first & 63;
+    return (m << s) | (m >> ((64 - s) & 63));
+  }
+
+  // Returns false if no delta overlaps [ADDR, ADDR + LEN).
+  bool may_overlap (const void *addr, size_t len) const
+  {
+    return filter != 0 && (filter & filter_bits (addr, len)) != 0;
+  }
+
+  // Returns the first delta that overlaps [ADDR, ADDR + LEN), or NULL.
+  gtm_delta *find (const void *addr, size_t len) const
+  {
+    if (!may_overlap (addr, len))
+      return 0;
+    const uint8_t *a = (const uint8_t *) addr;
+    for (gtm_delta *d = entries.begin (), *de = entries.end (); d != de; ++d)
+      if ((const uint8_t *) d->addr < a + len
+          && (const uint8_t *) (d->addr + 1) > a)
+        return d;
+    return 0;
+  }
+
+  // Add BITS to the delta of the word at ADDR.  Returns false if the word
+  // has a delta of another kind.
+  bool add (uint64_t *addr, uint64_t bits, gtm_delta_kind kind)
+  {
+    gtm_delta *d = find (addr, sizeof (uint64_t));
+    if (d == 0)
+      {
+        d = entries.push ();
+        d->addr = addr;
+        d->bits = bits;
+        d->kind = kind;
+        filter |= filter_bits (addr, sizeof (uint64_t));
+        return true;
+      }
+    if (d->kind != kind)
+      return false;
+    d->bits = combine (d->bits, bits, kind);
+    return true;
+  }
+
+  // Remove D from the log.
+  void remove (gtm_delta *d)
+  {
+    *d = *entries.pop ();
+    filter = 0;
+    for (gtm_delta *i = entries.begin (), *ie = entries.end (); i != ie; ++i)
+      filter |= filter_bits (i->addr, sizeof (uint64_t));
+  }
+
+  // Add the deltas to memory.  The caller must own the words.
+  void apply () const
+  {
+    for (gtm_delta *d = entries.begin (), *de = entries.end (); d != de; ++d)
+      *d->addr = combine (*d->addr, d->bits, d->kind);
+  }
+
+  void clear ()
+  {
+    entries.clear ();
+    filter = 0;
+  }
+
+  static uint64_t combine (uint64_t a, uint64_t b, gtm_delta_kind kind)
+  {
+    if (kind == DELTA_U8)
+      return a + b;
+    double x, y;
+    __builtin_memcpy (&x, &a, sizeof (x));
+    __builtin_memcpy (&y, &b, sizeof (y));
+    x += y;
+    __builtin_memcpy (&a, &x, sizeof (a));
+    return a;
+  }
+};
+
+} // namespace GTM
+
+#endif // LIBITM_DELTA_H
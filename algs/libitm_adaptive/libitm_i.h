@@ -0,0 +1,667 @@
+/* Copyright (C) 2008-2015 Free Software Foundation, Inc.
+   Contributed by Richard Henderson <rth@redhat.com>.
+
+   This file is part of the GNU Transactional Memory Library (libitm).
+
+   Libitm is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   Libitm is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   Under Section 7 of GPL version 3, you are granted additional
+   permissions described in the GCC Runtime Library Exception, version
+   3.1, as published by the Free Software Foundation.
+
+   You should have received a copy of the GNU General Public License and
+   a copy of the GCC Runtime Library Exception along with this program;
+   see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* The following are internal implementation functions and definitions.
+   To distinguish them from those defined by the Intel ABI, they all
+   begin with GTM/gtm.  */
+
+#ifndef LIBITM_I_H
+#define LIBITM_I_H 1
+
+#include "libitm.h"
+#include "config.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unwind.h>
+#include "local_type_traits"
+#include "local_atomic"
+
+/* Don't require libgcc_s.so for exceptions.  */
+extern void _Unwind_DeleteException (_Unwind_Exception*) __attribute__((weak));
+
+
+#include "common.h"
+
+// [transmem] include hash write set for lazy redo log
+#include "wset.h"
+
+namespace GTM HIDDEN {
+
+using namespace std;
+
+// A helper template for accessing an unsigned integral of SIZE bytes.
+template<size_t SIZE> struct sized_integral { };
+template<> struct sized_integral<1> { typedef uint8_t type; };
+template<> struct sized_integral<2> { typedef uint16_t type; };
+template<> struct sized_integral<4> { typedef uint32_t type; };
+template<> struct sized_integral<8> { typedef uint64_t type; };
+
+typedef unsigned int gtm_word __attribute__((mode (word)));
+
+// These values are given to GTM_restart_transaction and indicate the
+// reason for the restart.  The reason is used to decide what STM
+// implementation should be used during the next iteration.
+enum gtm_restart_reason
+{
+  RESTART_REALLOCATE,
+  RESTART_LOCKED_READ,
+  RESTART_LOCKED_WRITE,
+  RESTART_VALIDATE_READ,
+  RESTART_VALIDATE_WRITE,
+  RESTART_VALIDATE_COMMIT,
+  RESTART_PRIORITY,
+  RESTART_INEVITABLE,
+  RESTART_SERIAL_IRR,
+  RESTART_NOT_READONLY,
+  RESTART_CLOSED_NESTING,
+  RESTART_INIT_METHOD_GROUP,
+  NUM_RESTARTS,
+  NO_RESTART = NUM_RESTARTS
+};
+
+// [transmem] The contention management policies, selected with the ITM_CM
+// environment variable.  They decide how long a transaction waits before it
+// restarts, and when it gives up and restarts in serial mode.  See
+// contention.cc.
+enum gtm_cm_policy
+{
+  CM_IMMEDIATE,		// restart at once; go serial after 100 restarts
+  CM_BACKOFF,		// randomized exponential backoff between restarts
+  CM_ADAPTIVE		// backoff, and go serial sooner when aborts are common
+};
+
+// [transmem] True iff R is a restart caused by a conflict with another
+// transaction, which is what the contention manager reacts to.
+inline bool
+restart_is_conflict (gtm_restart_reason r)
+{
+  return r >= RESTART_LOCKED_READ && r <= RESTART_INEVITABLE;
+}
+
+} // namespace GTM
+
+#include "target.h"
+#include "rwlock.h"
+#include "aatree.h"
+#include "cacheline.h"
+#include "stmlock.h"
+#include "dispatch.h"
+#include "containers.h"
+#include "linefilter.h"
+#include "arena.h"
+#include "delta.h"
+#include "orec.h"
+#include "timebase.h"
+#include "version.h"
+
+#ifdef __USER_LABEL_PREFIX__
+# define UPFX UPFX1(__USER_LABEL_PREFIX__)
+# define UPFX1(t) UPFX2(t)
+# define UPFX2(t) #t
+#else
+# define UPFX
+#endif
+
+namespace GTM HIDDEN {
+
+struct gtm_thread;
+
+// An undo log for writes.
+struct gtm_undolog
+{
+  vector<gtm_word> undolog;
+
+  // Log the previous value at a certain address.
+  // The easiest way to inline this is to just define this here.
+  void log(const void *ptr, size_t len)
+  {
+    size_t words = (len + sizeof(gtm_word) - 1) / sizeof(gtm_word);
+    gtm_word *undo = undolog.push(words + 2);
+    memcpy(undo, ptr, len);
+    undo[words] = len;
+    undo[words + 1] = (gtm_word) ptr;
+  }
+
+  void commit () { undolog.clear(); }
+  size_t size() const { return undolog.size(); }
+
+  // In local.cc
+  void rollback (gtm_thread* tx, size_t until_size = 0);
+};
+
+// A validation kernel: returns true iff the LEN bytes at MEM still equal the
+// LEN bytes at LOGGED.  In valuelog.cc and config/x86/x86_avx2.cc.
+typedef bool (*gtm_valuecheck_fn)(const uint8_t *mem, const uint8_t *logged,
+                                  size_t len);
+extern bool valuecheck_scalar(const uint8_t *, const uint8_t *, size_t);
+extern bool valuecheck_avx2(const uint8_t *, const uint8_t *, size_t);
+
+// A value log for value-based validation (i.e., the read set of NOrec).
+// Rather than logging (value, length, address) per read, we keep the values
+// in one contiguous byte array, and describe them with runs of contiguous
+// addresses.  A read that starts where the previous run ended extends that
+// run, so that a traversal of an array or a struct validates with a single
+// long comparison.  A small direct-mapped filter catches repeated reads of
+// the same address, which do not need to be logged twice.
+struct gtm_valuelog
+{
+  // A run of LEN bytes starting at ADDR, whose values are at byte offset POS
+  // of the value array.
+  struct run
+  {
+    const uint8_t *addr;
+    size_t len;
+    size_t pos;
+  };
+
+  // An entry of the duplicate filter.  Only valid if EPOCH is current.
+  struct filter_entry
+  {
+    const void *addr;
+    size_t pos;
+    uint32_t len;
+    uint32_t epoch;
+  };
+  static const size_t FILTER_SIZE = 64;
+
+  vector<run> runs;
+  vector<gtm_word> values;
+  size_t nbytes;
+  filter_entry filter[FILTER_SIZE];
+  uint32_t epoch;
+
+  gtm_valuelog() : nbytes(0), epoch(1)
+  {
+    memset(filter, 0, sizeof(filter));
+  }
+
+  const uint8_t *bytes() const { return (const uint8_t *) values.begin(); }
+
+  // Log the value read from PTR, where the caller's copy of the value is at
+  // CALLER_PTR.  The easiest way to inline this is to just define this here.
+  void log_read(const void *ptr, size_t len, const void *caller_ptr)
+  {
+    // filter out repeated reads of an address with an unchanged value
+    filter_entry &f = filter[((uintptr_t) ptr >> 3) & (FILTER_SIZE - 1)];
+    if (f.epoch == epoch && f.addr == ptr && f.len == len
+        && __builtin_memcmp(bytes() + f.pos, caller_ptr, len) == 0)
+      return;
+
+    // append the value to the value array
+    size_t pos = nbytes;
+    size_t have = values.size() * sizeof(gtm_word);
+    if (nbytes + len > have)
+      values.push((nbytes + len - have + sizeof(gtm_word) - 1)
+                  / sizeof(gtm_word));
+    memcpy((uint8_t *) values.begin() + pos, caller_ptr, len);
+    nbytes += len;
+
+    // extend the last run if this read is adjacent to it, else start a new
+    // run
+    run *last = runs.size() ? &runs[runs.size() - 1] : 0;
+    if (last && last->addr + last->len == (const uint8_t *) ptr)
+      last->len += len;
+    else
+      {
+        run *r = runs.push();
+        r->addr = (const uint8_t *) ptr;
+        r->len = len;
+        r->pos = pos;
+      }
+
+    f.addr = ptr;
+    f.pos = pos;
+    f.len = len;
+    f.epoch = epoch;
+  }
+
+  // Clear the filter in constant time by moving to a new epoch.
+  void clear_filter ()
+  {
+    if (unlikely(++epoch == 0))
+      {
+        memset(filter, 0, sizeof(filter));
+        epoch = 1;
+      }
+  }
+
+  // Clear the log.
+  void commit ()
+  {
+    runs.clear();
+    values.clear();
+    nbytes = 0;
+    clear_filter();
+  }
+  size_t size() const { return nbytes; }
+
+  // [transmem] Drop the values at byte offsets [FROM, TO) of the value array
+  // from the log (see abi_dispatch::release_reads()).  In valuelog.cc.
+  void release (size_t from, size_t to);
+
+  // Returns true iff every logged location still holds the logged value.
+  // In valuelog.cc.
+  bool valuecheck();
+  bool valuecheck(gtm_valuecheck_fn kernel);
+};
+
+// An entry of a read or write log.  Used by multi-lock TM methods.
+struct gtm_rwlog_entry
+{
+  atomic<gtm_word> *orec;
+  gtm_word value;
+};
+
+// [transmem] An orec that a lazy transaction locks at commit, and one of the
+// stripes that it writes and that map to the orec.
+struct gtm_commit_orec
+{
+  size_t orec;
+  uintptr_t stripe;
+};
+
+// [transmem] The state of an elastic traversal (see elastic.cc).  MARKS are
+// the read set sizes (see abi_dispatch::read_set_mark()) after each of the
+// last STEPS steps, oldest first, and FLOOR is the size when the traversal
+// began.  WINDOW is 0 if the transaction is not in a traversal.
+struct gtm_elastic
+{
+  static const size_t MAX_WINDOW = 16;
+
+  size_t window;
+  size_t steps;
+  size_t floor;
+  size_t marks[MAX_WINDOW];
+
+  gtm_elastic() : window(0), steps(0), floor(0) { }
+  void reset() { window = 0; }
+};
+
+// Contains all thread-specific data required by the entire library.
+// [transmem] Contains all checkpoint data that is needed to roll back a
+// closed nested transaction, i.e., the state of its parent when it began.
+// Under methods that support closed nesting (see
+// abi_dispatch::closed_nesting()), the parent's writes are in the redo log or
+// in the undo log, and the redo log keeps a scope for each nested transaction
+// (see wset.h).  Reads stay in the read set when a nested transaction is
+// rolled back: the parent continues because the nested transaction was
+// cancelled, so it depends on what the latter read.
+struct gtm_transaction_cp
+{
+  gtm_jmpbuf jb;
+  size_t undolog_size;
+  WriteSet::scope redolog_scope;
+  gtm_alloc_arena::scope alloc_scope;
+  size_t user_actions_size;
+  _ITM_transactionId_t id;
+  uint32_t prop;
+  uint32_t cxa_catch_count;
+  void *cxa_unthrown;
+  // Nesting level of this checkpoint (1 means that this is a checkpoint of
+  // the outermost transaction).
+  uint32_t nesting;
+
+  void save(gtm_thread* tx);
+  void commit(gtm_thread* tx);
+};
+
+// [transmem] A thread's per-call-site profiles (see profile.cc)
+struct gtm_profile;
+struct gtm_site_profile;
+
+// This includes all data relevant to a single transaction. Because most
+// thread-specific data is about the current transaction, we also refer to
+// the transaction-specific parts of gtm_thread as "the transaction" (the
+// same applies to names of variables and arguments).
+// All but the shared part of this data structure are thread-local data.
+// gtm_thread could be split into transaction-specific structures and other
+// per-thread data (with those parts then nested in gtm_thread), but this
+// would make it harder to later rearrange individual members to optimize data
+// accesses. Thus, for now we keep one flat object, and will only split it if
+// the code gets too messy.
+struct gtm_thread
+{
+
+  struct user_action
+  {
+    _ITM_userCommitFunction fn;
+    void *arg;
+    bool on_commit;
+    _ITM_transactionId_t resuming_id;
+  };
+
+  // The jump buffer by which GTM_longjmp restarts the transaction.
+  // This field *must* be at the beginning of the transaction.
+  gtm_jmpbuf jb;
+
+  // Data used by local.c for the undo log for both local and shared memory.
+  gtm_undolog undolog;
+  // this is the read set
+  gtm_valuelog valuelog;
+
+  // Read and write logs.  Used by multi-lock TM methods.
+  vector<gtm_rwlog_entry> readlog;
+  vector<gtm_rwlog_entry> writelog;
+  // [transmem] The orecs that a lazy commit locks, in lock order.
+  vector<gtm_commit_orec> commit_orecs;
+
+  // [transmem] Redo log
+  WriteSet redolog;
+  // [transmem] Pending commutative updates (see delta.h)
+  gtm_delta_log deltas;
+
+  // Data used by alloc.c for the malloc/free undo log.  [transmem] This is
+  // a per-thread arena now (see arena.h).
+  gtm_alloc_arena arena;
+  // [transmem] Set if the transaction freed memory (see alloc.cc)
+  bool freed_memory;
+  // [transmem] The next exited thread whose gtm_thread waits to be freed
+  // (see reclaim.cc)
+  gtm_thread *next_dead;
+  // [transmem] Set by _ITM_markPrivatizing() (see quiesce.cc)
+  bool privatizing;
+  // [transmem] The current elastic traversal (see elastic.cc)
+  gtm_elastic elastic;
+  // [transmem] Set if the transaction read old versions (see version.h), and
+  // if it must not, because it turned out to be a writer
+  bool mv_snapshot;
+  bool mv_writer;
+
+  // Data used by useraction.c for the user-defined commit/abort handlers.
+  vector<user_action> user_actions;
+
+  // [transmem] Checkpoints of the parents of the current closed nested
+  // transaction, outermost first
+  vector<gtm_transaction_cp> parent_txns;
+
+  // A numerical identifier for this transaction.
+  _ITM_transactionId_t id;
+
+  // The _ITM_codeProperties of this transaction as given by the compiler.
+  uint32_t prop;
+  // [transmem] The call site of the outermost transaction (see retry.cc)
+  uintptr_t site;
+
+  // The nesting depth for subsequently started transactions. This variable
+  // will be set to 1 when starting an outermost transaction.
+  uint32_t nesting;
+
+  // Set if this transaction owns the serial write lock.
+  // Can be reset only when restarting the outermost transaction.
+  static const uint32_t STATE_SERIAL    = 0x0001;
+  // Set if the serial-irrevocable dispatch table is installed.
+  // Implies that no logging is being done, and abort is not possible.
+  // Can be reset only when restarting the outermost transaction.
+  static const uint32_t STATE_IRREVOCABLE = 0x0002;
+
+  // A bitmask of the above.
+  uint32_t state;
+
+  // In order to reduce cacheline contention on global_tid during
+  // beginTransaction, we allocate a block of 2**N ids to the thread
+  // all at once.  This number is the next value to be allocated from
+  // the block, or 0 % 2**N if no such block is allocated.
+  _ITM_transactionId_t local_tid;
+
+  // Data used by eh_cpp.c for managing exceptions within the transaction.
+  uint32_t cxa_catch_count;
+  void *cxa_unthrown;
+  void *eh_in_flight;
+
+  // Data used by retry.c for deciding what STM implementation should
+  // be used for the next iteration of the transaction.
+  // Only restart_total is reset to zero when the transaction commits, the
+  // other counters are total values for all previously executed transactions.
+  uint32_t restart_reason[NUM_RESTARTS];
+  uint32_t restart_total;
+
+  // [transmem] Contention manager state (see contention.cc).  The abort rate
+  // is measured over windows of commits and conflict-induced restarts;
+  // cm_aborts_base is the number of conflicts in restart_reason[] at the
+  // start of the current window, and cm_serial_limit is the restart_total
+  // at which we fall back to serial mode.
+  uint32_t cm_seed;
+  uint32_t cm_commits;
+  uint32_t cm_aborts_base;
+  uint32_t cm_serial_limit;
+  // [transmem] True iff this transaction holds the priority token.
+  bool cm_priority;
+  // [transmem] This thread's profiles, the profile of the current call
+  // site, and the time when the transaction began (see profile.cc)
+  gtm_profile *profile;
+  gtm_site_profile *profile_site;
+  uint64_t profile_start;
+
+  // [transmem] Samples for the algorithm selection monitor (see adapt.cc),
+  // accumulated since this thread last published them.  adapt_aborts_base
+  // is the value of cm_conflicts() at that time.
+  uint32_t adapt_commits;
+  uint32_t adapt_writers;
+  uint32_t adapt_aborts_base;
+  uint64_t adapt_reads;
+  uint64_t adapt_writes;
+
+  // *** The shared part of gtm_thread starts here. ***
+  // Shared state is on separate cachelines to avoid false sharing with
+  // thread-local parts of gtm_thread.
+
+  // Points to the next thread in the list of all threads.
+  gtm_thread *next_thread __attribute__((__aligned__(HW_CACHELINE_SIZE)));
+
+  // If this transaction is inactive, shared_state is ~0. Otherwise, this is
+  // an active or serial transaction.
+  atomic<gtm_word> shared_state;
+
+  // The lock that provides access to serial mode.  Non-serialized
+  // transactions acquire read locks; a serialized transaction aquires
+  // a write lock.
+  // Accessed from assembly language, thus the "asm" specifier on
+  // the name, avoiding complex name mangling.
+  static gtm_rwlock serial_lock __asm__(UPFX "gtm_serial_lock");
+
+  // The head of the list of all threads' transactions.
+  static gtm_thread *list_of_threads;
+  // The number of all registered threads.
+  static unsigned number_of_threads;
+
+  // [transmem] The number of committers blocked in quiesce()
+  static atomic<int> quiesce_waiters;
+  // [transmem] The transaction that holds the priority token, or null (see
+  // contention.cc)
+  static atomic<gtm_thread *> priority_owner;
+  // [transmem] The inevitable transaction, or null, and the cache lines that
+  // it has accessed (see method-serial.cc)
+  static atomic<gtm_thread *> inevitable_owner;
+  static gtm_line_filter inevitable_lines;
+  // [transmem] The number of threads that traverse list_of_threads without
+  // holding the serial lock, and the reclamation generation (see reclaim.cc)
+  static atomic<int> list_walkers;
+  static atomic<gtm_word> reclaim_generation;
+  // [transmem] The largest priv_time for which quiesce() has finished; no
+  // active transaction has an older snapshot
+  static atomic<gtm_word> quiesced_time;
+
+  // [transmem] In delta.cc
+  void fold_deltas (const void *, size_t);
+
+  // In alloc.cc
+  void commit_allocations (bool, gtm_word epoch = 0, gtm_word generation = 0);
+  void *allocate (size_t, void *(*)(size_t), void (*)(void *));
+  void record_allocation (void *, void (*)(void *));
+  void forget_allocation (void *, void (*)(void *));
+
+  // In beginend.cc
+  void rollback (gtm_transaction_cp *cp = 0, bool aborting = false);
+  bool trycommit ();
+  void restart (gtm_restart_reason, bool finish_serial_upgrade = false)
+        ITM_NORETURN;
+
+  gtm_thread();
+  ~gtm_thread();
+
+  static void *operator new(size_t);
+  static void operator delete(void *);
+
+  // Invoked from assembly language, thus the "asm" specifier on
+  // the name, avoiding complex name mangling.
+  static uint32_t begin_transaction(uint32_t, const gtm_jmpbuf *)
+  __asm__(UPFX "GTM_begin_transaction") ITM_REGPARM;
+  // In eh_cpp.cc
+  void revert_cpp_exceptions (gtm_transaction_cp *cp = 0);
+
+  // In retry.cc
+  // Must be called outside of transactions (i.e., after rollback).
+  void decide_retry_strategy (gtm_restart_reason);
+  abi_dispatch* decide_begin_dispatch (uint32_t prop);
+  abi_dispatch* decide_inevitable_dispatch (uint32_t prop);
+  // [transmem] Read-only prediction for the current call site (see retry.cc)
+  bool predict_read_only (uint32_t prop) const;
+  void note_read_only (bool read_only) const;
+  void number_of_threads_changed(unsigned previous, unsigned now);
+  // Must be called from serial mode. Does not call set_abi_disp().
+  void set_default_dispatch(abi_dispatch* disp);
+
+  // [transmem] In reclaim.cc
+  void retire_allocations (gtm_word epoch, gtm_word generation);
+  void reclaim ();
+  static void bury (gtm_thread *tx);
+  static void reap_threads ();
+  // Make the limbo batches of all threads safe to reclaim.  Must be called
+  // while holding the serial lock in write mode, whenever the values of
+  // shared_state may start over (e.g., when switching method groups).
+  static void new_reclaim_generation ()
+  {
+    reclaim_generation.fetch_add (1, memory_order_release);
+  }
+
+  // [transmem] In quiesce.cc
+  void quiesce (gtm_word priv_time);
+  static void quiesce_wake ();
+  // Wake committers blocked in quiesce().  Must be called after this
+  // thread's shared_state changed, with a seq_cst fence in between.
+  static void quiesce_notify ()
+  {
+    if (unlikely (quiesce_waiters.load (memory_order_relaxed) != 0))
+      quiesce_wake ();
+  }
+  // [transmem] True iff committing this transaction needs a privatization
+  // time even under a TM method that is otherwise privatization-safe: freed
+  // memory must not be reused (or unmapped) while doomed transactions may
+  // still read it, and user commit actions may free memory, too.  The
+  // former only delays the frees (see reclaim.cc); the latter must wait for
+  // quiescence.
+  bool needs_quiescence () const
+  {
+    return freed_memory || user_actions.size() != 0;
+  }
+  // [transmem] True iff a writer commit may skip quiescence, because the
+  // method is privatization-safe or the program declared that only marked
+  // transactions privatize data.  Freed memory is reclaimed later then.
+  bool skip_quiescence () const;
+
+  // [transmem] In contention.cc
+  void cm_reset ();
+  void cm_backoff ();
+  void cm_commit ();
+  uint32_t cm_conflicts () const;
+  bool cm_take_priority ();
+  void cm_release_priority ();
+  bool cm_priority_expired () const;
+  void cm_yield ();
+  void cm_note_read (const void *, size_t);
+  bool cm_priority_conflict (const void *, size_t) const;
+
+  // [transmem] In profile.cc
+  void profile_begin ();
+  void profile_restart (gtm_restart_reason);
+  void profile_commit (size_t reads, size_t writes);
+  void profile_detach ();
+
+  // [transmem] In adapt.cc
+  void adapt_commit (size_t reads, size_t writes);
+  void adapt_decide ();
+  void adapt_switch (abi_dispatch *disp);
+
+  // In method-serial.cc
+  void serialirr_mode ();
+  bool take_inevitable (bool wait);
+  void release_inevitable ();
+  static void wait_inevitable (gtm_thread *tx);
+
+  // In useraction.cc
+  void rollback_user_actions (size_t until_size = 0);
+  void commit_user_actions ();
+};
+
+} // namespace GTM
+
+#include "tls.h"
+
+namespace GTM HIDDEN {
+
+// An unscaled count of the number of times we should spin attempting to
+// acquire locks before we block the current thread and defer to the OS.
+// This variable isn't used when the standard POSIX lock implementations
+// are used.
+extern uint64_t gtm_spin_count_var;
+
+extern "C" uint32_t GTM_longjmp (uint32_t, const gtm_jmpbuf *, uint32_t)
+  ITM_NORETURN ITM_REGPARM;
+
+extern "C" void GTM_LB (const void *, size_t) ITM_REGPARM;
+
+extern void GTM_error (const char *fmt, ...)
+  __attribute__((format (printf, 1, 2)));
+extern void GTM_fatal (const char *fmt, ...)
+  __attribute__((noreturn, format (printf, 1, 2)));
+
+// [transmem] The contention management policy (see contention.cc)
+extern gtm_cm_policy cm_policy;
+// [transmem] False if ITM_INEVITABLE=0 (see method-serial.cc)
+extern bool inevitable_enabled;
+// [transmem] True iff ITM_PROFILE is set (see profile.cc)
+extern bool profile_enabled;
+extern void profile_init ();
+
+extern abi_dispatch *dispatch_serial();
+extern abi_dispatch *dispatch_serialirr();
+extern abi_dispatch *dispatch_norec();
+extern abi_dispatch *dispatch_norec_ro();
+extern abi_dispatch *dispatch_norec_irr();
+extern abi_dispatch *dispatch_lazy();
+extern abi_dispatch *dispatch_lazy_ro();
+extern abi_dispatch *dispatch_lazy_irr();
+extern abi_dispatch *dispatch_ml_wt();
+
+// [transmem] The algorithm selection monitor (see adapt.cc)
+extern bool adapt_enabled;
+extern abi_dispatch *adapt_dispatch();
+
+extern gtm_cacheline_mask gtm_mask_stack(gtm_cacheline *, gtm_cacheline_mask);
+
+} // namespace GTM
+
+#endif // LIBITM_I_H
@@ -0,0 +1,934 @@
+/* Copyright (C) 2012-2015 Free Software Foundation, Inc.
+   Contributed by Torvald Riegel <triegel@redhat.com>.
+
+   This file is part of the GNU Transactional Memory Library (libitm).
+
+   Libitm is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   Libitm is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   Under Section 7 of GPL version 3, you are granted additional
+   permissions described in the GCC Runtime Library Exception, version
+   3.1, as published by the Free Software Foundation.
+
+   You should have received a copy of the GNU General Public License and
+   a copy of the GCC Runtime Library Exception along with this program;
+   see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include "libitm_i.h"
+
+using namespace GTM;
+
+namespace {
+
+// This group consists of all TM methods that detect conflicts via
+// value-based validation
+struct norec_mg : public method_group
+{
+  // Maximum time is all bits except the lock bit and the overflow reserve bit
+  static const gtm_word TIME_MAX = (~(gtm_word)0 >> 2);
+
+  // The shared time base.
+  atomic<gtm_word> time __attribute__((aligned(HW_CACHELINE_SIZE)));
+  // [transmem] The (odd) value of TIME while the inevitable transaction holds
+  // the lock and has not started to commit, or 0 (see norec_irr_dispatch)
+  atomic<gtm_word> irr_time;
+
+  // [transmem] A writer that finds the sequence lock held publishes its
+  // transaction in a combining slot, so that the lock holder can validate
+  // and write it back under the same lock acquisition (see trycommit()).
+  // Each thread hashes to one slot; if the slot is taken, the writer just
+  // waits for the lock instead.
+  enum slot_state
+  {
+    SLOT_FREE,      // unused
+    SLOT_RESERVED,  // a writer is filling in TX
+    SLOT_PENDING,   // TX waits for a combiner
+    SLOT_CLAIMED,   // a combiner is committing TX
+    SLOT_COMMITTED, // TX committed at time CT
+    SLOT_ABORTED    // TX failed validation
+  };
+  struct combine_slot
+  {
+    atomic<gtm_word> state;
+    gtm_thread *tx;
+    gtm_word ct;
+  } __attribute__((aligned(HW_CACHELINE_SIZE)));
+  static const unsigned COMBINE_SLOTS = 64;
+  combine_slot slots[COMBINE_SLOTS];
+
+  combine_slot &slot_of(gtm_thread *tx)
+  {
+    uint64_t h = (uint64_t) (uintptr_t) tx * 0x9e3779b97f4a7c15ULL;
+    return slots[h >> 58];
+  }
+
+  virtual void init()
+  {
+    // This store is only executed while holding the serial lock, so relaxed
+    // memory order is sufficient here.
+    time.store(0, memory_order_relaxed);
+    irr_time.store(0, memory_order_relaxed);
+  }
+
+  virtual void fini() { }
+
+  // We only re-initialize when our time base overflows.  Thus, only reset
+  // the time base and the orecs but do not re-allocate the orec array.
+  virtual void reinit()
+  {
+    // This store is only executed while holding the serial lock, so relaxed
+    // memory order is sufficient here.
+    time.store(0, memory_order_relaxed);
+    irr_time.store(0, memory_order_relaxed);
+  }
+};
+
+static norec_mg o_norec_mg;
+
+// The NOrec TM method.
+// Uses a single global lock to protect writeback, and uses values for
+// validation
+//
+// Note that NOrec does not require quiescence-based validation, though we
+// employ it to simplify memory reclamation and remain consistent with the
+// rest of the GCC-TM implementations
+class norec_dispatch : public abi_dispatch
+{
+protected:
+
+  // Returns true iff all locations read by the transaction still have the
+  // values observed by the transaction
+  static gtm_word validate(gtm_thread *tx)
+  {
+    while (true) {
+      // read the lock until it is even.  [transmem] If the inevitable
+      // transaction holds it, we validate against the state before it took
+      // the lock instead (see inevitable_read_ok()).
+      gtm_word s = o_norec_mg.time.load(memory_order_acquire);
+      gtm_word irr = s & 1;
+      if (irr && o_norec_mg.irr_time.load(memory_order_relaxed) != s)
+        continue;
+
+      // check the read set... the read set is technically an "undo log", but
+      // that's not important to this code
+      bool valid = tx->valuelog.valuecheck();
+
+      if (!valid)
+          // does not allow -1, gtm_word is unsigned int
+          return -1;
+
+      if (irr)
+        {
+          atomic_thread_fence(memory_order_seq_cst);
+          bool marked = reads_inevitable_lines(tx);
+          if (o_norec_mg.irr_time.load(memory_order_relaxed) != s)
+            continue;
+          if (marked)
+            tx->restart(RESTART_INEVITABLE);
+          s -= 1;
+        }
+
+      // make sure lock didn't change during validation
+      tx->shared_state.store(s, memory_order_release);
+      if (o_norec_mg.time.load(memory_order_acquire) == s + irr)
+          return s;
+    }
+  }
+
+  // [transmem] Returns true iff a read of [ADDR, ADDR + LEN), which happened
+  // before the call, is consistent with the snapshot START of TX although
+  // the sequence lock has changed.  This is the case if the inevitable
+  // transaction took the lock right after START and has not written to the
+  // data: it adds the cache lines to gtm_thread::inevitable_lines before it
+  // writes to them (see norec_irr_dispatch), and resets irr_time before it
+  // writes back the writers that it commits.  If it has written to the data,
+  // TX waits for it to finish.
+  static bool inevitable_read_ok(gtm_thread* tx, gtm_word start,
+      const void* addr, size_t len)
+  {
+    gtm_word t = start + 1;
+    if (likely(o_norec_mg.time.load(memory_order_relaxed) != t))
+      return false;
+    // The fence pairs with the one in norec_irr_dispatch::note_write(): if
+    // we have read its write, we see its mark.  The filter is cleared with
+    // release stores after irr_time is reset, so check irr_time last.
+    atomic_thread_fence(memory_order_seq_cst);
+    bool marked = gtm_thread::inevitable_lines.contains(addr, len);
+    if (o_norec_mg.irr_time.load(memory_order_relaxed) != t)
+      return false;
+    if (marked)
+      tx->restart(RESTART_INEVITABLE);
+    return true;
+  }
+
+  // [transmem] Returns true iff TX has read some cache line that the
+  // inevitable transaction has written to.
+  static bool reads_inevitable_lines(gtm_thread* tx)
+  {
+    for (gtm_valuelog::run *r = tx->valuelog.runs.begin(),
+           *re = tx->valuelog.runs.end(); r != re; ++r)
+      if (gtm_thread::inevitable_lines.contains(r->addr, r->len))
+        return true;
+    return false;
+  }
+
+  // [transmem] Called by a writer TX that found the sequence lock held.
+  // Publishes TX in its combining slot and waits for the lock holder to
+  // commit it.  Returns the commit time, (gtm_word)-1 if TX failed
+  // validation, or 0 if nobody picked TX up before the lock was released (or
+  // the slot was taken), in which case TX must acquire the lock itself.
+  static gtm_word combine_wait(gtm_thread *tx)
+  {
+    norec_mg::combine_slot &s = o_norec_mg.slot_of(tx);
+    gtm_word st = norec_mg::SLOT_FREE;
+    if (!s.state.compare_exchange_strong(st, norec_mg::SLOT_RESERVED,
+                                         memory_order_relaxed))
+      return 0;
+    s.tx = tx;
+    s.state.store(norec_mg::SLOT_PENDING, memory_order_release);
+
+    while (true)
+      {
+        st = s.state.load(memory_order_acquire);
+        if (st == norec_mg::SLOT_COMMITTED || st == norec_mg::SLOT_ABORTED)
+          {
+            gtm_word ct = (st == norec_mg::SLOT_COMMITTED) ? s.ct : -1;
+            s.state.store(norec_mg::SLOT_FREE, memory_order_relaxed);
+            return ct;
+          }
+        // If the lock is free and no combiner has claimed us yet, withdraw.
+        // If the withdrawal fails, a combiner is committing us.
+        if (st == norec_mg::SLOT_PENDING
+            && (o_norec_mg.time.load(memory_order_relaxed) & 1) == 0
+            && s.state.compare_exchange_strong(st, norec_mg::SLOT_FREE,
+                                               memory_order_relaxed))
+          return 0;
+        cpu_relax();
+      }
+  }
+
+  // [transmem] Called by the holder of the sequence lock, after its own
+  // writeback.  Validates and writes back every pending writer, in slot
+  // order; each one is serialized after the writers before it.  Claimed
+  // slots are recorded in CLAIMED, so that the caller can report the results
+  // once it has released the lock.  Returns the number of claimed slots.
+  static unsigned combine(norec_mg::combine_slot **claimed)
+  {
+    unsigned n = 0;
+    for (unsigned i = 0; i < norec_mg::COMBINE_SLOTS; ++i)
+      {
+        norec_mg::combine_slot &s = o_norec_mg.slots[i];
+        gtm_word st = norec_mg::SLOT_PENDING;
+        if (s.state.load(memory_order_relaxed) != st
+            || !s.state.compare_exchange_strong(st, norec_mg::SLOT_CLAIMED,
+                                                memory_order_acquire))
+          continue;
+        // The writer is blocked in combine_wait(), so its logs are stable.
+        gtm_thread *w = s.tx;
+        if (w->valuelog.valuecheck())
+          {
+            w->redolog.writeback();
+            w->deltas.apply();
+            s.ct = 0;
+          }
+        else
+          s.ct = -1;
+        claimed[n++] = &s;
+      }
+    return n;
+  }
+
+  // [transmem] Tells the writers in the N slots in CLAIMED whether combine()
+  // has committed them, at time CT.  Must be called after the lock has been
+  // released.
+  static void report(norec_mg::combine_slot **claimed, unsigned n,
+      gtm_word ct)
+  {
+    for (unsigned i = 0; i < n; ++i) {
+      bool ok = claimed[i]->ct == 0;
+      claimed[i]->ct = ct;
+      claimed[i]->state.store(ok ? norec_mg::SLOT_COMMITTED
+                              : norec_mg::SLOT_ABORTED,
+                              memory_order_release);
+    }
+  }
+
+  // [transmem] Returns true iff TX would overwrite data that the priority
+  // transaction has read, in which case it must yield (see contention.cc).
+  // Slabs of the redo log are single cache lines.
+  static bool yields_to_priority(gtm_thread* tx)
+  {
+    if (likely(gtm_thread::priority_owner.load(memory_order_relaxed) == 0))
+      return false;
+    for (int i = 0; i < tx->redolog.slabcount(); ++i)
+      if (tx->cm_priority_conflict((void*)tx->redolog.get_key(i), 64))
+        return true;
+    for (gtm_delta *d = tx->deltas.entries.begin(),
+           *de = tx->deltas.entries.end(); d != de; ++d)
+      if (tx->cm_priority_conflict(d->addr, sizeof(uint64_t)))
+        return true;
+    return false;
+  }
+
+  template <typename V> static V load(const V* addr, ls_modifier mod)
+  {
+      gtm_thread *tx = gtm_thr();
+
+      // stack filter: if we are reading from a stack location, just read it
+      // without logging or write set lookup
+      void *top = mask_stack_top(tx);
+      void *bot = mask_stack_bottom(tx);
+      if ((addr <= top && (uint8_t*) addr > bot ) ||
+          ((uint8_t*)addr < bot && ((uint8_t*)addr + sizeof(V) > bot))) {
+          return *addr;
+      }
+
+      // [transmem] fold pending deltas, then check the redo log
+      if (unlikely(tx->deltas.may_overlap(addr, sizeof(V))))
+        tx->fold_deltas(addr, sizeof(V));
+      V v;
+      if (!tx->redolog.isEmpty() && tx->redolog.find(addr, v) != 0)
+        return v;
+
+      // [transmem] The priority transaction marks what it reads, so that
+      // writers yield to it (see contention.cc)
+      if (unlikely(tx->cm_priority))
+        tx->cm_note_read(addr, sizeof(V));
+
+      // NOrec read loop:
+      // A read is valid iff it occurs during a period where the seqlock does
+      // not change and is even.  This code also polls for new changes that
+      // might necessitate a validation.
+      v = *addr;
+      // get start time, compared to the current timestamp
+      gtm_word start_time = tx->shared_state.load(memory_order_acquire);
+      while (start_time != o_norec_mg.time.load(memory_order_acquire)) {
+          if (inevitable_read_ok(tx, start_time, addr, sizeof(V)))
+            break;
+          if ((start_time = validate(tx)) == (gtm_word)-1) {
+              tx->restart_reason[RESTART_VALIDATE_READ]++;
+              tx->restart(RESTART_VALIDATE_READ);
+          }//Abort
+
+          v = *addr;
+      }
+
+      // log address and value into read log
+      tx->valuelog.log_read(addr, sizeof(V), &v);
+      return v;
+  }
+
+  template <typename V> static void store(V* addr, const V value,
+      ls_modifier mod)
+  {
+    // filter out writes to the stack frame
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    if ((addr <= top && (uint8_t*) addr > bot ) ||
+        ((uint8_t*)addr < bot && ((uint8_t*)addr + sizeof(V) > bot))) {
+      *addr = value;
+      return;
+    }
+
+    // insert into the log, so we can write it back later.  [transmem] A
+    // pending delta must be folded first, or it would be added to VALUE.
+    if (unlikely(tx->deltas.may_overlap(addr, sizeof(V))))
+      tx->fold_deltas(addr, sizeof(V));
+    tx->redolog.insert(addr, value);
+  }
+
+  // Returns true iff [addr, addr + len) overlaps the transaction's own stack
+  // frames, in which case the access must bypass the logs
+  static bool on_stack(const void* addr, size_t len, void* top, void* bot)
+  {
+    return (const uint8_t*)addr <= (uint8_t*)top
+        && (const uint8_t*)addr + len > (uint8_t*)bot;
+  }
+
+  // Returns the size of the next chunk of a bulk access that starts at ADDR
+  // and has LEN bytes remaining.  Chunks are aligned 8/16/32-byte blocks, so
+  // they never span a slab of the redo log.  We fall back to single bytes
+  // only at unaligned edges.
+  static size_t next_chunk(const void* addr, size_t len)
+  {
+    uintptr_t a = (uintptr_t)addr;
+    if (len >= 32 && (a & 31) == 0)
+      return 32;
+    if (len >= 16 && (a & 15) == 0)
+      return 16;
+    if (len >= 8 && (a & 7) == 0)
+      return 8;
+    return 1;
+  }
+
+  // Transactionally read the LEN bytes of an aligned chunk at ADDR into BUF.
+  // This is load() for an arbitrary chunk: the chunk gets a single value-log
+  // entry, and then any bytes that the transaction has written are merged in
+  // from the redo log.
+  static void load_chunk(gtm_thread* tx, const uint8_t* addr, uint8_t* buf,
+      size_t len)
+  {
+    copy_chunk(buf, addr, len);
+    gtm_word start_time = tx->shared_state.load(memory_order_acquire);
+    while (start_time != o_norec_mg.time.load(memory_order_acquire)) {
+        if (inevitable_read_ok(tx, start_time, addr, len))
+          break;
+        if ((start_time = validate(tx)) == (gtm_word)-1) {
+          tx->restart_reason[RESTART_VALIDATE_READ]++;
+          tx->restart(RESTART_VALIDATE_READ);
+        }
+        copy_chunk(buf, addr, len);
+    }
+    tx->valuelog.log_read(addr, len, buf);
+    if (!tx->redolog.isEmpty())
+      tx->redolog.merge(addr, buf, len);
+  }
+
+  // Read [src, src + len) into BUF, one chunk at a time
+  static void load_bytes(gtm_thread* tx, const uint8_t* src, uint8_t* buf,
+      size_t len, ls_modifier mod, void* top, void* bot)
+  {
+    if (mod == NONTXNAL || on_stack(src, len, top, bot)) {
+      ::memcpy(buf, src, len);
+      return;
+    }
+    if (unlikely(tx->deltas.may_overlap(src, len)))
+      tx->fold_deltas(src, len);
+    if (unlikely(tx->cm_priority))
+      tx->cm_note_read(src, len);
+    while (len > 0) {
+      size_t n = next_chunk(src, len);
+      load_chunk(tx, src, buf, n);
+      src += n;
+      buf += n;
+      len -= n;
+    }
+  }
+
+  // Write BUF to [dst, dst + len).  The redo log buffers whole slabs at a
+  // time, so there is no need to chunk the range here.
+  static void store_bytes(gtm_thread* tx, uint8_t* dst, const uint8_t* buf,
+      size_t len, ls_modifier mod, void* top, void* bot)
+  {
+    if (mod == NONTXNAL)
+      ::memcpy(dst, buf, len);
+    else if (!on_stack(dst, len, top, bot)) {
+      if (unlikely(tx->deltas.may_overlap(dst, len)))
+        tx->fold_deltas(dst, len);
+      tx->redolog.insert_bytes(dst, buf, len);
+    }
+    else
+      for (size_t i = 0; i < len; i++)
+        store<uint8_t>(dst + i, buf[i], mod);
+  }
+
+public:
+  static void memtransfer_static(void *dst, const void* src, size_t size,
+      bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    const uint8_t *srcaddr = (const uint8_t*)src;
+    uint8_t *dstaddr = (uint8_t*)dst;
+
+    // Since we do buffered writes, a forward copy only goes wrong if a later
+    // chunk of the source was already overwritten (in the redo log) by an
+    // earlier chunk of the destination.  In that case, read everything first.
+    if (may_overlap && dstaddr > srcaddr && dstaddr < srcaddr + size)
+      {
+        uint8_t* tmp = (uint8_t*)xmalloc(size);
+        load_bytes(tx, srcaddr, tmp, size, src_mod, top, bot);
+        store_bytes(tx, dstaddr, tmp, size, dst_mod, top, bot);
+        free(tmp);
+        return;
+      }
+
+    // Otherwise, move the data through a small buffer.  After the first
+    // piece, every piece starts on a 64-byte boundary of the source, so only
+    // the very first and last chunks can be unaligned.
+    uint8_t buf[256] __attribute__((aligned(64)));
+    while (size > 0)
+      {
+        size_t n = sizeof(buf) - ((uintptr_t)srcaddr & 63);
+        if (n > size)
+          n = size;
+        load_bytes(tx, srcaddr, buf, n, src_mod, top, bot);
+        store_bytes(tx, dstaddr, buf, n, dst_mod, top, bot);
+        srcaddr += n;
+        dstaddr += n;
+        size -= n;
+      }
+  }
+
+  static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    uint8_t* dstaddr = (uint8_t*)dst;
+
+    // [transmem] save data into redo log, a slab at a time... note that the
+    //            modifier doesn't matter
+    if (!on_stack(dstaddr, size, top, bot)) {
+      if (unlikely(tx->deltas.may_overlap(dstaddr, size)))
+        tx->fold_deltas(dstaddr, size);
+      tx->redolog.fill_bytes(dstaddr, (uint8_t)c, size);
+    }
+    else
+      for (size_t i = 0; i < size; i++)
+        store<uint8_t>(dstaddr + i, (uint8_t)c, mod);
+  }
+
+  virtual gtm_restart_reason begin_or_restart()
+  {
+    // NB: We don't need to do anything for nested transactions.
+    gtm_thread *tx = gtm_thr();
+
+    // Read the current time, which becomes our snapshot time.
+    // Use acquire memory oder so that we see the lock acquisitions by update
+    // transcations that incremented the global time (see trycommit()).
+    gtm_word snapshot = o_norec_mg.time.load(memory_order_acquire);
+    // Sample the sequence lock, if it is even decrement by 1
+    snapshot = snapshot & ~(1L);
+
+    // Re-initialize method group on time overflow.
+    if (snapshot >= o_norec_mg.TIME_MAX)
+      return RESTART_INIT_METHOD_GROUP;
+
+    // We don't need to enforce any ordering for the following store. There
+    // are no earlier data loads in this transaction, so the store cannot
+    // become visible before those (which could lead to the violation of
+    // privatization safety). The store can become visible after later loads
+    // but this does not matter because the previous value will have been
+    // smaller or equal (the serial lock will set shared_state to zero when
+    // marking the transaction as active, and restarts enforce immediate
+    // visibility of a smaller or equal value with a barrier (see
+    // rollback()).
+    tx->shared_state.store(snapshot, memory_order_relaxed);
+    return NO_RESTART;
+  }
+
+  virtual bool trycommit(gtm_word& priv_time)
+  {
+    gtm_thread* tx = gtm_thr();
+    gtm_word start_time = 0;
+
+    // If we haven't updated anything, we can commit. Just clean value log.
+    if (tx->redolog.isEmpty() && tx->deltas.empty()) {
+      tx->valuelog.commit();
+      return true;
+    }
+
+    // [transmem] Let the priority transaction commit first.  Not if we
+    // commit while upgrading to serial mode (see serialirr_mode()): it is
+    // not active then, and we must not restart as if we were.
+    if (unlikely(!(tx->state & gtm_thread::STATE_SERIAL)
+                 && yields_to_priority(tx)))
+      tx->restart(RESTART_PRIORITY);
+
+    // get start time
+    start_time = tx->shared_state.load(memory_order_relaxed);
+
+    // get the lock and validate
+    // compare_exchange_weak should save some overhead in a loop?
+    gtm_word ct = 0;
+    while (!o_norec_mg.time.compare_exchange_weak
+           (start_time, start_time + 1, memory_order_acquire)) {
+      // [transmem] If somebody holds the lock, let them commit us
+      if ((start_time & 1) == 1 && (ct = combine_wait(tx)) != 0)
+        break;
+      if ((start_time = validate(tx)) == (gtm_word)-1) {
+        tx->restart_reason[RESTART_VALIDATE_READ]++;
+        return false;
+      }
+    }
+
+    if (ct == (gtm_word)-1) {
+      tx->restart_reason[RESTART_VALIDATE_READ]++;
+      return false;
+    }
+
+    if (ct == 0) {
+      // do write back, for us and for any writers that are waiting
+      tx->redolog.writeback();
+      tx->deltas.apply();
+      norec_mg::combine_slot *claimed[norec_mg::COMBINE_SLOTS];
+      unsigned n = combine(claimed);
+
+      // relaese the sequence lock
+      ct = start_time + 2;
+      o_norec_mg.time.store(ct, memory_order_release);
+
+      // report the results; waiting writers must not see success before the
+      // lock is released
+      report(claimed, n, ct);
+    }
+
+    // We're done, clear the logs.
+    tx->redolog.reset();
+    tx->deltas.clear();
+    // NB: this clears the log, although it is called "commit"
+    tx->valuelog.commit();
+
+    // Need to ensure privatization safety. Every other transaction must
+    // have a snapshot time that is at least as high as our commit time
+    // (i.e., our commit must be visible to them).
+    //
+    // [transmem] NOrec is privatization-safe without quiescence: a doomed
+    // transaction validates every value before using it, and a privatizer
+    // cannot commit while some writer is still writing back, since both
+    // need the sequence lock.  We only need a privatization time if memory
+    // might be freed, which a doomed transaction could still be reading.
+    if (tx->needs_quiescence())
+      priv_time = ct;
+    return true;
+  }
+
+  virtual void rollback()
+  {
+    gtm_thread *tx = gtm_thr();
+
+    // We need this release fence to ensure that privatizers see the
+    // rolled-back original state (not any uncommitted values) when they read
+    // the new snapshot time that we write in begin_or_restart().
+    atomic_thread_fence(memory_order_release);
+
+    // We're done, clear the logs.
+    tx->redolog.reset();
+    tx->deltas.clear();
+    // NB: this clears the log, although it is called "commit"
+    tx->valuelog.commit();
+  }
+
+  virtual bool supports(unsigned number_of_threads)
+  {
+    // NOrec can support any number of threads
+    return true;
+  }
+
+  // [transmem] See trycommit()
+  virtual bool privatization_safe() { return true; }
+  virtual bool commutative_updates() { return true; }
+  virtual bool supports_priority() { return true; }
+  // [transmem] Writes are buffered in the redo log, which has a scope for
+  // each closed nested transaction (see gtm_transaction_cp)
+  virtual bool closed_nesting() { return true; }
+  // [transmem] The read set is the value log, in bytes (see elastic.cc)
+  virtual size_t read_set_mark() { return gtm_thr()->valuelog.size(); }
+  virtual void release_reads(size_t from, size_t to)
+  {
+    gtm_thr()->valuelog.release(from, to);
+  }
+
+  virtual abi_dispatch* read_only_alternative()
+  {
+    return dispatch_norec_ro();
+  }
+  virtual abi_dispatch* inevitable_alternative()
+  {
+    return dispatch_norec_irr();
+  }
+
+  CREATE_DISPATCH_METHODS(virtual, )
+  CREATE_DISPATCH_METHODS_MEM()
+
+  norec_dispatch() : abi_dispatch(false, true, false, 0, &o_norec_mg)
+  { }
+
+protected:
+  norec_dispatch(bool ro) : abi_dispatch(ro, true, false, 0, &o_norec_mg)
+  { }
+};
+
+// [transmem] NOrec for transactions that are expected not to write (see
+// read_only_alternative()).  Reads skip the redo log lookup, and commit
+// just clears the value log.  The first store to shared memory restarts the
+// transaction with the full dispatch.
+class norec_ro_dispatch : public norec_dispatch
+{
+protected:
+  template <typename V> static V load(const V* addr, ls_modifier mod)
+  {
+      gtm_thread *tx = gtm_thr();
+
+      // stack filter, as in norec_dispatch::load()
+      void *top = mask_stack_top(tx);
+      void *bot = mask_stack_bottom(tx);
+      if ((addr <= top && (uint8_t*) addr > bot ) ||
+          ((uint8_t*)addr < bot && ((uint8_t*)addr + sizeof(V) > bot))) {
+          return *addr;
+      }
+
+      // NOrec read loop (see norec_dispatch::load())
+      V v = *addr;
+      gtm_word start_time = tx->shared_state.load(memory_order_acquire);
+      while (start_time != o_norec_mg.time.load(memory_order_acquire)) {
+          if (inevitable_read_ok(tx, start_time, addr, sizeof(V)))
+            break;
+          if ((start_time = validate(tx)) == (gtm_word)-1) {
+              tx->restart_reason[RESTART_VALIDATE_READ]++;
+              tx->restart(RESTART_VALIDATE_READ);
+          }
+
+          v = *addr;
+      }
+
+      tx->valuelog.log_read(addr, sizeof(V), &v);
+      return v;
+  }
+
+  template <typename V> static void store(V* addr, const V value,
+      ls_modifier mod)
+  {
+    // writes to the stack frame are private
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    if ((addr <= top && (uint8_t*) addr > bot ) ||
+        ((uint8_t*)addr < bot && ((uint8_t*)addr + sizeof(V) > bot))) {
+      *addr = value;
+      return;
+    }
+    tx->restart(RESTART_NOT_READONLY);
+  }
+
+public:
+  static void memtransfer_static(void *dst, const void* src, size_t size,
+      bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    if (dst_mod != NONTXNAL && !on_stack(dst, size, top, bot))
+      tx->restart(RESTART_NOT_READONLY);
+
+    // The destination is private, so we can read straight into it, unless
+    // it overlaps the source.
+    if (!may_overlap)
+      {
+        load_bytes(tx, (const uint8_t*)src, (uint8_t*)dst, size, src_mod,
+                   top, bot);
+        return;
+      }
+    uint8_t* tmp = (uint8_t*)xmalloc(size);
+    load_bytes(tx, (const uint8_t*)src, tmp, size, src_mod, top, bot);
+    ::memcpy(dst, tmp, size);
+    free(tmp);
+  }
+
+  static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    if (mod != NONTXNAL
+        && !on_stack(dst, size, mask_stack_top(tx), mask_stack_bottom(tx)))
+      tx->restart(RESTART_NOT_READONLY);
+    ::memset(dst, c, size);
+  }
+
+  virtual bool trycommit(gtm_word& priv_time)
+  {
+    // We have not written anything, and NOrec does not need quiescence for
+    // readers.
+    gtm_thr()->valuelog.commit();
+    return true;
+  }
+
+  virtual abi_dispatch* read_only_alternative() { return 0; }
+  // [transmem] Adds go through store(), which restarts the transaction
+  virtual bool commutative_updates() { return false; }
+  virtual bool supports_priority() { return false; }
+
+  CREATE_DISPATCH_METHODS(virtual, )
+  CREATE_DISPATCH_METHODS_MEM()
+
+  norec_ro_dispatch() : norec_dispatch(true)
+  { }
+};
+
+// [transmem] NOrec for the inevitable transaction (see method-serial.cc).  It
+// holds the sequence lock from the time that it becomes inevitable until it
+// commits, and accesses memory in place.  Writers cannot commit meanwhile;
+// those that wait for the lock are combined into its commit.  Readers keep
+// going with their snapshot from before the lock acquisition, except for the
+// cache lines that it has written to (see inevitable_read_ok()), until it may
+// write without barriers (see run_uninstrumented()).
+class norec_irr_dispatch : public norec_dispatch
+{
+protected:
+  // Add the cache lines of [ADDR, ADDR + LEN) to the filter before writing
+  // to them.  The fence orders the filter update before the write, and pairs
+  // with the one in inevitable_read_ok().
+  static void note_write(gtm_thread* tx, const void* addr, size_t len)
+  {
+    if (on_stack(addr, len, mask_stack_top(tx), mask_stack_bottom(tx)))
+      return;
+    if (gtm_thread::inevitable_lines.add(addr, len))
+      atomic_thread_fence(memory_order_seq_cst);
+  }
+
+  template <typename V> static V load(const V* addr, ls_modifier mod)
+  {
+    return *addr;
+  }
+
+  template <typename V> static void store(V* addr, const V value,
+      ls_modifier mod)
+  {
+    note_write(gtm_thr(), addr, sizeof(V));
+    *addr = value;
+  }
+
+  // Take the lock at time S, or return false if it is not S anymore.
+  static bool lock(gtm_thread* tx, gtm_word s)
+  {
+    if (!o_norec_mg.time.compare_exchange_strong(s, s + 1,
+                                                 memory_order_acquire))
+      return false;
+    tx->shared_state.store(s, memory_order_relaxed);
+    o_norec_mg.irr_time.store(s + 1, memory_order_relaxed);
+    return true;
+  }
+
+public:
+  static void memtransfer_static(void *dst, const void* src, size_t size,
+      bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
+  {
+    if (dst_mod != NONTXNAL)
+      note_write(gtm_thr(), dst, size);
+    if (!may_overlap)
+      ::memcpy(dst, src, size);
+    else
+      ::memmove(dst, src, size);
+  }
+
+  static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
+  {
+    if (mod != NONTXNAL)
+      note_write(gtm_thr(), dst, size);
+    ::memset(dst, c, size);
+  }
+
+  // We cannot restart, so we do not check for overflow of the time base;
+  // the other transactions reinitialize the method group, and the overflow
+  // reserve covers our commit.
+  virtual gtm_restart_reason begin_or_restart()
+  {
+    gtm_thread *tx = gtm_thr();
+    gtm_word s;
+    do
+      {
+        while (((s = o_norec_mg.time.load(memory_order_relaxed)) & 1) == 1)
+          cpu_relax();
+      }
+    while (!lock(tx, s));
+    return NO_RESTART;
+  }
+
+  // Take the lock, and write back the redo log of the current transaction
+  // of the full or the read-only variant.
+  virtual bool become_inevitable()
+  {
+    gtm_thread *tx = gtm_thr();
+    gtm_word s = tx->shared_state.load(memory_order_relaxed);
+    while (!lock(tx, s))
+      if ((s = validate(tx)) == (gtm_word)-1)
+        return false;
+
+    for (int i = 0; i < tx->redolog.slabcount(); ++i)
+      gtm_thread::inevitable_lines.add((void*)tx->redolog.get_key(i), 64);
+    for (gtm_delta *d = tx->deltas.entries.begin(),
+           *de = tx->deltas.entries.end(); d != de; ++d)
+      gtm_thread::inevitable_lines.add(d->addr, sizeof(uint64_t));
+    atomic_thread_fence(memory_order_seq_cst);
+    tx->redolog.writeback();
+    tx->deltas.apply();
+    tx->redolog.reset();
+    tx->deltas.clear();
+    tx->valuelog.commit();
+    return run_uninstrumented();
+  }
+
+  // The filter does not cover writes without barriers, so readers must wait
+  // for the lock from now on, and validate after we have committed.  Writers
+  // cannot commit anyway.  The fence orders the reset before our next write,
+  // as in trycommit().
+  virtual bool run_uninstrumented()
+  {
+    o_norec_mg.irr_time.store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    return true;
+  }
+
+  virtual bool trycommit(gtm_word& priv_time)
+  {
+    gtm_thread* tx = gtm_thr();
+
+    // Commit the writers that wait for the lock.  Readers must not mistake
+    // their writes for the state before our lock acquisition (see
+    // inevitable_read_ok()).
+    o_norec_mg.irr_time.store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    norec_mg::combine_slot *claimed[norec_mg::COMBINE_SLOTS];
+    unsigned n = combine(claimed);
+
+    gtm_word ct = tx->shared_state.load(memory_order_relaxed) + 2;
+    o_norec_mg.time.store(ct, memory_order_release);
+    gtm_thread::inevitable_lines.clear();
+    report(claimed, n, ct);
+
+    if (tx->needs_quiescence())
+      priv_time = ct;
+    return true;
+  }
+
+  virtual void rollback()
+  {
+    // The inevitable transaction cannot roll back.
+    abort();
+  }
+
+  virtual abi_dispatch* read_only_alternative() { return 0; }
+  virtual abi_dispatch* inevitable_alternative() { return 0; }
+  virtual bool commutative_updates() { return false; }
+  virtual bool supports_priority() { return false; }
+
+  CREATE_DISPATCH_METHODS(virtual, )
+  CREATE_DISPATCH_METHODS_MEM()
+
+  norec_irr_dispatch() : norec_dispatch(false)
+  { }
+};
+
+} // anon namespace
+
+static const norec_dispatch o_norec_dispatch;
+static const norec_ro_dispatch o_norec_ro_dispatch;
+static const norec_irr_dispatch o_norec_irr_dispatch;
+
+abi_dispatch *
+GTM::dispatch_norec ()
+{
+  return const_cast<norec_dispatch *>(&o_norec_dispatch);
+}
+
+abi_dispatch *
+GTM::dispatch_norec_ro ()
+{
+  return const_cast<norec_ro_dispatch *>(&o_norec_ro_dispatch);
+}
+
+abi_dispatch *
+GTM::dispatch_norec_irr ()
+{
+  return const_cast<norec_irr_dispatch *>(&o_norec_irr_dispatch);
+}
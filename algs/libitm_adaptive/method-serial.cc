@@ -0,0 +1,332 @@
+/* Copyright (C) 2008-2015 Free Software Foundation, Inc.
+   Contributed by Richard Henderson <rth@redhat.com>.
+
+   This file is part of the GNU Transactional Memory Library (libitm).
+
+   Libitm is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   Libitm is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+   more details.
+
+   Under Section 7 of GPL version 3, you are granted additional
+   permissions described in the GCC Runtime Library Exception, version
+   3.1, as published by the Free Software Foundation.
+
+   You should have received a copy of the GNU General Public License and
+   a copy of the GCC Runtime Library Exception along with this program;
+   see the files COPYING3 and COPYING.RUNTIME respectively.  If not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include "libitm_i.h"
+#include "futex.h"
+#include <limits.h>
+
+// Avoid a dependency on libstdc++ for the pure virtuals in abi_dispatch.
+extern "C" void HIDDEN
+__cxa_pure_virtual ()
+{
+  abort ();
+}
+
+using namespace GTM;
+
+namespace {
+
+// This group consists of the serial and serialirr
+// methods, which all need no global state (except what is already provided
+// by the serial mode implementation).
+struct serial_mg : public method_group
+{
+  virtual void init() { }
+  virtual void fini() { }
+};
+
+static serial_mg o_serial_mg;
+
+
+class serialirr_dispatch : public abi_dispatch
+{
+ public:
+  serialirr_dispatch() : abi_dispatch(false, true, true,
+      gtm_thread::STATE_SERIAL | gtm_thread::STATE_IRREVOCABLE, &o_serial_mg)
+  { }
+
+ protected:
+  serialirr_dispatch(bool ro, bool wt, bool uninstrumented,
+      uint32_t requires_serial, method_group* mg) :
+    abi_dispatch(ro, wt, uninstrumented, requires_serial, mg)
+  { }
+
+  // Transactional loads and stores simply access memory directly.
+  // These methods are static to avoid indirect calls, and will be used by the
+  // virtual ABI dispatch methods or by static direct-access methods created
+  // below.
+  template <typename V> static V load(const V* addr, ls_modifier mod)
+  {
+    return *addr;
+  }
+  template <typename V> static void store(V* addr, const V value,
+      ls_modifier mod)
+  {
+    *addr = value;
+  }
+
+ public:
+  static void memtransfer_static(void *dst, const void* src, size_t size,
+      bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
+  {
+    if (!may_overlap)
+      ::memcpy(dst, src, size);
+    else
+      ::memmove(dst, src, size);
+  }
+
+  static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
+  {
+    ::memset(dst, c, size);
+  }
+
+  CREATE_DISPATCH_METHODS(virtual, )
+  CREATE_DISPATCH_METHODS_MEM()
+
+  virtual gtm_restart_reason begin_or_restart() { return NO_RESTART; }
+  virtual bool trycommit(gtm_word& priv_time) { return true; }
+  virtual void rollback() { abort(); }
+};
+
+class serial_dispatch : public abi_dispatch
+{
+protected:
+  static void log(const void *addr, size_t len)
+  {
+    gtm_thread *tx = gtm_thr();
+    tx->undolog.log(addr, len);
+  }
+
+  template <typename V> static V load(const V* addr, ls_modifier mod)
+  {
+    // [transmem] The compiler follows a read for write with a WaW store,
+    // which does not log, so log here.  Otherwise, cancelling a closed
+    // nested transaction would keep the write.
+    if (mod == RfW)
+      log(addr, sizeof(V));
+    return *addr;
+  }
+  template <typename V> static void store(V* addr, const V value,
+      ls_modifier mod)
+  {
+    if (mod != WaW)
+      log(addr, sizeof(V));
+    *addr = value;
+  }
+
+public:
+  static void memtransfer_static(void *dst, const void* src, size_t size,
+      bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
+  {
+    if (dst_mod != WaW && dst_mod != NONTXNAL)
+      log(dst, size);
+    if (src_mod == RfW)
+      log(src, size);
+    if (!may_overlap)
+      ::memcpy(dst, src, size);
+    else
+      ::memmove(dst, src, size);
+  }
+
+  static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
+  {
+    if (mod != WaW)
+      log(dst, size);
+    ::memset(dst, c, size);
+  }
+
+  virtual gtm_restart_reason begin_or_restart() { return NO_RESTART; }
+  virtual bool trycommit(gtm_word& priv_time) { return true; }
+  // Local undo will handle this.
+  // trydropreference() need not be changed either.
+  virtual void rollback() { }
+  // [transmem] Likewise for closed nested transactions
+  virtual bool closed_nesting() { return true; }
+
+  CREATE_DISPATCH_METHODS(virtual, )
+  CREATE_DISPATCH_METHODS_MEM()
+
+  serial_dispatch() : abi_dispatch(false, true, false,
+      gtm_thread::STATE_SERIAL, &o_serial_mg)
+  { }
+};
+
+} // anon namespace
+
+static const serialirr_dispatch o_serialirr_dispatch;
+static const serial_dispatch o_serial_dispatch;
+
+abi_dispatch *
+GTM::dispatch_serialirr ()
+{
+  return const_cast<serialirr_dispatch *>(&o_serialirr_dispatch);
+}
+
+abi_dispatch *
+GTM::dispatch_serial ()
+{
+  return const_cast<serial_dispatch *>(&o_serial_dispatch);
+}
+
+// [transmem] Inevitable transactions
+//
+// Serial-irrevocable mode stops all other transactions while a transaction
+// that cannot roll back (e.g., because it does I/O) runs.  Methods that have
+// an inevitable variant (see abi_dispatch::inevitable_alternative()) instead
+// let one such transaction, which holds the inevitability token, run
+// concurrently with speculative transactions.  Those see it as a writer that
+// has already committed: NOrec's inevitable transaction holds the sequence
+// lock and writes in place, lazy's acquires orecs at the first write.  It
+// adds the cache lines that it must protect from the other transactions to
+// inevitable_lines, where they check for them.
+//
+// A transaction that asks for irrevocability at its start waits for the token
+// before it becomes active.  A transaction that asks later only tries to get
+// it, and otherwise restarts and asks at its start.  Transactions go
+// serial-irrevocable as before if the method has no inevitable variant, if
+// they run uninstrumented code, or if ITM_INEVITABLE=0.
+//
+// Once _ITM_changeTransactionMode() returns, the compiler may run the rest of
+// the transaction without barriers (GCC does, for code after a call to a
+// function that is not transaction-safe).  The inevitable transaction only
+// goes on concurrently from there if its method keeps the other transactions
+// away from all data (see abi_dispatch::run_uninstrumented()).  Otherwise,
+// it upgrades the serial lock, which cannot fail: other writers back off
+// while somebody holds the token (see gtm_rwlock::write_lock_generic()).
+// The speculative transactions never wait for the inevitable transaction
+// while they are active, so they do not hold up the upgrade.
+
+bool GTM::inevitable_enabled = true;
+atomic<gtm_thread *> gtm_thread::inevitable_owner;
+gtm_line_filter gtm_thread::inevitable_lines;
+
+// Bumped whenever the inevitability token is released
+static atomic<int> inevitable_seq;
+
+// Take the inevitability token.  If another transaction holds it, returns
+// false, or waits until the token is released if WAIT is true.  Waiting must
+// only be done while the transaction is inactive.
+bool
+GTM::gtm_thread::take_inevitable (bool wait)
+{
+  while (true)
+    {
+      int seq = inevitable_seq.load (memory_order_acquire);
+      gtm_thread *owner = 0;
+      if (inevitable_owner.compare_exchange_strong (owner, this,
+                                                    memory_order_seq_cst,
+                                                    memory_order_relaxed)
+          || owner == this)
+        return true;
+      if (!wait)
+        return false;
+      futex_wait (&inevitable_seq, seq);
+    }
+}
+
+// Release the inevitability token after the transaction has committed, or
+// before it restarts.
+void
+GTM::gtm_thread::release_inevitable ()
+{
+  inevitable_owner.store (0, memory_order_release);
+  inevitable_seq.fetch_add (1, memory_order_release);
+  futex_wake (&inevitable_seq, INT_MAX);
+}
+
+// Wait until the current inevitable transaction has finished, unless it is
+// TX.  Must be called while TX is inactive, because the inevitable
+// transaction might wait for it to quiesce or to leave the serial lock.
+void
+GTM::gtm_thread::wait_inevitable (gtm_thread *tx)
+{
+  int seq = inevitable_seq.load (memory_order_acquire);
+  gtm_thread *owner = inevitable_owner.load (memory_order_acquire);
+  if (owner != 0 && owner != tx)
+    futex_wait (&inevitable_seq, seq);
+}
+
+// Put the transaction into serial-irrevocable mode.  [transmem] Or let it
+// continue as the inevitable transaction, if possible.
+
+void
+GTM::gtm_thread::serialirr_mode ()
+{
+  struct abi_dispatch *disp = abi_disp ();
+  abi_dispatch *irr;
+
+  if (this->state & STATE_SERIAL)
+    {
+      if (this->state & STATE_IRREVOCABLE)
+    return;
+
+      // Try to commit the dispatch-specific part of the transaction, as we
+      // would do for an outermost commit.
+      // We're already serial, so we don't need to ensure privatization safety
+      // for other transactions here.
+      gtm_word priv_time = 0;
+      bool ok = disp->trycommit (priv_time);
+      // Given that we're already serial, the trycommit better work.
+      assert (ok);
+    }
+  else if (this->state & STATE_IRREVOCABLE)
+    {
+      // [transmem] We are the inevitable transaction already.  Go on if our
+      // method keeps the others away from the data that we access without
+      // barriers, or become serial.  We hold the token, so the upgrade
+      // cannot fail, and our dispatch cannot fail to commit.
+      if (disp->run_uninstrumented ())
+        return;
+      serial_lock.write_upgrade (this);
+      this->state |= STATE_SERIAL;
+      gtm_word priv_time = 0;
+      disp->trycommit (priv_time);
+      gtm_thread::serial_lock.write_upgrade_finish(this);
+    }
+  else if (inevitable_enabled
+           && (irr = disp->inevitable_alternative ()) != 0)
+    {
+      if (!take_inevitable (false) || !irr->become_inevitable ())
+        restart (RESTART_SERIAL_IRR);
+      this->state |= STATE_IRREVOCABLE;
+      set_abi_disp (irr);
+      return;
+    }
+  else if (serial_lock.write_upgrade (this))
+    {
+      this->state |= STATE_SERIAL;
+      // Try to commit the dispatch-specific part of the transaction, as we
+      // would do for an outermost commit.
+      // We have successfully upgraded to serial mode, so we don't need to
+      // ensure privatization safety for other transactions here.
+      // However, we are still a reader (wrt. privatization safety) until we
+      // have either committed or restarted, so finish the upgrade after that.
+      gtm_word priv_time = 0;
+      if (!disp->trycommit (priv_time))
+        restart (RESTART_SERIAL_IRR, true);
+      gtm_thread::serial_lock.write_upgrade_finish(this);
+    }
+  else
+    restart (RESTART_SERIAL_IRR, false);
+
+  this->state |= (STATE_SERIAL | STATE_IRREVOCABLE);
+  set_abi_disp (dispatch_serialirr ());
+}
+
+void ITM_REGPARM
+_ITM_changeTransactionMode (_ITM_transactionState state)
+{
+  assert (state == modeSerialIrrevocable);
+  gtm_thr()->serialirr_mode ();
+}
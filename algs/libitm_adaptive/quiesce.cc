@@ -0,0 +1,128 @@
+#include "libitm_i.h"
+#include "futex.h"
+#include <limits.h>
+
+// [transmem] Blocking quiescence for privatization safety
+//
+// After a writer commits, it must wait until every other thread's
+// shared_state (its announcement slot) shows either that the thread is
+// inactive, or that its snapshot is at least our commit time.  We spin
+// briefly, since most transactions are short.  After that, a committer
+// blocks on a futex over a global epoch counter, which transactions bump
+// when they leave (read_unlock()) or restart with a new snapshot, but only
+// when somebody is waiting.  Transactions can also advance their snapshot
+// without leaving (e.g., snapshot extension), so the wait has a timeout.
+
+namespace GTM HIDDEN {
+
+// The number of spins before we block, and the timeout for blocking
+static const unsigned QUIESCE_SPINS = 1024;
+static const long QUIESCE_TIMEOUT_NS = 100000;
+
+// The global epoch, which changes whenever a waiter might have to re-check
+static atomic<int> quiesce_epoch;
+
+} // namespace GTM
+
+using namespace GTM;
+
+atomic<int> gtm_thread::quiesce_waiters;
+atomic<gtm_word> gtm_thread::quiesced_time;
+
+// Wait until every other thread's shared_state is at least PRIV_TIME.
+void
+gtm_thread::quiesce (gtm_word priv_time)
+{
+  list_walkers.fetch_add (1, memory_order_seq_cst);
+  for (gtm_thread *it = list_of_threads; it != 0; it = it->next_thread)
+    {
+      if (it == this)
+        continue;
+      // We need to load other threads' shared_state using acquire semantics
+      // (matching the release semantics of the respective updates).  This
+      // is necessary to ensure that the other threads' memory accesses
+      // happen before our actions that assume privatization safety.
+      unsigned spins = 0;
+      while (it->shared_state.load (memory_order_acquire) < priv_time)
+        {
+          if (++spins < QUIESCE_SPINS)
+            {
+              cpu_relax ();
+              continue;
+            }
+          // To avoid lost wake-ups, we announce ourselves and read the
+          // epoch before checking shared_state again (Dekker-style, see
+          // quiesce_notify()).  If the thread leaves after the check, the
+          // epoch will have changed and futex_wait returns at once.
+          quiesce_waiters.fetch_add (1, memory_order_seq_cst);
+          int epoch = quiesce_epoch.load (memory_order_relaxed);
+          if (it->shared_state.load (memory_order_acquire) < priv_time)
+            futex_wait_timed (&quiesce_epoch, epoch, QUIESCE_TIMEOUT_NS);
+          quiesce_waiters.fetch_sub (1, memory_order_relaxed);
+        }
+    }
+  list_walkers.fetch_sub (1, memory_order_release);
+
+  // Transactions that start from now on get a snapshot of at least
+  // priv_time, so we can advance quiesced_time.
+  gtm_word t = quiesced_time.load (memory_order_relaxed);
+  while (t < priv_time
+         && !quiesced_time.compare_exchange_weak (t, priv_time,
+                                                  memory_order_release,
+                                                  memory_order_relaxed))
+    ;
+}
+
+// Wake all blocked committers, so they can re-check shared_state.
+void
+gtm_thread::quiesce_wake ()
+{
+  quiesce_epoch.fetch_add (1, memory_order_relaxed);
+  futex_wake (&quiesce_epoch, INT_MAX);
+}
+
+// [transmem] Privatization hints
+//
+// By default, every writer commit under ml_wt and lazy waits in quiesce(),
+// since any transaction might privatize data.  A program that knows which of
+// its transactions privatize can call _ITM_setPrivatizationPolicy
+// (privatizationMarked) and then _ITM_markPrivatizing() from within those
+// transactions; all other writer commits then skip quiescence.  Transactions
+// that register user actions still quiesce, since doomed transactions may be
+// reading the memory that they release.  Memory that transactions free with
+// the transactional allocator is reclaimed later instead (see reclaim.cc).
+
+namespace GTM HIDDEN {
+
+static atomic<_ITM_privatizationPolicy> priv_policy (privatizationAlways);
+
+} // namespace GTM
+
+bool
+gtm_thread::skip_quiescence () const
+{
+  if (user_actions.size () != 0)
+    return false;
+  if (abi_disp ()->privatization_safe ())
+    return true;
+  return !privatizing
+    && priv_policy.load (memory_order_relaxed) == privatizationMarked;
+}
+
+// Set the policy.  This should be called before any transactions run: a
+// transaction that commits around the call may or may not see the change.
+void ITM_REGPARM
+_ITM_setPrivatizationPolicy (_ITM_privatizationPolicy policy)
+{
+  priv_policy.store (policy, memory_order_relaxed);
+}
+
+// Declare that the current transaction privatizes data.  Outside of a
+// transaction, this does nothing.
+void ITM_REGPARM
+_ITM_markPrivatizing (void)
+{
+  gtm_thread *tx = gtm_thr();
+  if (tx && tx->nesting > 0)
+    tx->privatizing = true;
+}
@@ -0,0 +1,105 @@
+#include "libitm_i.h"
+
+// [transmem] Time base modes (see timebase.h)
+
+namespace GTM HIDDEN {
+
+gtm_timebase_mode timebase_mode = TB_GV1;
+
+} // namespace GTM
+
+using namespace GTM;
+
+// Threads are spread over the shards by the address of their gtm_thread.
+gtm_timebase::shard &
+gtm_timebase::shard_of (gtm_thread *tx)
+{
+  uint64_t h = (uint64_t) (uintptr_t) tx * 0x9e3779b97f4a7c15ULL;
+  return shards[h >> 60];
+}
+
+gtm_word
+gtm_timebase::now_sharded () const
+{
+  gtm_word t = 0;
+  for (unsigned i = 0; i < TB_SHARDS; ++i)
+    {
+      gtm_word s = shards[i].time.load (memory_order_acquire);
+      if (s > t)
+        t = s;
+    }
+  return t;
+}
+
+// Raise the counter to at least T, and return the resulting time.
+gtm_word
+gtm_timebase::raise (gtm_word t)
+{
+  gtm_word cur = time.load (memory_order_acquire);
+  while (cur < t
+         && !time.compare_exchange_weak (cur, t, memory_order_seq_cst,
+                                         memory_order_acquire))
+    ;
+  // Our subsequent validation must see the locks of writers that read the
+  // counter before we raised it (see commit_slow()).
+  atomic_thread_fence (memory_order_seq_cst);
+  return cur < t ? t : cur;
+}
+
+gtm_word
+gtm_timebase::commit_slow (gtm_thread *tx, bool &unique)
+{
+  // Our lock acquisitions must be visible before we read the time.  Then, a
+  // transaction that gets a snapshot at least as large as our commit time
+  // must have read a time that was published after our read, and so it will
+  // see our locks.
+  atomic_thread_fence (memory_order_seq_cst);
+  unique = false;
+
+  if (timebase_mode == TB_GV4)
+    {
+      gtm_word t = time.load (memory_order_relaxed);
+      if (time.compare_exchange_strong (t, t + 1, memory_order_acq_rel,
+                                        memory_order_acquire))
+        {
+          unique = true;
+          return t + 1;
+        }
+      // Somebody else incremented the counter after we read it, and thus
+      // after we locked our write set; share their commit time.
+      return t;
+    }
+
+  if (timebase_mode == TB_GV5)
+    return time.load (memory_order_acquire) + 1;
+
+  // Sharded: publish our commit time in our shard.  Release memory order
+  // makes our locks visible to transactions that see the new shard value.
+  gtm_word ct = now_sharded () + 1;
+  shard &s = shard_of (tx);
+  gtm_word cur = s.time.load (memory_order_relaxed);
+  while (cur < ct
+         && !s.time.compare_exchange_weak (cur, ct, memory_order_acq_rel,
+                                           memory_order_relaxed))
+    ;
+  return ct;
+}
+
+gtm_word
+gtm_timebase::tick (gtm_thread *tx)
+{
+  if (timebase_mode != TB_SHARDED)
+    // Release memory order is sufficient but required here (see
+    // ml_wt_dispatch::rollback()).
+    return time.fetch_add (1, memory_order_release) + 1;
+  bool unique;
+  return commit_slow (tx, unique);
+}
+
+void
+gtm_timebase::reset ()
+{
+  time.store (0, memory_order_relaxed);
+  for (unsigned i = 0; i < TB_SHARDS; ++i)
+    shards[i].time.store (0, memory_order_relaxed);
+}
@@ -0,0 +1,132 @@
+#include "libitm_i.h"
+
+namespace GTM HIDDEN {
+
+// The portable validation kernel: compare a word at a time, and then finish
+// with bytes.  We use memcpy to do the (possibly unaligned) word loads.
+bool
+valuecheck_scalar (const uint8_t *mem, const uint8_t *logged, size_t len)
+{
+  for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t))
+    {
+      uint64_t a, b;
+      __builtin_memcpy(&a, mem, sizeof(a));
+      __builtin_memcpy(&b, logged, sizeof(b));
+      if (a != b)
+        return false;
+      mem += sizeof(uint64_t);
+      logged += sizeof(uint64_t);
+    }
+  for (; len > 0; --len)
+    if (*mem++ != *logged++)
+      return false;
+  return true;
+}
+
+// The kernel to use for validation.  This is chosen once, when the library is
+// loaded, based on what the CPU supports.
+static const gtm_valuecheck_fn valuecheck_kernel =
+  avx2_available() ? valuecheck_avx2 : valuecheck_scalar;
+
+// Validate a value-based read set by iterating through the runs and ensuring
+// that every run of memory locations holds the values that were previously
+// observed
+bool
+gtm_valuelog::valuecheck (gtm_valuecheck_fn kernel)
+{
+  const uint8_t *logged = bytes();
+  for (run *r = runs.begin(), *re = runs.end(); r != re; ++r)
+    {
+      // A lone word is common (e.g., pointer chasing), and is not worth a
+      // call to the kernel
+      if (r->len == sizeof(uint64_t))
+        {
+          uint64_t a, b;
+          __builtin_memcpy(&a, r->addr, sizeof(a));
+          __builtin_memcpy(&b, logged + r->pos, sizeof(b));
+          if (a != b)
+            return false;
+        }
+      else if (!kernel(r->addr, logged + r->pos, r->len))
+        return false;
+    }
+  return true;
+}
+
+bool
+gtm_valuelog::valuecheck ()
+{
+  return valuecheck(valuecheck_kernel);
+}
+
+// [transmem] Remove the bytes [FROM, TO) of the value array, and the parts of
+// the runs that they describe.  Runs are in the order of their values, so we
+// binary search for the first one that ends after FROM, and slide the rest
+// down.  A run that covers the whole range (e.g., the transaction read an
+// array, or nodes that lie next to each other) is split in two, since the
+// caller relies on the positions after the range moving down by TO - FROM.
+void
+gtm_valuelog::release (size_t from, size_t to)
+{
+  size_t lo = 0, hi = runs.size();
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (runs[mid].pos + runs[mid].len <= from)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  if (lo == runs.size() || to <= from)
+    return;
+  if (runs[lo].pos < from && runs[lo].pos + runs[lo].len > to)
+    {
+      runs.push();
+      ::memmove(&runs[lo + 2], &runs[lo + 1],
+                (runs.size() - lo - 2) * sizeof(run));
+      run &before = runs[lo], &after = runs[lo + 1];
+      after.addr = before.addr + (to - before.pos);
+      after.len = before.pos + before.len - to;
+      after.pos = to;
+      before.len = from - before.pos;
+    }
+
+  size_t n = to - from;
+  run *out = &runs[lo];
+  for (run *r = &runs[lo], *re = runs.end(); r != re; ++r)
+    {
+      run x = *r;
+      size_t end = x.pos + x.len;
+      if (x.pos >= to)
+        {
+          // after the range: just move the values down
+          x.pos -= n;
+          *out++ = x;
+        }
+      else if (x.pos < from)
+        {
+          // keep the part before the range
+          x.len = from - x.pos;
+          *out++ = x;
+        }
+      else if (end > to)
+        {
+          // keep the part after the range
+          x.addr += to - x.pos;
+          x.len = end - to;
+          x.pos = from;
+          *out++ = x;
+        }
+    }
+  runs.set_size(out - runs.begin());
+
+  uint8_t *b = (uint8_t *) values.begin();
+  ::memmove(b + from, b + to, nbytes - to);
+  nbytes -= n;
+  values.set_size((nbytes + sizeof(gtm_word) - 1) / sizeof(gtm_word));
+
+  // The filter may point at values that have moved or are gone.
+  clear_filter();
+}
+
+} // namespace GTM
@@ -0,0 +1,135 @@
+#include "libitm_i.h"
+
+// [transmem] Multi-version store (see version.h)
+
+namespace GTM HIDDEN {
+
+static inline void
+bucket_lock (atomic<gtm_word> &lock)
+{
+  while (lock.load (memory_order_relaxed) != 0
+         || lock.exchange (1, memory_order_acquire) != 0)
+    cpu_relax ();
+}
+
+static inline void
+bucket_unlock (atomic<gtm_word> &lock)
+{
+  lock.store (0, memory_order_release);
+}
+
+} // namespace GTM
+
+using namespace GTM;
+
+void
+gtm_version_store::alloc ()
+{
+  const char *env = getenv ("ITM_MULTIVERSION");
+  buckets = NULL;
+  if (env != NULL && strtol (env, NULL, 10) != 0)
+    buckets = (bucket *) xcalloc (sizeof (bucket) << MV_BUCKET_BITS, true);
+}
+
+void
+gtm_version_store::release ()
+{
+  free (buckets);
+  buckets = NULL;
+}
+
+// Mark every version unused.  The data of a version is only read under its
+// mask, so it can stay.
+void
+gtm_version_store::clear ()
+{
+  if (buckets == NULL)
+    return;
+  for (size_t i = 0; i < ((size_t) 1 << MV_BUCKET_BITS); ++i)
+    {
+      bucket &b = buckets[i];
+      b.lock.store (0, memory_order_relaxed);
+      b.dropped = 0;
+      for (unsigned j = 0; j < MV_VERSIONS; ++j)
+        {
+          b.versions[j].slab = 0;
+          b.versions[j].mask = 0;
+          b.versions[j].ct = 0;
+        }
+    }
+}
+
+void
+gtm_version_store::save (uintptr_t slab, uint64_t mask, gtm_word ct)
+{
+  bucket &b = bucket_of (slab);
+  gtm_word horizon = gtm_thread::quiesced_time.load (memory_order_acquire);
+
+  bucket_lock (b.lock);
+  // Prefer a version that no transaction can need anymore, else evict the
+  // oldest one
+  version *v = &b.versions[0];
+  for (unsigned i = 0; i < MV_VERSIONS; ++i)
+    {
+      version *w = &b.versions[i];
+      if (w->ct <= horizon)
+        {
+          v = w;
+          break;
+        }
+      if (w->ct < v->ct)
+        v = w;
+    }
+  // Even a reused version counts as dropped, so that a stale horizon cannot
+  // make readers miss a version that they need.
+  if (v->ct > b.dropped)
+    b.dropped = v->ct;
+
+  v->slab = slab;
+  v->mask = mask;
+  v->ct = ct;
+  const uint8_t *src = (const uint8_t *) slab;
+  for (unsigned i = 0; i < 64; ++i)
+    if (mask & (1ULL << i))
+      v->data[i] = src[i];
+  bucket_unlock (b.lock);
+}
+
+bool
+gtm_version_store::read (gtm_word snapshot, const uint8_t *addr, uint8_t *buf,
+                         size_t len)
+{
+  uintptr_t slab = (uintptr_t) addr & ~(uintptr_t) 63;
+  unsigned off = (uintptr_t) addr & 63;
+  bucket &b = bucket_of (slab);
+
+  bucket_lock (b.lock);
+  if (b.dropped > snapshot)
+    {
+      bucket_unlock (b.lock);
+      return false;
+    }
+
+  // Writers save their versions before they write back, under this lock.
+  // Thus, any byte that we read here and that was overwritten after our
+  // snapshot is covered by a version.  For each byte, the oldest such
+  // version has the value as of our snapshot.
+  ::memcpy (buf, addr, len);
+  gtm_word best[64];
+  for (unsigned i = 0; i < len; ++i)
+    best[i] = ~(gtm_word) 0;
+  for (unsigned j = 0; j < MV_VERSIONS; ++j)
+    {
+      const version *v = &b.versions[j];
+      if (v->slab != slab || v->ct <= snapshot)
+        continue;
+      for (unsigned i = 0; i < len; ++i)
+        if ((v->mask & (1ULL << (off + i))) && v->ct < best[i])
+          {
+            buf[i] = v->data[off + i];
+            best[i] = v->ct;
+          }
+    }
+  bucket_unlock (b.lock);
+  return true;
+}
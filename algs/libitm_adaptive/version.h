@@ -0,0 +1,76 @@
+#ifndef LIBITM_VERSION_H
+#define LIBITM_VERSION_H 1
+
+// [transmem] The multi-version store used by lazy
+//
+// If ITM_MULTIVERSION is nonzero, every committing writer saves the values
+// that it is about to overwrite, one redo log slab at a time, together with
+// its commit time.  A read-only transaction that finds an orec newer than its
+// snapshot then does not need to extend its snapshot (and possibly abort):
+// the value as of its snapshot is the current value, overridden by the saved
+// values of the writers that committed after the snapshot.
+//
+// The store is a hash table of buckets, each with room for MV_VERSIONS
+// versions and protected by a spinlock.  A writer reuses a version once every
+// transaction has a snapshot at least as large as its commit time, which is
+// what quiesce() establishes.  Otherwise, it evicts the oldest version, and
+// the bucket remembers the largest commit time that it has evicted; readers
+// with an older snapshot cannot use the bucket and must restart.
+
+namespace GTM HIDDEN {
+
+struct gtm_version_store
+{
+  static const unsigned MV_VERSIONS = 4;
+  static const unsigned MV_BUCKET_BITS = 12;
+
+  // The old values of the bytes in MASK of the slab at SLAB, which the
+  // writer that committed at CT overwrote.  CT is zero for unused versions.
+  struct version
+  {
+    uintptr_t slab;
+    uint64_t mask;
+    gtm_word ct;
+    uint8_t data[64];
+  };
+
+  struct bucket
+  {
+    atomic<gtm_word> lock;
+    // The largest commit time of a version that was dropped from this bucket
+    gtm_word dropped;
+    version versions[MV_VERSIONS];
+  } __attribute__((aligned(HW_CACHELINE_SIZE)));
+
+  // The buckets, or NULL if the store is disabled.
+  bucket* buckets;
+
+  // In version.cc.  These must be called while holding the serial lock.
+  void alloc ();
+  void release ();
+  void clear ();
+
+  bool enabled () const { return buckets != 0; }
+
+  // Save the bytes in MASK of the 64-byte slab at SLAB, before a writer that
+  // has locked them and committed at CT overwrites them.
+  void save (uintptr_t slab, uint64_t mask, gtm_word ct);
+
+  // Read the LEN bytes at ADDR, which must not span a slab, as of time
+  // SNAPSHOT into BUF.  The orecs that cover the bytes must have been
+  // unlocked after SNAPSHOT was taken.  Returns false if the versions that
+  // we need have been dropped.
+  bool read (gtm_word snapshot, const uint8_t *addr, uint8_t *buf,
+             size_t len);
+
+private:
+  bucket &bucket_of (uintptr_t slab)
+  {
+    uint64_t h = (uint64_t) (slab >> 6) * 0x9e3779b97f4a7c15ULL;
+    return buckets[h >> (64 - MV_BUCKET_BITS)];
+  }
+};
+
+} // namespace GTM
+
+#endif // LIBITM_VERSION_H
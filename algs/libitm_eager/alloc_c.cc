@@ -33,19 +33,26 @@ extern "C" {
 void *
 _ITM_malloc (size_t sz)
 {
-  void *r = malloc (sz);
-  if (r)
-    gtm_thr()->record_allocation (r, free);
-  return r;
+  return gtm_thr()->allocate (sz, malloc, free);
 }
 
 /* Wrap: calloc (size_t nm, size_t sz)  */
 void *
 _ITM_calloc (size_t nm, size_t sz)
 {
-  void *r = calloc (nm, sz);
+  // [transmem] Zero a block from the arena (see arena.h), unless the size
+  // overflows, in which case calloc() fails.
+  size_t n;
+  if (__builtin_mul_overflow (nm, sz, &n))
+    {
+      void *r = calloc (nm, sz);
+      if (r)
+        gtm_thr()->record_allocation (r, free);
+      return r;
+    }
+  void *r = gtm_thr()->allocate (n, malloc, free);
   if (r)
-    gtm_thr()->record_allocation (r, free);
+    memset (r, 0, n);
   return r;
 }
 
@@ -0,0 +1,122 @@
+#ifndef LIBITM_ARENA_H
+#define LIBITM_ARENA_H 1
+
+// [transmem] The per-thread allocation arena used by transactional malloc
+// and operator new (see alloc.cc)
+//
+// Small allocations are served from a per-thread cache of blocks, with one
+// ring of blocks per size class (16 to 512 bytes) and allocator family (the
+// pair of allocation and free functions, e.g., malloc and free).  A ring
+// holds the blocks that the running transaction took, followed by the free
+// ones, and allocating moves a cursor over the free ones.  Thus, an abort
+// hands the transaction's blocks back by resetting the cursors, which it can
+// then reuse when it retries, and a commit gives them up by moving the start
+// of the rings.  Neither depends on the number of allocations.  Cache misses
+// allocate a block of the class size from the family.
+//
+// Allocations that the cache cannot hold (larger ones, or when a ring is
+// full) are logged and freed one by one on abort.  Frees are logged, too, and
+// executed at commit, or later if the committer did not wait for quiescence
+// (see reclaim.cc).  Blocks from malloc go back into the cache then, if they
+// fit a size class; for other families, we do not know the size of a block
+// (and operator delete may be replaced), so we call the free function.
+
+namespace GTM HIDDEN {
+
+// An allocation or free of the running transaction
+struct gtm_alloc_action
+{
+  void *ptr;
+  void (*free_fn)(void *);
+};
+
+struct gtm_alloc_arena
+{
+  static const unsigned MIN_SHIFT = 4;
+  static const unsigned CLASSES = 6;
+  static const size_t MAX_SIZE = (size_t) 1 << (MIN_SHIFT + CLASSES - 1);
+  static const unsigned BLOCKS = 64;
+  static const unsigned FAMILIES = 5;
+
+  // A ring of blocks of one size.  The transaction took [head, cursor), and
+  // [cursor, tail) are free.  The counters are free-running.
+  struct size_class
+  {
+    unsigned head, cursor, tail;
+    void *blocks[BLOCKS];
+  };
+
+  struct family
+  {
+    void *(*alloc_fn)(size_t);
+    void (*free_fn)(void *);
+    size_class classes[CLASSES];
+  };
+
+  // The families, allocated on first use
+  family *families[FAMILIES];
+  // One bit per size class (of any family) that the transaction took
+  // blocks from
+  uint32_t touched;
+  // Uncached allocations and the frees of the running transaction
+  vector<gtm_alloc_action> allocs;
+  vector<gtm_alloc_action> frees;
+
+  // A batch of frees of one committed transaction, which may be executed
+  // once every other thread's shared_state is at least EPOCH, or the
+  // reclamation generation is no longer GENERATION.  Its frees end at END
+  // in the limbo list.
+  struct limbo_batch
+  {
+    gtm_word epoch;
+    gtm_word generation;
+    size_t end;
+  };
+  // The frees that wait for reclamation, oldest batch first
+  vector<gtm_alloc_action> limbo;
+  vector<limbo_batch> batches;
+
+  ~gtm_alloc_arena() { release(); }
+
+  // Allocate SIZE bytes with ALLOC_FN for the running transaction, which
+  // are freed with FREE_FN on abort.
+  void *allocate (size_t size, void *(*alloc_fn)(size_t),
+                  void (*free_fn)(void *));
+  // Log an allocation that did not come from allocate().
+  void record (void *ptr, void (*free_fn)(void *))
+  {
+    gtm_alloc_action *a = allocs.push();
+    a->ptr = ptr;
+    a->free_fn = free_fn;
+  }
+  // Free PTR with FREE_FN when the running transaction commits.
+  void defer_free (void *ptr, void (*free_fn)(void *))
+  {
+    gtm_alloc_action *a = frees.push();
+    a->ptr = ptr;
+    a->free_fn = free_fn;
+  }
+
+  // Commit the running transaction's allocations and execute its frees.
+  void commit ();
+  // Likewise, but move the frees to the limbo list as a batch for EPOCH and
+  // GENERATION.
+  void commit (gtm_word epoch, gtm_word generation);
+  void rollback ();
+  // Execute the limbo batches for which every other thread's shared_state is
+  // at least HORIZON, or whose generation is not GENERATION.  Batches after
+  // the first one that does not qualify are kept.
+  void reclaim (gtm_word horizon, gtm_word generation);
+  // Free all cached blocks.  Must not be called in a transaction.
+  void release ();
+
+private:
+  int family_of (void *(*alloc_fn)(size_t), void (*free_fn)(void *));
+  void recycle (void *ptr);
+  void keep_allocations ();
+  void execute (gtm_alloc_action *begin, gtm_alloc_action *end);
+};
+
+} // namespace GTM
+
+#endif // LIBITM_ARENA_H
@@ -40,5 +40,37 @@ bool abi_dispatch::memmove_overlap_check(void *dst, const void *src,
   return true;
 }
 
+// [transmem] A library built for a single TM method with GTM_STATIC_DISPATCH
+// defines the ABI functions next to that method instead (see dispatch.h).
+#ifndef GTM_STATIC_DISPATCH
 CREATE_DISPATCH_FUNCTIONS(GTM::abi_disp()->, )
+#endif
 
+// [transmem] Commutative updates.  This library has no delta log (see
+// libitm_norec/delta.cc), so in a transaction they read and write through the
+// barriers.
+void ITM_REGPARM
+_ITM_addU8 (uint64_t *addr, uint64_t val)
+{
+  gtm_thread *tx = gtm_thr ();
+  if (tx == 0 || tx->nesting == 0)
+    *addr += val;
+  else
+    {
+      abi_dispatch *disp = abi_disp ();
+      disp->ITM_WU8 (addr, disp->ITM_RU8 (addr) + val);
+    }
+}
+
+void ITM_REGPARM
+_ITM_addF8 (double *addr, double val)
+{
+  gtm_thread *tx = gtm_thr ();
+  if (tx == 0 || tx->nesting == 0)
+    *addr += val;
+  else
+    {
+      abi_dispatch *disp = abi_disp ();
+      disp->ITM_WD (addr, disp->ITM_RD (addr) + val);
+    }
+}
@@ -69,11 +69,12 @@ GTM::gtm_thread::operator new (size_t s)
 }
 
 /* Free the given transaction. Raises an error if the transaction is still
-   in use.  */
+   in use.  [transmem] Other threads may still read it, so reap_threads()
+   frees it later (see reclaim.cc).  */
 void
 GTM::gtm_thread::operator delete(void *tx)
 {
-  free(tx);
+  bury ((gtm_thread *) tx);
 }
 
 static void
@@ -111,6 +112,10 @@ GTM::gtm_thread::~gtm_thread()
     }
   number_of_threads--;
   number_of_threads_changed(number_of_threads + 1, number_of_threads);
+  // [transmem] No transaction is active, so nobody can read the memory
+  // that we freed anymore.
+  arena.reclaim (~(gtm_word) 0, 0);
+  reap_threads ();
   serial_lock.write_unlock ();
 }
 
@@ -120,6 +125,7 @@ GTM::gtm_thread::gtm_thread ()
   // to initialize any of the other primitive-type members that do not have
   // constructors.
   shared_state.store(-1, memory_order_relaxed);
+  cm_reset ();
 
   // Register this transaction with the list of all threads' transactions.
   serial_lock.write_lock ();
@@ -127,6 +133,7 @@ GTM::gtm_thread::gtm_thread ()
   list_of_threads = this;
   number_of_threads++;
   number_of_threads_changed(number_of_threads - 1, number_of_threads);
+  reap_threads ();
   serial_lock.write_unlock ();
 
   if (pthread_once(&thr_release_once, thread_exit_init))
@@ -274,8 +281,10 @@ GTM::gtm_thread::rollback (bool aborting)
 
   // Roll back all actions that are supposed to happen around the transaction.
   rollback_user_actions (0);
-  commit_allocations (true, 0);
+  commit_allocations (true);
   revert_cpp_exceptions ();
+  privatizing = false;
+  elastic.reset ();
 
   // Reset the transaction. Do not reset this->state, which is handled by
   // the callers. Note that if we are not aborting, we reset the
@@ -326,8 +335,10 @@ GTM::gtm_thread::trycommit ()
   if (nesting > 0)
     return true;
 
-  // Commit of an outermost transaction.
+  // Commit of an outermost transaction.  [transmem] The reclamation
+  // generation cannot change while we are active (see reclaim.cc).
   gtm_word priv_time = 0;
+  gtm_word generation = reclaim_generation.load (memory_order_relaxed);
   if (abi_disp()->trycommit (priv_time))
     {
       // The transaction is now inactive. Everything that we still have to do
@@ -351,10 +362,18 @@ GTM::gtm_thread::trycommit ()
       cxa_catch_count = 0;
       cxa_unthrown = NULL;
       restart_total = 0;
-
-      // Ensure privatization safety, if necessary.
+      if (cm_policy != CM_IMMEDIATE)
+        cm_commit ();
+
+      // Ensure privatization safety, if necessary.  [transmem] If we skip
+      // quiescence, memory that we freed is reclaimed after RECLAIM_TIME.
+      gtm_word reclaim_time = priv_time;
+      if (priv_time && skip_quiescence ())
+        priv_time = 0;
+      privatizing = false;
+      elastic.reset ();
       if (priv_time)
-    {
+        {
           // There must be a seq_cst fence between the following loads of the
           // other transactions' shared_state and the dispatch-specific stores
           // that signal updates by this transaction (e.g., lock
@@ -363,28 +382,15 @@ GTM::gtm_thread::trycommit ()
           // readers will observe our updates.  We can reuse the seq_cst fence
           // in serial_lock.read_unlock() however, so we don't need another
           // one here.
-      // TODO Don't just spin but also block using cond vars / futexes
-      // here. Should probably be integrated with the serial lock code.
-      for (gtm_thread *it = gtm_thread::list_of_threads; it != 0;
-          it = it->next_thread)
-        {
-          if (it == this) continue;
-          // We need to load other threads' shared_state using acquire
-          // semantics (matching the release semantics of the respective
-          // updates).  This is necessary to ensure that the other
-          // threads' memory accesses happen before our actions that
-          // assume privatization safety.
-          // TODO Are there any platform-specific optimizations (e.g.,
-          // merging barriers)?
-          while (it->shared_state.load(memory_order_acquire) < priv_time)
-        cpu_relax();
+          quiesce (priv_time);
         }
-    }
 
       // After ensuring privatization safety, we execute potentially
       // privatizing actions (e.g., calling free()). User actions are first.
       commit_user_actions ();
-      commit_allocations (false, 0);
+      if (priv_time)
+        reclaim_time = 0;
+      commit_allocations (false, reclaim_time, generation);
 
       return true;
     }
@@ -416,6 +422,11 @@ GTM::gtm_thread::restart (gtm_restart_reason r, bool finish_serial_upgrade)
       disp = abi_disp();
     }
 
+  // [transmem] We have a new snapshot, which may be what a committer in
+  // quiesce() is waiting for.
+  atomic_thread_fence (memory_order_seq_cst);
+  quiesce_notify ();
+
   GTM_longjmp (choose_code_path(prop, disp) | a_restoreLiveVariables,
            &jb, prop);
 }
@@ -31,10 +31,12 @@ __thread gtm_thread_tls _gtm_thr_tls;
 #endif
 
 // See tls.h for comments.
+#ifndef GTM_STATIC_DISPATCH
 void * __attribute__((noinline))
 mask_stack_bottom(gtm_thread *tx)
 {
   return (uint8_t*)__builtin_dwarf_cfa() - 256;
 }
+#endif
 
 } // namespace GTM
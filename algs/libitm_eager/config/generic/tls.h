@@ -73,8 +73,20 @@ static inline void set_abi_disp(abi_dispatch *x) { _gtm_thr_tls.disp = x; }
 // no such calls, or can we determine a future-proof value otherwise?
 static inline void *
 mask_stack_top(gtm_thread *tx) { return tx->jb.cfa; }
+#ifndef GTM_STATIC_DISPATCH
 void * __attribute__((noinline))
 mask_stack_bottom(gtm_thread *tx);
+#else
+// [transmem] When the barriers are inlined into the ABI functions (see
+// dispatch.h), the frame that we get here is the ABI function's, which is
+// right below the calling function, so we can save the call.  If the
+// compiler does not inline, we get a lower bound, which is safe as well.
+static inline void * __attribute__((always_inline))
+mask_stack_bottom(gtm_thread *tx)
+{
+  return (uint8_t*)__builtin_dwarf_cfa() - 256;
+}
+#endif
 #endif
 
 } // namespace GTM
@@ -41,3 +41,14 @@ sys_futex0 (std::atomic<int> *addr, long op, long val)
     return -errno;
   return res;
 }
+
+// [transmem] As above, but FUTEX_WAIT gives up after the relative timeout TS
+static inline long
+sys_futex0_timed (std::atomic<int> *addr, long op, long val,
+		  const struct timespec *ts)
+{
+  long res = syscall (SYS_futex, (int*) addr, op, val, ts);
+  if (__builtin_expect (res == -1, 0))
+    return -errno;
+  return res;
+}
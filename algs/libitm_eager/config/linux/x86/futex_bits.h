@@ -41,6 +41,22 @@ sys_futex0 (std::atomic<int> *addr, long op, long val)
   return res;
 }
 
+// [transmem] As above, but FUTEX_WAIT gives up after the relative timeout TS
+static inline long
+sys_futex0_timed (std::atomic<int> *addr, long op, long val,
+		  const struct timespec *ts)
+{
+  register const struct timespec *r10 __asm__("%r10") = ts;
+  long res;
+
+  __asm volatile ("syscall"
+		  : "=a" (res)
+		  : "0" (SYS_futex), "D" (addr), "S" (op), "d" (val), "r" (r10)
+		  : "r11", "rcx", "memory");
+
+  return res;
+}
+
 #else
 # ifndef SYS_futex
 #  define SYS_futex	240
@@ -63,6 +79,22 @@ sys_futex0 (std::atomic<int> *addr, int op, int val)
   return res;
 }
 
+static inline long
+sys_futex0_timed (std::atomic<int> *addr, int op, int val,
+		  const struct timespec *ts)
+{
+  long res;
+
+  __asm volatile ("xchgl\t%%ebx, %2\n\t"
+		  "int\t$0x80\n\t"
+		  "xchgl\t%%ebx, %2"
+		  : "=a" (res)
+		  : "0"(SYS_futex), "r" (addr), "c"(op),
+		    "d"(val), "S"(ts)
+		  : "memory");
+  return res;
+}
+
 # else
 
 static inline long
@@ -78,5 +110,19 @@ sys_futex0 (std::atomic<int> *addr, int op, int val)
   return res;
 }
 
+static inline long
+sys_futex0_timed (std::atomic<int> *addr, int op, int val,
+		  const struct timespec *ts)
+{
+  long res;
+
+  __asm volatile ("int $0x80"
+		  : "=a" (res)
+		  : "0"(SYS_futex), "b" (addr), "c"(op),
+		    "d"(val), "S"(ts)
+		  : "memory");
+  return res;
+}
+
 # endif /* __PIC__ */
 #endif /* __x86_64__ */
@@ -234,6 +234,105 @@ void ITM_REGPARM _ITM_memset##WRITE(void *dst, int c, size_t size) \
   ITM_WRITE_MEMCPY(T, WaW, TARGET, M2)
 
 
+// [transmem] Creates ABI functions for a library that is built for a single
+// TM method (with GTM_STATIC_DISPATCH, see barrier.cc).  If OBJ is the
+// current dispatch, they call the static methods of its class CLS, which
+// the compiler can inline.  Otherwise (e.g., in serial mode), they call the
+// virtual methods of the current dispatch.  CLS must create its static
+// methods with CREATE_DISPATCH_METHODS(static, _static).
+#define ITM_READ_STATIC(T, LSMOD, CLS, OBJ)                            \
+  _ITM_TYPE_##T ITM_REGPARM _ITM_##LSMOD##T (const _ITM_TYPE_##T *ptr) \
+  {                                                                    \
+    GTM::abi_dispatch *disp = GTM::abi_disp();                         \
+    if (likely (disp == OBJ))                                          \
+      return CLS::ITM_##LSMOD##T##_static(ptr);                        \
+    return disp->ITM_##LSMOD##T(ptr);                                  \
+  }
+
+#define ITM_WRITE_STATIC(T, LSMOD, CLS, OBJ)                               \
+  void ITM_REGPARM _ITM_##LSMOD##T (_ITM_TYPE_##T *ptr, _ITM_TYPE_##T val) \
+  {                                                                        \
+    GTM::abi_dispatch *disp = GTM::abi_disp();                             \
+    if (likely (disp == OBJ))                                              \
+      CLS::ITM_##LSMOD##T##_static(ptr, val);                              \
+    else                                                                   \
+      disp->ITM_##LSMOD##T(ptr, val);                                      \
+  }
+
+#define CREATE_DISPATCH_FUNCTIONS_T_STATIC(T, CLS, OBJ) \
+  ITM_READ_STATIC(T, R, CLS, OBJ)                \
+  ITM_READ_STATIC(T, RaR, CLS, OBJ)              \
+  ITM_READ_STATIC(T, RaW, CLS, OBJ)              \
+  ITM_READ_STATIC(T, RfW, CLS, OBJ)              \
+  ITM_WRITE_STATIC(T, W, CLS, OBJ)               \
+  ITM_WRITE_STATIC(T, WaR, CLS, OBJ)             \
+  ITM_WRITE_STATIC(T, WaW, CLS, OBJ)
+
+#define ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, NAME, READ, WRITE)             \
+void ITM_REGPARM _ITM_memcpy##NAME(void *dst, const void *src, size_t size)  \
+{                                                                            \
+  GTM::abi_dispatch *disp = GTM::abi_disp();                                 \
+  if (disp != OBJ)                                                           \
+    disp->memtransfer (dst, src, size, false,                                \
+       GTM::abi_dispatch::WRITE, GTM::abi_dispatch::READ);                   \
+  else if (size > 0)                                                         \
+    CLS::memtransfer_static (dst, src, size, false,                          \
+       GTM::abi_dispatch::WRITE, GTM::abi_dispatch::READ);                   \
+}                                                                            \
+void ITM_REGPARM _ITM_memmove##NAME(void *dst, const void *src, size_t size) \
+{                                                                            \
+  GTM::abi_dispatch *disp = GTM::abi_disp();                                 \
+  bool may_overlap = GTM::abi_dispatch::memmove_overlap_check(dst, src,      \
+      size, GTM::abi_dispatch::WRITE, GTM::abi_dispatch::READ);              \
+  if (disp != OBJ)                                                           \
+    disp->memtransfer (dst, src, size, may_overlap,                          \
+       GTM::abi_dispatch::WRITE, GTM::abi_dispatch::READ);                   \
+  else if (size > 0)                                                         \
+    CLS::memtransfer_static (dst, src, size, may_overlap,                    \
+       GTM::abi_dispatch::WRITE, GTM::abi_dispatch::READ);                   \
+}
+
+#define ITM_MEMSET_STATIC_DEF(CLS, OBJ, WRITE)                     \
+void ITM_REGPARM _ITM_memset##WRITE(void *dst, int c, size_t size) \
+{                                                                  \
+  GTM::abi_dispatch *disp = GTM::abi_disp();                       \
+  if (disp != OBJ)                                                 \
+    disp->memset (dst, c, size, GTM::abi_dispatch::WRITE);         \
+  else if (size > 0)                                               \
+    CLS::memset_static (dst, c, size, GTM::abi_dispatch::WRITE);   \
+}
+
+#define CREATE_DISPATCH_FUNCTIONS_STATIC(CLS, OBJ)  \
+  CREATE_DISPATCH_FUNCTIONS_T_STATIC (U1, CLS, OBJ) \
+  CREATE_DISPATCH_FUNCTIONS_T_STATIC (U2, CLS, OBJ) \
+  CREATE_DISPATCH_FUNCTIONS_T_STATIC (U4, CLS, OBJ) \
+  CREATE_DISPATCH_FUNCTIONS_T_STATIC (U8, CLS, OBJ) \
+  CREATE_DISPATCH_FUNCTIONS_T_STATIC (F, CLS, OBJ)  \
+  CREATE_DISPATCH_FUNCTIONS_T_STATIC (D, CLS, OBJ)  \
+  CREATE_DISPATCH_FUNCTIONS_T_STATIC (E, CLS, OBJ)  \
+  CREATE_DISPATCH_FUNCTIONS_T_STATIC (CF, CLS, OBJ) \
+  CREATE_DISPATCH_FUNCTIONS_T_STATIC (CD, CLS, OBJ) \
+  CREATE_DISPATCH_FUNCTIONS_T_STATIC (CE, CLS, OBJ) \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RnWt,     NONTXNAL, W)      \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RnWtaR,   NONTXNAL, WaR)    \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RnWtaW,   NONTXNAL, WaW)    \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtWn,     R,      NONTXNAL) \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtWt,     R,      W)        \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtWtaR,   R,      WaR)      \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtWtaW,   R,      WaW)      \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtaRWn,   RaR,    NONTXNAL) \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtaRWt,   RaR,    W)        \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtaRWtaR, RaR,    WaR)      \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtaRWtaW, RaR,    WaW)      \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtaWWn,   RaW,    NONTXNAL) \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtaWWt,   RaW,    W)        \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtaWWtaR, RaW,    WaR)      \
+  ITM_MEMTRANSFER_STATIC_DEF(CLS, OBJ, RtaWWtaW, RaW,    WaW)      \
+  ITM_MEMSET_STATIC_DEF(CLS, OBJ, W)   \
+  ITM_MEMSET_STATIC_DEF(CLS, OBJ, WaR) \
+  ITM_MEMSET_STATIC_DEF(CLS, OBJ, WaW)
+
+
 namespace GTM HIDDEN {
 
 struct method_group
@@ -295,6 +394,21 @@ public:
   // transactions.
   virtual bool supports(unsigned number_of_threads) { return true; }
 
+  // [transmem] Returns true iff this method ensures privatization safety
+  // without quiescence.  It must still set priv_time in trycommit() if
+  // gtm_thread::needs_quiescence(), for reclaiming freed memory.
+  virtual bool privatization_safe() { return false; }
+
+  // [transmem] Returns the size of the current transaction's read set, in
+  // the units of release_reads().  Used by elastic traversals (see
+  // elastic.cc); methods that return 0 keep all reads.
+  virtual size_t read_set_mark() { return 0; }
+
+  // [transmem] Drops the read set entries in [FROM, TO), given by
+  // read_set_mark(), so that validation no longer checks them.  Later
+  // entries move down by TO - FROM.
+  virtual void release_reads(size_t from, size_t to) { }
+
   bool read_only () const { return m_read_only; }
   bool write_through() const { return m_write_through; }
   bool can_run_uninstrumented_code() const
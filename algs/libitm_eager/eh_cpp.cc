@@ -34,6 +34,7 @@ using namespace GTM;
 extern "C" {
 
 extern void *__cxa_allocate_exception (size_t) WEAK;
+extern void __cxa_free_exception (void *) WEAK;
 extern void __cxa_throw (void *, void *, void *) WEAK;
 extern void *__cxa_begin_catch (void *) WEAK;
 extern void __cxa_end_catch (void) WEAK;
@@ -41,6 +42,7 @@ extern void __cxa_tm_cleanup (void *, void *, unsigned int) WEAK;
 
 #if !defined (HAVE_ELF_STYLE_WEAKREF)
 void *__cxa_allocate_exception (size_t) { return NULL; }
+void __cxa_free_exception (void *) { return; }
 void __cxa_throw (void *, void *, void *) { return; }
 void *__cxa_begin_catch (void *) { return NULL; }
 void __cxa_end_catch (void) { return; }
@@ -59,6 +61,18 @@ _ITM_cxa_allocate_exception (size_t size)
   return r;
 }
 
+/* [transmem] The constructor of an exception object can throw, in which case
+   the exception is freed before it is thrown, and must no longer be cleaned
+   up on abort.  */
+void
+_ITM_cxa_free_exception (void *exc_ptr)
+{
+  gtm_thread *t = gtm_thr();
+  if (t->cxa_unthrown == exc_ptr)
+    t->cxa_unthrown = NULL;
+  __cxa_free_exception (exc_ptr);
+}
+
 void
 _ITM_cxa_throw (void *obj, void *tinfo, void *dest)
 {
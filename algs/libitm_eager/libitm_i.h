@@ -69,6 +69,7 @@ enum gtm_restart_reason
   RESTART_VALIDATE_READ,
   RESTART_VALIDATE_WRITE,
   RESTART_VALIDATE_COMMIT,
+  RESTART_PRIORITY,
   RESTART_SERIAL_IRR,
   RESTART_NOT_READONLY,
   RESTART_CLOSED_NESTING,
@@ -77,6 +78,25 @@ enum gtm_restart_reason
   NO_RESTART = NUM_RESTARTS
 };
 
+// [transmem] The contention management policies, selected with the ITM_CM
+// environment variable.  They decide how long a transaction waits before it
+// restarts, and when it gives up and restarts in serial mode.  See
+// contention.cc.
+enum gtm_cm_policy
+{
+  CM_IMMEDIATE,		// restart at once; go serial after 100 restarts
+  CM_BACKOFF,		// randomized exponential backoff between restarts
+  CM_ADAPTIVE		// backoff, and go serial sooner when aborts are common
+};
+
+// [transmem] True iff R is a restart caused by a conflict with another
+// transaction, which is what the contention manager reacts to.
+inline bool
+restart_is_conflict (gtm_restart_reason r)
+{
+  return r >= RESTART_LOCKED_READ && r <= RESTART_PRIORITY;
+}
+
 } // namespace GTM
 
 #include "target.h"
@@ -86,6 +106,10 @@ enum gtm_restart_reason
 #include "stmlock.h"
 #include "dispatch.h"
 #include "containers.h"
+#include "linefilter.h"
+#include "arena.h"
+#include "orec.h"
+#include "timebase.h"
 
 #ifdef __USER_LABEL_PREFIX__
 # define UPFX UPFX1(__USER_LABEL_PREFIX__)
@@ -97,14 +121,6 @@ enum gtm_restart_reason
 
 namespace GTM HIDDEN {
 
-// This type is private to alloc.c, but needs to be defined so that
-// the template used inside gtm_thread can instantiate.
-struct gtm_alloc_action
-{
-  void (*free_fn)(void *);
-  bool allocated;
-};
-
 struct gtm_thread;
 
 // An undo log for writes.
@@ -137,6 +153,23 @@ struct gtm_rwlog_entry
   gtm_word value;
 };
 
+// [transmem] The state of an elastic traversal (see elastic.cc).  MARKS are
+// the read set sizes (see abi_dispatch::read_set_mark()) after each of the
+// last STEPS steps, oldest first, and FLOOR is the size when the traversal
+// began.  WINDOW is 0 if the transaction is not in a traversal.
+struct gtm_elastic
+{
+  static const size_t MAX_WINDOW = 16;
+
+  size_t window;
+  size_t steps;
+  size_t floor;
+  size_t marks[MAX_WINDOW];
+
+  gtm_elastic() : window(0), steps(0), floor(0) { }
+  void reset() { window = 0; }
+};
+
 // Contains all thread-specific data required by the entire library.
 // This includes all data relevant to a single transaction. Because most
 // thread-specific data is about the current transaction, we also refer to
@@ -170,8 +203,18 @@ struct gtm_thread
   vector<gtm_rwlog_entry> readlog;
   vector<gtm_rwlog_entry> writelog;
 
-  // Data used by alloc.c for the malloc/free undo log.
-  aa_tree<uintptr_t, gtm_alloc_action> alloc_actions;
+  // Data used by alloc.c for the malloc/free undo log.  [transmem] This is
+  // a per-thread arena now (see arena.h).
+  gtm_alloc_arena arena;
+  // [transmem] Set if the transaction freed memory (see alloc.cc)
+  bool freed_memory;
+  // [transmem] The next exited thread whose gtm_thread waits to be freed
+  // (see reclaim.cc)
+  gtm_thread *next_dead;
+  // [transmem] Set by _ITM_markPrivatizing() (see quiesce.cc)
+  bool privatizing;
+  // [transmem] The current elastic traversal (see elastic.cc)
+  gtm_elastic elastic;
 
   // Data used by useraction.c for the user-defined commit/abort handlers.
   vector<user_action> user_actions;
@@ -215,6 +258,18 @@ struct gtm_thread
   uint32_t restart_reason[NUM_RESTARTS];
   uint32_t restart_total;
 
+  // [transmem] Contention manager state (see contention.cc).  The abort rate
+  // is measured over windows of commits and conflict-induced restarts;
+  // cm_aborts_base is the number of conflicts in restart_reason[] at the
+  // start of the current window, and cm_serial_limit is the restart_total
+  // at which we fall back to serial mode.
+  uint32_t cm_seed;
+  uint32_t cm_commits;
+  uint32_t cm_aborts_base;
+  uint32_t cm_serial_limit;
+  // [transmem] True iff this transaction holds the priority token.
+  bool cm_priority;
+
   // *** The shared part of gtm_thread starts here. ***
   // Shared state is on separate cachelines to avoid false sharing with
   // thread-local parts of gtm_thread.
@@ -238,14 +293,21 @@ struct gtm_thread
   // The number of all registered threads.
   static unsigned number_of_threads;
 
+  // [transmem] The number of committers blocked in quiesce()
+  static atomic<int> quiesce_waiters;
+  // [transmem] The transaction that holds the priority token, or null (see
+  // contention.cc)
+  static atomic<gtm_thread *> priority_owner;
+  // [transmem] The number of threads that traverse list_of_threads without
+  // holding the serial lock, and the reclamation generation (see reclaim.cc)
+  static atomic<int> list_walkers;
+  static atomic<gtm_word> reclaim_generation;
+
   // In alloc.cc
-  void commit_allocations (bool, aa_tree<uintptr_t, gtm_alloc_action>*);
+  void commit_allocations (bool, gtm_word epoch = 0, gtm_word generation = 0);
+  void *allocate (size_t, void *(*)(size_t), void (*)(void *));
   void record_allocation (void *, void (*)(void *));
   void forget_allocation (void *, void (*)(void *));
-  void drop_references_allocations (const void *ptr)
-  {
-    this->alloc_actions.erase((uintptr_t) ptr);
-  }
 
   // In beginend.cc
   void rollback (bool aborting = false);
@@ -274,6 +336,56 @@ struct gtm_thread
   // Must be called from serial mode. Does not call set_abi_disp().
   void set_default_dispatch(abi_dispatch* disp);
 
+  // [transmem] In reclaim.cc
+  void retire_allocations (gtm_word epoch, gtm_word generation);
+  void reclaim ();
+  static void bury (gtm_thread *tx);
+  static void reap_threads ();
+  // Make the limbo batches of all threads safe to reclaim.  Must be called
+  // while holding the serial lock in write mode, whenever the values of
+  // shared_state may start over (e.g., when switching method groups).
+  static void new_reclaim_generation ()
+  {
+    reclaim_generation.fetch_add (1, memory_order_release);
+  }
+
+  // [transmem] In quiesce.cc
+  void quiesce (gtm_word priv_time);
+  static void quiesce_wake ();
+  // Wake committers blocked in quiesce().  Must be called after this
+  // thread's shared_state changed, with a seq_cst fence in between.
+  static void quiesce_notify ()
+  {
+    if (unlikely (quiesce_waiters.load (memory_order_relaxed) != 0))
+      quiesce_wake ();
+  }
+  // [transmem] True iff committing this transaction needs a privatization
+  // time even under a TM method that is otherwise privatization-safe: freed
+  // memory must not be reused (or unmapped) while doomed transactions may
+  // still read it, and user commit actions may free memory, too.  The
+  // former only delays the frees (see reclaim.cc); the latter must wait for
+  // quiescence.
+  bool needs_quiescence () const
+  {
+    return freed_memory || user_actions.size() != 0;
+  }
+  // [transmem] True iff a writer commit may skip quiescence, because the
+  // method is privatization-safe or the program declared that only marked
+  // transactions privatize data.  Freed memory is reclaimed later then.
+  bool skip_quiescence () const;
+
+  // [transmem] In contention.cc
+  void cm_reset ();
+  void cm_backoff ();
+  void cm_commit ();
+  uint32_t cm_conflicts () const;
+  bool cm_take_priority ();
+  void cm_release_priority ();
+  bool cm_priority_expired () const;
+  void cm_yield ();
+  void cm_note_read (const void *, size_t);
+  bool cm_priority_conflict (const void *, size_t) const;
+
   // In method-serial.cc
   void serialirr_mode ();
 
@@ -304,6 +416,9 @@ extern void GTM_error (const char *fmt, ...)
 extern void GTM_fatal (const char *fmt, ...)
   __attribute__((noreturn, format (printf, 1, 2)));
 
+// [transmem] The contention management policy (see contention.cc)
+extern gtm_cm_policy cm_policy;
+
 extern abi_dispatch *dispatch_serial();
 extern abi_dispatch *dispatch_serialirr();
 extern abi_dispatch *dispatch_ml_wt();
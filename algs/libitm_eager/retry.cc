@@ -68,8 +68,11 @@ GTM::gtm_thread::decide_retry_strategy (gtm_restart_reason r)
       if (disp->get_method_group()
           == default_dispatch.load(memory_order_relaxed)
           ->get_method_group())
-        // Still the same method group.
-        disp->get_method_group()->reinit();
+        {
+          // Still the same method group.
+          disp->get_method_group()->reinit();
+          new_reclaim_generation();
+        }
       serial_lock.write_unlock();
       // Also, we're making the transaction inactive, so when we become
       // active again, some other thread might have changed the default
@@ -79,20 +82,38 @@ GTM::gtm_thread::decide_retry_strategy (gtm_restart_reason r)
       set_abi_disp(disp);
     }
       else
-    // We are a serial transaction already, which makes things simple.
-    disp->get_method_group()->reinit();
+    {
+      // We are a serial transaction already, which makes things simple.
+      disp->get_method_group()->reinit();
+      new_reclaim_generation();
+    }
 
       return;
     }
 
   bool retry_irr = (r == RESTART_SERIAL_IRR);
-  bool retry_serial = (retry_irr || this->restart_total > 100);
+  bool retry_serial = (retry_irr
+                       || this->restart_total > this->cm_serial_limit);
 
   // We assume closed nesting to be infrequently required, so just use
   // dispatch_serial (with undo logging) if required.
   if (r == RESTART_CLOSED_NESTING)
     retry_serial = true;
 
+  // [transmem] If we are not going serial, let the contention manager delay
+  // the restart after a conflict.  We wait as an inactive transaction, so
+  // that we don't hold up serial transactions or other threads' quiescence,
+  // and then start over as if this were the first attempt (see above).
+  if (!retry_serial && cm_policy != CM_IMMEDIATE
+      && (this->state & STATE_SERIAL) == 0 && restart_is_conflict(r))
+    {
+      serial_lock.read_unlock(this);
+      cm_backoff();
+      disp = decide_begin_dispatch(prop);
+      set_abi_disp(disp);
+      return;
+    }
+
   if (retry_serial)
     {
       // In serialirr_mode we can succeed with the upgrade to
@@ -200,6 +221,7 @@ GTM::gtm_thread::set_default_dispatch(GTM::abi_dispatch* disp)
     {
       dd->get_method_group()->fini();
       disp->get_method_group()->init();
+      new_reclaim_generation();
     }
     }
   else
@@ -208,6 +230,93 @@ GTM::gtm_thread::set_default_dispatch(GTM::abi_dispatch* disp)
 }
 
 
+// [transmem] Read the contention management policy from ITM_CM.  The
+// default is to restart immediately, as libitm always has.
+static GTM::gtm_cm_policy
+parse_contention_manager()
+{
+  const char *env = getenv("ITM_CM");
+  GTM::gtm_cm_policy cm;
+  if (env == NULL)
+    return GTM::CM_IMMEDIATE;
+
+  while (isspace((unsigned char) *env))
+    ++env;
+  if (strncmp(env, "immediate", 9) == 0)
+    {
+      cm = GTM::CM_IMMEDIATE;
+      env += 9;
+    }
+  else if (strncmp(env, "backoff", 7) == 0)
+    {
+      cm = GTM::CM_BACKOFF;
+      env += 7;
+    }
+  else if (strncmp(env, "adaptive", 8) == 0)
+    {
+      cm = GTM::CM_ADAPTIVE;
+      env += 8;
+    }
+  else
+    goto unknown;
+
+  while (isspace((unsigned char) *env))
+    ++env;
+  if (*env == '\0')
+    return cm;
+
+ unknown:
+  GTM::GTM_error("Unknown contention manager in environment variable "
+      "ITM_CM\n");
+  return GTM::CM_IMMEDIATE;
+}
+
+// [transmem] Read the global time base mode from ITM_TIMEBASE (see
+// timebase.h).  The default is gv1.
+static GTM::gtm_timebase_mode
+parse_time_base()
+{
+  const char *env = getenv("ITM_TIMEBASE");
+  GTM::gtm_timebase_mode tb;
+  if (env == NULL)
+    return GTM::TB_GV1;
+
+  while (isspace((unsigned char) *env))
+    ++env;
+  if (strncmp(env, "gv1", 3) == 0)
+    {
+      tb = GTM::TB_GV1;
+      env += 3;
+    }
+  else if (strncmp(env, "gv4", 3) == 0)
+    {
+      tb = GTM::TB_GV4;
+      env += 3;
+    }
+  else if (strncmp(env, "gv5", 3) == 0)
+    {
+      tb = GTM::TB_GV5;
+      env += 3;
+    }
+  else if (strncmp(env, "sharded", 7) == 0)
+    {
+      tb = GTM::TB_SHARDED;
+      env += 7;
+    }
+  else
+    goto unknown;
+
+  while (isspace((unsigned char) *env))
+    ++env;
+  if (*env == '\0')
+    return tb;
+
+ unknown:
+  GTM::GTM_error("Unknown time base in environment variable "
+      "ITM_TIMEBASE\n");
+  return GTM::TB_GV1;
+}
+
 static GTM::abi_dispatch*
 parse_default_method()
 {
@@ -266,6 +375,8 @@ GTM::gtm_thread::number_of_threads_changed(unsigned previous, unsigned now)
       // Check for user preferences here.
       default_dispatch = 0;
       default_dispatch_user = parse_default_method();
+      cm_policy = parse_contention_manager();
+      timebase_mode = parse_time_base();
     }
     }
   else if (now == 0)
@@ -0,0 +1,114 @@
+#ifndef LIBITM_TIMEBASE_H
+#define LIBITM_TIMEBASE_H 1
+
+// [transmem] The global time base used by ml_wt and lazy
+//
+// Transactions take a snapshot time when they start, and writers get a
+// commit time once they have locked their write set.  The mode is chosen
+// with ITM_TIMEBASE:
+//
+//  - gv1:     every writer commit increments the counter (the default, and
+//             the original libitm behavior).
+//  - gv4:     writers try to increment the counter with a single CAS, and
+//             adopt the winner's value if the CAS fails.  Writers that share
+//             a commit time have disjoint (locked) write sets.
+//  - gv5:     writers commit at counter+1 without incrementing the counter.
+//             A transaction that sees an orec newer than the counter raises
+//             the counter to that time before it revalidates.
+//  - sharded: the counter is split into TB_SHARDS cache lines, and the time
+//             is the maximum over all of them.  Writers commit at that
+//             maximum plus one, which they store in their own shard.
+//
+// Except in gv1, a commit time can be shared, so a writer cannot skip
+// validation just because its snapshot is one less than its commit time.
+// In all modes, a writer must lock its write set before it reads the time
+// for its commit, and a transaction whose snapshot is at least the commit
+// time of a writer must see either that writer's locks or its new versions.
+
+namespace GTM HIDDEN {
+
+struct gtm_thread;
+
+enum gtm_timebase_mode
+{
+  TB_GV1,
+  TB_GV4,
+  TB_GV5,
+  TB_SHARDED
+};
+
+// The mode, chosen once at startup (see retry.cc)
+extern gtm_timebase_mode timebase_mode;
+
+struct gtm_timebase
+{
+  static const unsigned TB_SHARDS = 16;
+
+  // The counter for gv1, gv4 and gv5
+  atomic<gtm_word> time __attribute__((aligned(HW_CACHELINE_SIZE)));
+
+  // The shards, each on its own cache line
+  struct shard
+  {
+    atomic<gtm_word> time __attribute__((aligned(HW_CACHELINE_SIZE)));
+  } shards[TB_SHARDS];
+
+  // Returns the current time, for use as a snapshot.  Acquire memory order
+  // makes us see the lock acquisitions of writers that published this time.
+  gtm_word now () const
+  {
+    if (likely (timebase_mode != TB_SHARDED))
+      return time.load (memory_order_acquire);
+    return now_sharded ();
+  }
+
+  // Returns the current time, after making sure that it is at least SEEN,
+  // the time of an orec that is newer than our snapshot.
+  gtm_word now_at_least (gtm_word seen)
+  {
+    if (unlikely (timebase_mode == TB_GV5))
+      return raise (seen);
+    return now ();
+  }
+
+  // Returns a commit time for TX, which must have locked its write set.
+  // UNIQUE is set iff no other writer can get the same commit time.
+  gtm_word commit (gtm_thread *tx, bool &unique)
+  {
+    if (likely (timebase_mode == TB_GV1))
+      {
+        unique = true;
+        // We need acq_rel here because (1) the acquire part is required for
+        // the writer's subsequent call to validate(), and the release part is
+        // necessary to make other threads' validate() work as explained in
+        // extend().
+        return time.fetch_add (1, memory_order_acq_rel) + 1;
+      }
+    return commit_slow (tx, unique);
+  }
+
+  // Make sure that snapshots taken from now on are at least CT, so that
+  // transactions that start after a commit do not hold up its quiescence.
+  void publish (gtm_word ct)
+  {
+    if (timebase_mode == TB_GV5)
+      raise (ct);
+  }
+
+  // Returns a new time that no writer has committed at yet (see
+  // ml_wt_dispatch::rollback()).
+  gtm_word tick (gtm_thread *tx);
+
+  // Reset the time to zero.  Must be called while holding the serial lock.
+  void reset ();
+
+private:
+  gtm_word now_sharded () const;
+  gtm_word commit_slow (gtm_thread *tx, bool &unique);
+  gtm_word raise (gtm_word t);
+  shard &shard_of (gtm_thread *tx);
+};
+
+} // namespace GTM
+
+#endif // LIBITM_TIMEBASE_H
@@ -23,107 +23,270 @@
    <http://www.gnu.org/licenses/>.  */
 
 #include "libitm_i.h"
+#include <malloc.h>
 
 namespace GTM HIDDEN {
 
+// [transmem] Transactional malloc and new allocate through the per-thread
+// arena (see arena.h), and log allocations that they make otherwise.
+void *
+gtm_thread::allocate (size_t size, void *(*alloc_fn)(size_t),
+                      void (*free_fn)(void *))
+{
+  return this->arena.allocate (size, alloc_fn, free_fn);
+}
+
 void
 gtm_thread::record_allocation (void *ptr, void (*free_fn)(void *))
 {
-  uintptr_t iptr = (uintptr_t) ptr;
-
-  gtm_alloc_action *a = this->alloc_actions.find(iptr);
-  if (a == 0)
-    a = this->alloc_actions.insert(iptr);
-
-  a->free_fn = free_fn;
-  a->allocated = true;
+  this->arena.record (ptr, free_fn);
 }
 
 void
 gtm_thread::forget_allocation (void *ptr, void (*free_fn)(void *))
 {
-  uintptr_t iptr = (uintptr_t) ptr;
+  this->arena.defer_free (ptr, free_fn);
+  this->freed_memory = true;
+}
+
+/* Permanently commit allocated memory during transaction.
 
-  gtm_alloc_action *a = this->alloc_actions.find(iptr);
-  if (a == 0)
-    a = this->alloc_actions.insert(iptr);
+   REVERT_P is true if instead of committing the allocations, we want
+   to roll them back (and vice versa).  [transmem] If EPOCH is nonzero,
+   the frees are deferred until they are safe (see reclaim.cc).  */
+void
+gtm_thread::commit_allocations (bool revert_p, gtm_word epoch,
+                                gtm_word generation)
+{
+  if (revert_p)
+    this->arena.rollback ();
+  else if (epoch == 0 || !this->freed_memory)
+    this->arena.commit ();
+  else
+    retire_allocations (epoch, generation);
+  this->freed_memory = false;
+}
 
-  a->free_fn = free_fn;
-  a->allocated = false;
+// Returns the size class for SIZE, which must be at most MAX_SIZE.
+static inline unsigned
+size_class_of (size_t size)
+{
+  unsigned c = 0;
+  while (size > ((size_t) 1 << (gtm_alloc_arena::MIN_SHIFT + c)))
+    c++;
+  return c;
 }
 
-namespace {
-struct commit_cb_data {
-  aa_tree<uintptr_t, gtm_alloc_action>* parent;
-  bool revert_p;
-};
+// Returns the index of the family of ALLOC_FN and FREE_FN, creating it if
+// necessary, or -1 if there is no room for another family.
+int
+gtm_alloc_arena::family_of (void *(*alloc_fn)(size_t),
+                            void (*free_fn)(void *))
+{
+  for (unsigned i = 0; i < FAMILIES; i++)
+    {
+      family *f = this->families[i];
+      if (f == 0)
+        {
+          f = (family *) xcalloc (sizeof (family));
+          f->alloc_fn = alloc_fn;
+          f->free_fn = free_fn;
+          this->families[i] = f;
+          return i;
+        }
+      if (f->alloc_fn == alloc_fn && f->free_fn == free_fn)
+        return i;
+    }
+  return -1;
 }
 
-static void
-commit_allocations_2 (uintptr_t key, gtm_alloc_action *a, void *data)
+void *
+gtm_alloc_arena::allocate (size_t size, void *(*alloc_fn)(size_t),
+                           void (*free_fn)(void *))
 {
-  void *ptr = (void *)key;
-  commit_cb_data *cb_data = static_cast<commit_cb_data *>(data);
+  int i;
+  if (size > MAX_SIZE || this->scopes != 0
+      || (i = family_of (alloc_fn, free_fn)) < 0)
+    {
+      void *ptr = alloc_fn (size);
+      if (ptr)
+        record (ptr, free_fn);
+      return ptr;
+    }
+
+  unsigned c = size_class_of (size);
+  size_class &sc = this->families[i]->classes[c];
+  this->touched |= 1U << (i * CLASSES + c);
+  if (sc.cursor != sc.tail)
+    return sc.blocks[sc.cursor++ % BLOCKS];
+
+  // Cache miss.  Keep the new block in the ring if there is room, so that we
+  // can reuse it if we abort.
+  void *ptr = alloc_fn ((size_t) 1 << (MIN_SHIFT + c));
+  if (ptr == 0)
+    return ptr;
+  if (sc.tail - sc.head < BLOCKS)
+    {
+      sc.blocks[sc.tail++ % BLOCKS] = ptr;
+      sc.cursor++;
+    }
+  else
+    record (ptr, free_fn);
+  return ptr;
+}
 
-  if (cb_data->revert_p)
+// Put PTR, which the transaction freed with free(), back into the cache if
+// it fits a size class and there is room, or free it.
+void
+gtm_alloc_arena::recycle (void *ptr)
+{
+  size_t usable = malloc_usable_size (ptr);
+  int i;
+  if (usable < ((size_t) 1 << MIN_SHIFT) || usable >= 2 * MAX_SIZE
+      || (i = family_of (malloc, free)) < 0)
     {
-      // Roll back nested allocations.
-      if (a->allocated)
-	a->free_fn (ptr);
+      free (ptr);
+      return;
     }
+
+  // The largest class that the block can hold
+  unsigned c = size_class_of (usable);
+  if (((size_t) 1 << (MIN_SHIFT + c)) > usable)
+    c--;
+  if (c >= CLASSES)
+    c = CLASSES - 1;
+  size_class &sc = this->families[i]->classes[c];
+  if (sc.tail - sc.head < BLOCKS)
+    sc.blocks[sc.tail++ % BLOCKS] = ptr;
   else
+    free (ptr);
+}
+
+// The transaction keeps the blocks that it took.
+void
+gtm_alloc_arena::keep_allocations ()
+{
+  for (uint32_t t = this->touched; t != 0; t &= t - 1)
     {
-      if (a->allocated)
-	{
-	  // Add nested allocations to parent transaction.
-	  gtm_alloc_action* a_parent = cb_data->parent->insert(key);
-	  *a_parent = *a;
-	}
+      unsigned b = __builtin_ctz (t);
+      size_class &sc = this->families[b / CLASSES]->classes[b % CLASSES];
+      sc.head = sc.cursor;
+    }
+  this->touched = 0;
+  this->allocs.clear ();
+}
+
+void
+gtm_alloc_arena::execute (gtm_alloc_action *a, gtm_alloc_action *ae)
+{
+  for (; a != ae; a++)
+    {
+      if (a->free_fn == free)
+        recycle (a->ptr);
       else
-	{
-	  // ??? We could eliminate a parent allocation that matches this
-	  // memory release, if we had support for removing all accesses
-	  // to this allocation from the transaction's undo and redo logs
-	  // (otherwise, the parent transaction's undo or redo might write to
-	  // data that is already shared again because of calling free()).
-	  // We don't have this support currently, and the benefit of this
-	  // optimization is unknown, so just add it to the parent.
-	  gtm_alloc_action* a_parent;
-	  a_parent = cb_data->parent->insert(key);
-	  *a_parent = *a;
-	}
+        a->free_fn (a->ptr);
     }
 }
 
-static void
-commit_allocations_1 (uintptr_t key, gtm_alloc_action *a, void *cb_data)
+void
+gtm_alloc_arena::commit ()
+{
+  keep_allocations ();
+  execute (this->frees.begin (), this->frees.end ());
+  this->frees.clear ();
+}
+
+void
+gtm_alloc_arena::commit (gtm_word epoch, gtm_word generation)
 {
-  void *ptr = (void *)key;
-  uintptr_t revert_p = (uintptr_t) cb_data;
+  keep_allocations ();
+  size_t n = this->frees.size ();
+  if (n == 0)
+    return;
+  gtm_alloc_action *a = this->limbo.push (n);
+  memcpy (a, this->frees.begin (), n * sizeof (gtm_alloc_action));
+  this->frees.clear ();
 
-  if (a->allocated == revert_p)
-    a->free_fn (ptr);
+  limbo_batch *b = this->batches.push ();
+  b->epoch = epoch;
+  b->generation = generation;
+  b->end = this->limbo.size ();
 }
 
-/* Permanently commit allocated memory during transaction.
+void
+gtm_alloc_arena::rollback ()
+{
+  // Hand back the blocks that the transaction took.
+  for (uint32_t t = this->touched; t != 0; t &= t - 1)
+    {
+      unsigned b = __builtin_ctz (t);
+      size_class &sc = this->families[b / CLASSES]->classes[b % CLASSES];
+      sc.cursor = sc.head;
+    }
+  this->touched = 0;
+
+  for (gtm_alloc_action *a = this->allocs.begin (), *ae = this->allocs.end ();
+       a != ae; a++)
+    a->free_fn (a->ptr);
+  this->allocs.clear ();
+  this->frees.clear ();
+  this->scopes = 0;
+}
+
+void
+gtm_alloc_arena::rollback_scope (const scope &s)
+{
+  for (gtm_alloc_action *a = this->allocs.begin () + s.allocs,
+         *ae = this->allocs.end (); a != ae; a++)
+    a->free_fn (a->ptr);
+  this->allocs.set_size (s.allocs);
+  this->frees.set_size (s.frees);
+  this->scopes--;
+}
+
+void
+gtm_alloc_arena::reclaim (gtm_word horizon, gtm_word generation)
+{
+  size_t k = 0, n = this->batches.size ();
+  while (k < n && (this->batches[k].epoch <= horizon
+                   || this->batches[k].generation != generation))
+    k++;
+  if (k == 0)
+    return;
+
+  size_t end = this->batches[k - 1].end;
+  execute (this->limbo.begin (), this->limbo.begin () + end);
+
+  // Move the remaining batches to the front.
+  size_t rest = this->limbo.size () - end;
+  memmove (this->limbo.begin (), this->limbo.begin () + end,
+           rest * sizeof (gtm_alloc_action));
+  this->limbo.set_size (rest);
+  for (size_t i = k; i < n; i++)
+    {
+      this->batches[i - k] = this->batches[i];
+      this->batches[i - k].end -= end;
+    }
+  this->batches.set_size (n - k);
+}
 
-   REVERT_P is true if instead of committing the allocations, we want
-   to roll them back (and vice versa).  */
 void
-gtm_thread::commit_allocations (bool revert_p,
-    aa_tree<uintptr_t, gtm_alloc_action>* parent)
+gtm_alloc_arena::release ()
 {
-  if (parent)
+  for (unsigned i = 0; i < FAMILIES; i++)
     {
-      commit_cb_data cb_data;
-      cb_data.parent = parent;
-      cb_data.revert_p = revert_p;
-      this->alloc_actions.traverse (commit_allocations_2, &cb_data);
+      family *f = this->families[i];
+      if (f == 0)
+        continue;
+      for (unsigned c = 0; c < CLASSES; c++)
+        {
+          size_class &sc = f->classes[c];
+          for (unsigned b = sc.cursor; b != sc.tail; b++)
+            f->free_fn (sc.blocks[b % BLOCKS]);
+        }
+      free (f);
+      this->families[i] = 0;
     }
-  else
-    this->alloc_actions.traverse (commit_allocations_1,
-				  (void *)(uintptr_t)revert_p);
-  this->alloc_actions.clear ();
 }
 
 } // namespace GTM
@@ -43,6 +43,9 @@ using namespace GTM;
 #define _ZGTtnwXRKSt9nothrow_t	S(S(_ZGTtnw,MANGLE_SIZE_T),RKSt9nothrow_t)
 #define _ZGTtnaXRKSt9nothrow_t	S(S(_ZGTtna,MANGLE_SIZE_T),RKSt9nothrow_t)
 
+#define _ZGTtdlPvX		S(_ZGTtdlPv,MANGLE_SIZE_T)
+#define _ZGTtdlPvXRKSt9nothrow_t S(S(_ZGTtdlPv,MANGLE_SIZE_T),RKSt9nothrow_t)
+
 /* Everything from libstdc++ is weak, to avoid requiring that library
    to be linked into plain C applications using libitm.so.  */
 
@@ -89,44 +92,46 @@ del_opvnt (void *ptr)
   _ZdaPvRKSt9nothrow_t (ptr, NULL);
 }
 
+/* [transmem] Likewise for the new nothrow symbols, which the arena calls
+   with just a size (see arena.h).  */
+static void *
+new_opnt (size_t sz)
+{
+  return _ZnwXRKSt9nothrow_t (sz, NULL);
+}
+
+static void *
+new_opvnt (size_t sz)
+{
+  return _ZnaXRKSt9nothrow_t (sz, NULL);
+}
+
 /* Wrap: operator new (std::size_t sz)  */
 void *
 _ZGTtnwX (size_t sz)
 {
-  void *r = _ZnwX (sz);
-  if (r)
-    gtm_thr()->record_allocation (r, _ZdlPv);
-  return r;
+  return gtm_thr()->allocate (sz, _ZnwX, _ZdlPv);
 }
 
 /* Wrap: operator new (std::size_t sz, const std::nothrow_t&)  */
 void *
-_ZGTtnwXRKSt9nothrow_t (size_t sz, c_nothrow_p nt)
+_ZGTtnwXRKSt9nothrow_t (size_t sz, c_nothrow_p nt UNUSED)
 {
-  void *r = _ZnwXRKSt9nothrow_t (sz, nt);
-  if (r)
-    gtm_thr()->record_allocation (r, del_opnt);
-  return r;
+  return gtm_thr()->allocate (sz, new_opnt, del_opnt);
 }
 
 /* Wrap: operator new[] (std::size_t sz)  */
 void *
 _ZGTtnaX (size_t sz)
 {
-  void *r = _ZnaX (sz);
-  if (r)
-    gtm_thr()->record_allocation (r, _ZdaPv);
-  return r;
+  return gtm_thr()->allocate (sz, _ZnaX, _ZdaPv);
 }
 
 /* Wrap: operator new[] (std::size_t sz, const std::nothrow_t& nothrow)  */
 void *
-_ZGTtnaXRKSt9nothrow_t (size_t sz, c_nothrow_p nt)
+_ZGTtnaXRKSt9nothrow_t (size_t sz, c_nothrow_p nt UNUSED)
 {
-  void *r = _ZnaXRKSt9nothrow_t (sz, nt);
-  if (r)
-    gtm_thr()->record_allocation (r, del_opvnt);
-  return r;
+  return gtm_thr()->allocate (sz, new_opvnt, del_opvnt);
 }
 
 /* Wrap: operator delete(void* ptr)  */
@@ -145,6 +150,26 @@ _ZGTtdlPvRKSt9nothrow_t (void *ptr, c_nothrow_p nt UNUSED)
     gtm_thr()->forget_allocation (ptr, del_opnt);
 }
 
+/* [transmem] Wrap: operator delete (void *ptr, std::size_t sz), which g++
+   emits by default since C++14.  The size is only a hint, so we free with
+   the unsized operator, which also matches the free function that
+   operator new recorded.  */
+void
+_ZGTtdlPvX (void *ptr, size_t sz UNUSED)
+{
+  if (ptr)
+    gtm_thr()->forget_allocation (ptr, _ZdlPv);
+}
+
+/* [transmem] Wrap: operator delete (void *ptr, std::size_t sz,
+   const std::nothrow_t&), which GCC's libitm exports as well.  */
+void
+_ZGTtdlPvXRKSt9nothrow_t (void *ptr, size_t sz UNUSED, c_nothrow_p nt UNUSED)
+{
+  if (ptr)
+    gtm_thr()->forget_allocation (ptr, del_opnt);
+}
+
 /* Wrap: operator delete[] (void *ptr)  */
 void
 _ZGTtdaPv (void *ptr)
@@ -1,4 +1,5 @@
 #include "libitm_i.h"
+#include "bst.h"
 
 namespace GTM HIDDEN {
   /**
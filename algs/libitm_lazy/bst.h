@@ -20,7 +20,8 @@ namespace GTM HIDDEN
    *  node/slab by its index.  When the pool is exhausted, we can simply and
    *  efficiently realloc() it, and the indices do not need to change.
    *
-   *  [transmem] we should try to use a balanced tree or hash table instead.
+   *  [transmem] The redo log now uses the hash-based WriteSet (wset.h).  We
+   *             keep the BST around as a baseline for benchmarking.
    */
   class BST
   {
@@ -256,6 +257,9 @@ namespace GTM HIDDEN
        *  Method for Commutatively inserting an element to the write set, by type.
        *
        *  NB: This assumes that the datum does not span a 64-byte boundary
+       *
+       *  [transmem] Not implemented: commutative updates are kept in a
+       *  separate delta log (see delta.h), since the redo log is a WriteSet.
        */
       template <typename T>
       void commu_insert(const T* addr, T val);
@@ -33,6 +33,8 @@ namespace GTM HIDDEN {
 
 extern void futex_wait (std::atomic<int> *addr, int val);
 extern long futex_wake (std::atomic<int> *addr, int count);
+// [transmem] Like futex_wait, but gives up after NSEC nanoseconds.
+extern void futex_wait_timed (std::atomic<int> *addr, int val, long nsec);
 
 }
 
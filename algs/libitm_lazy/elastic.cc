@@ -0,0 +1,89 @@
+#include "libitm_i.h"
+
+// [transmem] Elastic traversals (_ITM_beginElastic and _ITM_elasticStep)
+//
+// A transaction that searches a linked list reads every node on its way, and
+// keeps them all in its read set, so a commit that changes any of them
+// invalidates it, although the outcome of the search only depends on the
+// last few nodes.  An elastic traversal lets the program say so: it calls
+// _ITM_beginElastic(WINDOW) before the search, and _ITM_elasticStep() each
+// time it moves to the next node.  The reads of the steps before the last
+// WINDOW ones are then dropped from the read set (see
+// abi_dispatch::release_reads()), so later validations no longer check them.
+// Reads before the traversal and after the last step stay, and the
+// traversal ends when the next one begins or the transaction ends.
+//
+// This is only correct if the nodes that the transaction relies on at the
+// end of the traversal are covered by the window, and if unlinking a node
+// writes to the node itself.  Otherwise, a transaction that is positioned
+// at a node that a concurrent transaction has removed cannot tell, because
+// the link to the node is gone from its read set.  NOrec validates by
+// value, so that write must change the value: _ITM_elasticUnlink clears the
+// node's next pointer.
+//
+// Methods whose read set positions are not stable (read_set_mark() returns
+// 0, or the read set shrinks, e.g., when the transaction becomes
+// inevitable) keep all reads.  Outside of transactions, these are no-ops.
+
+using namespace GTM;
+
+void ITM_REGPARM
+_ITM_beginElastic (size_t window)
+{
+  gtm_thread *tx = gtm_thr ();
+  if (tx == 0 || tx->nesting == 0)
+    return;
+
+  gtm_elastic &e = tx->elastic;
+  e.window = window == 0 ? 1
+    : window > gtm_elastic::MAX_WINDOW ? gtm_elastic::MAX_WINDOW : window;
+  e.steps = 0;
+  e.floor = abi_disp ()->read_set_mark ();
+}
+
+void ITM_REGPARM
+_ITM_elasticStep (void)
+{
+  gtm_thread *tx = gtm_thr ();
+  if (tx == 0 || tx->nesting == 0 || tx->elastic.window == 0)
+    return;
+
+  gtm_elastic &e = tx->elastic;
+  abi_dispatch *disp = abi_disp ();
+  size_t now = disp->read_set_mark ();
+  if (now < (e.steps ? e.marks[e.steps - 1] : e.floor))
+    {
+      e.reset ();
+      return;
+    }
+
+  if (e.steps == e.window)
+    {
+      // Drop the reads of the oldest step in the window.  The traversal
+      // reads from FLOOR on, so the ones before FLOOR stay.
+      size_t cut = e.marks[0];
+      size_t n = cut - e.floor;
+      if (n != 0)
+        disp->release_reads (e.floor, cut);
+      for (size_t i = 1; i < e.steps; i++)
+        e.marks[i - 1] = e.marks[i] - n;
+      e.steps--;
+      now -= n;
+    }
+  e.marks[e.steps++] = now;
+}
+
+// Unlinking a node that an elastic traversal may be positioned at.  This is
+// a transactional store of NULL to the node's link, but the program cannot
+// just write it: the node is usually freed right after it is unlinked, and
+// compilers drop stores to memory that is freed next.  Outside of
+// transactions, this is a plain store.
+void ITM_REGPARM
+_ITM_elasticUnlink (void **link)
+{
+  gtm_thread *tx = gtm_thr ();
+  if (tx == 0 || tx->nesting == 0)
+    *link = 0;
+  else
+    abi_disp ()->memset (link, 0, sizeof (*link), abi_dispatch::W);
+}
@@ -45,8 +45,8 @@ extern void _Unwind_DeleteException (_Unwind_Exception*) __attribute__((weak));
 
 #include "common.h"
 
-// [transmem] include bst for lazy redo log
-#include "bst.h"
+// [transmem] include hash write set for lazy redo log
+#include "wset.h"
 
 namespace GTM HIDDEN {
 
@@ -72,6 +72,8 @@ enum gtm_restart_reason
   RESTART_VALIDATE_READ,
   RESTART_VALIDATE_WRITE,
   RESTART_VALIDATE_COMMIT,
+  RESTART_PRIORITY,
+  RESTART_INEVITABLE,
   RESTART_SERIAL_IRR,
   RESTART_NOT_READONLY,
   RESTART_CLOSED_NESTING,
@@ -80,6 +82,25 @@ enum gtm_restart_reason
   NO_RESTART = NUM_RESTARTS
 };
 
+// [transmem] The contention management policies, selected with the ITM_CM
+// environment variable.  They decide how long a transaction waits before it
+// restarts, and when it gives up and restarts in serial mode.  See
+// contention.cc.
+enum gtm_cm_policy
+{
+  CM_IMMEDIATE,		// restart at once; go serial after 100 restarts
+  CM_BACKOFF,		// randomized exponential backoff between restarts
+  CM_ADAPTIVE		// backoff, and go serial sooner when aborts are common
+};
+
+// [transmem] True iff R is a restart caused by a conflict with another
+// transaction, which is what the contention manager reacts to.
+inline bool
+restart_is_conflict (gtm_restart_reason r)
+{
+  return r >= RESTART_LOCKED_READ && r <= RESTART_INEVITABLE;
+}
+
 } // namespace GTM
 
 #include "target.h"
@@ -89,6 +110,12 @@ enum gtm_restart_reason
 #include "stmlock.h"
 #include "dispatch.h"
 #include "containers.h"
+#include "linefilter.h"
+#include "arena.h"
+#include "delta.h"
+#include "orec.h"
+#include "timebase.h"
+#include "version.h"
 
 #ifdef __USER_LABEL_PREFIX__
 # define UPFX UPFX1(__USER_LABEL_PREFIX__)
@@ -100,14 +127,6 @@ enum gtm_restart_reason
 
 namespace GTM HIDDEN {
 
-// This type is private to alloc.c, but needs to be defined so that
-// the template used inside gtm_thread can instantiate.
-struct gtm_alloc_action
-{
-  void (*free_fn)(void *);
-  bool allocated;
-};
-
 struct gtm_thread;
 
 // An undo log for writes.
@@ -140,7 +159,63 @@ struct gtm_rwlog_entry
   gtm_word value;
 };
 
+// [transmem] An orec that a lazy transaction locks at commit, and one of the
+// stripes that it writes and that map to the orec.
+struct gtm_commit_orec
+{
+  size_t orec;
+  uintptr_t stripe;
+};
+
+// [transmem] The state of an elastic traversal (see elastic.cc).  MARKS are
+// the read set sizes (see abi_dispatch::read_set_mark()) after each of the
+// last STEPS steps, oldest first, and FLOOR is the size when the traversal
+// began.  WINDOW is 0 if the transaction is not in a traversal.
+struct gtm_elastic
+{
+  static const size_t MAX_WINDOW = 16;
+
+  size_t window;
+  size_t steps;
+  size_t floor;
+  size_t marks[MAX_WINDOW];
+
+  gtm_elastic() : window(0), steps(0), floor(0) { }
+  void reset() { window = 0; }
+};
+
 // Contains all thread-specific data required by the entire library.
+// [transmem] Contains all checkpoint data that is needed to roll back a
+// closed nested transaction, i.e., the state of its parent when it began.
+// Under methods that support closed nesting (see
+// abi_dispatch::closed_nesting()), the parent's writes are in the redo log or
+// in the undo log, and the redo log keeps a scope for each nested transaction
+// (see wset.h).  Reads stay in the read set when a nested transaction is
+// rolled back: the parent continues because the nested transaction was
+// cancelled, so it depends on what the latter read.
+struct gtm_transaction_cp
+{
+  gtm_jmpbuf jb;
+  size_t undolog_size;
+  WriteSet::scope redolog_scope;
+  gtm_alloc_arena::scope alloc_scope;
+  size_t user_actions_size;
+  _ITM_transactionId_t id;
+  uint32_t prop;
+  uint32_t cxa_catch_count;
+  void *cxa_unthrown;
+  // Nesting level of this checkpoint (1 means that this is a checkpoint of
+  // the outermost transaction).
+  uint32_t nesting;
+
+  void save(gtm_thread* tx);
+  void commit(gtm_thread* tx);
+};
+
+// [transmem] A thread's per-call-site profiles (see profile.cc)
+struct gtm_profile;
+struct gtm_site_profile;
+
 // This includes all data relevant to a single transaction. Because most
 // thread-specific data is about the current transaction, we also refer to
 // the transaction-specific parts of gtm_thread as "the transaction" (the
@@ -172,21 +247,45 @@ struct gtm_thread
   // Read and write logs.  Used by multi-lock TM methods.
   vector<gtm_rwlog_entry> readlog;
   vector<gtm_rwlog_entry> writelog;
+  // [transmem] The orecs that a lazy commit locks, in lock order.
+  vector<gtm_commit_orec> commit_orecs;
 
   // [transmem] Redo log
-  BST redolog_bst;
-
-  // Data used by alloc.c for the malloc/free undo log.
-  aa_tree<uintptr_t, gtm_alloc_action> alloc_actions;
+  WriteSet redolog;
+  // [transmem] Pending commutative updates (see delta.h)
+  gtm_delta_log deltas;
+
+  // Data used by alloc.c for the malloc/free undo log.  [transmem] This is
+  // a per-thread arena now (see arena.h).
+  gtm_alloc_arena arena;
+  // [transmem] Set if the transaction freed memory (see alloc.cc)
+  bool freed_memory;
+  // [transmem] The next exited thread whose gtm_thread waits to be freed
+  // (see reclaim.cc)
+  gtm_thread *next_dead;
+  // [transmem] Set by _ITM_markPrivatizing() (see quiesce.cc)
+  bool privatizing;
+  // [transmem] The current elastic traversal (see elastic.cc)
+  gtm_elastic elastic;
+  // [transmem] Set if the transaction read old versions (see version.h), and
+  // if it must not, because it turned out to be a writer
+  bool mv_snapshot;
+  bool mv_writer;
 
   // Data used by useraction.c for the user-defined commit/abort handlers.
   vector<user_action> user_actions;
 
+  // [transmem] Checkpoints of the parents of the current closed nested
+  // transaction, outermost first
+  vector<gtm_transaction_cp> parent_txns;
+
   // A numerical identifier for this transaction.
   _ITM_transactionId_t id;
 
   // The _ITM_codeProperties of this transaction as given by the compiler.
   uint32_t prop;
+  // [transmem] The call site of the outermost transaction (see retry.cc)
+  uintptr_t site;
 
   // The nesting depth for subsequently started transactions. This variable
   // will be set to 1 when starting an outermost transaction.
@@ -221,6 +320,23 @@ struct gtm_thread
   uint32_t restart_reason[NUM_RESTARTS];
   uint32_t restart_total;
 
+  // [transmem] Contention manager state (see contention.cc).  The abort rate
+  // is measured over windows of commits and conflict-induced restarts;
+  // cm_aborts_base is the number of conflicts in restart_reason[] at the
+  // start of the current window, and cm_serial_limit is the restart_total
+  // at which we fall back to serial mode.
+  uint32_t cm_seed;
+  uint32_t cm_commits;
+  uint32_t cm_aborts_base;
+  uint32_t cm_serial_limit;
+  // [transmem] True iff this transaction holds the priority token.
+  bool cm_priority;
+  // [transmem] This thread's profiles, the profile of the current call
+  // site, and the time when the transaction began (see profile.cc)
+  gtm_profile *profile;
+  gtm_site_profile *profile_site;
+  uint64_t profile_start;
+
   // *** The shared part of gtm_thread starts here. ***
   // Shared state is on separate cachelines to avoid false sharing with
   // thread-local parts of gtm_thread.
@@ -244,17 +360,34 @@ struct gtm_thread
   // The number of all registered threads.
   static unsigned number_of_threads;
 
+  // [transmem] The number of committers blocked in quiesce()
+  static atomic<int> quiesce_waiters;
+  // [transmem] The transaction that holds the priority token, or null (see
+  // contention.cc)
+  static atomic<gtm_thread *> priority_owner;
+  // [transmem] The inevitable transaction, or null, and the cache lines that
+  // it has accessed (see method-serial.cc)
+  static atomic<gtm_thread *> inevitable_owner;
+  static gtm_line_filter inevitable_lines;
+  // [transmem] The number of threads that traverse list_of_threads without
+  // holding the serial lock, and the reclamation generation (see reclaim.cc)
+  static atomic<int> list_walkers;
+  static atomic<gtm_word> reclaim_generation;
+  // [transmem] The largest priv_time for which quiesce() has finished; no
+  // active transaction has an older snapshot
+  static atomic<gtm_word> quiesced_time;
+
+  // [transmem] In delta.cc
+  void fold_deltas (const void *, size_t);
+
   // In alloc.cc
-  void commit_allocations (bool, aa_tree<uintptr_t, gtm_alloc_action>*);
+  void commit_allocations (bool, gtm_word epoch = 0, gtm_word generation = 0);
+  void *allocate (size_t, void *(*)(size_t), void (*)(void *));
   void record_allocation (void *, void (*)(void *));
   void forget_allocation (void *, void (*)(void *));
-  void drop_references_allocations (const void *ptr)
-  {
-    this->alloc_actions.erase((uintptr_t) ptr);
-  }
 
   // In beginend.cc
-  void rollback (bool aborting = false);
+  void rollback (gtm_transaction_cp *cp = 0, bool aborting = false);
   bool trycommit ();
   void restart (gtm_restart_reason, bool finish_serial_upgrade = false)
         ITM_NORETURN;
@@ -270,18 +403,81 @@ struct gtm_thread
   static uint32_t begin_transaction(uint32_t, const gtm_jmpbuf *)
   __asm__(UPFX "GTM_begin_transaction") ITM_REGPARM;
   // In eh_cpp.cc
-  void revert_cpp_exceptions ();
+  void revert_cpp_exceptions (gtm_transaction_cp *cp = 0);
 
   // In retry.cc
   // Must be called outside of transactions (i.e., after rollback).
   void decide_retry_strategy (gtm_restart_reason);
   abi_dispatch* decide_begin_dispatch (uint32_t prop);
+  abi_dispatch* decide_inevitable_dispatch (uint32_t prop);
+  // [transmem] Read-only prediction for the current call site (see retry.cc)
+  bool predict_read_only (uint32_t prop) const;
+  void note_read_only (bool read_only) const;
   void number_of_threads_changed(unsigned previous, unsigned now);
   // Must be called from serial mode. Does not call set_abi_disp().
   void set_default_dispatch(abi_dispatch* disp);
 
+  // [transmem] In reclaim.cc
+  void retire_allocations (gtm_word epoch, gtm_word generation);
+  void reclaim ();
+  static void bury (gtm_thread *tx);
+  static void reap_threads ();
+  // Make the limbo batches of all threads safe to reclaim.  Must be called
+  // while holding the serial lock in write mode, whenever the values of
+  // shared_state may start over (e.g., when switching method groups).
+  static void new_reclaim_generation ()
+  {
+    reclaim_generation.fetch_add (1, memory_order_release);
+  }
+
+  // [transmem] In quiesce.cc
+  void quiesce (gtm_word priv_time);
+  static void quiesce_wake ();
+  // Wake committers blocked in quiesce().  Must be called after this
+  // thread's shared_state changed, with a seq_cst fence in between.
+  static void quiesce_notify ()
+  {
+    if (unlikely (quiesce_waiters.load (memory_order_relaxed) != 0))
+      quiesce_wake ();
+  }
+  // [transmem] True iff committing this transaction needs a privatization
+  // time even under a TM method that is otherwise privatization-safe: freed
+  // memory must not be reused (or unmapped) while doomed transactions may
+  // still read it, and user commit actions may free memory, too.  The
+  // former only delays the frees (see reclaim.cc); the latter must wait for
+  // quiescence.
+  bool needs_quiescence () const
+  {
+    return freed_memory || user_actions.size() != 0;
+  }
+  // [transmem] True iff a writer commit may skip quiescence, because the
+  // method is privatization-safe or the program declared that only marked
+  // transactions privatize data.  Freed memory is reclaimed later then.
+  bool skip_quiescence () const;
+
+  // [transmem] In contention.cc
+  void cm_reset ();
+  void cm_backoff ();
+  void cm_commit ();
+  uint32_t cm_conflicts () const;
+  bool cm_take_priority ();
+  void cm_release_priority ();
+  bool cm_priority_expired () const;
+  void cm_yield ();
+  void cm_note_read (const void *, size_t);
+  bool cm_priority_conflict (const void *, size_t) const;
+
+  // [transmem] In profile.cc
+  void profile_begin ();
+  void profile_restart (gtm_restart_reason);
+  void profile_commit (size_t reads, size_t writes);
+  void profile_detach ();
+
   // In method-serial.cc
   void serialirr_mode ();
+  bool take_inevitable (bool wait);
+  void release_inevitable ();
+  static void wait_inevitable (gtm_thread *tx);
 
   // In useraction.cc
   void rollback_user_actions (size_t until_size = 0);
@@ -310,9 +506,19 @@ extern void GTM_error (const char *fmt, ...)
 extern void GTM_fatal (const char *fmt, ...)
   __attribute__((noreturn, format (printf, 1, 2)));
 
+// [transmem] The contention management policy (see contention.cc)
+extern gtm_cm_policy cm_policy;
+// [transmem] False if ITM_INEVITABLE=0 (see method-serial.cc)
+extern bool inevitable_enabled;
+// [transmem] True iff ITM_PROFILE is set (see profile.cc)
+extern bool profile_enabled;
+extern void profile_init ();
+
 extern abi_dispatch *dispatch_serial();
 extern abi_dispatch *dispatch_serialirr();
 extern abi_dispatch *dispatch_lazy();
+extern abi_dispatch *dispatch_lazy_ro();
+extern abi_dispatch *dispatch_lazy_irr();
 
 extern gtm_cacheline_mask gtm_mask_stack(gtm_cacheline *, gtm_cacheline_mask);
 
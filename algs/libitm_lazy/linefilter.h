@@ -0,0 +1,74 @@
+#ifndef LIBITM_LINEFILTER_H
+#define LIBITM_LINEFILTER_H 1
+
+// [transmem] A shared filter of cache lines
+//
+// One transaction adds the cache lines that it accesses, and other threads
+// test whether the lines that they access might be among them.  Lines hash to
+// one of 1024 bits, so tests can report false positives, but never false
+// negatives for lines that were added before the test (in the sense of the
+// fences around the filter, see the callers).  Used for the reads of the
+// priority transaction (see contention.cc) and for the accesses of the
+// inevitable transaction (see method-serial.cc).
+
+namespace GTM HIDDEN {
+
+struct gtm_line_filter
+{
+  static const uint32_t WORDS = 16;
+  static const uint32_t BITS_LOG2 = 10;
+
+  atomic<uint64_t> bits[WORDS];
+
+  static uint32_t bit_of (uintptr_t line)
+  {
+    return (uint32_t) (line * 0x9e3779b9u) >> (32 - BITS_LOG2);
+  }
+
+  // Add the lines that [ADDR, ADDR + LEN) overlaps.  Returns true if some
+  // line was not in the filter before.
+  bool add (const void *addr, size_t len)
+  {
+    bool added = false;
+    uintptr_t line = (uintptr_t) addr >> 6;
+    uintptr_t last = ((uintptr_t) addr + len - 1) >> 6;
+    for (; line <= last; ++line)
+      {
+        uint32_t b = bit_of (line);
+        atomic<uint64_t> *w = &bits[b / 64];
+        uint64_t m = (uint64_t) 1 << (b % 64);
+        if ((w->load (memory_order_relaxed) & m) == 0)
+          {
+            w->fetch_or (m, memory_order_relaxed);
+            added = true;
+          }
+      }
+    return added;
+  }
+
+  // Returns true if some line that [ADDR, ADDR + LEN) overlaps may be in the
+  // filter.
+  bool contains (const void *addr, size_t len) const
+  {
+    uintptr_t line = (uintptr_t) addr >> 6;
+    uintptr_t last = ((uintptr_t) addr + len - 1) >> 6;
+    for (; line <= last; ++line)
+      {
+        uint32_t b = bit_of (line);
+        uint64_t m = (uint64_t) 1 << (b % 64);
+        if (bits[b / 64].load (memory_order_acquire) & m)
+          return true;
+      }
+    return false;
+  }
+
+  void clear ()
+  {
+    for (uint32_t i = 0; i < WORDS; ++i)
+      bits[i].store (0, memory_order_release);
+  }
+};
+
+} // namespace GTM
+
+#endif // LIBITM_LINEFILTER_H
@@ -55,55 +55,44 @@ struct lazy_mg : public method_group
     return get_time(o) > than_time;
   }
 
-  // The shared time base.
-  atomic<gtm_word> time __attribute__((aligned(HW_CACHELINE_SIZE)));
+  // The shared time base.  [transmem] See timebase.h for the modes.
+  gtm_timebase time __attribute__((aligned(HW_CACHELINE_SIZE)));
 
-  // The array of ownership records.
-  atomic<gtm_word>* orecs __attribute__((aligned(HW_CACHELINE_SIZE)));
-  char tailpadding[HW_CACHELINE_SIZE - sizeof(atomic<gtm_word>*)];
+  // [transmem] The array of ownership records, and its geometry (see
+  // orec.h).
+  gtm_orec_table table __attribute__((aligned(HW_CACHELINE_SIZE)));
+  char tailpadding[HW_CACHELINE_SIZE - sizeof(gtm_orec_table)];
 
-  // Location-to-orec mapping.  Stripes of 16B mapped to 2^19 orecs.
-  static const gtm_word L2O_ORECS = 1 << 19;
-  static const gtm_word L2O_SHIFT = 4;
-  static size_t get_orec(const void* addr)
-  {
-    return ((uintptr_t)addr >> L2O_SHIFT) & (L2O_ORECS - 1);
-  }
-  static size_t get_next_orec(size_t orec)
-  {
-    return (orec + 1) & (L2O_ORECS - 1);
-  }
-  // Returns the next orec after the region.
-  static size_t get_orec_end(const void* addr, size_t len)
-  {
-    return (((uintptr_t)addr + len + (1 << L2O_SHIFT) - 1) >> L2O_SHIFT)
-        & (L2O_ORECS - 1);
-  }
+  // [transmem] Old versions for read-only transactions, if enabled (see
+  // version.h).
+  gtm_version_store versions;
 
   virtual void init()
   {
-    // We assume that an atomic<gtm_word> is backed by just a gtm_word, so
-    // starting with zeroed memory is fine.
-    orecs = (atomic<gtm_word>*) xcalloc(
-        sizeof(atomic<gtm_word>) * L2O_ORECS, true);
-    // This store is only executed while holding the serial lock, so relaxed
+    table.alloc();
+    versions.alloc();
+    // This is only executed while holding the serial lock, so relaxed
     // memory order is sufficient here.
-    time.store(0, memory_order_relaxed);
+    time.reset();
+    gtm_thread::quiesced_time.store(0, memory_order_relaxed);
   }
 
   virtual void fini()
   {
-    free(orecs);
+    table.release();
+    versions.release();
   }
 
   // We only re-initialize when our time base overflows.  Thus, only reset
   // the time base and the orecs but do not re-allocate the orec array.
   virtual void reinit()
   {
-    // This store is only executed while holding the serial lock, so relaxed
+    // This is only executed while holding the serial lock, so relaxed
     // memory order is sufficient here.  Same holds for the memset.
-    time.store(0, memory_order_relaxed);
-    memset(orecs, 0, sizeof(atomic<gtm_word>) * L2O_ORECS);
+    time.reset();
+    table.clear();
+    versions.clear();
+    gtm_thread::quiesced_time.store(0, memory_order_relaxed);
   }
 };
 
@@ -131,30 +120,118 @@ static lazy_mg o_lazy_mg;
 class lazy_dispatch : public abi_dispatch
 {
 protected:
-  static void pre_write(gtm_thread *tx, const void *addr, size_t len)
+  // [transmem] True iff O is locked by the inevitable transaction, which
+  // holds its orecs until it commits (see lazy_irr_dispatch).  Transactions
+  // that find such an orec wait for it as inactive transactions.
+  static bool locked_by_inevitable(gtm_word o)
+  {
+    gtm_thread *irr = gtm_thread::inevitable_owner.load(memory_order_relaxed);
+    return irr != 0 && o == lazy_mg::set_locked(irr);
+  }
+
+  // [transmem] The priority transaction waits for an orec that another
+  // transaction holds instead of restarting (see contention.cc).  Orecs are
+  // only held while committing, and only the priority transaction waits, so
+  // this cannot deadlock.  The inevitable transaction's orecs are an
+  // exception, which we do not wait for.  Returns the first value of the orec
+  // that is not locked by another transaction.
+  static gtm_word wait_unlocked(const atomic<gtm_word>& orec, gtm_word o,
+      gtm_word locked_by_tx)
+  {
+    while (lazy_mg::is_locked(o) && o != locked_by_tx
+           && !locked_by_inevitable(o))
+      {
+        cpu_relax();
+        o = orec.load(memory_order_acquire);
+      }
+    return o;
+  }
+
+  // [transmem] Adds the orecs that cover [ADDR, ADDR + LEN) to the orecs that
+  // we lock at commit.
+  static void add_commit_orecs(gtm_thread *tx, const void *addr, size_t len)
+  {
+    const gtm_orec_table& table = o_lazy_mg.table;
+    uintptr_t stripe = table.get_stripe(addr);
+    uintptr_t stripe_end = table.get_stripe_end(addr, len);
+    do
+      {
+        gtm_commit_orec *c = tx->commit_orecs.push();
+        c->orec = table.get_orec(stripe);
+        c->stripe = stripe;
+      }
+    while (++stripe != stripe_end);
+  }
+
+  static int compare_commit_orecs(const void *a, const void *b)
+  {
+    size_t x = ((const gtm_commit_orec *) a)->orec;
+    size_t y = ((const gtm_commit_orec *) b)->orec;
+    return x < y ? -1 : x > y;
+  }
+
+  // [transmem] Sorts the commit orecs by index, which is the order in which
+  // all transactions lock them, and removes duplicates, so that we try to
+  // acquire each orec only once.  We prefetch the remaining orecs for
+  // writing while we are at it.
+  static void sort_commit_orecs(gtm_thread *tx)
+  {
+    const gtm_orec_table& table = o_lazy_mg.table;
+    gtm_commit_orec *c = tx->commit_orecs.begin();
+    size_t n = tx->commit_orecs.size();
+    qsort(c, n, sizeof(*c), compare_commit_orecs);
+    size_t unique = 0;
+    for (size_t i = 0; i < n; ++i)
+      if (unique == 0 || c[i].orec != c[unique - 1].orec)
+        {
+          __builtin_prefetch(table.orecs + c[i].orec, 1);
+          c[unique++] = c[i];
+        }
+    tx->commit_orecs.set_size(unique);
+  }
+
+  // [transmem] Locks the sorted commit orecs.  We wait a little for an orec
+  // to be released instead of restarting right away, while holding the orecs
+  // that we have already locked.  This cannot deadlock: every committer locks
+  // its orecs in ascending index order, so the waits cannot form a cycle, and
+  // the wait is bounded, since we restart after gtm_spin_count_var spins.  We
+  // never wait for the inevitable transaction, which holds its orecs until it
+  // commits.  Only the priority transaction waits longer (see wait_unlocked).
+  static void lock_commit_orecs(gtm_thread *tx)
   {
     gtm_word snapshot = tx->shared_state.load(memory_order_relaxed);
     gtm_word locked_by_tx = lazy_mg::set_locked(tx);
+    const gtm_orec_table& table = o_lazy_mg.table;
 
-    // Lock all orecs that cover the region.
-    size_t orec = lazy_mg::get_orec(addr);
-    size_t orec_end = lazy_mg::get_orec_end(addr, len);
-    do
+    for (gtm_commit_orec *c = tx->commit_orecs.begin(),
+           *ce = tx->commit_orecs.end(); c != ce; ++c)
       {
+        atomic<gtm_word>& orec = table.orecs[c->orec];
         // Load the orec.  Relaxed memory order is sufficient here because
-        // either we have acquired the orec or we will try to acquire it with
-        // a CAS with stronger memory order.
-        gtm_word o = o_lazy_mg.orecs[orec].load(memory_order_relaxed);
+        // we will try to acquire it with a CAS with stronger memory order.
+        gtm_word o = orec.load(memory_order_relaxed);
+        if (unlikely (tx->cm_priority))
+          o = wait_unlocked(orec, o, locked_by_tx);
 
-        // Check whether we have acquired the orec already.
-        if (likely (locked_by_tx != o))
+        uint64_t spins = 0;
+        while (true)
           {
-            // If not, acquire.  Make sure that our snapshot time is larger or
-            // equal than the orec's version to avoid masking invalidations of
-            // our snapshot with our own writes.
             if (unlikely (lazy_mg::is_locked(o)))
-              tx->restart(RESTART_LOCKED_WRITE);
+              {
+                if (locked_by_inevitable(o) || ++spins > gtm_spin_count_var)
+                  {
+                    table.note_conflict(c->orec, c->stripe);
+                    tx->restart(locked_by_inevitable(o) ? RESTART_INEVITABLE
+                                : RESTART_LOCKED_WRITE);
+                  }
+                cpu_relax();
+                o = orec.load(memory_order_relaxed);
+                continue;
+              }
 
+            // Make sure that our snapshot time is larger or equal than the
+            // orec's version to avoid masking invalidations of our snapshot
+            // with our own writes.
             if (unlikely (lazy_mg::get_time(o) > snapshot))
               {
                 // We only need to extend the snapshot if we have indeed read
@@ -162,43 +239,35 @@ protected:
                 // transaction, we will have to extend anyway during commit.
                 // ??? Scan the read log instead, aborting if we have read
                 // from data covered by this orec before?
-                snapshot = extend(tx);
+                snapshot = extend(tx, lazy_mg::get_time(o));
               }
 
             // We need acquire memory order here to synchronize with other
-            // (ownership) releases of the orec.  We do not need acq_rel order
-            // because whenever another thread reads from this CAS'
+            // (ownership) releases of the orec.  We do not need acq_rel
+            // order because whenever another thread reads from this CAS'
             // modification, then it will abort anyway and does not rely on
-            // any further happens-before relation to be established.
-            if (unlikely (!o_lazy_mg.orecs[orec].compare_exchange_strong(
-                o, locked_by_tx, memory_order_acquire)))
-              tx->restart(RESTART_LOCKED_WRITE);
-
-            // We use an explicit fence here to avoid having to use release
-            // memory order for all subsequent data stores.  This fence will
-            // synchronize with loads of the data with acquire memory order.
-            // See post_load() for why this is necessary.
-            // Adding require memory order to the prior CAS is not sufficient,
-            // at least according to the Batty et al. formalization of the
-            // memory model.
-            atomic_thread_fence(memory_order_release);
-
-            // We log the previous value here to be able to use incarnation
-            // numbers when we have to roll back.
-            // ??? Reserve capacity early to avoid capacity checks here?
-            gtm_rwlog_entry *e = tx->writelog.push();
-            e->orec = o_lazy_mg.orecs + orec;
-            e->value = o;
+            // any further happens-before relation to be established.  If
+            // the CAS fails, O is the orec's new value, and we try again.
+            if (likely (orec.compare_exchange_strong(o, locked_by_tx,
+                                                     memory_order_acquire)))
+              break;
           }
-        orec = o_lazy_mg.get_next_orec(orec);
+        table.note_acquire(c->orec, c->stripe);
+
+        // We log the previous value here to be able to use incarnation
+        // numbers when we have to roll back.
+        gtm_rwlog_entry *e = tx->writelog.push();
+        e->orec = &orec;
+        e->value = o;
       }
-    while (orec != orec_end);
-  }
 
-  static void pre_write(const void *addr, size_t len)
-  {
-    gtm_thread *tx = gtm_thr();
-    pre_write(tx, addr, len);
+    // We use an explicit fence here to avoid having to use release memory
+    // order for all subsequent data stores.  This fence will synchronize
+    // with loads of the data with acquire memory order.  See post_load() for
+    // why this is necessary.  Adding require memory order to the prior CASes
+    // is not sufficient, at least according to the Batty et al.
+    // formalization of the memory model.
+    atomic_thread_fence(memory_order_release);
   }
 
   // Returns true iff all the orecs in our read log still have the same time
@@ -230,10 +299,11 @@ protected:
     return true;
   }
 
-  // Tries to extend the snapshot to a more recent time.  Returns the new
-  // snapshot time and updates TX->SHARED_STATE.  If the snapshot cannot be
-  // extended to the current global time, TX is restarted.
-  static gtm_word extend(gtm_thread *tx)
+  // Tries to extend the snapshot to a more recent time, which is at least
+  // SEEN.  Returns the new snapshot time and updates TX->SHARED_STATE.  If
+  // the snapshot cannot be extended to the current global time, TX is
+  // restarted.
+  static gtm_word extend(gtm_thread *tx, gtm_word seen)
   {
     // We read global time here, even if this isn't strictly necessary
     // because we could just return the maximum of the timestamps that
@@ -243,7 +313,7 @@ protected:
     // We need acquire memory oder because we have to synchronize with the
     // increment of global time by update transactions, whose lock
     // acquisitions we have to observe (also see trycommit()).
-    gtm_word snapshot = o_lazy_mg.time.load(memory_order_acquire);
+    gtm_word snapshot = o_lazy_mg.time.now_at_least(seen);
     if (!validate(tx))
       tx->restart(RESTART_VALIDATE_READ);
 
@@ -266,22 +336,26 @@ protected:
     gtm_word snapshot = tx->shared_state.load(memory_order_relaxed);
     gtm_word locked_by_tx = lazy_mg::set_locked(tx);
 
-    size_t orec = lazy_mg::get_orec(addr);
-    size_t orec_end = lazy_mg::get_orec_end(addr, len);
+    const gtm_orec_table& table = o_lazy_mg.table;
+    uintptr_t stripe = table.get_stripe(addr);
+    uintptr_t stripe_end = table.get_stripe_end(addr, len);
     do
       {
+        size_t orec = table.get_orec(stripe);
         // We need acquire memory order here so that this load will
         // synchronize with the store that releases the orec in trycommit().
         // In turn, this makes sure that subsequent data loads will read from
         // a visible sequence of side effects that starts with the most recent
         // store to the data right before the release of the orec.
-        gtm_word o = o_lazy_mg.orecs[orec].load(memory_order_acquire);
+        gtm_word o = table.orecs[orec].load(memory_order_acquire);
+        if (unlikely (tx->cm_priority))
+          o = wait_unlocked(table.orecs[orec], o, locked_by_tx);
 
         if (likely (!lazy_mg::is_more_recent_or_locked(o, snapshot)))
           {
             success:
             gtm_rwlog_entry *e = tx->readlog.push();
-            e->orec = o_lazy_mg.orecs + orec;
+            e->orec = table.orecs + orec;
             e->value = o;
           }
         else if (!lazy_mg::is_locked(o))
@@ -289,7 +363,8 @@ protected:
             // We cannot read this part of the region because it has been
             // updated more recently than our snapshot time.  If we can extend
             // our snapshot, then we can read.
-            snapshot = extend(tx);
+            table.note_conflict(orec, stripe);
+            snapshot = extend(tx, lazy_mg::get_time(o));
             goto success;
           }
         else
@@ -297,11 +372,14 @@ protected:
             // If the orec is locked by us, just skip it because we can just
             // read from it.  Otherwise, restart the transaction.
             if (o != locked_by_tx)
-              tx->restart(RESTART_LOCKED_READ);
+              {
+                table.note_conflict(orec, stripe);
+                tx->restart(locked_by_inevitable(o) ? RESTART_INEVITABLE
+                            : RESTART_LOCKED_READ);
+              }
           }
-        orec = o_lazy_mg.get_next_orec(orec);
       }
-    while (orec != orec_end);
+    while (++stripe != stripe_end);
     return &tx->readlog[log_start];
   }
 
@@ -334,6 +412,89 @@ protected:
       }
   }
 
+  // [transmem] True iff TX should read through the multi-version store,
+  // i.e., if the store is enabled and TX has not written anything (or has
+  // read old versions already, in which case it will restart at commit).
+  static bool mv_reader(gtm_thread *tx)
+  {
+    return o_lazy_mg.versions.enabled() && !tx->mv_writer
+      && (tx->mv_snapshot || (tx->redolog.isEmpty() && tx->deltas.empty()));
+  }
+
+  // [transmem] Read [src, src + len) into BUF as of TX's snapshot, without
+  // ever extending the snapshot.  If no orec of the range is newer than the
+  // snapshot, this is just pre_load(), the data load, and post_load().
+  // Otherwise, we read from the version store, and then TX can only commit
+  // if it is read-only.
+  static void mv_load(gtm_thread *tx, const uint8_t* src, uint8_t* buf,
+      size_t len)
+  {
+    size_t log_start = tx->readlog.size();
+    gtm_word snapshot = tx->shared_state.load(memory_order_relaxed);
+    const gtm_orec_table& table = o_lazy_mg.table;
+    uintptr_t stripe = table.get_stripe(src);
+    uintptr_t stripe_end = table.get_stripe_end(src, len);
+    bool current = true;
+    do
+      {
+        // See pre_load() for the memory orders here and below.
+        size_t orec = table.get_orec(stripe);
+        gtm_word o = table.orecs[orec].load(memory_order_acquire);
+        if (lazy_mg::is_more_recent_or_locked(o, snapshot))
+          {
+            table.note_conflict(orec, stripe);
+            current = false;
+            break;
+          }
+        gtm_rwlog_entry *e = tx->readlog.push();
+        e->orec = table.orecs + orec;
+        e->value = o;
+      }
+    while (++stripe != stripe_end);
+
+    if (current)
+      {
+        ::memcpy(buf, src, len);
+        atomic_thread_fence(memory_order_acquire);
+        for (gtm_rwlog_entry *i = &tx->readlog[log_start],
+               *ie = tx->readlog.end(); i != ie; i++)
+          if (i->orec->load(memory_order_relaxed) != i->value)
+            {
+              current = false;
+              break;
+            }
+        if (current)
+          return;
+      }
+
+    // Somebody has written to the range after our snapshot.  Wait for
+    // writers to release the range, so that all writers that committed at
+    // or before our snapshot have written back; later ones must save
+    // versions of what they overwrite first.
+    tx->readlog.set_size(log_start);
+    stripe = table.get_stripe(src);
+    do
+      {
+        size_t orec = table.get_orec(stripe);
+        while (lazy_mg::is_locked(table.orecs[orec].load(memory_order_acquire)))
+          cpu_relax();
+      }
+    while (++stripe != stripe_end);
+
+    while (len > 0)
+      {
+        size_t n = 64 - ((uintptr_t)src & 63);
+        if (n > len)
+          n = len;
+        if (!o_lazy_mg.versions.read(snapshot, src, buf, n))
+          tx->restart(RESTART_VALIDATE_READ);
+        src += n;
+        buf += n;
+        len -= n;
+      }
+    tx->mv_snapshot = true;
+  }
+
   template <typename V> static V load(const V* addr, ls_modifier mod)
   {
     // [transmem] Be conservative: if read is on stack, read from memory and
@@ -350,11 +511,24 @@ protected:
     // [transmem] no such thing as rfw
 
     // [transmem] Not every RaW will be marked as such, so just do a lookup
-    //            every time
+    //            every time, after folding pending deltas
+    if (unlikely (tx->deltas.may_overlap(addr, sizeof(V))))
+      tx->fold_deltas(addr, sizeof(V));
     V v;
-    if (!tx->redolog_bst.isEmpty() && tx->redolog_bst.find(addr, v) != 0)
+    if (!tx->redolog.isEmpty() && tx->redolog.find(addr, v) != 0)
       return v;
 
+    // [transmem] The priority transaction marks what it reads, so that
+    //            writers yield to it (see contention.cc)
+    if (unlikely (tx->cm_priority))
+      tx->cm_note_read(addr, sizeof(V));
+
+    if (unlikely (mv_reader(tx)))
+      {
+        mv_load(tx, (const uint8_t*)addr, (uint8_t*)&v, sizeof(V));
+        return v;
+      }
+
     // [transmem] do the pre-check... it's acquire order
     gtm_rwlog_entry* log = pre_load(tx, addr, sizeof(V));
 
@@ -395,41 +569,138 @@ protected:
       return;
     }
 
-    // [transmem] insert into the log...
-    tx->redolog_bst.insert(addr, value);
+    // [transmem] insert into the log... a pending delta must be folded
+    //            first, or it would be added to VALUE
+    if (unlikely (tx->deltas.may_overlap(addr, sizeof(V))))
+      tx->fold_deltas(addr, sizeof(V));
+    tx->redolog.insert(addr, value);
+  }
+
+  // Returns true iff [addr, addr + len) overlaps the transaction's own stack
+  // frames, in which case the access must bypass the logs
+  static bool on_stack(const void* addr, size_t len, void* top, void* bot)
+  {
+    return (const uint8_t*)addr <= (uint8_t*)top
+        && (const uint8_t*)addr + len > (uint8_t*)bot;
+  }
+
+  // Transactionally read [src, src + len) into BUF.  This is load() for an
+  // arbitrary range: a single pre_load()/post_load() pair covers every orec
+  // of the range, and then any bytes that the transaction has written are
+  // merged in from the redo log, one slab at a time.
+  static void load_bytes(gtm_thread* tx, const uint8_t* src, uint8_t* buf,
+      size_t len, ls_modifier mod, void* top, void* bot)
+  {
+    if (mod == NONTXNAL || on_stack(src, len, top, bot))
+      {
+        ::memcpy(buf, src, len);
+        return;
+      }
+    if (unlikely (tx->deltas.may_overlap(src, len)))
+      tx->fold_deltas(src, len);
+    if (unlikely (tx->cm_priority))
+      tx->cm_note_read(src, len);
+
+    if (unlikely (mv_reader(tx)))
+      mv_load(tx, src, buf, len);
+    else
+      {
+        gtm_rwlog_entry* log = pre_load(tx, src, len);
+        // See load() for why we need the acquire fence here.
+        ::memcpy(buf, src, len);
+        atomic_thread_fence(memory_order_acquire);
+        post_load(tx, log);
+      }
+
+    if (tx->redolog.isEmpty())
+      return;
+    while (len > 0)
+      {
+        size_t n = 64 - ((uintptr_t)src & 63);
+        if (n > len)
+          n = len;
+        tx->redolog.merge(src, buf, n);
+        src += n;
+        buf += n;
+        len -= n;
+      }
+  }
+
+  // Write BUF to [dst, dst + len).  The redo log buffers whole slabs at a
+  // time, so there is no need to chunk the range here.
+  static void store_bytes(gtm_thread* tx, uint8_t* dst, const uint8_t* buf,
+      size_t len, ls_modifier mod, void* top, void* bot)
+  {
+    if (mod == NONTXNAL)
+      ::memcpy(dst, buf, len);
+    else if (!on_stack(dst, len, top, bot))
+      {
+        if (unlikely (tx->deltas.may_overlap(dst, len)))
+          tx->fold_deltas(dst, len);
+        tx->redolog.insert_bytes(dst, buf, len);
+      }
+    else
+      for (size_t i = 0; i < len; i++)
+        store<uint8_t>(dst + i, buf[i], mod);
   }
 
 public:
   static void memtransfer_static(void *dst, const void* src, size_t size,
       bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
   {
-    // [transmem] This code is far from optimal
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    const uint8_t *srcaddr = (const uint8_t*)src;
+    uint8_t *dstaddr = (uint8_t*)dst;
 
-    // [transmem] we copy byte-by-byte, since we need to do log lookups.
-    // That means we can treat the type as unsigned chars.
-    //
-    // Note that we can ignore overlap, since we do buffered writes
-    unsigned char *srcaddr = (unsigned char*)const_cast<void*>(src);
-    unsigned char *dstaddr = (unsigned char*)dst;
+    // Since we do buffered writes, a forward copy only goes wrong if a later
+    // part of the source was already overwritten (in the redo log) by an
+    // earlier part of the destination.  In that case, read everything first.
+    if (may_overlap && dstaddr > srcaddr && dstaddr < srcaddr + size)
+      {
+        uint8_t* tmp = (uint8_t*)xmalloc(size);
+        load_bytes(tx, srcaddr, tmp, size, src_mod, top, bot);
+        store_bytes(tx, dstaddr, tmp, size, dst_mod, top, bot);
+        free(tmp);
+        return;
+      }
 
-    for (size_t i = 0; i < size; i++) {
-      unsigned char temp = load<unsigned char>(srcaddr, RaR);
-      store<unsigned char>(dstaddr, temp, WaW);
-      dstaddr = (unsigned char*) ((long long)dstaddr + sizeof(unsigned char));
-      srcaddr = (unsigned char*) ((long long)srcaddr + sizeof(unsigned char));
-    }
+    // Otherwise, move the data through a small buffer.  Pieces after the
+    // first one start on a 64-byte boundary of the source, so that they line
+    // up with the slabs of the redo log.
+    uint8_t buf[256] __attribute__((aligned(64)));
+    while (size > 0)
+      {
+        size_t n = sizeof(buf) - ((uintptr_t)srcaddr & 63);
+        if (n > size)
+          n = size;
+        load_bytes(tx, srcaddr, buf, n, src_mod, top, bot);
+        store_bytes(tx, dstaddr, buf, n, dst_mod, top, bot);
+        srcaddr += n;
+        dstaddr += n;
+        size -= n;
+      }
   }
 
   static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
   {
-    unsigned char* dstaddr = (unsigned char*)dst;
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    uint8_t* dstaddr = (uint8_t*)dst;
 
-    // [transmem] save data into redo log... note that the modifier doesn't
-    //            matter
-    for (size_t it = 0; it < size; it++) {
-      store<unsigned char>(dstaddr, (unsigned char)c, WaW);
-      dstaddr = (unsigned char*) ((long long)dst + sizeof(unsigned char));
-    }
+    // [transmem] save data into redo log, a slab at a time... note that the
+    //            modifier doesn't matter
+    if (!on_stack(dstaddr, size, top, bot))
+      {
+        if (unlikely (tx->deltas.may_overlap(dstaddr, size)))
+          tx->fold_deltas(dstaddr, size);
+        tx->redolog.fill_bytes(dstaddr, (uint8_t)c, size);
+      }
+    else
+      for (size_t i = 0; i < size; i++)
+        store<uint8_t>(dstaddr + i, (uint8_t)c, mod);
   }
 
   virtual gtm_restart_reason begin_or_restart()
@@ -440,7 +711,7 @@ public:
     // Read the current time, which becomes our snapshot time.
     // Use acquire memory oder so that we see the lock acquisitions by update
     // transcations that incremented the global time (see trycommit()).
-    gtm_word snapshot = o_lazy_mg.time.load(memory_order_acquire);
+    gtm_word snapshot = o_lazy_mg.time.now();
     // Re-initialize method group on time overflow.
     if (snapshot >= o_lazy_mg.TIME_MAX)
       return RESTART_INIT_METHOD_GROUP;
@@ -455,55 +726,141 @@ public:
     // visibility of a smaller or equal value with a barrier (see
     // rollback()).
     tx->shared_state.store(snapshot, memory_order_relaxed);
+    tx->mv_snapshot = false;
     return NO_RESTART;
   }
 
+  // [transmem] Returns true iff TX would overwrite data that the priority
+  // transaction has read, in which case it must yield (see contention.cc).
+  // Slabs of the redo log are single cache lines.
+  static bool yields_to_priority(gtm_thread* tx)
+  {
+    if (likely (gtm_thread::priority_owner.load(memory_order_relaxed) == 0))
+      return false;
+    for (int i = 0; i < tx->redolog.slabcount(); ++i)
+      if (tx->cm_priority_conflict((void*)tx->redolog.get_key(i), 64))
+        return true;
+    for (gtm_delta *d = tx->deltas.entries.begin(),
+           *de = tx->deltas.entries.end(); d != de; ++d)
+      if (tx->cm_priority_conflict(d->addr, sizeof(uint64_t)))
+        return true;
+    return false;
+  }
+
+  // [transmem] Returns true iff TX would overwrite data that the inevitable
+  // transaction has read, which it must never do (see lazy_irr_dispatch).
+  // TX must have locked its write set, and there must be a seq_cst fence
+  // in between.
+  static bool yields_to_inevitable(gtm_thread* tx)
+  {
+    gtm_thread *irr = gtm_thread::inevitable_owner.load(memory_order_relaxed);
+    if (likely (irr == 0 || irr == tx))
+      return false;
+    for (int i = 0; i < tx->redolog.slabcount(); ++i)
+      if (gtm_thread::inevitable_lines.contains(
+              (void*)tx->redolog.get_key(i), 64))
+        return true;
+    for (gtm_delta *d = tx->deltas.entries.begin(),
+           *de = tx->deltas.entries.end(); d != de; ++d)
+      if (gtm_thread::inevitable_lines.contains(d->addr, sizeof(uint64_t)))
+        return true;
+    return false;
+  }
+
   virtual bool trycommit(gtm_word& priv_time)
   {
     gtm_thread* tx = gtm_thr();
 
     // If we haven't updated anything, we can commit.
-    if (tx->redolog_bst.isEmpty())
+    if (tx->redolog.isEmpty() && tx->deltas.empty())
       {
         tx->readlog.clear();
         return true;
       }
 
-    // [transmem] acquire locks... 16 byte stripes are covered by an orec, so
-    //            4 orecs max per slab
-    for (int i = 0; i < tx->redolog_bst.slabcount(); ++i) {
-      uint64_t mask = tx->redolog_bst.get_mask(i);
-      uint8_t* addr = (uint8_t*)tx->redolog_bst.get_key(i);
-      if (mask & 0x000000000000FFFFLL)
-        pre_write(tx, addr, 16);
-      if (mask & 0x00000000FFFF0000LL)
-        pre_write(tx, addr+16, 16);
-      if (mask & 0x0000FFFF00000000LL)
-        pre_write(tx, addr+32, 16);
-      if (mask & 0xFFFF000000000000LL)
-        pre_write(tx, addr+48, 16);
-    }
+    // [transmem] A writer that has read old versions has not read a
+    // snapshot that it can validate.  Run it again without the version
+    // store.  If we are upgrading to serial mode, serialirr_mode() restarts
+    // us in serial-irrevocable mode instead when we fail.
+    if (unlikely (tx->mv_snapshot))
+      {
+        if (tx->state & gtm_thread::STATE_SERIAL)
+          return false;
+        tx->mv_writer = true;
+        tx->restart(RESTART_NOT_READONLY);
+      }
 
+    // [transmem] Let the priority transaction commit first.  Not if we
+    // commit while upgrading to serial mode (see serialirr_mode()): it is
+    // not active then, and we must not restart as if we were.
+    if (unlikely (!(tx->state & gtm_thread::STATE_SERIAL)
+                  && yields_to_priority(tx)))
+      tx->restart(RESTART_PRIORITY);
+
+    // [transmem] acquire locks... each stripe of a slab that has a written
+    //            byte needs its orec.  Stripes of 64 bytes or more cover the
+    //            whole slab.  We collect the orecs first and lock them in
+    //            index order.
+    tx->commit_orecs.clear();
+    size_t stripe_size = o_lazy_mg.table.stripe_size();
+    for (int i = 0; i < tx->redolog.slabcount(); ++i) {
+      uint64_t mask = tx->redolog.get_mask(i);
+      uint8_t* addr = (uint8_t*)tx->redolog.get_key(i);
+      if (stripe_size >= 64) {
+        if (mask)
+          add_commit_orecs(tx, addr, 64);
+        continue;
+      }
+      uint64_t stripe_mask = (1ULL << stripe_size) - 1;
+      for (size_t off = 0; off < 64; off += stripe_size)
+        if (mask & (stripe_mask << off))
+          add_commit_orecs(tx, addr + off, stripe_size);
+    }
+    // [transmem] ... and so does each word with a delta
+    for (gtm_delta *d = tx->deltas.entries.begin(),
+           *de = tx->deltas.entries.end(); d != de; ++d)
+      add_commit_orecs(tx, d->addr, sizeof(uint64_t));
+    sort_commit_orecs(tx);
+    lock_commit_orecs(tx);
+
+    // [transmem] The fence pairs with the one in
+    // lazy_irr_dispatch::pre_read(): either we see the inevitable
+    // transaction's marks, or it sees our locks and waits for us.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (unlikely (yields_to_inevitable(tx)))
+      tx->restart(RESTART_INEVITABLE);
 
     // Get a commit time.
     // Overflow of o_ml_mg.time is prevented in begin_or_restart().
-    // We need acq_rel here because (1) the acquire part is required for our
-    // own subsequent call to validate(), and the release part is necessary to
-    // make other threads' validate() work as explained there and in extend().
-    gtm_word ct = o_lazy_mg.time.fetch_add(1, memory_order_acq_rel) + 1;
+    bool unique;
+    gtm_word ct = o_lazy_mg.time.commit(tx, unique);
 
     // Extend our snapshot time to at least our commit time.
     // Note that we do not need to validate if our snapshot time is right
-    // before the commit time because we are never sharing the same commit
-    // time with other transactions.
+    // before the commit time and we are not sharing the same commit time
+    // with other transactions.
     // No need to reset shared_state, which will be modified by the serial
     // lock right after our commit anyway.
     gtm_word snapshot = tx->shared_state.load(memory_order_relaxed);
-    if (snapshot < ct - 1 && !validate(tx))
+    if ((!unique || snapshot < ct - 1) && !validate(tx))
       return false;
 
-    // replay redo log
-    tx->redolog_bst.writeback();
+    // [transmem] save what we overwrite for read-only transactions with an
+    // older snapshot
+    if (o_lazy_mg.versions.enabled())
+      {
+        for (int i = 0; i < tx->redolog.slabcount(); ++i)
+          o_lazy_mg.versions.save(tx->redolog.get_key(i),
+                                  tx->redolog.get_mask(i), ct);
+        for (gtm_delta *d = tx->deltas.entries.begin(),
+               *de = tx->deltas.entries.end(); d != de; ++d)
+          o_lazy_mg.versions.save((uintptr_t)d->addr & ~(uintptr_t)63,
+                                  0xffULL << ((uintptr_t)d->addr & 63), ct);
+      }
+
+    // replay redo log and add deltas
+    tx->redolog.writeback();
+    tx->deltas.apply();
 
     // Release orecs.
     // See pre_load() / post_load() for why we need release memory order.
@@ -516,11 +873,16 @@ public:
     // We're done, clear the logs.
     tx->writelog.clear();
     tx->readlog.clear();
-    tx->redolog_bst.reset();
+    tx->redolog.reset();
+    tx->deltas.clear();
 
     // Need to ensure privatization safety. Every other transaction must
     // have a snapshot time that is at least as high as our commit time
-    // (i.e., our commit must be visible to them).
+    // (i.e., our commit must be visible to them).  [transmem] If the time
+    // base does not advance on commit, advance it now so that transactions
+    // starting after us do not hold up quiescence.
+    if (!tx->skip_quiescence())
+      o_lazy_mg.time.publish(ct);
     priv_time = ct;
     return true;
   }
@@ -547,7 +909,8 @@ public:
     // We're done, clear the logs.
     tx->writelog.clear();
     tx->readlog.clear();
-    tx->redolog_bst.reset();
+    tx->redolog.reset();
+    tx->deltas.clear();
   }
 
   virtual bool supports(unsigned number_of_threads)
@@ -559,19 +922,346 @@ public:
     return (number_of_threads * 2 <= lazy_mg::OVERFLOW_RESERVE);
   }
 
+  // [transmem] Deltas are added while holding the orecs (see trycommit())
+  virtual bool commutative_updates() { return true; }
+  virtual bool supports_priority() { return true; }
+  // [transmem] Writes are buffered in the redo log, which has a scope for
+  // each closed nested transaction (see gtm_transaction_cp)
+  virtual bool closed_nesting() { return true; }
+  // [transmem] The read set is the read log (see elastic.cc)
+  virtual size_t read_set_mark() { return gtm_thr()->readlog.size(); }
+  virtual void release_reads(size_t from, size_t to)
+  {
+    vector<gtm_rwlog_entry> &log = gtm_thr()->readlog;
+    ::memmove(&log[from], &log[to], (log.size() - to) * sizeof(log[0]));
+    log.set_size(log.size() - (to - from));
+  }
+
+#ifndef GTM_STATIC_DISPATCH
+  virtual abi_dispatch* read_only_alternative()
+  {
+    return dispatch_lazy_ro();
+  }
+#endif
+  // [transmem] Old versions cannot be saved for data that is written in
+  // place, so the multi-version store needs serial-irrevocable mode.
+  virtual abi_dispatch* inevitable_alternative()
+  {
+    return o_lazy_mg.versions.enabled() ? 0 : dispatch_lazy_irr();
+  }
+
   CREATE_DISPATCH_METHODS(virtual, )
   CREATE_DISPATCH_METHODS_MEM()
+#ifdef GTM_STATIC_DISPATCH
+  // [transmem] Called directly by the ABI functions (see below).  The
+  // read-only variant would have to go through the virtual methods, so it is
+  // not used in this build.
+  CREATE_DISPATCH_METHODS(static, _static)
+#endif
 
   lazy_dispatch() : abi_dispatch(false, true, false, 0, &o_lazy_mg)
   { }
+
+protected:
+  lazy_dispatch(bool ro) : abi_dispatch(ro, true, false, 0, &o_lazy_mg)
+  { }
+};
+
+// [transmem] lazy for transactions that are expected not to write (see
+// read_only_alternative()).  Reads skip the redo log lookup, and commit
+// just clears the read log.  The first store to shared memory restarts the
+// transaction with the full dispatch.
+class lazy_ro_dispatch : public lazy_dispatch
+{
+protected:
+  template <typename V> static V load(const V* addr, ls_modifier mod)
+  {
+    // stack filter, as in lazy_dispatch::load()
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    if ((addr <= top && (uint8_t*)addr > bot) ||
+        ((uint8_t*)addr < bot && ((uint8_t*)addr + sizeof(V) > bot)))
+    {
+      return *addr;
+    }
+
+    V v;
+    if (unlikely (mv_reader(tx)))
+      {
+        mv_load(tx, (const uint8_t*)addr, (uint8_t*)&v, sizeof(V));
+        return v;
+      }
+
+    // See lazy_dispatch::load() for the acquire fence.
+    gtm_rwlog_entry* log = pre_load(tx, addr, sizeof(V));
+    v = *addr;
+    atomic_thread_fence(memory_order_acquire);
+    post_load(tx, log);
+    return v;
+  }
+
+  template <typename V> static void store(V* addr, const V value,
+      ls_modifier mod)
+  {
+    // writes to the stack frame are private
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    if ((addr <= top && (uint8_t*) addr > bot ) ||
+        ((uint8_t*)addr < bot && ((uint8_t*)addr + sizeof(V) > bot))) {
+      *addr = value;
+      return;
+    }
+    tx->restart(RESTART_NOT_READONLY);
+  }
+
+public:
+  static void memtransfer_static(void *dst, const void* src, size_t size,
+      bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    if (dst_mod != NONTXNAL && !on_stack(dst, size, top, bot))
+      tx->restart(RESTART_NOT_READONLY);
+
+    // The destination is private, so we can read straight into it, unless
+    // it overlaps the source.
+    if (!may_overlap)
+      {
+        load_bytes(tx, (const uint8_t*)src, (uint8_t*)dst, size, src_mod,
+                   top, bot);
+        return;
+      }
+    uint8_t* tmp = (uint8_t*)xmalloc(size);
+    load_bytes(tx, (const uint8_t*)src, tmp, size, src_mod, top, bot);
+    ::memcpy(dst, tmp, size);
+    free(tmp);
+  }
+
+  static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    if (mod != NONTXNAL
+        && !on_stack(dst, size, mask_stack_top(tx), mask_stack_bottom(tx)))
+      tx->restart(RESTART_NOT_READONLY);
+    ::memset(dst, c, size);
+  }
+
+  virtual bool trycommit(gtm_word& priv_time)
+  {
+    gtm_thr()->readlog.clear();
+    return true;
+  }
+
+  virtual abi_dispatch* read_only_alternative() { return 0; }
+  // [transmem] Adds go through store(), which restarts the transaction
+  virtual bool commutative_updates() { return false; }
+  virtual bool supports_priority() { return false; }
+
+  CREATE_DISPATCH_METHODS(virtual, )
+  CREATE_DISPATCH_METHODS_MEM()
+
+  lazy_ro_dispatch() : lazy_dispatch(true)
+  { }
+};
+
+// [transmem] lazy for the inevitable transaction (see method-serial.cc).  It
+// acquires the orecs of the data that it writes at the first write, and
+// writes in place; the other transactions find the orecs locked until it
+// commits.  It reads without logging, but it adds the cache lines to
+// gtm_thread::inevitable_lines first, and committing writers check the
+// filter once they hold their orecs (see yields_to_inevitable()), so that
+// nothing that it has read is overwritten.  It waits for orecs that writers
+// hold, which they only do while they commit.  It cannot protect what it
+// accesses without barriers, so it only runs concurrently until it asks for
+// serial-irrevocable mode, and then becomes serial; and a transaction that
+// asks for it later always restarts with this dispatch (see
+// run_uninstrumented() and become_inevitable() in abi_dispatch).
+class lazy_irr_dispatch : public lazy_dispatch
+{
+protected:
+  // The shared_state of the inevitable transaction.  It never reads stale
+  // data, so it does not hold up quiescence.
+  static const gtm_word IRR_SNAPSHOT = ~(gtm_word)0 - 1;
+
+  // Mark [ADDR, ADDR + LEN) as read, and wait until no other transaction
+  // holds the orecs that cover it.  The fence orders the mark before the
+  // orec loads, and pairs with the one in lazy_dispatch::trycommit().
+  static void pre_read(gtm_thread *tx, const void *addr, size_t len)
+  {
+    if (gtm_thread::inevitable_lines.add(addr, len))
+      atomic_thread_fence(memory_order_seq_cst);
+
+    gtm_word locked_by_tx = lazy_mg::set_locked(tx);
+    const gtm_orec_table& table = o_lazy_mg.table;
+    uintptr_t stripe = table.get_stripe(addr);
+    uintptr_t stripe_end = table.get_stripe_end(addr, len);
+    do
+      {
+        // Acquire memory order makes the writeback of the last writer of the
+        // data visible (see pre_load()).
+        size_t orec = table.get_orec(stripe);
+        wait_unlocked(table.orecs[orec],
+                      table.orecs[orec].load(memory_order_acquire),
+                      locked_by_tx);
+      }
+    while (++stripe != stripe_end);
+  }
+
+  // Acquire the orecs that cover [ADDR, ADDR + LEN), waiting for other
+  // transactions to release them.
+  static void pre_write_irr(gtm_thread *tx, const void *addr, size_t len)
+  {
+    gtm_word locked_by_tx = lazy_mg::set_locked(tx);
+    const gtm_orec_table& table = o_lazy_mg.table;
+    uintptr_t stripe = table.get_stripe(addr);
+    uintptr_t stripe_end = table.get_stripe_end(addr, len);
+    do
+      {
+        size_t orec = table.get_orec(stripe);
+        gtm_word o = table.orecs[orec].load(memory_order_relaxed);
+        while (o != locked_by_tx)
+          {
+            o = wait_unlocked(table.orecs[orec], o, locked_by_tx);
+            if (!table.orecs[orec].compare_exchange_strong(
+                    o, locked_by_tx, memory_order_acquire))
+              continue;
+            table.note_acquire(orec, stripe);
+            // See lock_commit_orecs() for the fence.
+            atomic_thread_fence(memory_order_release);
+            gtm_rwlog_entry *e = tx->writelog.push();
+            e->orec = table.orecs + orec;
+            e->value = o;
+            break;
+          }
+      }
+    while (++stripe != stripe_end);
+  }
+
+  static bool private_range(gtm_thread *tx, const void *addr, size_t len)
+  {
+    return on_stack(addr, len, mask_stack_top(tx), mask_stack_bottom(tx));
+  }
+
+  template <typename V> static V load(const V* addr, ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    if (!private_range(tx, addr, sizeof(V)))
+      pre_read(tx, addr, sizeof(V));
+    return *addr;
+  }
+
+  template <typename V> static void store(V* addr, const V value,
+      ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    if (!private_range(tx, addr, sizeof(V)))
+      pre_write_irr(tx, addr, sizeof(V));
+    *addr = value;
+  }
+
+public:
+  static void memtransfer_static(void *dst, const void* src, size_t size,
+      bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    if (src_mod != NONTXNAL && !private_range(tx, src, size))
+      pre_read(tx, src, size);
+    if (dst_mod != NONTXNAL && !private_range(tx, dst, size))
+      pre_write_irr(tx, dst, size);
+    if (!may_overlap)
+      ::memcpy(dst, src, size);
+    else
+      ::memmove(dst, src, size);
+  }
+
+  static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    if (mod != NONTXNAL && !private_range(tx, dst, size))
+      pre_write_irr(tx, dst, size);
+    ::memset(dst, c, size);
+  }
+
+  // We cannot restart, so we do not check for overflow of the time base; the
+  // other transactions reinitialize the method group, and the overflow
+  // reserve covers our commit (see supports()).
+  virtual gtm_restart_reason begin_or_restart()
+  {
+    gtm_thread *tx = gtm_thr();
+    tx->shared_state.store(IRR_SNAPSHOT, memory_order_relaxed);
+    tx->mv_snapshot = false;
+    return NO_RESTART;
+  }
+
+  virtual bool trycommit(gtm_word& priv_time)
+  {
+    gtm_thread* tx = gtm_thr();
+
+    // We are done reading, so writers may overwrite what we have read.
+    gtm_thread::inevitable_lines.clear();
+    if (tx->writelog.size() == 0)
+      return true;
+
+    // Release the orecs at a commit time, as in lazy_dispatch::trycommit().
+    bool unique;
+    gtm_word ct = o_lazy_mg.time.commit(tx, unique);
+    gtm_word v = lazy_mg::set_time(ct);
+    for (gtm_rwlog_entry *i = tx->writelog.begin(), *ie = tx->writelog.end();
+        i != ie; i++)
+      i->orec->store(v, memory_order_release);
+    tx->writelog.clear();
+
+    if (!tx->skip_quiescence())
+      o_lazy_mg.time.publish(ct);
+    priv_time = ct;
+    return true;
+  }
+
+  virtual void rollback()
+  {
+    // The inevitable transaction cannot roll back.
+    abort();
+  }
+
+  virtual abi_dispatch* read_only_alternative() { return 0; }
+  virtual abi_dispatch* inevitable_alternative() { return 0; }
+  virtual bool commutative_updates() { return false; }
+  virtual bool supports_priority() { return false; }
+
+  CREATE_DISPATCH_METHODS(virtual, )
+  CREATE_DISPATCH_METHODS_MEM()
+
+  lazy_irr_dispatch() : lazy_dispatch(false)
+  { }
 };
 
 } // anon namespace
 
 static const lazy_dispatch o_lazy_dispatch;
+static const lazy_ro_dispatch o_lazy_ro_dispatch;
+static const lazy_irr_dispatch o_lazy_irr_dispatch;
 
 abi_dispatch *
 GTM::dispatch_lazy ()
 {
   return const_cast<lazy_dispatch *>(&o_lazy_dispatch);
 }
+
+abi_dispatch *
+GTM::dispatch_lazy_ro ()
+{
+  return const_cast<lazy_ro_dispatch *>(&o_lazy_ro_dispatch);
+}
+
+abi_dispatch *
+GTM::dispatch_lazy_irr ()
+{
+  return const_cast<lazy_irr_dispatch *>(&o_lazy_irr_dispatch);
+}
+
+#ifdef GTM_STATIC_DISPATCH
+CREATE_DISPATCH_FUNCTIONS_STATIC(lazy_dispatch, &o_lazy_dispatch)
+#endif
@@ -23,6 +23,8 @@
    <http://www.gnu.org/licenses/>.  */
 
 #include "libitm_i.h"
+#include "futex.h"
+#include <limits.h>
 
 // Avoid a dependency on libstdc++ for the pure virtuals in abi_dispatch.
 extern "C" void HIDDEN
@@ -108,6 +110,11 @@ protected:
 
   template <typename V> static V load(const V* addr, ls_modifier mod)
   {
+    // [transmem] The compiler follows a read for write with a WaW store,
+    // which does not log, so log here.  Otherwise, cancelling a closed
+    // nested transaction would keep the write.
+    if (mod == RfW)
+      log(addr, sizeof(V));
     return *addr;
   }
   template <typename V> static void store(V* addr, const V value,
@@ -124,6 +131,8 @@ public:
   {
     if (dst_mod != WaW && dst_mod != NONTXNAL)
       log(dst, size);
+    if (src_mod == RfW)
+      log(src, size);
     if (!may_overlap)
       ::memcpy(dst, src, size);
     else
@@ -142,6 +151,8 @@ public:
   // Local undo will handle this.
   // trydropreference() need not be changed either.
   virtual void rollback() { }
+  // [transmem] Likewise for closed nested transactions
+  virtual bool closed_nesting() { return true; }
 
   CREATE_DISPATCH_METHODS(virtual, )
   CREATE_DISPATCH_METHODS_MEM()
@@ -168,12 +179,92 @@ GTM::dispatch_serial ()
   return const_cast<serial_dispatch *>(&o_serial_dispatch);
 }
 
-// Put the transaction into serial-irrevocable mode.
+// [transmem] Inevitable transactions
+//
+// Serial-irrevocable mode stops all other transactions while a transaction
+// that cannot roll back (e.g., because it does I/O) runs.  Methods that have
+// an inevitable variant (see abi_dispatch::inevitable_alternative()) instead
+// let one such transaction, which holds the inevitability token, run
+// concurrently with speculative transactions.  Those see it as a writer that
+// has already committed: NOrec's inevitable transaction holds the sequence
+// lock and writes in place, lazy's acquires orecs at the first write.  It
+// adds the cache lines that it must protect from the other transactions to
+// inevitable_lines, where they check for them.
+//
+// A transaction that asks for irrevocability at its start waits for the token
+// before it becomes active.  A transaction that asks later only tries to get
+// it, and otherwise restarts and asks at its start.  Transactions go
+// serial-irrevocable as before if the method has no inevitable variant, if
+// they run uninstrumented code, or if ITM_INEVITABLE=0.
+//
+// Once _ITM_changeTransactionMode() returns, the compiler may run the rest of
+// the transaction without barriers (GCC does, for code after a call to a
+// function that is not transaction-safe).  The inevitable transaction only
+// goes on concurrently from there if its method keeps the other transactions
+// away from all data (see abi_dispatch::run_uninstrumented()).  Otherwise,
+// it upgrades the serial lock, which cannot fail: other writers back off
+// while somebody holds the token (see gtm_rwlock::write_lock_generic()).
+// The speculative transactions never wait for the inevitable transaction
+// while they are active, so they do not hold up the upgrade.
+
+bool GTM::inevitable_enabled = true;
+atomic<gtm_thread *> gtm_thread::inevitable_owner;
+gtm_line_filter gtm_thread::inevitable_lines;
+
+// Bumped whenever the inevitability token is released
+static atomic<int> inevitable_seq;
+
+// Take the inevitability token.  If another transaction holds it, returns
+// false, or waits until the token is released if WAIT is true.  Waiting must
+// only be done while the transaction is inactive.
+bool
+GTM::gtm_thread::take_inevitable (bool wait)
+{
+  while (true)
+    {
+      int seq = inevitable_seq.load (memory_order_acquire);
+      gtm_thread *owner = 0;
+      if (inevitable_owner.compare_exchange_strong (owner, this,
+                                                    memory_order_seq_cst,
+                                                    memory_order_relaxed)
+          || owner == this)
+        return true;
+      if (!wait)
+        return false;
+      futex_wait (&inevitable_seq, seq);
+    }
+}
+
+// Release the inevitability token after the transaction has committed, or
+// before it restarts.
+void
+GTM::gtm_thread::release_inevitable ()
+{
+  inevitable_owner.store (0, memory_order_release);
+  inevitable_seq.fetch_add (1, memory_order_release);
+  futex_wake (&inevitable_seq, INT_MAX);
+}
+
+// Wait until the current inevitable transaction has finished, unless it is
+// TX.  Must be called while TX is inactive, because the inevitable
+// transaction might wait for it to quiesce or to leave the serial lock.
+void
+GTM::gtm_thread::wait_inevitable (gtm_thread *tx)
+{
+  int seq = inevitable_seq.load (memory_order_acquire);
+  gtm_thread *owner = inevitable_owner.load (memory_order_acquire);
+  if (owner != 0 && owner != tx)
+    futex_wait (&inevitable_seq, seq);
+}
+
+// Put the transaction into serial-irrevocable mode.  [transmem] Or let it
+// continue as the inevitable transaction, if possible.
 
 void
 GTM::gtm_thread::serialirr_mode ()
 {
   struct abi_dispatch *disp = abi_disp ();
+  abi_dispatch *irr;
 
   if (this->state & STATE_SERIAL)
     {
@@ -189,6 +280,29 @@ GTM::gtm_thread::serialirr_mode ()
       // Given that we're already serial, the trycommit better work.
       assert (ok);
     }
+  else if (this->state & STATE_IRREVOCABLE)
+    {
+      // [transmem] We are the inevitable transaction already.  Go on if our
+      // method keeps the others away from the data that we access without
+      // barriers, or become serial.  We hold the token, so the upgrade
+      // cannot fail, and our dispatch cannot fail to commit.
+      if (disp->run_uninstrumented ())
+        return;
+      serial_lock.write_upgrade (this);
+      this->state |= STATE_SERIAL;
+      gtm_word priv_time = 0;
+      disp->trycommit (priv_time);
+      gtm_thread::serial_lock.write_upgrade_finish(this);
+    }
+  else if (inevitable_enabled
+           && (irr = disp->inevitable_alternative ()) != 0)
+    {
+      if (!take_inevitable (false) || !irr->become_inevitable ())
+        restart (RESTART_SERIAL_IRR);
+      this->state |= STATE_IRREVOCABLE;
+      set_abi_disp (irr);
+      return;
+    }
   else if (serial_lock.write_upgrade (this))
     {
       this->state |= STATE_SERIAL;
@@ -0,0 +1,100 @@
+#ifndef LIBITM_OREC_H
+#define LIBITM_OREC_H 1
+
+// [transmem] The ownership record (orec) table used by ml_wt and lazy
+//
+// Memory is divided into stripes of 2^shift bytes, and each stripe is hashed
+// to one of a power-of-two number of orecs.  The table geometry is read from
+// the environment when a method group first allocates its table:
+//
+//  - ITM_ORECS:          the number of orecs (rounded up to a power of two)
+//  - ITM_OREC_SHIFT:     log2 of the stripe size in bytes
+//  - ITM_OREC_HASH:      mod (stripe modulo table size), mul (Fibonacci
+//                        multiplicative hashing), or xor (XOR-fold the upper
+//                        bits of the stripe number into the lower ones)
+//  - ITM_OREC_HUGEPAGES: if nonzero, back the table with transparent huge
+//                        pages
+//  - ITM_OREC_PROFILE:   if nonzero, remember which stripe last acquired each
+//                        orec, count how many conflicts are false (i.e., on
+//                        an orec that was acquired for a different stripe),
+//                        and report the counts at exit
+//
+// Since consecutive stripes need not map to consecutive orecs, callers visit
+// the orecs of a region by iterating over its stripes.
+
+namespace GTM HIDDEN {
+
+enum gtm_orec_hash
+{
+  OREC_HASH_MOD,
+  OREC_HASH_MUL,
+  OREC_HASH_XOR
+};
+
+struct gtm_orec_table
+{
+  // The orecs.  We assume that an atomic<gtm_word> is backed by just a
+  // gtm_word, so starting with zeroed memory is fine.
+  atomic<gtm_word>* orecs;
+  // If profiling, the stripe that last acquired each orec; otherwise, NULL.
+  atomic<uintptr_t>* owners;
+  // The number of orecs minus one, and its log2.
+  gtm_word mask;
+  unsigned bits;
+  // The log2 of the stripe size.
+  unsigned shift;
+  gtm_orec_hash hash;
+  // True iff the orecs were allocated with mmap().
+  bool mapped;
+
+  // In orec.cc.  These must be called while holding the serial lock.
+  void alloc ();
+  void release ();
+  void clear ();
+
+  size_t stripe_size () const { return (size_t) 1 << shift; }
+
+  // Returns the stripe of ADDR, and the first stripe after [ADDR, ADDR+LEN).
+  uintptr_t get_stripe (const void *addr) const
+  {
+    return (uintptr_t) addr >> shift;
+  }
+  uintptr_t get_stripe_end (const void *addr, size_t len) const
+  {
+    return ((uintptr_t) addr + len + stripe_size () - 1) >> shift;
+  }
+
+  // Returns the index of the orec that covers STRIPE.
+  size_t get_orec (uintptr_t stripe) const
+  {
+    switch (hash)
+      {
+      case OREC_HASH_MUL:
+        return (size_t) (((uint64_t) stripe * 0x9e3779b97f4a7c15ULL)
+                         >> (64 - bits));
+      case OREC_HASH_XOR:
+        return (stripe ^ (stripe >> bits) ^ (stripe >> (2 * bits))) & mask;
+      default:
+        return stripe & mask;
+      }
+  }
+
+  // Record that ORECS[OREC] was acquired for STRIPE, and note a conflict on
+  // ORECS[OREC] while accessing STRIPE.  These do nothing unless profiling.
+  void note_acquire (size_t orec, uintptr_t stripe) const
+  {
+    if (unlikely (owners != 0))
+      owners[orec].store (stripe, memory_order_relaxed);
+  }
+  void note_conflict (size_t orec, uintptr_t stripe) const
+  {
+    if (unlikely (owners != 0))
+      count_conflict (owners[orec].load (memory_order_relaxed) != stripe);
+  }
+
+  static void count_conflict (bool false_conflict);
+};
+
+} // namespace GTM
+
+#endif // LIBITM_OREC_H
@@ -0,0 +1,115 @@
+#include "libitm_i.h"
+
+// [transmem] Epoch-based reclamation of transactionally freed memory
+//
+// A doomed transaction may still read memory that a committed transaction
+// freed, so the memory must not be reused until every transaction that was
+// active at the commit has finished or taken a newer snapshot.  quiesce()
+// waits for that on every commit.  A committer that skips quiescence (see
+// skip_quiescence()) instead moves its frees to its limbo list, as a batch
+// tagged with its privatization time (see abi_dispatch::trycommit()).  A
+// batch is executed once every other thread's shared_state is at least its
+// tag.  Committers check this without blocking, whenever their limbo list
+// has grown by LIMBO_POLL blocks, and wait in quiesce() only when it holds
+// LIMBO_MAX blocks.
+//
+// The values of shared_state may start over when the method group changes or
+// is reinitialized, which only happens while holding the serial lock in write
+// mode.  No transaction is active then, so the code that does it starts a new
+// reclamation generation, and batches from older generations are safe.
+//
+// Threads that exit free their gtm_thread, which quiesce() and reclaim() may
+// still be reading: they walk list_of_threads without holding the serial
+// lock.  operator delete puts the gtm_thread on a list instead, which is
+// emptied when another thread registers or exits at a time when nobody walks
+// list_of_threads.
+
+namespace GTM HIDDEN {
+
+static const size_t LIMBO_POLL = 64;
+static const size_t LIMBO_MAX = 4096;
+
+// Destroyed gtm_thread objects, linked by next_dead
+static atomic<gtm_thread *> dead_threads;
+
+} // namespace GTM
+
+using namespace GTM;
+
+atomic<int> gtm_thread::list_walkers;
+atomic<gtm_word> gtm_thread::reclaim_generation;
+
+// Move the committed transaction's frees to the limbo list, and execute the
+// batches that are safe.  EPOCH and GENERATION are as for
+// gtm_alloc_arena::commit().
+void
+gtm_thread::retire_allocations (gtm_word epoch, gtm_word generation)
+{
+  size_t before = arena.limbo.size ();
+  arena.commit (epoch, generation);
+  size_t after = arena.limbo.size ();
+
+  if (after >= LIMBO_MAX
+      && reclaim_generation.load (memory_order_acquire) == generation)
+    {
+      // Some thread holds back the reclamation of too much memory.  Our
+      // earlier batches have smaller tags, so wait until all are safe.
+      quiesce (epoch);
+      arena.reclaim (epoch, generation);
+    }
+  else if (after / LIMBO_POLL != before / LIMBO_POLL)
+    reclaim ();
+}
+
+// Execute the limbo batches that other threads cannot be reading anymore.
+void
+gtm_thread::reclaim ()
+{
+  gtm_word horizon = ~(gtm_word) 0;
+  list_walkers.fetch_add (1, memory_order_seq_cst);
+  for (gtm_thread *it = list_of_threads; it != 0; it = it->next_thread)
+    {
+      if (it == this)
+        continue;
+      // Acquire memory order makes the accesses of the other thread's
+      // transactions happen before the frees, as in quiesce().
+      gtm_word s = it->shared_state.load (memory_order_acquire);
+      if (s < horizon)
+        horizon = s;
+    }
+  list_walkers.fetch_sub (1, memory_order_release);
+  arena.reclaim (horizon, reclaim_generation.load (memory_order_acquire));
+}
+
+// Add TX, which has been unlinked from list_of_threads and destroyed, to
+// the objects that reap_threads() frees.
+void
+gtm_thread::bury (gtm_thread *tx)
+{
+  gtm_thread *next = dead_threads.load (memory_order_relaxed);
+  do
+    tx->next_dead = next;
+  while (!dead_threads.compare_exchange_weak (next, tx,
+                                              memory_order_release,
+                                              memory_order_relaxed));
+}
+
+// Free the gtm_thread of exited threads, if no thread walks list_of_threads.
+// Must be called while holding the serial lock in write mode.
+void
+gtm_thread::reap_threads ()
+{
+  // The exited threads were unlinked before we got the serial lock.  A
+  // walker that we do not see here will not see them in list_of_threads
+  // (Dekker-style, see list_walkers in quiesce() and reclaim()).
+  atomic_thread_fence (memory_order_seq_cst);
+  if (list_walkers.load (memory_order_acquire) != 0)
+    return;
+  gtm_thread *t = dead_threads.exchange (0, memory_order_acquire);
+  while (t)
+    {
+      gtm_thread *next = t->next_dead;
+      free (t);
+      t = next;
+    }
+}
@@ -47,6 +47,9 @@ GTM::gtm_thread::decide_retry_strategy (gtm_restart_reason r)
 
   this->restart_reason[r]++;
   this->restart_total++;
+  // [transmem] Attribute the restart to the call site (see profile.cc)
+  if (unlikely (profile_enabled))
+    profile_restart (r);
 
   if (r == RESTART_INIT_METHOD_GROUP)
     {
@@ -68,8 +71,11 @@ GTM::gtm_thread::decide_retry_strategy (gtm_restart_reason r)
       if (disp->get_method_group()
           == default_dispatch.load(memory_order_relaxed)
           ->get_method_group())
-        // Still the same method group.
-        disp->get_method_group()->reinit();
+        {
+          // Still the same method group.
+          disp->get_method_group()->reinit();
+          new_reclaim_generation();
+        }
       serial_lock.write_unlock();
       // Also, we're making the transaction inactive, so when we become
       // active again, some other thread might have changed the default
@@ -79,20 +85,104 @@ GTM::gtm_thread::decide_retry_strategy (gtm_restart_reason r)
       set_abi_disp(disp);
     }
       else
-    // We are a serial transaction already, which makes things simple.
-    disp->get_method_group()->reinit();
+    {
+      // We are a serial transaction already, which makes things simple.
+      disp->get_method_group()->reinit();
+      new_reclaim_generation();
+    }
 
       return;
     }
 
+  // [transmem] A transaction that we expected to be read-only has written.
+  // We are still active, so the default dispatch has not changed, and it is
+  // the full variant of our method.
+  if (r == RESTART_NOT_READONLY && disp->read_only())
+    {
+      note_read_only(false);
+      disp = default_dispatch.load(memory_order_relaxed);
+      set_abi_disp(disp);
+    }
+
   bool retry_irr = (r == RESTART_SERIAL_IRR);
-  bool retry_serial = (retry_irr || this->restart_total > 100);
+  bool retry_serial = (retry_irr
+                       || this->restart_total > this->cm_serial_limit);
 
   // We assume closed nesting to be infrequently required, so just use
   // dispatch_serial (with undo logging) if required.
   if (r == RESTART_CLOSED_NESTING)
     retry_serial = true;
 
+  // [transmem] A transaction that yielded to the priority or the inevitable
+  // transaction waits until that one has finished, as an inactive
+  // transaction, and then starts over.
+  if (r == RESTART_PRIORITY || r == RESTART_INEVITABLE)
+    {
+      serial_lock.read_unlock(this);
+      if (r == RESTART_PRIORITY)
+        cm_yield();
+      else
+        wait_inevitable(this);
+      disp = decide_begin_dispatch(prop);
+      set_abi_disp(disp);
+      return;
+    }
+
+  // [transmem] A transaction that has to become irrevocable starts over as
+  // an inactive transaction, so that it can wait for the inevitability token
+  // (see method-serial.cc), or for the serial lock otherwise.
+  if (retry_irr && (this->state & STATE_SERIAL) == 0)
+    {
+      if (cm_priority)
+        cm_release_priority();
+      serial_lock.read_unlock(this);
+      disp = decide_begin_dispatch(prop | pr_doesGoIrrevocable);
+      set_abi_disp(disp);
+      return;
+    }
+
+  // [transmem] A starving transaction retries concurrently with the priority
+  // token instead of going serial, if the method supports it (see
+  // contention.cc).  If another transaction holds the token, wait for it.
+  // Irrevocability and closed nesting still need serial mode.
+  if (retry_serial && !retry_irr && r != RESTART_CLOSED_NESTING
+      && (this->state & STATE_SERIAL) == 0
+      && default_dispatch.load(memory_order_relaxed)->supports_priority()
+      && !cm_priority_expired())
+    {
+      if (cm_priority || cm_take_priority())
+        {
+          // We are still active, so this is the full variant of our method.
+          retry_serial = false;
+          disp = default_dispatch.load(memory_order_relaxed);
+          set_abi_disp(disp);
+        }
+      else
+        {
+          serial_lock.read_unlock(this);
+          cm_yield();
+          disp = decide_begin_dispatch(prop);
+          set_abi_disp(disp);
+          return;
+        }
+    }
+  if (retry_serial && cm_priority)
+    cm_release_priority();
+
+  // [transmem] If we are not going serial, let the contention manager delay
+  // the restart after a conflict.  We wait as an inactive transaction, so
+  // that we don't hold up serial transactions or other threads' quiescence,
+  // and then start over as if this were the first attempt (see above).
+  if (!retry_serial && cm_policy != CM_IMMEDIATE && !cm_priority
+      && (this->state & STATE_SERIAL) == 0 && restart_is_conflict(r))
+    {
+      serial_lock.read_unlock(this);
+      cm_backoff();
+      disp = decide_begin_dispatch(prop);
+      set_abi_disp(disp);
+      return;
+    }
+
   if (retry_serial)
     {
       // In serialirr_mode we can succeed with the upgrade to
@@ -135,6 +225,44 @@ GTM::gtm_thread::decide_retry_strategy (gtm_restart_reason r)
 }
 
 
+// [transmem] Read-only prediction
+//
+// Methods can provide a read-only variant that skips the redo log and the
+// writer commit path.  We use it if the call site of the transaction has
+// committed read-only the last time that we saw it, or, for sites that we
+// do not know, if the compiler says that the transaction is read-only
+// (pr_readOnly, which may be lexically scoped, so it is just a hint).  Each
+// entry of the direct-mapped history holds a site and whether it wrote.
+static const unsigned RO_SITES = 1024;
+static std::atomic<uintptr_t> ro_sites[RO_SITES];
+
+static inline std::atomic<uintptr_t>&
+ro_site_entry(uintptr_t site)
+{
+  return ro_sites[(site ^ (site >> 10) ^ (site >> 20)) & (RO_SITES - 1)];
+}
+
+bool
+GTM::gtm_thread::predict_read_only (uint32_t prop) const
+{
+  uintptr_t e = ro_site_entry(site).load(memory_order_relaxed);
+  if ((e >> 1) == (site & (~(uintptr_t) 0 >> 1)))
+    return e & 1;
+  return prop & pr_readOnly;
+}
+
+// Remember whether the transaction at the current call site wrote.  We only
+// store if this changes the prediction, to keep the entry's cache line
+// shared.
+void
+GTM::gtm_thread::note_read_only (bool read_only) const
+{
+  std::atomic<uintptr_t>& entry = ro_site_entry(site);
+  uintptr_t e = (site << 1) | read_only;
+  if (entry.load(memory_order_relaxed) != e)
+    entry.store(e, memory_order_relaxed);
+}
+
 // Decides which TM method should be used on the first attempt to run this
 // transaction.  Acquires the serial lock and sets transaction state
 // according to the chosen TM method.
@@ -143,11 +271,17 @@ GTM::gtm_thread::decide_begin_dispatch (uint32_t prop)
 {
   abi_dispatch* dd;
   // TODO Pay more attention to prop flags (eg, *omitted) when selecting
-  // dispatch.
+  // dispatch.  [transmem] pr_readOnly is used below.
   // ??? We go irrevocable eagerly here, which is not always good for
   // performance.  Don't do this?
   if ((prop & pr_doesGoIrrevocable) || !(prop & pr_instrumentedCode))
-    dd = dispatch_serialirr();
+    {
+      // [transmem] Prefer an inevitable transaction, which does not stop
+      // the others.
+      if ((dd = decide_inevitable_dispatch(prop)) != 0)
+        return dd;
+      dd = dispatch_serialirr();
+    }
 
   else
     {
@@ -170,7 +304,12 @@ GTM::gtm_thread::decide_begin_dispatch (uint32_t prop)
       // happens-before for any change to the selected dispatch.
       serial_lock.read_lock (this);
       if (default_dispatch.load(memory_order_relaxed) == dd_orig)
-        return dd;
+        {
+          abi_dispatch* ro = dd->read_only_alternative();
+          if (ro && predict_read_only(prop))
+            return ro;
+          return dd;
+        }
 
       // If we raced with a concurrent modification of default_dispatch,
       // just fall back to serialirr.  The dispatch choice might not be
@@ -187,6 +326,36 @@ GTM::gtm_thread::decide_begin_dispatch (uint32_t prop)
 }
 
 
+// [transmem] Decides whether a transaction that must be irrevocable can run
+// as the inevitable transaction (see method-serial.cc), and if so, waits for
+// the inevitability token, acquires the serial lock in read mode, and returns
+// the dispatch.  Returns NULL, and releases the token if we hold it, if the
+// transaction must run in serial-irrevocable mode instead.
+GTM::abi_dispatch*
+GTM::gtm_thread::decide_inevitable_dispatch (uint32_t prop)
+{
+  // As in decide_begin_dispatch(), we check the default dispatch again after
+  // becoming active.
+  abi_dispatch* dd = default_dispatch.load(memory_order_relaxed);
+  if (inevitable_enabled && (prop & pr_instrumentedCode)
+      && dd->inevitable_alternative())
+    {
+      take_inevitable(true);
+      serial_lock.read_lock(this);
+      abi_dispatch* irr = dd->inevitable_alternative();
+      if (default_dispatch.load(memory_order_relaxed) == dd && irr)
+        {
+          state = STATE_IRREVOCABLE;
+          return irr;
+        }
+      serial_lock.read_unlock(this);
+    }
+  if (inevitable_owner.load(memory_order_relaxed) == this)
+    release_inevitable();
+  return 0;
+}
+
+
 void
 GTM::gtm_thread::set_default_dispatch(GTM::abi_dispatch* disp)
 {
@@ -200,6 +369,7 @@ GTM::gtm_thread::set_default_dispatch(GTM::abi_dispatch* disp)
     {
       dd->get_method_group()->fini();
       disp->get_method_group()->init();
+      new_reclaim_generation();
     }
     }
   else
@@ -208,6 +378,93 @@ GTM::gtm_thread::set_default_dispatch(GTM::abi_dispatch* disp)
 }
 
 
+// [transmem] Read the contention management policy from ITM_CM.  The
+// default is to restart immediately, as libitm always has.
+static GTM::gtm_cm_policy
+parse_contention_manager()
+{
+  const char *env = getenv("ITM_CM");
+  GTM::gtm_cm_policy cm;
+  if (env == NULL)
+    return GTM::CM_IMMEDIATE;
+
+  while (isspace((unsigned char) *env))
+    ++env;
+  if (strncmp(env, "immediate", 9) == 0)
+    {
+      cm = GTM::CM_IMMEDIATE;
+      env += 9;
+    }
+  else if (strncmp(env, "backoff", 7) == 0)
+    {
+      cm = GTM::CM_BACKOFF;
+      env += 7;
+    }
+  else if (strncmp(env, "adaptive", 8) == 0)
+    {
+      cm = GTM::CM_ADAPTIVE;
+      env += 8;
+    }
+  else
+    goto unknown;
+
+  while (isspace((unsigned char) *env))
+    ++env;
+  if (*env == '\0')
+    return cm;
+
+ unknown:
+  GTM::GTM_error("Unknown contention manager in environment variable "
+      "ITM_CM\n");
+  return GTM::CM_IMMEDIATE;
+}
+
+// [transmem] Read the global time base mode from ITM_TIMEBASE (see
+// timebase.h).  The default is gv1.
+static GTM::gtm_timebase_mode
+parse_time_base()
+{
+  const char *env = getenv("ITM_TIMEBASE");
+  GTM::gtm_timebase_mode tb;
+  if (env == NULL)
+    return GTM::TB_GV1;
+
+  while (isspace((unsigned char) *env))
+    ++env;
+  if (strncmp(env, "gv1", 3) == 0)
+    {
+      tb = GTM::TB_GV1;
+      env += 3;
+    }
+  else if (strncmp(env, "gv4", 3) == 0)
+    {
+      tb = GTM::TB_GV4;
+      env += 3;
+    }
+  else if (strncmp(env, "gv5", 3) == 0)
+    {
+      tb = GTM::TB_GV5;
+      env += 3;
+    }
+  else if (strncmp(env, "sharded", 7) == 0)
+    {
+      tb = GTM::TB_SHARDED;
+      env += 7;
+    }
+  else
+    goto unknown;
+
+  while (isspace((unsigned char) *env))
+    ++env;
+  if (*env == '\0')
+    return tb;
+
+ unknown:
+  GTM::GTM_error("Unknown time base in environment variable "
+      "ITM_TIMEBASE\n");
+  return GTM::TB_GV1;
+}
+
 static GTM::abi_dispatch*
 parse_default_method()
 {
@@ -233,7 +490,7 @@ parse_default_method()
   else if (strncmp(env, "lazy", 4) == 0)
     {
       disp = GTM::dispatch_lazy();
-      env += 5;
+      env += 4;
     }
   else
     goto unknown;
@@ -266,6 +523,13 @@ GTM::gtm_thread::number_of_threads_changed(unsigned previous, unsigned now)
       // Check for user preferences here.
       default_dispatch = 0;
       default_dispatch_user = parse_default_method();
+      cm_policy = parse_contention_manager();
+      profile_init();
+      // [transmem] ITM_INEVITABLE=0 restores serial-irrevocable mode.
+      const char *env = getenv("ITM_INEVITABLE");
+      if (env != NULL)
+        inevitable_enabled = strtol(env, NULL, 10) != 0;
+      timebase_mode = parse_time_base();
     }
     }
   else if (now == 0)
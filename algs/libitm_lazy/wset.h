@@ -0,0 +1,668 @@
+#ifndef WSET_HPP__
+#define WSET_HPP__
+
+namespace GTM HIDDEN
+{
+#ifdef __SSE__
+  typedef float wset_m128u
+      __attribute__((vector_size(16), aligned(1), may_alias));
+#endif
+
+  /**
+   *  Copy a small block of memory.  The bulk (memcpy/memset) barriers move
+   *  data in aligned 8/16/32-byte chunks, so we special-case those sizes to
+   *  use scalar or SSE moves.  The vector type is the same as _ITM_TYPE_M128
+   *  (see x86_sse.cc), except that it does not require alignment, since only
+   *  one side of the copy is guaranteed to be aligned.  Only x86_avx.cc is
+   *  built with -mavx, so 32-byte chunks take two moves everywhere.
+   */
+  static inline void copy_chunk(void* dst, const void* src, size_t len)
+  {
+      switch (len) {
+        case 8:
+          *(uint64_t*)dst = *(const uint64_t*)src;
+          break;
+#ifdef __SSE__
+        case 16:
+          *(wset_m128u*)dst = *(const wset_m128u*)src;
+          break;
+        case 32:
+          ((wset_m128u*)dst)[0] = ((const wset_m128u*)src)[0];
+          ((wset_m128u*)dst)[1] = ((const wset_m128u*)src)[1];
+          break;
+#endif
+        default:
+          __builtin_memcpy(dst, src, len);
+      }
+  }
+
+  /**
+   *  An open-addressing hash table specialized for our writeset needs
+   *
+   *  This is a drop-in replacement for the BST.  As with the BST, each entry
+   *  consists of a 64-byte slab of data, the address of the first byte (the
+   *  key), and a bitmask to show which bytes have actually been written, and
+   *  the node (key, mask) is kept separate from the payload so that slabs are
+   *  exactly 64 bytes.  Nodes and slabs are allocated in order from a pair of
+   *  pools, which means that slab IDs are dense, and that iterating over
+   *  slabcount() visits slabs in the order in which they were first written.
+   *
+   *  The difference is the index: instead of a tree, we keep a power-of-two
+   *  table of buckets, and use linear probing on a hash of the cache line
+   *  address.  This makes insert and find O(1), even when the program writes
+   *  to sequential addresses (which turns an unbalanced BST into a list).
+   *
+   *  To clear the table in constant time, each bucket carries the "epoch" in
+   *  which it was last written.  reset() just increments the epoch, which
+   *  invalidates every bucket at once.  We only pay for a memset when the
+   *  epoch wraps around.
+   *
+   *  [transmem] For closed nesting, the set also supports scopes: a nested
+   *  transaction opens a scope, and rolling the scope back undoes exactly the
+   *  writes made since.  Slabs created in the scope are dropped, by
+   *  truncating the pools and rebuilding the index, and the first write in
+   *  the scope to an older slab saves the slab's mask and data, which are
+   *  restored on rollback.  Committing a scope hands its saved slabs to the
+   *  enclosing scope, unless that one has saved or created them itself.
+   */
+  class WriteSet
+  {
+      /**
+       *  Size of a slab... this must match the BST, since the lazy commit
+       *  code assumes 64-byte slabs with a 64-bit mask.
+       */
+      static const size_t SLAB_SIZE = 64;
+
+      /**
+       *  Each slab is a 64-byte array, which represents new values for 64
+       *  contiguous bytes of memory.  For alignment purposes, we keep the slab
+       *  separate from its starting address and mask.
+       */
+      struct slab_t
+      {
+          uint8_t data[SLAB_SIZE]; // the data
+      };
+
+      /**
+       *  The node consists of a key (64-byte aligned address) and a 64-bit
+       *  mask of which bytes in the corresponding slab are live.  As with the
+       *  BST, the index of a slab and the index of a node correlate.
+       */
+      struct node_t
+      {
+          uintptr_t key;          // key stored here
+          uint64_t  mask;         // mask of valid bits in slab
+      };
+
+      /**
+       *  A bucket of the hash index.  We keep a copy of the key in the bucket,
+       *  so that a probe does not need to touch the node pool until it finds
+       *  a match.  A bucket is only valid if its epoch matches the table's.
+       */
+      struct bucket_t
+      {
+          uintptr_t key;          // key of the node this bucket refers to
+          uint32_t  epoch;        // epoch in which this bucket was filled
+          int       idx;          // index of the node/slab
+      };
+
+      /**
+       *  [transmem] A slab as it was before the innermost scope first wrote
+       *  it, and the scope that had saved it before (see scopepool)
+       */
+      struct saved_t
+      {
+          int       idx;          // index of the node/slab
+          uint32_t  scope;        // previous scopepool[idx]
+          uint64_t  mask;         // previous mask
+          slab_t    slab;         // previous data
+      };
+
+      /**
+       *  The node and slab pools.  As with the BST, there is a one-to-one
+       *  correspondence between nodes and slabs, so a single next/size pair
+       *  suffices.
+       */
+      node_t* nodepool;
+      slab_t* slabpool;
+
+      /**
+       *  The next free node/slab in the pool
+       */
+      int pool_next;
+
+      /**
+       *  The size of the node and slab pools
+       */
+      int pool_size;
+
+      /**
+       *  The hash index, and its size minus one (the size is a power of two)
+       */
+      bucket_t* table;
+      size_t    table_mask;
+
+      /**
+       *  The current epoch.  Buckets from older epochs are empty.
+       */
+      uint32_t epoch;
+
+      /**
+       *  [transmem] The innermost scope: it started when the pools held
+       *  scope_mark slabs, it saved savedpool[scope_saved, saved_next), and
+       *  scopepool[i] == scope_id iff it saved slab i already.  Scope IDs
+       *  are never reused (until they wrap around), so stale entries of
+       *  scopepool never match.  scope_mark is 0 outside of scopes, which
+       *  disables saving.
+       */
+      int       scope_mark;
+      uint32_t  scope_id;
+      uint32_t  scope_next;
+      size_t    scope_saved;
+      uint32_t* scopepool;
+      saved_t*  savedpool;
+      size_t    saved_next;
+      size_t    saved_size;
+
+      /**
+       *  The initial size of the pools.  The table starts out twice as big,
+       *  and we keep the load factor at or below 1/2.
+       */
+      static const size_t INITIAL_SIZE = 1024;
+
+      /**
+       *  Hash a key to a bucket.  The low 6 bits of a key are always zero, so
+       *  we drop them and then use a multiplicative (Fibonacci) hash, taking
+       *  the high bits so that strided addresses still spread out.
+       */
+      size_t hash(uintptr_t key) const
+      {
+          uint64_t h = (uint64_t)(key >> 6) * 0x9E3779B97F4A7C15ULL;
+          return (size_t)(h >> 32) & table_mask;
+      }
+
+      /**
+       *  Insert every live node into the (empty) index.  Since the node pool
+       *  is dense, we don't need to look at the old table at all.
+       */
+      void rehash()
+      {
+          for (int i = 0; i < pool_next; ++i) {
+              size_t b = hash(nodepool[i].key);
+              while (table[b].epoch == epoch)
+                  b = (b + 1) & table_mask;
+              table[b].key   = nodepool[i].key;
+              table[b].epoch = epoch;
+              table[b].idx   = i;
+          }
+      }
+
+      /**
+       *  Double the size of the hash index and re-insert every live node.
+       */
+      void grow_table() __attribute__((noinline))
+      {
+          size_t size = (table_mask + 1) * 2;
+          free(table);
+          table = (bucket_t*)calloc(size, sizeof(bucket_t));
+          table_mask = size - 1;
+          epoch = 1;
+          rehash();
+      }
+
+      /**
+       *  Move to a new epoch, which empties the index.
+       */
+      void new_epoch()
+      {
+          if (unlikely(++epoch == 0)) {
+              memset(table, 0, (table_mask + 1) * sizeof(bucket_t));
+              epoch = 1;
+          }
+      }
+
+      /**
+       *  [transmem] Save slab IDX before the innermost scope writes it for
+       *  the first time.
+       */
+      void preserve(int idx) __attribute__((noinline))
+      {
+          if (saved_next == saved_size) {
+              saved_size = saved_size ? saved_size * 2 : 64;
+              savedpool = (saved_t*)realloc(savedpool,
+                                            saved_size * sizeof(saved_t));
+          }
+          saved_t* s = &savedpool[saved_next++];
+          s->idx   = idx;
+          s->scope = scopepool[idx];
+          s->mask  = nodepool[idx].mask;
+          memcpy(s->slab.data, slabpool[idx].data, SLAB_SIZE);
+          scopepool[idx] = scope_id;
+      }
+
+      /**
+       *  Double the size of the node and slab pools.  Indices do not change,
+       *  so the hash index remains valid.
+       */
+      void grow_pools() __attribute__((noinline))
+      {
+          pool_size *= 2;
+          nodepool = (node_t*)realloc(nodepool, pool_size * sizeof(node_t));
+          slab_t* slabpool1 = (slab_t*)aligned_alloc(SLAB_SIZE,
+                                                     pool_size * sizeof(slab_t));
+          memcpy(slabpool1, slabpool, sizeof(slab_t) * pool_size / 2);
+          free(slabpool);
+          slabpool = slabpool1;
+          scopepool = (uint32_t*)realloc(scopepool,
+                                         pool_size * sizeof(uint32_t));
+          memset(scopepool + pool_size / 2, 0,
+                 sizeof(uint32_t) * pool_size / 2);
+      }
+
+      /**
+       *  This function takes a key, and returns the index of the node and slab
+       *  that correspond to that key.  If the key is not in the data
+       *  structure, then a new slab and node will be created for the key.
+       *  [transmem] The caller is about to write the slab, so save it if it
+       *  is older than the innermost scope.
+       */
+      int reserve(uintptr_t key)
+      {
+          size_t b = hash(key);
+          while (table[b].epoch == epoch) {
+              if (table[b].key == key) {
+                  int idx = table[b].idx;
+                  if (unlikely(idx < scope_mark)
+                      && scopepool[idx] != scope_id)
+                      preserve(idx);
+                  return idx;
+              }
+              b = (b + 1) & table_mask;
+          }
+
+          // not found: make sure there's room in the pools, then claim the
+          // empty bucket that ended the probe
+          if (pool_next == pool_size)
+              grow_pools();
+          int idx = pool_next++;
+          nodepool[idx].key  = key;
+          nodepool[idx].mask = 0;
+          table[b].key   = key;
+          table[b].epoch = epoch;
+          table[b].idx   = idx;
+
+          // keep the load factor at or below 1/2, so probes stay short
+          if ((size_t)pool_next * 2 > table_mask + 1)
+              grow_table();
+          return idx;
+      }
+
+      /**
+       *  Return the index of the node that holds this key, or -1 on failure
+       */
+      int lookup(uintptr_t key) const
+      {
+          size_t b = hash(key);
+          while (table[b].epoch == epoch) {
+              if (table[b].key == key)
+                  return table[b].idx;
+              b = (b + 1) & table_mask;
+          }
+          return -1;
+      }
+
+      /**
+       *  Compute the mask of bytes covered by a datum of type T at offset 0.
+       *  The largest type (long double _Complex) is 32 bytes.
+       */
+      template <typename T>
+      static uint64_t type_mask()
+      {
+          return (1ULL << sizeof(T)) - 1;
+      }
+
+      /**
+       *  Compute the mask of the first LEN bytes of a slab
+       */
+      static uint64_t range_mask(size_t len)
+      {
+          return (len == SLAB_SIZE) ? ~0ULL : ((1ULL << len) - 1);
+      }
+
+    public:
+
+      /**
+       *  initially the set is empty, and has two well-defined pools and an
+       *  empty index.  Epoch 0 marks the calloc'd buckets as free.
+       */
+      WriteSet()
+      {
+          pool_size = INITIAL_SIZE;
+          pool_next = 0;
+
+          slabpool = (slab_t*)aligned_alloc(SLAB_SIZE,
+                                            pool_size * sizeof(slab_t));
+          nodepool = (node_t*)malloc(pool_size * sizeof(node_t));
+          table = (bucket_t*)calloc(2 * INITIAL_SIZE, sizeof(bucket_t));
+          table_mask = 2 * INITIAL_SIZE - 1;
+          epoch = 1;
+          scope_mark = 0;
+          scope_id = 0;
+          scope_next = 0;
+          scope_saved = 0;
+          scopepool = (uint32_t*)calloc(pool_size, sizeof(uint32_t));
+          savedpool = 0;
+          saved_next = 0;
+          saved_size = 0;
+      }
+
+      ~WriteSet()
+      {
+          free(slabpool);
+          free(nodepool);
+          free(table);
+          free(scopepool);
+          free(savedpool);
+      }
+
+      /**
+       *  Return whether the set is empty or not... this is useful in the
+       *  commit function.
+       */
+      bool isEmpty() const
+      {
+          return pool_next == 0;
+      }
+
+      /**
+       *  Reset the data structure in constant time, by resetting the pools and
+       *  moving to a new epoch.  On the (rare) epoch wraparound, we have to
+       *  actually clear the index.
+       *
+       *  As with the BST, we don't shrink anything... if the set grew, we
+       *  assume we'll have another transaction in the future that also needs
+       *  it to be large.
+       */
+      void reset()
+      {
+          pool_next = 0;
+          new_epoch();
+          scope_mark = 0;
+          scope_id = 0;
+          scope_saved = 0;
+          saved_next = 0;
+      }
+
+      /**
+       *  [transmem] The state of a scope, which the enclosing transaction
+       *  keeps while a nested one runs
+       */
+      struct scope
+      {
+          int      mark;
+          uint32_t id;
+          size_t   saved;
+      };
+
+      /**
+       *  [transmem] Open a new innermost scope.  Returns the enclosing scope,
+       *  which must be passed to rollback_scope() or commit_scope().
+       */
+      scope begin_scope()
+      {
+          scope parent = { scope_mark, scope_id, scope_saved };
+          if (unlikely(++scope_next == 0)) {
+              // The enclosing scopes may save some slabs again, which is
+              // harmless: rollback restores the oldest copy last.
+              memset(scopepool, 0, pool_size * sizeof(uint32_t));
+              scope_next = 1;
+          }
+          scope_mark = pool_next;
+          scope_id = scope_next;
+          scope_saved = saved_next;
+          return parent;
+      }
+
+      /**
+       *  [transmem] Undo the writes of the innermost scope, and close it
+       */
+      void rollback_scope(const scope& parent)
+      {
+          for (size_t i = saved_next; i-- > scope_saved; ) {
+              saved_t* s = &savedpool[i];
+              nodepool[s->idx].mask = s->mask;
+              memcpy(slabpool[s->idx].data, s->slab.data, SLAB_SIZE);
+              scopepool[s->idx] = s->scope;
+          }
+          saved_next = scope_saved;
+          if (pool_next > scope_mark) {
+              pool_next = scope_mark;
+              new_epoch();
+              rehash();
+          }
+          scope_mark = parent.mark;
+          scope_id = parent.id;
+          scope_saved = parent.saved;
+      }
+
+      /**
+       *  [transmem] Close the innermost scope, keeping its writes.  The saved
+       *  slabs that the enclosing scope needs to roll back become its own.
+       */
+      void commit_scope(const scope& parent)
+      {
+          size_t k = scope_saved;
+          for (size_t i = scope_saved; i < saved_next; ++i) {
+              saved_t* s = &savedpool[i];
+              // the enclosing scope created the slab, or saved it already
+              if (s->idx >= parent.mark)
+                  continue;
+              scopepool[s->idx] = parent.id;
+              if (s->scope == parent.id)
+                  continue;
+              if (k != i)
+                  savedpool[k] = *s;
+              ++k;
+          }
+          saved_next = k;
+          scope_mark = parent.mark;
+          scope_id = parent.id;
+          scope_saved = parent.saved;
+      }
+
+      /**
+       *  Method for inserting an element to the write set, by type.
+       *
+       *  NB: This assumes that the datum does not span a 64-byte boundary
+       */
+      template <typename T>
+      void insert(const T* addr, T val)
+      {
+          uintptr_t key = (uintptr_t)addr & ~0x3FLL;
+          uint64_t offset = (uintptr_t)addr & 0x3F;
+          int idx = reserve(key);
+          *(T*)(slabpool[idx].data + offset) = val;
+          nodepool[idx].mask |= (type_mask<T>() << offset);
+      }
+
+      /**
+       *  Method for finding an element in the write set
+       *
+       *  This return the mask that describes which bytes of val are valid
+       *
+       *  NB: Again, assumes that the datum does not span a 64-byte boundary
+       */
+      template <typename T>
+      int find(const T* addr, T& val) const
+      {
+          uintptr_t key = (uintptr_t)addr & ~0x3FLL;
+          uint64_t offset = (uintptr_t)addr & 0x3F;
+          int idx = lookup(key);
+          if (idx == -1)
+              return 0;
+
+          // if our bytes in slab not set, then we're done
+          uint32_t livebits = type_mask<T>() & (nodepool[idx].mask >> offset);
+          if (!livebits)
+              return 0;
+          val = *(const T*)(slabpool[idx].data + offset);
+          return livebits;
+      }
+
+      /**
+       *  Bulk insert: buffer the LEN bytes at SRC as the new contents of
+       *  [ADDR, ADDR + LEN).  Unlike insert(), the range may span any number
+       *  of slabs.
+       */
+      void insert_bytes(void* addr, const void* src, size_t len)
+      {
+          uint8_t* a = (uint8_t*)addr;
+          const uint8_t* s = (const uint8_t*)src;
+          while (len > 0) {
+              uintptr_t key = (uintptr_t)a & ~0x3FLL;
+              size_t offset = (uintptr_t)a & 0x3F;
+              size_t n = SLAB_SIZE - offset;
+              if (n > len)
+                  n = len;
+              int idx = reserve(key);
+              copy_chunk(slabpool[idx].data + offset, s, n);
+              nodepool[idx].mask |= (range_mask(n) << offset);
+              a += n;
+              s += n;
+              len -= n;
+          }
+      }
+
+      /**
+       *  Bulk fill: buffer C as the new value of every byte in
+       *  [ADDR, ADDR + LEN).  The range may span any number of slabs.
+       */
+      void fill_bytes(void* addr, uint8_t c, size_t len)
+      {
+          uint8_t* a = (uint8_t*)addr;
+          while (len > 0) {
+              uintptr_t key = (uintptr_t)a & ~0x3FLL;
+              size_t offset = (uintptr_t)a & 0x3F;
+              size_t n = SLAB_SIZE - offset;
+              if (n > len)
+                  n = len;
+              int idx = reserve(key);
+              __builtin_memset(slabpool[idx].data + offset, c, n);
+              nodepool[idx].mask |= (range_mask(n) << offset);
+              a += n;
+              len -= n;
+          }
+      }
+
+      /**
+       *  Bulk lookup: overlay any buffered bytes of [ADDR, ADDR + LEN) onto
+       *  BUF, which holds the values read from memory.  The range must not
+       *  span a slab boundary.  Returns true iff any bytes were buffered.
+       */
+      bool merge(const void* addr, void* buf, size_t len) const
+      {
+          uintptr_t key = (uintptr_t)addr & ~0x3FLL;
+          size_t offset = (uintptr_t)addr & 0x3F;
+          int idx = lookup(key);
+          if (idx == -1)
+              return false;
+
+          uint64_t want = range_mask(len);
+          uint64_t live = (nodepool[idx].mask >> offset) & want;
+          if (!live)
+              return false;
+
+          const uint8_t* data = slabpool[idx].data + offset;
+          if (live == want) {
+              copy_chunk(buf, data, len);
+              return true;
+          }
+          // only some bytes are live, so copy them one at a time
+          uint8_t* b = (uint8_t*)buf;
+          while (live) {
+              int i = __builtin_ctzll(live);
+              b[i] = data[i];
+              live &= live - 1;
+          }
+          return true;
+      }
+
+      /**
+       *  Method for doing writeback
+       */
+      void writeback()
+      {
+          // iterate through the slabs, and then write out the bytes
+          for (int i = 0; i < pool_next; ++i) {
+              uint64_t mask = nodepool[i].mask;
+              // fast path: the whole slab is live
+              if (mask == ~0ULL) {
+                  memcpy((void*)nodepool[i].key, slabpool[i].data, SLAB_SIZE);
+                  continue;
+              }
+              for (int bytes = 0; bytes < 64; bytes += 4) {
+                  // figure out if current 4 bytes are all valid
+                  int m = (mask >> bytes) & 0xF;
+                  if (m == 0xF) {
+                      // we can write this as a 32-bit word
+                      uint32_t* addr = (uint32_t*)(nodepool[i].key + bytes);
+                      uint32_t* data = (uint32_t*)(slabpool[i].data + bytes);
+                      *addr = *data;
+                  }
+                  else if (m != 0) {
+                      // write out live bytes, one at a time
+                      uint8_t* addr = (uint8_t*)nodepool[i].key + bytes;
+                      uint8_t* data = slabpool[i].data + bytes;
+                      for (int q = 0; q < 4; ++q) {
+                          if (m & 1)
+                              *addr = *data;
+                          addr++;
+                          data++;
+                          m >>= 1;
+                      }
+                  }
+              }
+          }
+      }
+
+      /**
+       *  Report whether a realloc will occur on the next new insertion.
+       */
+      bool will_reorg() const
+      {
+          return pool_next == pool_size;
+      }
+
+      /**
+       *  As with the BST, we support iteration over slabs via a two-step
+       *  interface: report the number of slabs, and then allow querying by
+       *  slab ID to get the key and mask.
+       */
+
+      /**
+       *  Return the number of active slabs
+       */
+      int slabcount() const
+      {
+          return pool_next;
+      }
+
+      /**
+       *  Allow queries to see the mask for a given slab
+       */
+      uint64_t get_mask(int slab_id) const
+      {
+          return nodepool[slab_id].mask;
+      }
+
+      /**
+       *  Allow queries to see the key for a given slab
+       */
+      uintptr_t get_key(int slab_id) const
+      {
+          return nodepool[slab_id].key;
+      }
+  };
+
+} // namespace GTM HIDDEN
+#endif // WSET_HPP__
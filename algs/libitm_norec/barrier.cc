@@ -40,5 +40,9 @@ bool abi_dispatch::memmove_overlap_check(void *dst, const void *src,
   return true;
 }
 
+// [transmem] A library built for a single TM method with GTM_STATIC_DISPATCH
+// defines the ABI functions next to that method instead (see dispatch.h).
+#ifndef GTM_STATIC_DISPATCH
 CREATE_DISPATCH_FUNCTIONS(GTM::abi_disp()->, )
+#endif
 
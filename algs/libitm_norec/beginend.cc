@@ -69,11 +69,12 @@ GTM::gtm_thread::operator new (size_t s)
 }
 
 /* Free the given transaction. Raises an error if the transaction is still
-   in use.  */
+   in use.  [transmem] Other threads may still read it, so reap_threads()
+   frees it later (see reclaim.cc).  */
 void
 GTM::gtm_thread::operator delete(void *tx)
 {
-  free(tx);
+  bury ((gtm_thread *) tx);
 }
 
 static void
@@ -97,6 +98,8 @@ GTM::gtm_thread::~gtm_thread()
 {
   if (nesting > 0)
     GTM_fatal("Thread exit while a transaction is still active.");
+  // [transmem] Let the next thread adopt our profiles (see profile.cc)
+  profile_detach ();
 
   // Deregister this transaction.
   serial_lock.write_lock ();
@@ -111,6 +114,10 @@ GTM::gtm_thread::~gtm_thread()
     }
   number_of_threads--;
   number_of_threads_changed(number_of_threads + 1, number_of_threads);
+  // [transmem] No transaction is active, so nobody can read the memory
+  // that we freed anymore.
+  arena.reclaim (~(gtm_word) 0, 0);
+  reap_threads ();
   serial_lock.write_unlock ();
 }
 
@@ -120,6 +127,7 @@ GTM::gtm_thread::gtm_thread ()
   // to initialize any of the other primitive-type members that do not have
   // constructors.
   shared_state.store(-1, memory_order_relaxed);
+  cm_reset ();
 
   // Register this transaction with the list of all threads' transactions.
   serial_lock.write_lock ();
@@ -127,6 +135,7 @@ GTM::gtm_thread::gtm_thread ()
   list_of_threads = this;
   number_of_threads++;
   number_of_threads_changed(number_of_threads - 1, number_of_threads);
+  reap_threads ();
   serial_lock.write_unlock ();
 
   if (pthread_once(&thr_release_once, thread_exit_init))
@@ -140,7 +149,11 @@ GTM::gtm_thread::gtm_thread ()
 static inline uint32_t
 choose_code_path(uint32_t prop, abi_dispatch *disp)
 {
-  if ((prop & pr_uninstrumentedCode) && disp->can_run_uninstrumented_code())
+  // [transmem] The inevitable transaction runs nested transactions that only
+  // have uninstrumented code (see method-serial.cc).
+  if ((prop & pr_uninstrumentedCode)
+      && (disp->can_run_uninstrumented_code()
+          || !(prop & pr_instrumentedCode)))
     return a_runUninstrumentedCode;
   else
     return a_runInstrumentedCode;
@@ -204,8 +217,23 @@ GTM::gtm_thread::begin_transaction (uint32_t prop, const gtm_jmpbuf *jb)
       // generated an instrumented code path.
       assert(prop & pr_instrumentedCode);
 
+      // [transmem] A serial-irrevocable transaction cannot roll back.  It
+      // may be one only because it restarted serially (see
+      // decide_retry_strategy()), which assumes that it cannot cancel, since
+      // it only checks the properties of the outermost transaction.  We hold
+      // the serial lock, so continue in serial mode, which logs the writes
+      // from here on, so that this transaction can be rolled back.
+      if ((tx->state & STATE_IRREVOCABLE) && (tx->state & STATE_SERIAL))
+        {
+          tx->state = STATE_SERIAL;
+          set_abi_disp (dispatch_serial ());
+        }
+
+      // Create a checkpoint of the current transaction.
+      gtm_transaction_cp *cp = tx->parent_txns.push();
+      cp->save(tx);
+
       // Check whether the current method actually supports closed nesting.
-      // If we can switch to another one, do so.
       // If not, we assume that actual aborts are infrequent, and rather
       // restart in _ITM_abortTransaction when we really have to.
       disp = abi_disp();
@@ -213,6 +241,14 @@ GTM::gtm_thread::begin_transaction (uint32_t prop, const gtm_jmpbuf *jb)
   else
     {
       // Outermost transaction
+      // [transmem] The call site, for read-only prediction (see retry.cc)
+#ifdef __x86_64__
+      tx->site = jb->rip;
+#else
+      tx->site = jb->eip;
+#endif
+      if (unlikely (profile_enabled))
+        tx->profile_begin ();
       disp = tx->decide_begin_dispatch (prop);
       set_abi_disp (disp);
     }
@@ -245,12 +281,15 @@ GTM::gtm_thread::begin_transaction (uint32_t prop, const gtm_jmpbuf *jb)
     }
 
   // Run dispatch-specific restart code. Retry until we succeed.
+  // [transmem] A closed nested transaction continues with the snapshot of
+  // its parent.
   GTM::gtm_restart_reason rr;
-  while ((rr = disp->begin_or_restart()) != NO_RESTART)
-    {
-      tx->decide_retry_strategy(rr);
-      disp = abi_disp();
-    }
+  if (tx->parent_txns.size() == 0)
+    while ((rr = disp->begin_or_restart()) != NO_RESTART)
+      {
+        tx->decide_retry_strategy(rr);
+        disp = abi_disp();
+      }
 
   // Determine the code path to run. Only irrevocable transactions cannot be
   // restarted, so all other transactions need to save live variables.
@@ -261,27 +300,98 @@ GTM::gtm_thread::begin_transaction (uint32_t prop, const gtm_jmpbuf *jb)
 }
 
 void
-GTM::gtm_thread::rollback (bool aborting)
+GTM::gtm_transaction_cp::save(gtm_thread* tx)
+{
+  // [transmem] Move the parent's deltas to the redo log, so that the scope
+  // covers all of its writes (see delta.cc).
+  while (!tx->deltas.empty())
+    tx->fold_deltas (tx->deltas.entries.begin()->addr, sizeof(uint64_t));
+
+  // Save everything that we might have to restore on restarts or aborts.
+  jb = tx->jb;
+  undolog_size = tx->undolog.size();
+  redolog_scope = tx->redolog.begin_scope();
+  alloc_scope = tx->arena.begin_scope();
+  user_actions_size = tx->user_actions.size();
+  id = tx->id;
+  prop = tx->prop;
+  cxa_catch_count = tx->cxa_catch_count;
+  cxa_unthrown = tx->cxa_unthrown;
+  nesting = tx->nesting;
+}
+
+void
+GTM::gtm_transaction_cp::commit(gtm_thread* tx)
+{
+  // Restore state that is not persistent across commits. Exception handling,
+  // information, nesting level, and any logs do not need to be restored on
+  // commits of nested transactions. The scopes of the logs are merged into
+  // the parent's.
+  tx->jb = jb;
+  tx->redolog.commit_scope(redolog_scope);
+  tx->arena.commit_scope();
+  tx->id = id;
+  tx->prop = prop;
+}
+
+void
+GTM::gtm_thread::rollback (gtm_transaction_cp *cp, bool aborting)
 {
   // The undo log is special in that it used for both thread-local and shared
   // data. Because of the latter, we have to roll it back before any
   // dispatch-specific rollback (which handles synchronization with other
   // transactions).
-  undolog.rollback (this, 0);
+  undolog.rollback (this, cp ? cp->undolog_size : 0);
 
-  // Perform dispatch-specific rollback.
-  abi_disp()->rollback ();
+  // Perform dispatch-specific rollback.  [transmem] A closed nested
+  // transaction only has to drop its scope of the redo log, since nothing
+  // that it wrote is visible to other transactions.
+  if (cp)
+    redolog.rollback_scope (cp->redolog_scope);
+  else
+    abi_disp()->rollback ();
 
   // Roll back all actions that are supposed to happen around the transaction.
-  rollback_user_actions (0);
-  commit_allocations (true, 0);
-  revert_cpp_exceptions ();
+  rollback_user_actions (cp ? cp->user_actions_size : 0);
+  if (cp)
+    arena.rollback_scope (cp->alloc_scope);
+  else
+    commit_allocations (true);
+  revert_cpp_exceptions (cp);
 
-  // Reset the transaction. Do not reset this->state, which is handled by
-  // the callers. Note that if we are not aborting, we reset the
-  // transaction to the point after having executed begin_transaction
-  // (we will return from it), so the nesting level must be one, not zero.
-  nesting = (aborting ? 0 : 1);
+  if (cp)
+    {
+      // We do not yet handle restarts of nested transactions. To do that, we
+      // would have to restore some state (jb, id, prop, nesting) not to the
+      // checkpoint but to the transaction that was started from this
+      // checkpoint (e.g., nesting = cp->nesting + 1);
+      assert(aborting);
+      // Roll back the rest of the state to the checkpoint.
+      jb = cp->jb;
+      id = cp->id;
+      prop = cp->prop;
+      nesting = cp->nesting;
+    }
+  else
+    {
+      // Roll back to the outermost transaction.
+      // Restore the jump buffer and transaction properties, which we will
+      // need for the longjmp used to restart or abort the transaction.
+      if (parent_txns.size() > 0)
+        {
+          jb = parent_txns[0].jb;
+          id = parent_txns[0].id;
+          prop = parent_txns[0].prop;
+        }
+      privatizing = false;
+      elastic.reset ();
+      // Reset the transaction. Do not reset this->state, which is handled by
+      // the callers. Note that if we are not aborting, we reset the
+      // transaction to the point after having executed begin_transaction
+      // (we will return from it), so the nesting level must be one, not zero.
+      nesting = (aborting ? 0 : 1);
+      parent_txns.clear();
+    }
 
   if (this->eh_in_flight)
     {
@@ -301,9 +411,31 @@ _ITM_abortTransaction (_ITM_abortReason reason)
   if (tx->state & gtm_thread::STATE_IRREVOCABLE)
     abort ();
 
+  // Roll back to innermost transaction.
+  if (tx->parent_txns.size() > 0 && !(reason & outerAbort))
+    {
+      // If the current method does not support closed nesting but we are
+      // nested and must only roll back the innermost transaction, then
+      // restart with a method that supports closed nesting.
+      abi_dispatch *disp = abi_disp();
+      if (!disp->closed_nesting())
+        tx->restart(RESTART_CLOSED_NESTING);
+
+      // The innermost transaction is a closed nested transaction.
+      gtm_transaction_cp *cp = tx->parent_txns.pop();
+      uint32_t longjmp_prop = tx->prop;
+      gtm_jmpbuf longjmp_jb = tx->jb;
+
+      tx->rollback (cp, true);
+
+      // Jump to nested transaction (use the saved jump buffer).
+      GTM_longjmp (a_abortTransaction | a_restoreLiveVariables,
+                   &longjmp_jb, longjmp_prop);
+    }
+
       // There is no nested transaction or an abort of the outermost
       // transaction was requested, so roll back to the outermost transaction.
-      tx->rollback (true);
+      tx->rollback (0, true);
 
       // Aborting an outermost transaction finishes execution of the whole
       // transaction. Therefore, reset transaction state.
@@ -312,6 +444,8 @@ _ITM_abortTransaction (_ITM_abortReason reason)
       else
     gtm_thread::serial_lock.read_unlock (tx);
       tx->state = 0;
+      if (tx->cm_priority)
+        tx->cm_release_priority ();
 
       GTM_longjmp (a_abortTransaction | a_restoreLiveVariables,
            &tx->jb, tx->prop);
@@ -323,11 +457,41 @@ GTM::gtm_thread::trycommit ()
   nesting--;
 
   // Skip any real commit for elided transactions.
-  if (nesting > 0)
+  if (nesting > 0 && (parent_txns.size() == 0 ||
+      nesting > parent_txns[parent_txns.size() - 1].nesting))
     return true;
 
-  // Commit of an outermost transaction.
+  if (nesting > 0)
+    {
+      // Commit of a closed-nested transaction. Remove one checkpoint and add
+      // any effects of this transaction to the parent transaction.
+      gtm_transaction_cp *cp = parent_txns.pop();
+      cp->commit(this);
+      return true;
+    }
+
+  // [transmem] Remember whether the call site wrote (see retry.cc).  The
+  // dispatch clears its logs when it commits, so check them now.  The
+  // read-only variants restart if the transaction writes, so there is
+  // nothing to learn from them, and neither is there from the inevitable
+  // transaction, which writes in place.
+  bool note_site = !(state & (STATE_SERIAL | STATE_IRREVOCABLE))
+    && !abi_disp()->read_only();
+  bool read_only = redolog.isEmpty() && deltas.empty() && writelog.size() == 0;
+
+  // [transmem] Measure the read and write sets for the profile now, since
+  // the dispatch clears its logs when it commits.
+  size_t profile_reads = 0, profile_writes = 0;
+  if (unlikely (profile_enabled))
+    {
+      profile_reads = valuelog.size() / sizeof (gtm_word);
+      profile_writes = redolog.slabcount() + deltas.entries.size();
+    }
+
+  // Commit of an outermost transaction.  [transmem] The reclamation
+  // generation cannot change while we are active (see reclaim.cc).
   gtm_word priv_time = 0;
+  gtm_word generation = reclaim_generation.load (memory_order_relaxed);
   if (abi_disp()->trycommit (priv_time))
     {
       // The transaction is now inactive. Everything that we still have to do
@@ -341,6 +505,12 @@ GTM::gtm_thread::trycommit ()
         }
       else
     gtm_thread::serial_lock.read_unlock (this);
+      // [transmem] Let the transactions that wait for us go ahead.  We may
+      // have become serial since we took the token (see serialirr_mode()).
+      if (inevitable_owner.load (memory_order_relaxed) == this)
+        release_inevitable ();
+      if (unlikely (profile_enabled))
+        profile_commit (profile_reads, profile_writes);
       state = 0;
 
       // We can commit the undo log after dispatch-specific commit and after
@@ -351,10 +521,23 @@ GTM::gtm_thread::trycommit ()
       cxa_catch_count = 0;
       cxa_unthrown = NULL;
       restart_total = 0;
-
-      // Ensure privatization safety, if necessary.
+      if (note_site)
+        note_read_only (read_only);
+      if (cm_policy != CM_IMMEDIATE)
+        cm_commit ();
+      // [transmem] Let the writers that yielded to us go ahead.
+      if (cm_priority)
+        cm_release_priority ();
+
+      // Ensure privatization safety, if necessary.  [transmem] If we skip
+      // quiescence, memory that we freed is reclaimed after RECLAIM_TIME.
+      gtm_word reclaim_time = priv_time;
+      if (priv_time && skip_quiescence ())
+        priv_time = 0;
+      privatizing = false;
+      elastic.reset ();
       if (priv_time)
-    {
+        {
           // There must be a seq_cst fence between the following loads of the
           // other transactions' shared_state and the dispatch-specific stores
           // that signal updates by this transaction (e.g., lock
@@ -363,28 +546,15 @@ GTM::gtm_thread::trycommit ()
           // readers will observe our updates.  We can reuse the seq_cst fence
           // in serial_lock.read_unlock() however, so we don't need another
           // one here.
-      // TODO Don't just spin but also block using cond vars / futexes
-      // here. Should probably be integrated with the serial lock code.
-      for (gtm_thread *it = gtm_thread::list_of_threads; it != 0;
-          it = it->next_thread)
-        {
-          if (it == this) continue;
-          // We need to load other threads' shared_state using acquire
-          // semantics (matching the release semantics of the respective
-          // updates).  This is necessary to ensure that the other
-          // threads' memory accesses happen before our actions that
-          // assume privatization safety.
-          // TODO Are there any platform-specific optimizations (e.g.,
-          // merging barriers)?
-          while (it->shared_state.load(memory_order_acquire) < priv_time)
-        cpu_relax();
+          quiesce (priv_time);
         }
-    }
 
       // After ensuring privatization safety, we execute potentially
       // privatizing actions (e.g., calling free()). User actions are first.
       commit_user_actions ();
-      commit_allocations (false, 0);
+      if (priv_time)
+        reclaim_time = 0;
+      commit_allocations (false, reclaim_time, generation);
 
       return true;
     }
@@ -402,6 +572,17 @@ GTM::gtm_thread::restart (gtm_restart_reason r, bool finish_serial_upgrade)
   // we need to finish this here, after rollback (to ensure privatization
   // safety despite undo writes) and before deciding about the retry strategy
   // (which could switch to/from serial mode).
+  // [transmem] The dispatch may also restart us from within trycommit()
+  // during the upgrade (e.g., lazy when it cannot lock its orecs), in which
+  // case we are serial but still marked as a reader.  Retry as
+  // serialirr_mode() would have, instead of running the dispatch again while
+  // holding the serial lock.
+  if (!finish_serial_upgrade && (state & STATE_SERIAL)
+      && shared_state.load (memory_order_relaxed) != ~(gtm_word)0)
+    {
+      finish_serial_upgrade = true;
+      r = RESTART_SERIAL_IRR;
+    }
   if (finish_serial_upgrade)
     gtm_thread::serial_lock.write_upgrade_finish(this);
 
@@ -416,6 +597,11 @@ GTM::gtm_thread::restart (gtm_restart_reason r, bool finish_serial_upgrade)
       disp = abi_disp();
     }
 
+  // [transmem] We have a new snapshot, which may be what a committer in
+  // quiesce() is waiting for.
+  atomic_thread_fence (memory_order_seq_cst);
+  quiesce_notify ();
+
   GTM_longjmp (choose_code_path(prop, disp) | a_restoreLiveVariables,
            &jb, prop);
 }
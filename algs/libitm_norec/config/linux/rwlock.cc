@@ -58,6 +58,8 @@ gtm_rwlock::read_lock (gtm_thread *tx)
 	  writer_readers.store (0, memory_order_relaxed);
 	  futex_wake(&writer_readers, 1);
 	}
+      // [transmem] Committers blocked in quiesce() can stop waiting for us.
+      gtm_thread::quiesce_notify ();
 
       // Signal that there are waiting readers and wait until there is no
       // writer anymore.
@@ -118,29 +120,57 @@ gtm_rwlock::read_lock (gtm_thread *tx)
 // would have to coordinate with later arriving upgrades and hand over the
 // lock to them, including the the reader-waiting state. We can try to support
 // this if this will actually happen often enough in real workloads.
+//
+// [transmem] The inevitable transaction cannot restart, so its upgrade must
+// not fail (see serialirr_mode()).  Other writers therefore back off while
+// another thread holds the inevitability token: they release the lock, and
+// then fail the upgrade, or wait until the token is released.  They check
+// for the token after acquiring the lock, and the inevitable transaction
+// checks for writers after taking the token (in read_lock()), so either it
+// waits for us before it becomes active, or we see it (Dekker-style).
 
 bool
 gtm_rwlock::write_lock_generic (gtm_thread *tx)
 {
-  // Try to acquire the write lock.
-  int w = 0;
-  if (unlikely (!writers.compare_exchange_strong (w, 1)))
+  gtm_thread *self = tx ? tx : gtm_thr ();
+  for (;;)
     {
-      // If this is an upgrade, we must not wait for other writers or
-      // upgrades.
-      if (tx != 0)
-	return false;
-
-      // There is already a writer. If there are no other waiting writers,
-      // switch to contended mode.  We need seq_cst memory order to make the
-      // Dekker-style synchronization work.
-      if (w != 2)
-	w = writers.exchange (2);
-      while (w != 0)
+      // Try to acquire the write lock.
+      int w = 0;
+      if (unlikely (!writers.compare_exchange_strong (w, 1)))
 	{
-	  futex_wait(&writers, 2);
-	  w = writers.exchange (2);
+	  // If this is an upgrade, we must not wait for other writers or
+	  // upgrades.  [transmem] Unless it is the inevitable transaction's,
+	  // which waits for them to back off.
+	  if (tx != 0)
+	    {
+	      if (gtm_thread::inevitable_owner.load (memory_order_relaxed)
+		  != tx)
+		return false;
+	      cpu_relax ();
+	      continue;
+	    }
+
+	  // There is already a writer. If there are no other waiting writers,
+	  // switch to contended mode.  We need seq_cst memory order to make
+	  // the Dekker-style synchronization work.
+	  if (w != 2)
+	    w = writers.exchange (2);
+	  while (w != 0)
+	    {
+	      futex_wait(&writers, 2);
+	      w = writers.exchange (2);
+	    }
 	}
+
+      // [transmem] Back off if somebody else holds the inevitability token.
+      gtm_thread *owner = gtm_thread::inevitable_owner.load ();
+      if (likely (owner == 0 || owner == self))
+	break;
+      write_unlock ();
+      if (tx != 0)
+	return false;
+      gtm_thread::wait_inevitable (self);
     }
 
   // We have acquired the writer side of the R/W lock. Now wait for any
@@ -206,6 +236,9 @@ gtm_rwlock::write_upgrade_finish (gtm_thread *tx)
   // We are not a reader anymore.  This is only safe to do after we have
   // acquired the writer lock.
   tx->shared_state.store (-1, memory_order_release);
+  // [transmem] Wake committers blocked in quiesce().
+  atomic_thread_fence (memory_order_seq_cst);
+  gtm_thread::quiesce_notify ();
 }
 
 
@@ -238,6 +271,10 @@ gtm_rwlock::read_unlock (gtm_thread *tx)
       writer_readers.store (0, memory_order_relaxed);
       futex_wake(&writer_readers, 1);
     }
+
+  // [transmem] Wake committers blocked in quiesce(), which also relies on
+  // the seq_cst fence above.
+  gtm_thread::quiesce_notify ();
 }
 
 
@@ -62,6 +62,25 @@ cpu_relax (void)
   __builtin_ia32_pause ();
 }
 
+// Returns true iff the CPU supports AVX2, and the OS saves the upper halves of
+// the ymm registers (i.e., it is safe to run AVX2 code).
+static inline bool
+avx2_available ()
+{
+  unsigned a, b, c, d;
+  if (__get_cpuid_max (0, NULL) < 7)
+    return false;
+  __cpuid (1, a, b, c, d);
+  if (!(c & bit_OSXSAVE) || !(c & bit_AVX))
+    return false;
+  unsigned xcr0_lo, xcr0_hi;
+  __asm__ ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  if ((xcr0_lo & 6) != 6)
+    return false;
+  __cpuid_count (7, 0, a, b, c, d);
+  return b & bit_AVX2;
+}
+
 // Use Intel RTM if supported by the assembler.
 // See gtm_thread::begin_transaction for how these functions are used.
 #ifdef HAVE_AS_RTM
@@ -0,0 +1,36 @@
+// AVX2 validation kernel for value-based validation (see valuelog.cc).  This
+// file is compiled with -mavx2, and the kernel is only selected at load time
+// if the CPU (and OS) support AVX2.
+
+#include "libitm_i.h"
+
+namespace GTM HIDDEN {
+
+bool
+valuecheck_avx2 (const uint8_t *mem, const uint8_t *logged, size_t len)
+{
+  // Compare 32 bytes at a time: cmpeq sets a byte to 0xFF iff the bytes
+  // match, so the movemask is all ones iff the whole block matches.
+  for (; len >= 32; len -= 32)
+    {
+      __m256i a = _mm256_loadu_si256((const __m256i *) mem);
+      __m256i b = _mm256_loadu_si256((const __m256i *) logged);
+      if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) != -1)
+        return false;
+      mem += 32;
+      logged += 32;
+    }
+  if (len >= 16)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i *) mem);
+      __m128i b = _mm_loadu_si128((const __m128i *) logged);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF)
+        return false;
+      mem += 16;
+      logged += 16;
+      len -= 16;
+    }
+  return valuecheck_scalar(mem, logged, len);
+}
+
+} // namespace GTM
@@ -34,6 +34,7 @@ using namespace GTM;
 extern "C" {
 
 extern void *__cxa_allocate_exception (size_t) WEAK;
+extern void __cxa_free_exception (void *) WEAK;
 extern void __cxa_throw (void *, void *, void *) WEAK;
 extern void *__cxa_begin_catch (void *) WEAK;
 extern void __cxa_end_catch (void) WEAK;
@@ -41,6 +42,7 @@ extern void __cxa_tm_cleanup (void *, void *, unsigned int) WEAK;
 
 #if !defined (HAVE_ELF_STYLE_WEAKREF)
 void *__cxa_allocate_exception (size_t) { return NULL; }
+void __cxa_free_exception (void *) { return; }
 void __cxa_throw (void *, void *, void *) { return; }
 void *__cxa_begin_catch (void *) { return NULL; }
 void __cxa_end_catch (void) { return; }
@@ -59,6 +61,18 @@ _ITM_cxa_allocate_exception (size_t size)
   return r;
 }
 
+/* [transmem] The constructor of an exception object can throw, in which case
+   the exception is freed before it is thrown, and must no longer be cleaned
+   up on abort.  */
+void
+_ITM_cxa_free_exception (void *exc_ptr)
+{
+  gtm_thread *t = gtm_thr();
+  if (t->cxa_unthrown == exc_ptr)
+    t->cxa_unthrown = NULL;
+  __cxa_free_exception (exc_ptr);
+}
+
 void
 _ITM_cxa_throw (void *obj, void *tinfo, void *dest)
 {
@@ -81,16 +95,37 @@ _ITM_cxa_end_catch (void)
 }
 
 void
-GTM::gtm_thread::revert_cpp_exceptions ()
+GTM::gtm_thread::revert_cpp_exceptions (gtm_transaction_cp *cp)
 {
+  if (cp)
+    {
+      // If rolling back a nested transaction, only clean up unthrown
+      // exceptions since the last checkpoint. Always reset eh_in_flight
+      // because it just contains the argument provided to
+      // _ITM_commitTransactionEH
+      void *unthrown =
+          (cxa_unthrown != cp->cxa_unthrown ? cxa_unthrown : NULL);
+      assert (cxa_catch_count >= cp->cxa_catch_count);
+      uint32_t catch_count = cxa_catch_count - cp->cxa_catch_count;
+      if (unthrown || catch_count)
+        {
+          __cxa_tm_cleanup (unthrown, this->eh_in_flight, catch_count);
+          cxa_catch_count = cp->cxa_catch_count;
+          cxa_unthrown = cp->cxa_unthrown;
+          this->eh_in_flight = NULL;
+        }
+    }
+  else
+    {
       // Both cxa_catch_count and cxa_unthrown are maximal because EH regions
       // and transactions are properly nested.
       if (this->cxa_unthrown || this->cxa_catch_count)
-    {
-      __cxa_tm_cleanup (this->cxa_unthrown, this->eh_in_flight,
-          this->cxa_catch_count);
-      this->cxa_catch_count = 0;
-      this->cxa_unthrown = NULL;
-      this->eh_in_flight = NULL;
+        {
+          __cxa_tm_cleanup (this->cxa_unthrown, this->eh_in_flight,
+              this->cxa_catch_count);
+          this->cxa_catch_count = 0;
+          this->cxa_unthrown = NULL;
+          this->eh_in_flight = NULL;
+        }
     }
 }
@@ -65,34 +65,6 @@ gtm_undolog::rollback (gtm_thread* tx, size_t until_size)
     }
 }
 
-// Validate a value-based read set by iterating through the set and ensuring
-// that every memory location holds the value that was previously observed
-bool gtm_undolog::valuecheck ()
-{
-  gtm_thread *tx = gtm_thr();
-  size_t i, n = undolog.size();
-  void *top = mask_stack_top(tx);
-  void *bot = mask_stack_bottom(tx);
-
-  if (n > 0) {
-    for (i = n; i-- > 0; ) {
-      void *ptr = (void *) undolog[i--];
-      size_t len = undolog[i];
-      size_t words = (len + sizeof(gtm_word) - 1) / sizeof(gtm_word);
-      i -= words;
-      // only validate if on the stack
-      // NB: this check is probably not needed, since we filter on every
-      //     read
-      if (likely(ptr > top || (uint8_t*)ptr + len <= bot)) {
-        if (0 != __builtin_memcmp(ptr, &undolog[i], len))
-          return false;
-      }
-    }
-  }
-  return true;
-}
-
-
 void ITM_REGPARM
 GTM_LB (const void *ptr, size_t len)
 {
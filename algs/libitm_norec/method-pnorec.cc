@@ -0,0 +1,494 @@
+#include "libitm_i.h"
+
+// [transmem] Partitioned NOrec
+//
+// NOrec has a single sequence lock, so every writer commit makes all
+// concurrent transactions revalidate, and writers commit one at a time.
+// Partitioned NOrec splits the lock into up to 64 partitions, each
+// protecting the cache lines that hash to it.  A transaction records the
+// partitions that it has read in a bitmask, together with the value of each
+// partition's lock.  A read is consistent if the partition of the data has
+// not changed since; the first read of a partition must also check that none
+// of the others has changed, so that all reads are consistent at that time.
+// Only a change to a partition that the transaction has read makes it
+// revalidate its value log.  A writer acquires the locks of the partitions
+// that it writes to in ascending order, so that writers to disjoint
+// partitions commit concurrently.
+//
+// Set ITM_DEFAULT_METHOD=pnorec to use it, and ITM_PNOREC_PARTITIONS to the
+// number of partitions (a power of two up to 64, 16 by default).  Unlike
+// NOrec, this is not privatization-safe: a writer might still be writing
+// back data that a privatizer has read, if they share no partition.  Writers
+// thus take a commit time from a shared clock, which is only used for
+// quiescence.  There is no read-only or inevitable variant, and no support
+// for commutative updates or priority transactions.
+
+using namespace GTM;
+
+namespace {
+
+// The group of the partitioned NOrec method
+struct pnorec_mg : public method_group
+{
+  // Maximum time is all bits except the lock bit and the overflow reserve bit
+  static const gtm_word TIME_MAX = (~(gtm_word)0 >> 2);
+  static const unsigned DEFAULT_PARTITIONS = 16;
+
+  // The sequence lock of a partition, on a cache line of its own
+  struct partition
+  {
+    atomic<gtm_word> seq;
+  } __attribute__((aligned(HW_CACHELINE_SIZE)));
+
+  partition parts[gtm_partitions::MAX];
+  // The clock for quiescence, incremented by every writer commit
+  atomic<gtm_word> clock __attribute__((aligned(HW_CACHELINE_SIZE)));
+  // The number of partitions, minus 1
+  unsigned mask;
+
+  pnorec_mg() : mask(0) { }
+
+  // Returns the partition of the cache line at ADDR
+  unsigned partition_of(const void* addr) const
+  {
+    uint64_t h = (uint64_t)((uintptr_t)addr >> 6) * 0x9E3779B97F4A7C15ULL;
+    return (unsigned)(h >> 58) & mask;
+  }
+
+  // Returns the partitions of [ADDR, ADDR + LEN), one bit for each
+  uint64_t partitions_of(const void* addr, size_t len) const
+  {
+    return (1ULL << partition_of(addr))
+      | (1ULL << partition_of((const uint8_t*)addr + len - 1));
+  }
+
+  void reset()
+  {
+    for (unsigned i = 0; i < gtm_partitions::MAX; i++)
+      parts[i].seq.store(0, memory_order_relaxed);
+    clock.store(0, memory_order_relaxed);
+  }
+
+  virtual void init()
+  {
+    // The number of partitions is rounded up to a power of two.
+    unsigned n = DEFAULT_PARTITIONS;
+    const char *env = getenv("ITM_PNOREC_PARTITIONS");
+    if (env != NULL)
+      {
+        unsigned long want = strtoul(env, NULL, 10);
+        for (n = 1; n < gtm_partitions::MAX && n < want; n <<= 1)
+          ;
+      }
+    mask = n - 1;
+    // This is only executed while holding the serial lock, so relaxed
+    // memory order is sufficient here.
+    reset();
+  }
+
+  virtual void fini() { }
+
+  // We only re-initialize when the clock overflows.
+  virtual void reinit() { reset(); }
+};
+
+static pnorec_mg o_pnorec_mg;
+
+class pnorec_dispatch : public abi_dispatch
+{
+protected:
+  // Take a snapshot of the partitions in BITS that TX has not read yet, and
+  // return those partitions.
+  static uint64_t extend(gtm_thread* tx, uint64_t bits)
+  {
+    gtm_partitions &tp = tx->partitions;
+    uint64_t fresh = bits & ~tp.read;
+    for (uint64_t m = fresh; m != 0; m &= m - 1)
+      {
+        unsigned p = __builtin_ctzll(m);
+        gtm_word s;
+        while (((s = o_pnorec_mg.parts[p].seq.load(memory_order_acquire))
+                & 1))
+          cpu_relax();
+        tp.snap[p] = s;
+      }
+    tp.read |= fresh;
+    return fresh;
+  }
+
+  // Returns true iff the data that TX has just read from the partitions in
+  // BITS is consistent with its earlier reads.  If it has read a partition
+  // for the first time (i.e., FRESH is not empty), none of its partitions
+  // may have changed.
+  static bool consistent(gtm_thread* tx, uint64_t bits, uint64_t fresh)
+  {
+    atomic_thread_fence(memory_order_acquire);
+    gtm_partitions &tp = tx->partitions;
+    for (uint64_t m = fresh ? tp.read : bits; m != 0; m &= m - 1)
+      {
+        unsigned p = __builtin_ctzll(m);
+        if (o_pnorec_mg.parts[p].seq.load(memory_order_relaxed)
+            != tp.snap[p])
+          return false;
+      }
+    return true;
+  }
+
+  // Returns true iff all locations read by the transaction still have the
+  // values observed by the transaction, and takes a new snapshot of its
+  // partitions that they are consistent with.
+  static bool validate(gtm_thread *tx)
+  {
+    gtm_partitions &tp = tx->partitions;
+    while (true)
+      {
+        // Read the clock first: the new snapshot is at least as recent.
+        gtm_word c = o_pnorec_mg.clock.load(memory_order_acquire);
+        for (uint64_t m = tp.read; m != 0; m &= m - 1)
+          {
+            unsigned p = __builtin_ctzll(m);
+            gtm_word s;
+            while (((s = o_pnorec_mg.parts[p].seq.load(memory_order_acquire))
+                    & 1))
+              cpu_relax();
+            tp.snap[p] = s;
+          }
+
+        if (!tx->valuelog.valuecheck())
+          return false;
+
+        // make sure no partition changed during validation
+        if (consistent(tx, tp.read, 0))
+          {
+            tx->shared_state.store(c, memory_order_release);
+            return true;
+          }
+      }
+  }
+
+  template <typename V> static V load(const V* addr, ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+
+    // stack filter: if we are reading from a stack location, just read it
+    // without logging or write set lookup
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    if ((addr <= top && (uint8_t*) addr > bot ) ||
+        ((uint8_t*)addr < bot && ((uint8_t*)addr + sizeof(V) > bot))) {
+      return *addr;
+    }
+
+    V v;
+    if (!tx->redolog.isEmpty() && tx->redolog.find(addr, v) != 0)
+      return v;
+
+    uint64_t bits = o_pnorec_mg.partitions_of(addr, sizeof(V));
+    while (true)
+      {
+        uint64_t fresh = extend(tx, bits);
+        v = *addr;
+        if (consistent(tx, bits, fresh))
+          break;
+        if (!validate(tx))
+          tx->restart(RESTART_VALIDATE_READ);
+      }
+
+    tx->valuelog.log_read(addr, sizeof(V), &v);
+    return v;
+  }
+
+  template <typename V> static void store(V* addr, const V value,
+      ls_modifier mod)
+  {
+    // filter out writes to the stack frame
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    if ((addr <= top && (uint8_t*) addr > bot ) ||
+        ((uint8_t*)addr < bot && ((uint8_t*)addr + sizeof(V) > bot))) {
+      *addr = value;
+      return;
+    }
+
+    // insert into the log, so we can write it back later
+    tx->redolog.insert(addr, value);
+  }
+
+  // Returns true iff [addr, addr + len) overlaps the transaction's own stack
+  // frames, in which case the access must bypass the logs
+  static bool on_stack(const void* addr, size_t len, void* top, void* bot)
+  {
+    return (const uint8_t*)addr <= (uint8_t*)top
+        && (const uint8_t*)addr + len > (uint8_t*)bot;
+  }
+
+  // As in NOrec, bulk accesses are split into aligned 8/16/32-byte chunks,
+  // which never span a cache line, so each has a single partition.
+  static size_t next_chunk(const void* addr, size_t len)
+  {
+    uintptr_t a = (uintptr_t)addr;
+    if (len >= 32 && (a & 31) == 0)
+      return 32;
+    if (len >= 16 && (a & 15) == 0)
+      return 16;
+    if (len >= 8 && (a & 7) == 0)
+      return 8;
+    return 1;
+  }
+
+  // Transactionally read the LEN bytes of an aligned chunk at ADDR into BUF
+  static void load_chunk(gtm_thread* tx, const uint8_t* addr, uint8_t* buf,
+      size_t len)
+  {
+    uint64_t bits = o_pnorec_mg.partitions_of(addr, len);
+    while (true)
+      {
+        uint64_t fresh = extend(tx, bits);
+        copy_chunk(buf, addr, len);
+        if (consistent(tx, bits, fresh))
+          break;
+        if (!validate(tx))
+          tx->restart(RESTART_VALIDATE_READ);
+      }
+    tx->valuelog.log_read(addr, len, buf);
+    if (!tx->redolog.isEmpty())
+      tx->redolog.merge(addr, buf, len);
+  }
+
+  // Read [src, src + len) into BUF, one chunk at a time
+  static void load_bytes(gtm_thread* tx, const uint8_t* src, uint8_t* buf,
+      size_t len, ls_modifier mod, void* top, void* bot)
+  {
+    if (mod == NONTXNAL || on_stack(src, len, top, bot)) {
+      ::memcpy(buf, src, len);
+      return;
+    }
+    while (len > 0) {
+      size_t n = next_chunk(src, len);
+      load_chunk(tx, src, buf, n);
+      src += n;
+      buf += n;
+      len -= n;
+    }
+  }
+
+  // Write BUF to [dst, dst + len)
+  static void store_bytes(gtm_thread* tx, uint8_t* dst, const uint8_t* buf,
+      size_t len, ls_modifier mod, void* top, void* bot)
+  {
+    if (mod == NONTXNAL)
+      ::memcpy(dst, buf, len);
+    else if (!on_stack(dst, len, top, bot))
+      tx->redolog.insert_bytes(dst, buf, len);
+    else
+      for (size_t i = 0; i < len; i++)
+        store<uint8_t>(dst + i, buf[i], mod);
+  }
+
+  // Release the locks of the partitions in HELD.  If WROTE is false, we
+  // have not written anything, so the locks get their old values back.
+  static void unlock(uint64_t held, bool wrote)
+  {
+    for (uint64_t m = held; m != 0; m &= m - 1)
+      {
+        unsigned p = __builtin_ctzll(m);
+        atomic<gtm_word> &seq = o_pnorec_mg.parts[p].seq;
+        gtm_word s = seq.load(memory_order_relaxed);
+        seq.store(wrote ? s + 1 : s - 1, memory_order_release);
+      }
+  }
+
+  // Acquire the locks of the partitions in WRITES, in ascending order, and
+  // check that the partitions that TX has read have not changed.  Returns
+  // false and releases the locks otherwise.  We only wait for a lock while
+  // holding others if TX has not read its partition, and then only for
+  // writers that acquire locks in the same order.
+  static bool lock(gtm_thread* tx, uint64_t writes)
+  {
+    gtm_partitions &tp = tx->partitions;
+    uint64_t held = 0;
+    for (uint64_t m = writes; m != 0; m &= m - 1)
+      {
+        unsigned p = __builtin_ctzll(m);
+        atomic<gtm_word> &seq = o_pnorec_mg.parts[p].seq;
+        gtm_word s;
+        if (tp.read & (1ULL << p))
+          {
+            s = tp.snap[p];
+            if (!seq.compare_exchange_strong(s, s + 1, memory_order_acquire))
+              {
+                unlock(held, false);
+                return false;
+              }
+          }
+        else
+          do
+            {
+              while (((s = seq.load(memory_order_relaxed)) & 1))
+                cpu_relax();
+            }
+          while (!seq.compare_exchange_weak(s, s + 1, memory_order_acquire));
+        held |= 1ULL << p;
+      }
+
+    if (!consistent(tx, tp.read & ~writes, 0))
+      {
+        unlock(held, false);
+        return false;
+      }
+    return true;
+  }
+
+public:
+  static void memtransfer_static(void *dst, const void* src, size_t size,
+      bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    const uint8_t *srcaddr = (const uint8_t*)src;
+    uint8_t *dstaddr = (uint8_t*)dst;
+
+    // Since we do buffered writes, a forward copy only goes wrong if a later
+    // chunk of the source was already overwritten (in the redo log) by an
+    // earlier chunk of the destination.  In that case, read everything first.
+    if (may_overlap && dstaddr > srcaddr && dstaddr < srcaddr + size)
+      {
+        uint8_t* tmp = (uint8_t*)xmalloc(size);
+        load_bytes(tx, srcaddr, tmp, size, src_mod, top, bot);
+        store_bytes(tx, dstaddr, tmp, size, dst_mod, top, bot);
+        free(tmp);
+        return;
+      }
+
+    // Otherwise, move the data through a small buffer.
+    uint8_t buf[256] __attribute__((aligned(64)));
+    while (size > 0)
+      {
+        size_t n = sizeof(buf) - ((uintptr_t)srcaddr & 63);
+        if (n > size)
+          n = size;
+        load_bytes(tx, srcaddr, buf, n, src_mod, top, bot);
+        store_bytes(tx, dstaddr, buf, n, dst_mod, top, bot);
+        srcaddr += n;
+        dstaddr += n;
+        size -= n;
+      }
+  }
+
+  static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    uint8_t* dstaddr = (uint8_t*)dst;
+
+    if (!on_stack(dstaddr, size, top, bot))
+      tx->redolog.fill_bytes(dstaddr, (uint8_t)c, size);
+    else
+      for (size_t i = 0; i < size; i++)
+        store<uint8_t>(dstaddr + i, (uint8_t)c, mod);
+  }
+
+  virtual gtm_restart_reason begin_or_restart()
+  {
+    // NB: We don't need to do anything for nested transactions.
+    gtm_thread *tx = gtm_thr();
+
+    // Partitions are read lazily, so the snapshot is only the clock.
+    gtm_word snapshot = o_pnorec_mg.clock.load(memory_order_acquire);
+
+    // Re-initialize method group on time overflow.
+    if (snapshot >= o_pnorec_mg.TIME_MAX)
+      return RESTART_INIT_METHOD_GROUP;
+
+    tx->partitions.read = 0;
+    // As in NOrec, relaxed memory order is sufficient here (see rollback()).
+    tx->shared_state.store(snapshot, memory_order_relaxed);
+    return NO_RESTART;
+  }
+
+  virtual bool trycommit(gtm_word& priv_time)
+  {
+    gtm_thread* tx = gtm_thr();
+
+    // If we haven't updated anything, we can commit. Just clean value log.
+    if (tx->redolog.isEmpty()) {
+      tx->valuelog.commit();
+      tx->partitions.read = 0;
+      return true;
+    }
+
+    // The slabs of the redo log are single cache lines.
+    uint64_t writes = 0;
+    for (int i = 0; i < tx->redolog.slabcount(); ++i)
+      writes |= 1ULL
+        << o_pnorec_mg.partition_of((void*)tx->redolog.get_key(i));
+
+    while (!lock(tx, writes))
+      if (!validate(tx))
+        return false;
+
+    tx->redolog.writeback();
+    unlock(writes, true);
+    gtm_word ct = o_pnorec_mg.clock.fetch_add(1, memory_order_acq_rel) + 1;
+
+    // We're done, clear the logs.
+    tx->redolog.reset();
+    // NB: this clears the log, although it is called "commit"
+    tx->valuelog.commit();
+    tx->partitions.read = 0;
+
+    // Need to ensure privatization safety (see the top of this file).
+    priv_time = ct;
+    return true;
+  }
+
+  virtual void rollback()
+  {
+    gtm_thread *tx = gtm_thr();
+
+    // We need this release fence to ensure that privatizers see the
+    // rolled-back original state (not any uncommitted values) when they read
+    // the new snapshot time that we write in begin_or_restart().
+    atomic_thread_fence(memory_order_release);
+
+    // We're done, clear the logs.
+    tx->redolog.reset();
+    tx->valuelog.commit();
+    tx->partitions.read = 0;
+  }
+
+  virtual bool supports(unsigned number_of_threads)
+  {
+    return true;
+  }
+
+  // Writes are buffered in the redo log, which has a scope for each closed
+  // nested transaction (see gtm_transaction_cp)
+  virtual bool closed_nesting() { return true; }
+  // The read set is the value log, in bytes (see elastic.cc).  Released
+  // reads keep their partitions, which is merely conservative.
+  virtual size_t read_set_mark() { return gtm_thr()->valuelog.size(); }
+  virtual void release_reads(size_t from, size_t to)
+  {
+    gtm_thr()->valuelog.release(from, to);
+  }
+
+  CREATE_DISPATCH_METHODS(virtual, )
+  CREATE_DISPATCH_METHODS_MEM()
+
+  pnorec_dispatch() : abi_dispatch(false, true, false, 0, &o_pnorec_mg)
+  { }
+};
+
+} // anon namespace
+
+static const pnorec_dispatch o_pnorec_dispatch;
+
+abi_dispatch *
+GTM::dispatch_pnorec ()
+{
+  return const_cast<pnorec_dispatch *>(&o_pnorec_dispatch);
+}
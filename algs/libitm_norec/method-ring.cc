@@ -0,0 +1,385 @@
+#include "libitm_i.h"
+
+// [transmem] RingSTM
+//
+// RingSTM (Spear et al., SPAA 2008) detects conflicts with Bloom filter
+// signatures instead of value or orec logs.  A transaction adds every cache
+// line that it reads to its read signature (see gtm_signature).  A writer
+// commits by appending the signature of its redo log to a global ring of
+// the most recent commits, and then writes back.  A transaction's snapshot
+// is the index of the newest ring entry that it has checked; if a newer
+// entry exists when it reads, it intersects its read signature with the
+// newer entries, and restarts if any of them have a line in common.
+// Validation thus costs the same however many locations the transaction has
+// read, at the price of false conflicts when signatures fill up.
+//
+// This is the single-writer variant: a writer only appends its entry once
+// the write-back of the previous entry has completed, so write-backs happen
+// in ring order.  A transaction that falls behind by more than the size of
+// the ring restarts.  As in NOrec, readers check every value before they use
+// it, and a privatizer cannot commit while a writer is still writing back,
+// so RingSTM is privatization-safe without quiescence.  Set
+// ITM_DEFAULT_METHOD=ring to use it.
+
+using namespace GTM;
+
+namespace {
+
+// This group consists of the RingSTM method
+struct ring_mg : public method_group
+{
+  // Maximum time is all bits except the lock bit and the overflow reserve bit
+  static const gtm_word TIME_MAX = (~(gtm_word)0 >> 2);
+  static const unsigned RING_SIZE = 1024;
+  // The index of an entry that is being overwritten
+  static const gtm_word INVALID = ~(gtm_word)0;
+
+  // An entry of the ring: the write signature of commit INDEX
+  struct entry
+  {
+    atomic<gtm_word> index;
+    uint64_t signature[gtm_signature::WORDS] __attribute__((aligned(16)));
+  } __attribute__((aligned(HW_CACHELINE_SIZE)));
+
+  // The index of the newest entry, and of the newest entry whose write-back
+  // has completed
+  atomic<gtm_word> last __attribute__((aligned(HW_CACHELINE_SIZE)));
+  atomic<gtm_word> completed __attribute__((aligned(HW_CACHELINE_SIZE)));
+  entry ring[RING_SIZE];
+
+  entry &entry_of(gtm_word i) { return ring[i & (RING_SIZE - 1)]; }
+
+  virtual void init()
+  {
+    // This is only executed while holding the serial lock, so relaxed
+    // memory order is sufficient here.
+    for (unsigned i = 0; i < RING_SIZE; i++)
+      {
+        ring[i].index.store(0, memory_order_relaxed);
+        memset(ring[i].signature, 0, sizeof(ring[i].signature));
+      }
+    last.store(0, memory_order_relaxed);
+    completed.store(0, memory_order_relaxed);
+  }
+
+  virtual void fini() { }
+
+  // We only re-initialize when the ring index overflows.
+  virtual void reinit() { init(); }
+};
+
+static ring_mg o_ring_mg;
+
+class ring_dispatch : public abi_dispatch
+{
+protected:
+  // Returns true iff the transaction's read signature has no line in common
+  // with the entries that have been appended since its snapshot, and then
+  // advances the snapshot past them, once their write-backs have completed.
+  static bool validate(gtm_thread *tx)
+  {
+    gtm_word start = tx->shared_state.load(memory_order_relaxed);
+    gtm_word last = o_ring_mg.last.load(memory_order_acquire);
+    if (last - start >= ring_mg::RING_SIZE)
+      return false;
+
+    for (gtm_word i = start + 1; i <= last; i++)
+      {
+        ring_mg::entry &e = o_ring_mg.entry_of(i);
+        // Wait until the writer has filled in the entry.  An index beyond I
+        // means that the entry has been overwritten.
+        gtm_word idx;
+        while ((idx = e.index.load(memory_order_acquire)) < i
+               || idx == ring_mg::INVALID)
+          cpu_relax();
+        if (idx != i)
+          return false;
+        bool conflict = tx->read_signature.intersects(e.signature);
+        atomic_thread_fence(memory_order_acquire);
+        if (e.index.load(memory_order_relaxed) != i || conflict)
+          return false;
+      }
+
+    while (o_ring_mg.completed.load(memory_order_acquire) < last)
+      cpu_relax();
+    tx->shared_state.store(last, memory_order_release);
+    return true;
+  }
+
+  // Returns true iff no writer has appended an entry since the snapshot of
+  // TX.  The fence orders the preceding data reads before the check.
+  static bool unchanged(gtm_thread *tx)
+  {
+    atomic_thread_fence(memory_order_acquire);
+    return o_ring_mg.last.load(memory_order_relaxed)
+      == tx->shared_state.load(memory_order_relaxed);
+  }
+
+  template <typename V> static V load(const V* addr, ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+
+    // stack filter: if we are reading from a stack location, just read it
+    // without logging or write set lookup
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    if ((addr <= top && (uint8_t*) addr > bot ) ||
+        ((uint8_t*)addr < bot && ((uint8_t*)addr + sizeof(V) > bot))) {
+      return *addr;
+    }
+
+    V v;
+    if (!tx->redolog.isEmpty() && tx->redolog.find(addr, v) != 0)
+      return v;
+
+    // The line must be in the signature before we check the ring.
+    tx->read_signature.add(addr, sizeof(V));
+    v = *addr;
+    while (!unchanged(tx))
+      {
+        if (!validate(tx))
+          tx->restart(RESTART_VALIDATE_READ);
+        v = *addr;
+      }
+    return v;
+  }
+
+  template <typename V> static void store(V* addr, const V value,
+      ls_modifier mod)
+  {
+    // filter out writes to the stack frame
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    if ((addr <= top && (uint8_t*) addr > bot ) ||
+        ((uint8_t*)addr < bot && ((uint8_t*)addr + sizeof(V) > bot))) {
+      *addr = value;
+      return;
+    }
+
+    // insert into the log, so we can write it back later
+    tx->redolog.insert(addr, value);
+  }
+
+  // Returns true iff [addr, addr + len) overlaps the transaction's own stack
+  // frames, in which case the access must bypass the logs
+  static bool on_stack(const void* addr, size_t len, void* top, void* bot)
+  {
+    return (const uint8_t*)addr <= (uint8_t*)top
+        && (const uint8_t*)addr + len > (uint8_t*)bot;
+  }
+
+  // Read [src, src + len) into BUF.  A single check of the ring covers the
+  // whole range, so there is no need to read it in chunks; the bytes that
+  // the transaction has written are then merged in from the redo log.
+  static void load_bytes(gtm_thread* tx, const uint8_t* src, uint8_t* buf,
+      size_t len, ls_modifier mod, void* top, void* bot)
+  {
+    if (mod == NONTXNAL || on_stack(src, len, top, bot)) {
+      ::memcpy(buf, src, len);
+      return;
+    }
+    tx->read_signature.add(src, len);
+    ::memcpy(buf, src, len);
+    while (!unchanged(tx))
+      {
+        if (!validate(tx))
+          tx->restart(RESTART_VALIDATE_READ);
+        ::memcpy(buf, src, len);
+      }
+    // merge() works on one slab (cache line) at a time
+    if (!tx->redolog.isEmpty())
+      while (len > 0)
+        {
+          size_t n = 64 - ((uintptr_t)src & 63);
+          if (n > len)
+            n = len;
+          tx->redolog.merge(src, buf, n);
+          src += n;
+          buf += n;
+          len -= n;
+        }
+  }
+
+  // Write BUF to [dst, dst + len)
+  static void store_bytes(gtm_thread* tx, uint8_t* dst, const uint8_t* buf,
+      size_t len, ls_modifier mod, void* top, void* bot)
+  {
+    if (mod == NONTXNAL)
+      ::memcpy(dst, buf, len);
+    else if (!on_stack(dst, len, top, bot))
+      tx->redolog.insert_bytes(dst, buf, len);
+    else
+      for (size_t i = 0; i < len; i++)
+        store<uint8_t>(dst + i, buf[i], mod);
+  }
+
+public:
+  static void memtransfer_static(void *dst, const void* src, size_t size,
+      bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    const uint8_t *srcaddr = (const uint8_t*)src;
+    uint8_t *dstaddr = (uint8_t*)dst;
+
+    // Since we do buffered writes, a forward copy only goes wrong if a later
+    // chunk of the source was already overwritten (in the redo log) by an
+    // earlier chunk of the destination.  In that case, read everything first.
+    if (may_overlap && dstaddr > srcaddr && dstaddr < srcaddr + size)
+      {
+        uint8_t* tmp = (uint8_t*)xmalloc(size);
+        load_bytes(tx, srcaddr, tmp, size, src_mod, top, bot);
+        store_bytes(tx, dstaddr, tmp, size, dst_mod, top, bot);
+        free(tmp);
+        return;
+      }
+
+    // Otherwise, move the data through a small buffer.
+    uint8_t buf[256] __attribute__((aligned(64)));
+    while (size > 0)
+      {
+        size_t n = sizeof(buf) - ((uintptr_t)srcaddr & 63);
+        if (n > size)
+          n = size;
+        load_bytes(tx, srcaddr, buf, n, src_mod, top, bot);
+        store_bytes(tx, dstaddr, buf, n, dst_mod, top, bot);
+        srcaddr += n;
+        dstaddr += n;
+        size -= n;
+      }
+  }
+
+  static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    uint8_t* dstaddr = (uint8_t*)dst;
+
+    if (!on_stack(dstaddr, size, top, bot))
+      tx->redolog.fill_bytes(dstaddr, (uint8_t)c, size);
+    else
+      for (size_t i = 0; i < size; i++)
+        store<uint8_t>(dstaddr + i, (uint8_t)c, mod);
+  }
+
+  virtual gtm_restart_reason begin_or_restart()
+  {
+    // NB: We don't need to do anything for nested transactions.
+    gtm_thread *tx = gtm_thr();
+
+    // Our snapshot is the newest entry whose write-back has completed.  Use
+    // acquire memory order so that we see the writes.
+    gtm_word snapshot = o_ring_mg.completed.load(memory_order_acquire);
+
+    // Re-initialize method group on time overflow.
+    if (snapshot >= o_ring_mg.TIME_MAX)
+      return RESTART_INIT_METHOD_GROUP;
+
+    // As in NOrec, relaxed memory order is sufficient here (see rollback()).
+    tx->shared_state.store(snapshot, memory_order_relaxed);
+    return NO_RESTART;
+  }
+
+  virtual bool trycommit(gtm_word& priv_time)
+  {
+    gtm_thread* tx = gtm_thr();
+
+    // If we haven't updated anything, we can commit.
+    if (tx->redolog.isEmpty()) {
+      tx->read_signature.clear();
+      return true;
+    }
+
+    // The slabs of the redo log are single cache lines.
+    gtm_signature writes;
+    for (int i = 0; i < tx->redolog.slabcount(); ++i)
+      writes.add((void*)tx->redolog.get_key(i), 1);
+
+    // Append our entry once the previous write-back has completed and we
+    // have checked every entry before ours.
+    gtm_word s;
+    while (true)
+      {
+        s = o_ring_mg.last.load(memory_order_acquire);
+        if (o_ring_mg.completed.load(memory_order_acquire) != s)
+          {
+            cpu_relax();
+            continue;
+          }
+        if (s != tx->shared_state.load(memory_order_relaxed))
+          {
+            if (!validate(tx))
+              return false;
+            continue;
+          }
+        if (o_ring_mg.last.compare_exchange_strong(s, s + 1,
+                                                   memory_order_acquire))
+          break;
+      }
+
+    // Fill in the entry.  Readers that check the entry it replaces must not
+    // mistake our signature for the old one.
+    gtm_word ct = s + 1;
+    ring_mg::entry &e = o_ring_mg.entry_of(ct);
+    e.index.store(ring_mg::INVALID, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(e.signature, writes.words, sizeof(e.signature));
+    e.index.store(ct, memory_order_release);
+
+    tx->redolog.writeback();
+    o_ring_mg.completed.store(ct, memory_order_release);
+
+    // We're done, clear the logs.
+    tx->redolog.reset();
+    tx->read_signature.clear();
+
+    // See the top of this file.
+    if (tx->needs_quiescence())
+      priv_time = ct;
+    return true;
+  }
+
+  virtual void rollback()
+  {
+    gtm_thread *tx = gtm_thr();
+
+    // We need this release fence to ensure that privatizers see the
+    // rolled-back original state (not any uncommitted values) when they read
+    // the new snapshot time that we write in begin_or_restart().
+    atomic_thread_fence(memory_order_release);
+
+    // We're done, clear the logs.
+    tx->redolog.reset();
+    tx->read_signature.clear();
+  }
+
+  virtual bool supports(unsigned number_of_threads)
+  {
+    return true;
+  }
+
+  // See the top of this file
+  virtual bool privatization_safe() { return true; }
+  // Writes are buffered in the redo log, which has a scope for each closed
+  // nested transaction (see gtm_transaction_cp)
+  virtual bool closed_nesting() { return true; }
+
+  CREATE_DISPATCH_METHODS(virtual, )
+  CREATE_DISPATCH_METHODS_MEM()
+
+  ring_dispatch() : abi_dispatch(false, true, false, 0, &o_ring_mg)
+  { }
+};
+
+} // anon namespace
+
+static const ring_dispatch o_ring_dispatch;
+
+abi_dispatch *
+GTM::dispatch_ring ()
+{
+  return const_cast<ring_dispatch *>(&o_ring_dispatch);
+}
@@ -0,0 +1,5 @@
+#ifdef __x86_64__
+#include "config_64.h"
+#else
+#include "config_32.h"
+#endif
@@ -0,0 +1,402 @@
+#include "libitm_i.h"
+
+// [transmem] TML, the transactional mutex lock
+//
+// A single global sequence lock protects all shared data.  Readers keep no
+// read set: they sample the lock when they begin, and check after every read
+// that it has not changed since, in which case the value is consistent with
+// all earlier reads.  The first write of a transaction acquires the lock
+// (makes it odd), which only succeeds if nobody else has written since the
+// snapshot; from then on, the transaction is the only writer, and reads and
+// writes memory in place.  Writes are undo-logged, so that a cancelled
+// transaction (or a closed nested one) can restore memory, and committing
+// just releases the lock.  A writer thus never aborts after its first write,
+// and any commit by a writer aborts all concurrent transactions, which makes
+// TML a good fit for workloads that rarely write.
+//
+// Like NOrec, TML is privatization-safe without quiescence, since readers
+// check every value before they use it; we only need a privatization time if
+// memory might be freed.
+
+using namespace GTM;
+
+namespace {
+
+// This group consists of all TM methods that use the global sequence lock
+struct tml_mg : public method_group
+{
+  // Maximum time is all bits except the lock bit and the overflow reserve bit
+  static const gtm_word TIME_MAX = (~(gtm_word)0 >> 2);
+
+  // The sequence lock.  It is odd while a writer holds it.
+  atomic<gtm_word> seq __attribute__((aligned(HW_CACHELINE_SIZE)));
+
+  virtual void init()
+  {
+    // This store is only executed while holding the serial lock, so relaxed
+    // memory order is sufficient here.
+    seq.store(0, memory_order_relaxed);
+  }
+
+  virtual void fini() { }
+
+  // We only re-initialize when the sequence lock overflows.
+  virtual void reinit()
+  {
+    seq.store(0, memory_order_relaxed);
+  }
+};
+
+static tml_mg o_tml_mg;
+
+// The TML method.  A transaction's shared_state is the value of the sequence
+// lock at its start, or the (odd) value that it has set the lock to if it
+// holds the lock.  Neither is ever smaller than the other transactions' commit
+// times before it started, as quiescence requires.
+class tml_dispatch : public abi_dispatch
+{
+protected:
+  // Returns true iff TX holds the sequence lock
+  static bool is_writer(gtm_thread* tx)
+  {
+    return (tx->shared_state.load(memory_order_relaxed) & 1) != 0;
+  }
+
+  // Restart unless the sequence lock still has the value that TX read at its
+  // start.  The fence orders the preceding data reads before the check.
+  static void validate(gtm_thread* tx)
+  {
+    if (is_writer(tx))
+      return;
+    atomic_thread_fence(memory_order_acquire);
+    if (o_tml_mg.seq.load(memory_order_relaxed)
+        != tx->shared_state.load(memory_order_relaxed))
+      tx->restart(RESTART_VALIDATE_READ);
+  }
+
+  // Acquire the sequence lock before the first write of TX.  This fails if
+  // the lock has changed since the start of TX, in which case TX might have
+  // read inconsistent data, so it must restart.
+  static void acquire(gtm_thread* tx)
+  {
+    gtm_word s = tx->shared_state.load(memory_order_relaxed);
+    if (s & 1)
+      return;
+    if (!o_tml_mg.seq.compare_exchange_strong(s, s + 1,
+                                              memory_order_acquire))
+      tx->restart(RESTART_LOCKED_WRITE);
+    // The write must not become visible before the lock acquisition.
+    atomic_thread_fence(memory_order_release);
+    tx->shared_state.store(s + 1, memory_order_relaxed);
+  }
+
+  // Returns true iff [addr, addr + len) overlaps the transaction's own stack
+  // frames, in which case the access must bypass the lock and the undo log
+  static bool on_stack(const void* addr, size_t len, void* top, void* bot)
+  {
+    return (const uint8_t*)addr <= (uint8_t*)top
+        && (const uint8_t*)addr + len > (uint8_t*)bot;
+  }
+
+  template <typename V> static V load(const V* addr, ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+
+    // stack filter: if we are reading from a stack location, just read it
+    if (on_stack(addr, sizeof(V), mask_stack_top(tx), mask_stack_bottom(tx)))
+      return *addr;
+
+    // A read for write will be followed by a write, so take the lock now
+    // rather than abort at the write.
+    if (unlikely(mod == RfW))
+      acquire(tx);
+
+    V v = *addr;
+    validate(tx);
+    return v;
+  }
+
+  template <typename V> static void store(V* addr, const V value,
+      ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    if (on_stack(addr, sizeof(V), mask_stack_top(tx), mask_stack_bottom(tx)))
+      {
+        *addr = value;
+        return;
+      }
+
+    // Log even if MOD is WaW: the compiler uses that after a read for write
+    // that we have not logged.
+    acquire(tx);
+    tx->undolog.log(addr, sizeof(V));
+    *addr = value;
+  }
+
+public:
+  static void memtransfer_static(void *dst, const void* src, size_t size,
+      bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+    bool src_tx = src_mod != NONTXNAL && !on_stack(src, size, top, bot);
+
+    // A destination that overlaps our stack frames is filtered byte by byte,
+    // in the order that memmove would copy it.
+    if (dst_mod != NONTXNAL && on_stack(dst, size, top, bot))
+      {
+        uint8_t *d = (uint8_t*)dst;
+        const uint8_t *s = (const uint8_t*)src;
+        if (may_overlap && d > s && d < s + size)
+          for (size_t i = size; i-- > 0; )
+            store<uint8_t>(d + i, s[i], dst_mod);
+        else
+          for (size_t i = 0; i < size; i++)
+            store<uint8_t>(d + i, s[i], dst_mod);
+      }
+    else
+      {
+        if (dst_mod != NONTXNAL)
+          {
+            acquire(tx);
+            tx->undolog.log(dst, size);
+          }
+        if (!may_overlap)
+          ::memcpy(dst, src, size);
+        else
+          ::memmove(dst, src, size);
+      }
+
+    if (src_tx)
+      validate(tx);
+  }
+
+  static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
+  {
+    gtm_thread *tx = gtm_thr();
+    void *top = mask_stack_top(tx);
+    void *bot = mask_stack_bottom(tx);
+
+    if (mod != NONTXNAL && on_stack(dst, size, top, bot))
+      {
+        for (size_t i = 0; i < size; i++)
+          store<uint8_t>((uint8_t*)dst + i, (uint8_t)c, mod);
+        return;
+      }
+    if (mod != NONTXNAL)
+      {
+        acquire(tx);
+        tx->undolog.log(dst, size);
+      }
+    ::memset(dst, c, size);
+  }
+
+  virtual gtm_restart_reason begin_or_restart()
+  {
+    // NB: We don't need to do anything for nested transactions.
+    gtm_thread *tx = gtm_thr();
+
+    // Wait until the lock is free, which becomes our snapshot time.  Use
+    // acquire memory order so that we see the writes of the last writer.
+    // We must not wait forever, though: a writer that upgrades to serial
+    // mode waits for us to become inactive, which we only do by restarting.
+    gtm_word snapshot;
+    uint64_t spins = 0;
+    while ((snapshot = o_tml_mg.seq.load(memory_order_acquire)) & 1)
+      {
+        if (++spins > gtm_spin_count_var)
+          return RESTART_LOCKED_READ;
+        cpu_relax();
+      }
+
+    // Re-initialize method group on time overflow.
+    if (snapshot >= o_tml_mg.TIME_MAX)
+      return RESTART_INIT_METHOD_GROUP;
+
+    // As in NOrec, relaxed memory order is sufficient here: the previous
+    // value was smaller, and restarts enforce its visibility (see
+    // rollback()).
+    tx->shared_state.store(snapshot, memory_order_relaxed);
+    return NO_RESTART;
+  }
+
+  virtual bool trycommit(gtm_word& priv_time)
+  {
+    gtm_thread* tx = gtm_thr();
+
+    // A reader has validated every read already.
+    if (!is_writer(tx))
+      return true;
+
+    // Release the lock.  Our writes are in place already.
+    gtm_word ct = tx->shared_state.load(memory_order_relaxed) + 1;
+    o_tml_mg.seq.store(ct, memory_order_release);
+
+    // See the top of this file.
+    if (tx->needs_quiescence())
+      priv_time = ct;
+    return true;
+  }
+
+  virtual void rollback()
+  {
+    gtm_thread *tx = gtm_thr();
+
+    // We need this release fence to ensure that privatizers see the
+    // rolled-back original state (not any uncommitted values) when they read
+    // the new snapshot time that we write in begin_or_restart().
+    atomic_thread_fence(memory_order_release);
+
+    // The undo log has been rolled back already (see
+    // gtm_thread::rollback()), so a writer can release the lock.  It still
+    // bumps the lock, because readers might have seen its writes.
+    if (is_writer(tx))
+      o_tml_mg.seq.store(tx->shared_state.load(memory_order_relaxed) + 1,
+                         memory_order_release);
+  }
+
+  virtual bool supports(unsigned number_of_threads)
+  {
+    // TML can support any number of threads
+    return true;
+  }
+
+  // See the top of this file
+  virtual bool privatization_safe() { return true; }
+  // Writes are undo-logged, and the undo log is rolled back to the size at
+  // the start of a closed nested transaction (see gtm_transaction_cp)
+  virtual bool closed_nesting() { return true; }
+
+  virtual abi_dispatch* inevitable_alternative()
+  {
+    return dispatch_tml_irr();
+  }
+
+  CREATE_DISPATCH_METHODS(virtual, )
+  CREATE_DISPATCH_METHODS_MEM()
+#ifdef GTM_STATIC_DISPATCH
+  // Called directly by the ABI functions (see below).
+  CREATE_DISPATCH_METHODS(static, _static)
+#endif
+
+  tml_dispatch() : abi_dispatch(false, true, false, 0, &o_tml_mg)
+  { }
+};
+
+// TML for the inevitable transaction (see method-serial.cc).  It holds the
+// sequence lock from the time that it becomes inevitable until it commits,
+// and accesses memory in place without logging.  Unlike NOrec, it does not
+// need to tell the other transactions where it writes: they cannot read
+// anything while it holds the lock.
+class tml_irr_dispatch : public tml_dispatch
+{
+protected:
+  template <typename V> static V load(const V* addr, ls_modifier mod)
+  {
+    return *addr;
+  }
+
+  template <typename V> static void store(V* addr, const V value,
+      ls_modifier mod)
+  {
+    *addr = value;
+  }
+
+public:
+  static void memtransfer_static(void *dst, const void* src, size_t size,
+      bool may_overlap, ls_modifier dst_mod, ls_modifier src_mod)
+  {
+    if (!may_overlap)
+      ::memcpy(dst, src, size);
+    else
+      ::memmove(dst, src, size);
+  }
+
+  static void memset_static(void *dst, int c, size_t size, ls_modifier mod)
+  {
+    ::memset(dst, c, size);
+  }
+
+  // We cannot restart, so we wait for the lock as long as it takes, and do
+  // not check for overflow of the time base; the other transactions
+  // reinitialize the method group, and the overflow reserve covers our
+  // commit.
+  virtual gtm_restart_reason begin_or_restart()
+  {
+    gtm_thread *tx = gtm_thr();
+    gtm_word s;
+    do
+      {
+        while (((s = o_tml_mg.seq.load(memory_order_relaxed)) & 1) == 1)
+          cpu_relax();
+      }
+    while (!o_tml_mg.seq.compare_exchange_weak(s, s + 1,
+                                               memory_order_acquire));
+    tx->shared_state.store(s + 1, memory_order_relaxed);
+    return NO_RESTART;
+  }
+
+  // Take the lock, unless the current transaction holds it already.  Its
+  // writes are in place, and stay there.
+  virtual bool become_inevitable()
+  {
+    gtm_thread *tx = gtm_thr();
+    gtm_word s = tx->shared_state.load(memory_order_relaxed);
+    if (s & 1)
+      return true;
+    if (!o_tml_mg.seq.compare_exchange_strong(s, s + 1,
+                                              memory_order_acquire))
+      return false;
+    tx->shared_state.store(s + 1, memory_order_relaxed);
+    return true;
+  }
+
+  // Nobody reads while we hold the lock, so writes without barriers are safe.
+  virtual bool run_uninstrumented() { return true; }
+
+  virtual bool trycommit(gtm_word& priv_time)
+  {
+    gtm_thread* tx = gtm_thr();
+    gtm_word ct = tx->shared_state.load(memory_order_relaxed) + 1;
+    o_tml_mg.seq.store(ct, memory_order_release);
+    if (tx->needs_quiescence())
+      priv_time = ct;
+    return true;
+  }
+
+  virtual void rollback()
+  {
+    // The inevitable transaction cannot roll back.
+    abort();
+  }
+
+  virtual abi_dispatch* inevitable_alternative() { return 0; }
+
+  CREATE_DISPATCH_METHODS(virtual, )
+  CREATE_DISPATCH_METHODS_MEM()
+
+  tml_irr_dispatch() : tml_dispatch()
+  { }
+};
+
+} // anon namespace
+
+static const tml_dispatch o_tml_dispatch;
+static const tml_irr_dispatch o_tml_irr_dispatch;
+
+abi_dispatch *
+GTM::dispatch_tml ()
+{
+  return const_cast<tml_dispatch *>(&o_tml_dispatch);
+}
+
+abi_dispatch *
+GTM::dispatch_tml_irr ()
+{
+  return const_cast<tml_irr_dispatch *>(&o_tml_irr_dispatch);
+}
+
+#ifdef GTM_STATIC_DISPATCH
+CREATE_DISPATCH_FUNCTIONS_STATIC(tml_dispatch, &o_tml_dispatch)
+#endif
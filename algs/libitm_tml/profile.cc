@@ -0,0 +1,399 @@
+#include "libitm_i.h"
+#include <dlfcn.h>
+#include <stdio.h>
+#include <time.h>
+
+// [transmem] Per-call-site transaction profiles
+//
+// Setting ITM_PROFILE=path makes every thread keep statistics for each call
+// site of an outermost transaction (the return address of
+// _ITM_beginTransaction, see gtm_thread::site): commits, restarts by reason,
+// commits in serial and in irrevocable mode, and histograms of the retries
+// before the commit, the read and write set sizes, and the time from the
+// first begin to the commit.  At exit, the statistics of all threads are
+// merged and written to PATH, as JSON if it ends in ".json" and as CSV
+// otherwise, with each site symbolized by dladdr().
+//
+// Each thread owns a table of sites, which only it updates, so profiling
+// needs no atomic operations.  Tables are linked on a global list and never
+// freed; a thread that exits releases its table for the next thread to
+// adopt.  The report may thus miss the last few updates of threads that are
+// still running at exit.
+//
+// Set sizes are in the units of the logs of the method that ran: read set
+// entries (orecs for lazy and ml_wt, words of the value log for NOrec), and
+// written cache lines plus deltas, or words of the undo log for TML.
+// Histogram bucket 0 counts zero, and bucket I > 0 counts values in
+// [2^(I-1), 2^I).
+
+namespace GTM HIDDEN {
+
+bool profile_enabled = false;
+
+static const unsigned PROFILE_BUCKETS = 32;
+
+struct gtm_site_profile
+{
+  uintptr_t site;
+  uint64_t commits;
+  uint64_t serial;
+  uint64_t irrevocable;
+  uint64_t retries;
+  uint64_t time;
+  uint64_t restarts[NUM_RESTARTS];
+  uint64_t retry_hist[PROFILE_BUCKETS];
+  uint64_t read_hist[PROFILE_BUCKETS];
+  uint64_t write_hist[PROFILE_BUCKETS];
+  uint64_t time_hist[PROFILE_BUCKETS];
+};
+
+// A thread's table of sites.  Sites are found by linear probing; when the
+// table is full, new sites share the extra entry at the end, with site 0.
+struct gtm_profile
+{
+  static const unsigned SITES = 128;
+
+  gtm_profile *next;
+  atomic<bool> in_use;
+  gtm_site_profile sites[SITES + 1];
+
+  gtm_site_profile *lookup (uintptr_t site)
+  {
+    unsigned h = (site ^ (site >> 7) ^ (site >> 17)) & (SITES - 1);
+    for (unsigned i = 0; i < SITES; ++i, h = (h + 1) & (SITES - 1))
+      {
+        if (sites[h].site == site)
+          return &sites[h];
+        if (sites[h].site == 0)
+          {
+            sites[h].site = site;
+            return &sites[h];
+          }
+      }
+    return &sites[SITES];
+  }
+};
+
+// The names of the restart reasons, in the order of gtm_restart_reason
+static const char *const restart_names[] = {
+  "reallocate", "locked_read", "locked_write", "validate_read",
+  "validate_write", "validate_commit", "priority", "inevitable",
+  "serial_irr", "not_readonly", "closed_nesting", "init_method_group"
+};
+static_assert (sizeof (restart_names) / sizeof (restart_names[0])
+               == NUM_RESTARTS, "a restart reason has no name");
+
+// All tables, and the file to write the report to
+static atomic<gtm_profile *> profiles;
+static const char *profile_path;
+
+static inline uint64_t
+profile_now ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline unsigned
+profile_bucket (uint64_t v)
+{
+  unsigned b = v == 0 ? 0 : 64 - __builtin_clzll (v);
+  return b < PROFILE_BUCKETS ? b : PROFILE_BUCKETS - 1;
+}
+
+// Take a table that an exited thread released, or allocate a new one.
+static gtm_profile *
+profile_attach ()
+{
+  for (gtm_profile *p = profiles.load (memory_order_acquire); p != 0;
+       p = p->next)
+    {
+      bool in_use = false;
+      if (!p->in_use.load (memory_order_relaxed)
+          && p->in_use.compare_exchange_strong (in_use, true,
+                                                memory_order_acquire))
+        return p;
+    }
+
+  gtm_profile *p = (gtm_profile *) xcalloc (sizeof (gtm_profile));
+  p->in_use.store (true, memory_order_relaxed);
+  p->next = profiles.load (memory_order_relaxed);
+  while (!profiles.compare_exchange_weak (p->next, p, memory_order_release,
+                                          memory_order_relaxed))
+    ;
+  return p;
+}
+
+static void
+profile_add (gtm_site_profile *to, const gtm_site_profile *from)
+{
+  to->commits += from->commits;
+  to->serial += from->serial;
+  to->irrevocable += from->irrevocable;
+  to->retries += from->retries;
+  to->time += from->time;
+  for (unsigned r = 0; r < NUM_RESTARTS; ++r)
+    to->restarts[r] += from->restarts[r];
+  for (unsigned b = 0; b < PROFILE_BUCKETS; ++b)
+    {
+      to->retry_hist[b] += from->retry_hist[b];
+      to->read_hist[b] += from->read_hist[b];
+      to->write_hist[b] += from->write_hist[b];
+      to->time_hist[b] += from->time_hist[b];
+    }
+}
+
+static uint64_t
+profile_attempts (const gtm_site_profile *p)
+{
+  uint64_t n = p->commits;
+  for (unsigned r = 0; r < NUM_RESTARTS; ++r)
+    n += p->restarts[r];
+  return n;
+}
+
+static int
+compare_sites (const void *a, const void *b)
+{
+  uintptr_t x = ((const gtm_site_profile *) a)->site;
+  uintptr_t y = ((const gtm_site_profile *) b)->site;
+  return x < y ? -1 : x > y;
+}
+
+// Busiest sites first
+static int
+compare_attempts (const void *a, const void *b)
+{
+  uint64_t x = profile_attempts ((const gtm_site_profile *) a);
+  uint64_t y = profile_attempts ((const gtm_site_profile *) b);
+  return x > y ? -1 : x < y;
+}
+
+// Write the object that contains SITE and the offset into it to OBJECT, and
+// the nearest dynamic symbol and the offset from it to SYMBOL.  Symbols are
+// only found for code in shared libraries or in programs linked with
+// -rdynamic; the object offset works with addr2line either way.
+static void
+profile_symbolize (uintptr_t site, char *object, char *symbol, size_t len)
+{
+  Dl_info info;
+  snprintf (object, len, "?");
+  snprintf (symbol, len, site == 0 ? "<other>" : "?");
+  if (site == 0 || dladdr ((void *) site, &info) == 0)
+    return;
+  if (info.dli_fname != 0)
+    snprintf (object, len, "%s+0x%lx", info.dli_fname,
+              (unsigned long) (site - (uintptr_t) info.dli_fbase));
+  if (info.dli_sname != 0)
+    snprintf (symbol, len, "%s+0x%lx", info.dli_sname,
+              (unsigned long) (site - (uintptr_t) info.dli_saddr));
+}
+
+// Write S as a JSON string; symbols and paths need no escapes but for
+// quotes and backslashes.
+static void
+profile_json_string (FILE *f, const char *s)
+{
+  fputc ('"', f);
+  for (; *s; ++s)
+    {
+      if (*s == '"' || *s == '\\')
+        fputc ('\\', f);
+      fputc (*s, f);
+    }
+  fputc ('"', f);
+}
+
+// Write histogram H, up to its last non-empty bucket, separated by SEP
+static void
+profile_hist (FILE *f, const uint64_t *h, const char *sep)
+{
+  unsigned n = PROFILE_BUCKETS;
+  while (n > 1 && h[n - 1] == 0)
+    n--;
+  for (unsigned b = 0; b < n; ++b)
+    fprintf (f, "%s%llu", b ? sep : "", (unsigned long long) h[b]);
+}
+
+static void
+profile_write_csv (FILE *f, const gtm_site_profile *p, size_t n)
+{
+  fprintf (f, "site,object,symbol,commits,serial,irrevocable,retries,time_ns");
+  for (unsigned r = 0; r < NUM_RESTARTS; ++r)
+    fprintf (f, ",restart_%s", restart_names[r]);
+  fprintf (f, ",retries_hist,reads_hist,writes_hist,time_hist\n");
+
+  char object[512], symbol[512];
+  for (size_t i = 0; i < n; ++i)
+    {
+      profile_symbolize (p[i].site, object, symbol, sizeof (object));
+      fprintf (f, "0x%lx,\"%s\",\"%s\",%llu,%llu,%llu,%llu,%llu",
+               (unsigned long) p[i].site, object, symbol,
+               (unsigned long long) p[i].commits,
+               (unsigned long long) p[i].serial,
+               (unsigned long long) p[i].irrevocable,
+               (unsigned long long) p[i].retries,
+               (unsigned long long) p[i].time);
+      for (unsigned r = 0; r < NUM_RESTARTS; ++r)
+        fprintf (f, ",%llu", (unsigned long long) p[i].restarts[r]);
+      const uint64_t *hists[] = { p[i].retry_hist, p[i].read_hist,
+                                  p[i].write_hist, p[i].time_hist };
+      for (unsigned h = 0; h < 4; ++h)
+        {
+          fputc (',', f);
+          profile_hist (f, hists[h], ";");
+        }
+      fputc ('\n', f);
+    }
+}
+
+static void
+profile_write_json (FILE *f, const gtm_site_profile *p, size_t n)
+{
+  static const char *const hist_names[] = {
+    "retries", "reads", "writes", "time_ns"
+  };
+
+  char object[512], symbol[512];
+  fprintf (f, "{\"sites\": [");
+  for (size_t i = 0; i < n; ++i)
+    {
+      profile_symbolize (p[i].site, object, symbol, sizeof (object));
+      fprintf (f, "%s\n  {\"site\": \"0x%lx\", \"object\": ", i ? "," : "",
+               (unsigned long) p[i].site);
+      profile_json_string (f, object);
+      fprintf (f, ", \"symbol\": ");
+      profile_json_string (f, symbol);
+      fprintf (f, ",\n   \"commits\": %llu, \"serial\": %llu, "
+               "\"irrevocable\": %llu, \"retries\": %llu, \"time_ns\": %llu,"
+               "\n   \"restarts\": {",
+               (unsigned long long) p[i].commits,
+               (unsigned long long) p[i].serial,
+               (unsigned long long) p[i].irrevocable,
+               (unsigned long long) p[i].retries,
+               (unsigned long long) p[i].time);
+      for (unsigned r = 0; r < NUM_RESTARTS; ++r)
+        fprintf (f, "%s\"%s\": %llu", r ? ", " : "", restart_names[r],
+                 (unsigned long long) p[i].restarts[r]);
+      fprintf (f, "},\n   \"histograms\": {");
+      const uint64_t *hists[] = { p[i].retry_hist, p[i].read_hist,
+                                  p[i].write_hist, p[i].time_hist };
+      for (unsigned h = 0; h < 4; ++h)
+        {
+          fprintf (f, "%s\"%s\": [", h ? ", " : "", hist_names[h]);
+          profile_hist (f, hists[h], ", ");
+          fputc (']', f);
+        }
+      fprintf (f, "}}");
+    }
+  fprintf (f, "\n]}\n");
+}
+
+// Merge the tables of all threads by site and write the report.
+static void
+profile_report ()
+{
+  size_t n = 0;
+  for (gtm_profile *t = profiles.load (memory_order_acquire); t != 0;
+       t = t->next)
+    n += gtm_profile::SITES + 1;
+  if (n == 0)
+    return;
+
+  gtm_site_profile *all =
+    (gtm_site_profile *) xmalloc (n * sizeof (gtm_site_profile));
+  n = 0;
+  for (gtm_profile *t = profiles.load (memory_order_acquire); t != 0;
+       t = t->next)
+    for (unsigned i = 0; i <= gtm_profile::SITES; ++i)
+      if (profile_attempts (&t->sites[i]) != 0)
+        all[n++] = t->sites[i];
+
+  size_t sites = 0;
+  qsort (all, n, sizeof (*all), compare_sites);
+  for (size_t i = 0; i < n; ++i)
+    {
+      if (sites != 0 && all[sites - 1].site == all[i].site)
+        profile_add (&all[sites - 1], &all[i]);
+      else
+        all[sites++] = all[i];
+    }
+  qsort (all, sites, sizeof (*all), compare_attempts);
+
+  FILE *f = fopen (profile_path, "w");
+  if (f == NULL)
+    GTM_error ("Cannot write the profile to %s (ITM_PROFILE)\n",
+               profile_path);
+  else
+    {
+      size_t len = strlen (profile_path);
+      if (len >= 5 && strcmp (profile_path + len - 5, ".json") == 0)
+        profile_write_json (f, all, sites);
+      else
+        profile_write_csv (f, all, sites);
+      fclose (f);
+    }
+  free (all);
+}
+
+void
+profile_init ()
+{
+  const char *env = getenv ("ITM_PROFILE");
+  if (env == NULL || *env == '\0')
+    return;
+  profile_path = env;
+  profile_enabled = true;
+  atexit (profile_report);
+}
+
+} // namespace GTM
+
+using namespace GTM;
+
+// Start profiling the outermost transaction at the current call site.
+void
+gtm_thread::profile_begin ()
+{
+  if (unlikely (profile == 0))
+    profile = profile_attach ();
+  profile_site = profile->lookup (site);
+  profile_start = profile_now ();
+}
+
+void
+gtm_thread::profile_restart (gtm_restart_reason r)
+{
+  if (profile_site != 0)
+    profile_site->restarts[r]++;
+}
+
+// Count the commit of the current transaction, which had READS and WRITES
+// entries in its read and write set.  Must be called before state and
+// restart_total are reset.
+void
+gtm_thread::profile_commit (size_t reads, size_t writes)
+{
+  gtm_site_profile *p = profile_site;
+  uint64_t time = profile_now () - profile_start;
+  p->commits++;
+  if (state & STATE_SERIAL)
+    p->serial++;
+  if (state & STATE_IRREVOCABLE)
+    p->irrevocable++;
+  p->retries += restart_total;
+  p->time += time;
+  p->retry_hist[profile_bucket (restart_total)]++;
+  p->read_hist[profile_bucket (reads)]++;
+  p->write_hist[profile_bucket (writes)]++;
+  p->time_hist[profile_bucket (time)]++;
+}
+
+// Let another thread adopt our table.  Called when the thread exits.
+void
+gtm_thread::profile_detach ()
+{
+  if (profile != 0)
+    profile->in_use.store (false, memory_order_release);
+}
@@ -82,3 +82,55 @@ _ITM_error (const _ITM_srcLocation * loc UNUSED, int errorCode UNUSED)
 {
   abort ();
 }
+
+
+// [transmem] Privatization hints.  Hardware transactions and serial mode are
+// privatization-safe without quiescence, so there is nothing to do.
+void ITM_REGPARM
+_ITM_setPrivatizationPolicy (_ITM_privatizationPolicy policy UNUSED)
+{
+}
+
+
+void ITM_REGPARM
+_ITM_markPrivatizing (void)
+{
+}
+
+
+// [transmem] Commutative updates.  Transactions run in hardware or
+// irrevocably, so a plain add is part of the transaction.
+void ITM_REGPARM
+_ITM_addU8 (uint64_t *addr, uint64_t val)
+{
+  *addr += val;
+}
+
+
+void ITM_REGPARM
+_ITM_addF8 (double *addr, double val)
+{
+  *addr += val;
+}
+
+
+// [transmem] Elastic traversals.  Hardware transactions track their reads
+// themselves, so these are no-ops.
+void ITM_REGPARM
+_ITM_beginElastic (size_t)
+{
+}
+
+
+void ITM_REGPARM
+_ITM_elasticStep (void)
+{
+}
+
+
+// Unlinking a node is a plain store, like the commutative updates.
+void ITM_REGPARM
+_ITM_elasticUnlink (void **link)
+{
+  *link = 0;
+}
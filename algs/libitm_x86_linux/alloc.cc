@@ -50,6 +50,7 @@ gtm_thread::forget_allocation (void *ptr, void (*free_fn)(void *))
 
   a->free_fn = free_fn;
   a->allocated = false;
+  this->freed_memory = true;
 }
 
 namespace {
@@ -121,8 +122,11 @@ gtm_thread::commit_allocations (bool revert_p,
       this->alloc_actions.traverse (commit_allocations_2, &cb_data);
     }
   else
-    this->alloc_actions.traverse (commit_allocations_1,
-				  (void *)(uintptr_t)revert_p);
+    {
+      this->alloc_actions.traverse (commit_allocations_1,
+				    (void *)(uintptr_t)revert_p);
+      this->freed_memory = false;
+    }
   this->alloc_actions.clear ();
 }
 
@@ -43,6 +43,9 @@ using namespace GTM;
 #define _ZGTtnwXRKSt9nothrow_t	S(S(_ZGTtnw,MANGLE_SIZE_T),RKSt9nothrow_t)
 #define _ZGTtnaXRKSt9nothrow_t	S(S(_ZGTtna,MANGLE_SIZE_T),RKSt9nothrow_t)
 
+#define _ZGTtdlPvX		S(_ZGTtdlPv,MANGLE_SIZE_T)
+#define _ZGTtdlPvXRKSt9nothrow_t S(S(_ZGTtdlPv,MANGLE_SIZE_T),RKSt9nothrow_t)
+
 /* Everything from libstdc++ is weak, to avoid requiring that library
    to be linked into plain C applications using libitm.so.  */
 
@@ -145,6 +148,26 @@ _ZGTtdlPvRKSt9nothrow_t (void *ptr, c_nothrow_p nt UNUSED)
     gtm_thr()->forget_allocation (ptr, del_opnt);
 }
 
+/* [transmem] Wrap: operator delete (void *ptr, std::size_t sz), which g++
+   emits by default since C++14.  The size is only a hint, so we free with
+   the unsized operator, which also matches the free function that
+   operator new recorded.  */
+void
+_ZGTtdlPvX (void *ptr, size_t sz UNUSED)
+{
+  if (ptr)
+    gtm_thr()->forget_allocation (ptr, _ZdlPv);
+}
+
+/* [transmem] Wrap: operator delete (void *ptr, std::size_t sz,
+   const std::nothrow_t&), which GCC's libitm exports as well.  */
+void
+_ZGTtdlPvXRKSt9nothrow_t (void *ptr, size_t sz UNUSED, c_nothrow_p nt UNUSED)
+{
+  if (ptr)
+    gtm_thr()->forget_allocation (ptr, del_opnt);
+}
+
 /* Wrap: operator delete[] (void *ptr)  */
 void
 _ZGTtdaPv (void *ptr)
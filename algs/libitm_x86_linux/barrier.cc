@@ -42,3 +42,55 @@ bool abi_dispatch::memmove_overlap_check(void *dst, const void *src,
 
 CREATE_DISPATCH_FUNCTIONS(GTM::abi_disp()->, )
 
+// [transmem] Commutative updates.  This library has no delta log (see
+// libitm_norec/delta.cc), so in a transaction they read and write through the
+// barriers.
+void ITM_REGPARM
+_ITM_addU8 (uint64_t *addr, uint64_t val)
+{
+  gtm_thread *tx = gtm_thr ();
+  if (tx == 0 || tx->nesting == 0)
+    *addr += val;
+  else
+    {
+      abi_dispatch *disp = abi_disp ();
+      disp->ITM_WU8 (addr, disp->ITM_RU8 (addr) + val);
+    }
+}
+
+void ITM_REGPARM
+_ITM_addF8 (double *addr, double val)
+{
+  gtm_thread *tx = gtm_thr ();
+  if (tx == 0 || tx->nesting == 0)
+    *addr += val;
+  else
+    {
+      abi_dispatch *disp = abi_disp ();
+      disp->ITM_WD (addr, disp->ITM_RD (addr) + val);
+    }
+}
+
+// [transmem] Elastic traversals.  This library does not drop reads from its
+// read sets (see libitm_norec/elastic.cc), so these are no-ops.
+void ITM_REGPARM
+_ITM_beginElastic (size_t)
+{
+}
+
+void ITM_REGPARM
+_ITM_elasticStep (void)
+{
+}
+
+// Unlinking a node is still a transactional store (see
+// libitm_norec/elastic.cc).
+void ITM_REGPARM
+_ITM_elasticUnlink (void **link)
+{
+  gtm_thread *tx = gtm_thr ();
+  if (tx == 0 || tx->nesting == 0)
+    *link = 0;
+  else
+    abi_disp ()->memset (link, 0, sizeof (*link), abi_dispatch::W);
+}
@@ -72,11 +72,12 @@ GTM::gtm_thread::operator new (size_t s)
 }
 
 /* Free the given transaction. Raises an error if the transaction is still
-   in use.  */
+   in use.  [transmem] Other threads may still read it, so reap_threads()
+   frees it later (see quiesce.cc).  */
 void
 GTM::gtm_thread::operator delete(void *tx)
 {
-  free(tx);
+  bury ((gtm_thread *) tx);
 }
 
 static void
@@ -114,6 +115,7 @@ GTM::gtm_thread::~gtm_thread()
     }
   number_of_threads--;
   number_of_threads_changed(number_of_threads + 1, number_of_threads);
+  reap_threads ();
   serial_lock.write_unlock ();
 }
 
@@ -123,6 +125,7 @@ GTM::gtm_thread::gtm_thread ()
   // to initialize any of the other primitive-type members that do not have
   // constructors.
   shared_state.store(-1, memory_order_relaxed);
+  cm_reset ();
 
   // Register this transaction with the list of all threads' transactions.
   serial_lock.write_lock ();
@@ -130,6 +133,7 @@ GTM::gtm_thread::gtm_thread ()
   list_of_threads = this;
   number_of_threads++;
   number_of_threads_changed(number_of_threads - 1, number_of_threads);
+  reap_threads ();
   serial_lock.write_unlock ();
 
   if (pthread_once(&thr_release_once, thread_exit_init))
@@ -480,6 +484,7 @@ GTM::gtm_thread::rollback (gtm_transaction_cp *cp, bool aborting)
       // (we will return from it), so the nesting level must be one, not zero.
       nesting = (aborting ? 0 : 1);
       parent_txns.clear();
+      privatizing = false;
     }
 
   if (this->eh_in_flight)
@@ -585,8 +590,13 @@ GTM::gtm_thread::trycommit ()
       cxa_catch_count = 0;
       cxa_unthrown = NULL;
       restart_total = 0;
+      if (cm_policy != CM_IMMEDIATE)
+        cm_commit ();
 
       // Ensure privatization safety, if necessary.
+      if (priv_time && skip_quiescence ())
+        priv_time = 0;
+      privatizing = false;
       if (priv_time)
 	{
           // There must be a seq_cst fence between the following loads of the
@@ -597,22 +607,7 @@ GTM::gtm_thread::trycommit ()
           // readers will observe our updates.  We can reuse the seq_cst fence
           // in serial_lock.read_unlock() however, so we don't need another
           // one here.
-	  // TODO Don't just spin but also block using cond vars / futexes
-	  // here. Should probably be integrated with the serial lock code.
-	  for (gtm_thread *it = gtm_thread::list_of_threads; it != 0;
-	      it = it->next_thread)
-	    {
-	      if (it == this) continue;
-	      // We need to load other threads' shared_state using acquire
-	      // semantics (matching the release semantics of the respective
-	      // updates).  This is necessary to ensure that the other
-	      // threads' memory accesses happen before our actions that
-	      // assume privatization safety.
-	      // TODO Are there any platform-specific optimizations (e.g.,
-	      // merging barriers)?
-	      while (it->shared_state.load(memory_order_acquire) < priv_time)
-		cpu_relax();
-	    }
+	  quiesce (priv_time);
 	}
 
       // After ensuring privatization safety, we execute potentially
@@ -650,6 +645,11 @@ GTM::gtm_thread::restart (gtm_restart_reason r, bool finish_serial_upgrade)
       disp = abi_disp();
     }
 
+  // [transmem] We have a new snapshot, which may be what a committer in
+  // quiesce() is waiting for.
+  atomic_thread_fence (memory_order_seq_cst);
+  quiesce_notify ();
+
   GTM_longjmp (choose_code_path(prop, disp) | a_restoreLiveVariables,
 	       &jb, prop);
 }
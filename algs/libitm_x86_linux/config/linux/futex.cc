@@ -26,6 +26,7 @@
 
 #include "libitm_i.h"
 #include "futex.h"
+#include <time.h>
 #include <futex_bits.h>
 #include <errno.h>
 
@@ -64,6 +65,31 @@ futex_wait (std::atomic<int> *addr, int val)
 }
 
 
+void
+futex_wait_timed (std::atomic<int> *addr, int val, long nsec)
+{
+  struct timespec ts;
+  ts.tv_sec = nsec / 1000000000L;
+  ts.tv_nsec = nsec % 1000000000L;
+
+  long res = sys_futex0_timed (addr, gtm_futex_wait, val, &ts);
+  if (__builtin_expect (res == -ENOSYS, 0))
+    {
+      gtm_futex_wait = FUTEX_WAIT;
+      gtm_futex_wake = FUTEX_WAKE;
+      res = sys_futex0_timed (addr, FUTEX_WAIT, val, &ts);
+    }
+  if (__builtin_expect (res < 0, 0))
+    {
+      if (res == -EWOULDBLOCK || res == -ETIMEDOUT || res == -EINTR)
+	;
+      else if (res == -EFAULT)
+	GTM_fatal ("futex failed (EFAULT %p)", addr);
+      else
+	GTM_fatal ("futex failed (%s)", strerror(-res));
+    }
+}
+
 long
 futex_wake (std::atomic<int> *addr, int count)
 {
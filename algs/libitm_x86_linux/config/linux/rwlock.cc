@@ -58,6 +58,8 @@ gtm_rwlock::read_lock (gtm_thread *tx)
 	  writer_readers.store (0, memory_order_relaxed);
 	  futex_wake(&writer_readers, 1);
 	}
+      // [transmem] Committers blocked in quiesce() can stop waiting for us.
+      gtm_thread::quiesce_notify ();
 
       // Signal that there are waiting readers and wait until there is no
       // writer anymore.
@@ -206,6 +208,9 @@ gtm_rwlock::write_upgrade_finish (gtm_thread *tx)
   // We are not a reader anymore.  This is only safe to do after we have
   // acquired the writer lock.
   tx->shared_state.store (-1, memory_order_release);
+  // [transmem] Wake committers blocked in quiesce().
+  atomic_thread_fence (memory_order_seq_cst);
+  gtm_thread::quiesce_notify ();
 }
 
 
@@ -238,6 +243,10 @@ gtm_rwlock::read_unlock (gtm_thread *tx)
       writer_readers.store (0, memory_order_relaxed);
       futex_wake(&writer_readers, 1);
     }
+
+  // [transmem] Wake committers blocked in quiesce(), which also relies on
+  // the seq_cst fence above.
+  gtm_thread::quiesce_notify ();
 }
 
 
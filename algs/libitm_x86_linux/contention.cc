@@ -0,0 +1,249 @@
+#include "libitm_i.h"
+#include "futex.h"
+#include <limits.h>
+
+// [transmem] Contention management
+//
+// decide_retry_strategy() asks the contention manager two things: how long
+// to wait before restarting after a conflict, and how many restarts to allow
+// before falling back to serial mode.  The policy is chosen with ITM_CM:
+//
+//  - immediate: restart at once, and go serial after CM_SERIAL_RETRIES
+//    restarts.  This is the original libitm behavior, and the default.
+//  - backoff:   wait a random time from an exponentially growing window
+//    between restarts.  Short waits spin with cpu_relax(); long waits
+//    sleep on a futex until some other transaction commits (or a timeout).
+//  - adaptive:  backoff, and lower the serial threshold as this thread's
+//    abort rate grows, so that an abort storm goes serial quickly instead of
+//    burning CM_SERIAL_RETRIES attempts per transaction.
+//
+// ITM_CM_RETRIES=n replaces CM_SERIAL_RETRIES, so that tests can make
+// priority transactions and serial mode happen without heavy contention.
+//
+// Backoff happens while the transaction is inactive (see retry.cc), so that
+// a waiting thread does not hold up serial transactions or quiescence.
+//
+// A transaction that reaches its serial threshold does not go serial right
+// away if the method supports it (abi_dispatch::supports_priority()).  It
+// takes the priority token instead, of which there is only one, and restarts
+// concurrently.  The priority transaction marks the cache lines that it reads
+// in a shared filter, and a writer that would overwrite a marked line restarts
+// at commit (RESTART_PRIORITY) and waits until the priority transaction has
+// finished.  Transactions that do not conflict with it keep running, and
+// readers are never held up.  The priority transaction goes serial only if
+// it still has not committed after another cm_serial_retries restarts, or if
+// it needs to be irrevocable.  Transactions that want the token while another
+// one holds it wait like writers that yielded to it.
+
+namespace GTM HIDDEN {
+
+gtm_cm_policy cm_policy = CM_IMMEDIATE;
+
+// The serial-mode threshold for the immediate and backoff policies, and the
+// range of thresholds for the adaptive policy.
+static const uint32_t CM_SERIAL_RETRIES = 100;
+static const uint32_t CM_MIN_SERIAL_RETRIES = 4;
+
+// The serial-mode threshold in use, which ITM_CM_RETRIES may change.  It is
+// read when the library is loaded, before any thread calls cm_reset().
+static uint32_t
+cm_parse_serial_retries ()
+{
+  const char *env = getenv ("ITM_CM_RETRIES");
+  if (env == NULL)
+    return CM_SERIAL_RETRIES;
+  return strtoul (env, NULL, 10);
+}
+static const uint32_t cm_serial_retries = cm_parse_serial_retries ();
+
+// The backoff window is 2^(restarts + CM_MIN_EXP) pauses, capped at
+// 2^CM_MAX_EXP.  Windows bigger than 2^CM_SPIN_EXP sleep instead of spinning,
+// assuming roughly CM_PAUSE_NS per pause.
+static const uint32_t CM_MIN_EXP = 4;
+static const uint32_t CM_SPIN_EXP = 10;
+static const uint32_t CM_MAX_EXP = 18;
+static const long CM_PAUSE_NS = 10;
+
+// The number of commits and conflicts over which the adaptive policy
+// measures the abort rate.
+static const uint32_t CM_WINDOW = 64;
+
+// Threads that sleep in cm_backoff() wait for cm_commit_seq to change, and
+// announce themselves in cm_sleepers so that committers only touch the
+// shared cacheline when someone is actually waiting.
+static atomic<int> cm_commit_seq;
+static atomic<int> cm_sleepers;
+
+// The cache lines that the priority transaction has read.  cm_priority_seq
+// changes whenever the token is released, and yielding threads wait for that.
+// A long timeout covers the race with a release that happens before the wait
+// starts.
+static const long CM_YIELD_NS = 100000;
+static gtm_line_filter cm_priority_reads;
+static atomic<int> cm_priority_seq;
+
+} // namespace GTM
+
+using namespace GTM;
+
+atomic<gtm_thread *> gtm_thread::priority_owner;
+
+// The number of conflict-induced restarts so far.  Restarts for other
+// reasons (e.g., switching to serial mode) say nothing about contention.
+uint32_t
+gtm_thread::cm_conflicts () const
+{
+  uint32_t n = 0;
+  for (int r = 0; r < NUM_RESTARTS; ++r)
+    if (restart_is_conflict ((gtm_restart_reason) r))
+      n += restart_reason[r];
+  return n;
+}
+
+// Called once per thread, from the gtm_thread constructor.
+void
+gtm_thread::cm_reset ()
+{
+  cm_seed = (uint32_t) ((uintptr_t) this >> 6) | 1;
+  cm_commits = 0;
+  cm_aborts_base = cm_conflicts ();
+  cm_serial_limit = cm_serial_retries;
+  cm_priority = false;
+}
+
+// Recompute the adaptive serial threshold once a window is full.  The
+// threshold falls linearly from cm_serial_retries (no aborts) to
+// CM_MIN_SERIAL_RETRIES (every attempt aborted), or to cm_serial_retries if
+// that is lower.
+static inline void
+cm_adapt (gtm_thread *tx)
+{
+  uint32_t aborts = tx->cm_conflicts () - tx->cm_aborts_base;
+  uint32_t events = aborts + tx->cm_commits;
+  if (events < CM_WINDOW)
+    return;
+  uint32_t min = cm_serial_retries < CM_MIN_SERIAL_RETRIES
+    ? cm_serial_retries : CM_MIN_SERIAL_RETRIES;
+  tx->cm_serial_limit = cm_serial_retries
+    - (cm_serial_retries - min) * aborts / events;
+  tx->cm_commits = 0;
+  tx->cm_aborts_base += aborts;
+}
+
+// Wait before restarting after a conflict (see restart_is_conflict()).  Must
+// be called while the transaction is inactive.
+void
+gtm_thread::cm_backoff ()
+{
+  if (cm_policy == CM_ADAPTIVE)
+    cm_adapt (this);
+
+  // Pick a random delay from the window (xorshift32).
+  uint32_t exp = restart_total + CM_MIN_EXP;
+  if (exp > CM_MAX_EXP)
+    exp = CM_MAX_EXP;
+  cm_seed ^= cm_seed << 13;
+  cm_seed ^= cm_seed >> 17;
+  cm_seed ^= cm_seed << 5;
+  uint32_t delay = cm_seed & ((1u << exp) - 1);
+
+  if (exp <= CM_SPIN_EXP)
+    {
+      for (uint32_t i = 0; i < delay; ++i)
+        cpu_relax ();
+      return;
+    }
+
+  // Sleep until another transaction commits, since that is what we are
+  // waiting for anyway.  The timeout bounds the wait if nobody commits
+  // (e.g., when every thread is backing off), and also covers the race
+  // with a committer that checked cm_sleepers before we incremented it.
+  cm_sleepers.fetch_add (1, memory_order_seq_cst);
+  int seq = cm_commit_seq.load (memory_order_relaxed);
+  futex_wait_timed (&cm_commit_seq, seq, delay * CM_PAUSE_NS);
+  cm_sleepers.fetch_sub (1, memory_order_relaxed);
+}
+
+// Called after a successful commit, if the policy is not immediate.
+void
+gtm_thread::cm_commit ()
+{
+  if (cm_policy == CM_ADAPTIVE)
+    {
+      cm_commits++;
+      cm_adapt (this);
+    }
+  if (cm_sleepers.load (memory_order_relaxed) != 0)
+    {
+      cm_commit_seq.fetch_add (1, memory_order_release);
+      futex_wake (&cm_commit_seq, INT_MAX);
+    }
+}
+
+// Try to take the priority token.  Must be called while the transaction is
+// active, and before it restarts, so that its filter starts out empty.
+bool
+gtm_thread::cm_take_priority ()
+{
+  gtm_thread *expected = 0;
+  if (!priority_owner.compare_exchange_strong (expected, this,
+                                               memory_order_seq_cst,
+                                               memory_order_relaxed))
+    return false;
+  cm_priority = true;
+  return true;
+}
+
+// Release the priority token after the transaction has committed or aborted,
+// or before it goes serial.  Wakes up the transactions that yielded to it.
+void
+gtm_thread::cm_release_priority ()
+{
+  cm_priority_reads.clear ();
+  cm_priority = false;
+  priority_owner.store (0, memory_order_release);
+  cm_priority_seq.fetch_add (1, memory_order_release);
+  futex_wake (&cm_priority_seq, INT_MAX);
+}
+
+// True iff the priority transaction has restarted too often, and should go
+// serial instead.
+bool
+gtm_thread::cm_priority_expired () const
+{
+  return restart_total > cm_serial_limit + cm_serial_retries;
+}
+
+// Wait until the current priority transaction has finished.  Must be called
+// while the transaction is inactive, because the priority transaction might
+// need the serial lock.
+void
+gtm_thread::cm_yield ()
+{
+  int seq = cm_priority_seq.load (memory_order_acquire);
+  gtm_thread *owner = priority_owner.load (memory_order_acquire);
+  if (owner != 0 && owner != this)
+    futex_wait_timed (&cm_priority_seq, seq, CM_YIELD_NS);
+}
+
+// Called by the read barriers of the priority transaction, before the read.
+// The filter only steers contention; the method still validates as usual.  A
+// writer that misses a mark that is set concurrently only makes the priority
+// transaction restart once more.
+void
+gtm_thread::cm_note_read (const void *addr, size_t len)
+{
+  cm_priority_reads.add (addr, len);
+}
+
+// True iff another transaction holds the priority token and may have read
+// [ADDR, ADDR + LEN).  Writers call this for the data that they are about to
+// commit, and yield if it returns true.
+bool
+gtm_thread::cm_priority_conflict (const void *addr, size_t len) const
+{
+  gtm_thread *owner = priority_owner.load (memory_order_relaxed);
+  if (owner == 0 || owner == this)
+    return false;
+  return cm_priority_reads.contains (addr, len);
+}
@@ -72,6 +72,15 @@ typedef enum
     inIrrevocableTransaction
 } _ITM_howExecuting;
 
+/* [transmem] Arguments to setPrivatizationPolicy */
+typedef enum
+{
+    privatizationAlways = 0,   /* Every writer commit ensures privatization
+                                  safety (the default) */
+    privatizationMarked        /* Only transactions that call markPrivatizing,
+                                  or that free memory, do so */
+} _ITM_privatizationPolicy;
+
 /* Values to describe properties of code, passed in to beginTransaction.
    Some of these constants are duplicated in some of the ITM_beginTransaction
    implementations, so update those too when applying any changes.  */
@@ -168,6 +177,24 @@ extern void *_ITM_calloc (size_t, size_t)
 
 extern  void _ITM_free (void *) ITM_PURE;
 
+/* [transmem] Privatization hints.  These are not part of the ABI spec.  */
+extern void _ITM_setPrivatizationPolicy (_ITM_privatizationPolicy) ITM_REGPARM;
+extern void _ITM_markPrivatizing (void) ITM_REGPARM ITM_PURE;
+
+/* [transmem] Commutative updates: add the second argument to the first one
+   when the transaction commits, without reading it.  These are not part of
+   the ABI spec.  */
+extern void _ITM_addU8 (uint64_t *, uint64_t) ITM_REGPARM ITM_PURE;
+extern void _ITM_addF8 (double *, double) ITM_REGPARM ITM_PURE;
+
+/* [transmem] Elastic traversals: after _ITM_beginElastic (WINDOW), each
+   _ITM_elasticStep drops the reads made before the last WINDOW steps from
+   the read set.  _ITM_elasticUnlink clears the link of a node that is
+   removed.  These are not part of the ABI spec.  */
+extern void _ITM_beginElastic (size_t) ITM_REGPARM ITM_PURE;
+extern void _ITM_elasticStep (void) ITM_REGPARM ITM_PURE;
+extern void _ITM_elasticUnlink (void **) ITM_REGPARM ITM_PURE;
+
 
 /* The following typedefs exist to make the macro expansions below work
    properly.  They are not part of any API.  */
@@ -283,6 +310,7 @@ extern void _ITM_registerTMCloneTable (void *, size_t);
 extern void _ITM_deregisterTMCloneTable (void *);
 
 extern void *_ITM_cxa_allocate_exception (size_t);
+extern void _ITM_cxa_free_exception (void *exc_ptr);
 extern void _ITM_cxa_throw (void *obj, void *tinfo, void *dest);
 extern void *_ITM_cxa_begin_catch (void *exc_ptr);
 extern void _ITM_cxa_end_catch (void);
@@ -290,6 +318,19 @@ extern void _ITM_commitTransactionEH(void *exc_ptr) ITM_REGPARM;
 
 #ifdef __cplusplus
 } /* extern "C" */
+
+/* [transmem] C++ wrappers for the commutative updates.  */
+ITM_PURE inline void
+_ITM_add (uint64_t *addr, uint64_t val)
+{
+  _ITM_addU8 (addr, val);
+}
+
+ITM_PURE inline void
+_ITM_add (double *addr, double val)
+{
+  _ITM_addF8 (addr, val);
+}
 #endif
 
 #endif /* LIBITM_H */
@@ -69,6 +69,7 @@ enum gtm_restart_reason
   RESTART_VALIDATE_READ,
   RESTART_VALIDATE_WRITE,
   RESTART_VALIDATE_COMMIT,
+  RESTART_PRIORITY,
   RESTART_SERIAL_IRR,
   RESTART_NOT_READONLY,
   RESTART_CLOSED_NESTING,
@@ -77,6 +78,25 @@ enum gtm_restart_reason
   NO_RESTART = NUM_RESTARTS
 };
 
+// [transmem] The contention management policies, selected with the ITM_CM
+// environment variable.  They decide how long a transaction waits before it
+// restarts, and when it gives up and restarts in serial mode.  See
+// contention.cc.
+enum gtm_cm_policy
+{
+  CM_IMMEDIATE,		// restart at once; go serial after 100 restarts
+  CM_BACKOFF,		// randomized exponential backoff between restarts
+  CM_ADAPTIVE		// backoff, and go serial sooner when aborts are common
+};
+
+// [transmem] True iff R is a restart caused by a conflict with another
+// transaction, which is what the contention manager reacts to.
+inline bool
+restart_is_conflict (gtm_restart_reason r)
+{
+  return r >= RESTART_LOCKED_READ && r <= RESTART_PRIORITY;
+}
+
 } // namespace GTM
 
 #include "target.h"
@@ -86,6 +106,9 @@ enum gtm_restart_reason
 #include "stmlock.h"
 #include "dispatch.h"
 #include "containers.h"
+#include "linefilter.h"
+#include "orec.h"
+#include "timebase.h"
 
 #ifdef __USER_LABEL_PREFIX__
 # define UPFX UPFX1(__USER_LABEL_PREFIX__)
@@ -195,6 +218,10 @@ struct gtm_thread
 
   // Data used by alloc.c for the malloc/free undo log.
   aa_tree<uintptr_t, gtm_alloc_action> alloc_actions;
+  // [transmem] Set if the transaction freed memory (see alloc.cc)
+  bool freed_memory;
+  // [transmem] Set by _ITM_markPrivatizing() (see quiesce.cc)
+  bool privatizing;
 
   // Data used by useraction.c for the user-defined commit/abort handlers.
   vector<user_action> user_actions;
@@ -242,6 +269,21 @@ struct gtm_thread
   uint32_t restart_reason[NUM_RESTARTS];
   uint32_t restart_total;
 
+  // [transmem] Contention manager state (see contention.cc).  The abort rate
+  // is measured over windows of commits and conflict-induced restarts;
+  // cm_aborts_base is the number of conflicts in restart_reason[] at the
+  // start of the current window, and cm_serial_limit is the restart_total
+  // at which we fall back to serial mode.
+  uint32_t cm_seed;
+  uint32_t cm_commits;
+  uint32_t cm_aborts_base;
+  uint32_t cm_serial_limit;
+  // [transmem] True iff this transaction holds the priority token.
+  bool cm_priority;
+  // [transmem] The next exited thread whose gtm_thread waits to be freed
+  // (see quiesce.cc)
+  gtm_thread *next_dead;
+
   // *** The shared part of gtm_thread starts here. ***
   // Shared state is on separate cachelines to avoid false sharing with
   // thread-local parts of gtm_thread.
@@ -265,6 +307,15 @@ struct gtm_thread
   // The number of all registered threads.
   static unsigned number_of_threads;
 
+  // [transmem] The number of committers blocked in quiesce()
+  static atomic<int> quiesce_waiters;
+  // [transmem] The transaction that holds the priority token, or null (see
+  // contention.cc)
+  static atomic<gtm_thread *> priority_owner;
+  // [transmem] The number of threads that traverse list_of_threads without
+  // holding the serial lock (see quiesce.cc)
+  static atomic<int> list_walkers;
+
   // In alloc.cc
   void commit_allocations (bool, aa_tree<uintptr_t, gtm_alloc_action>*);
   void record_allocation (void *, void (*)(void *));
@@ -301,6 +352,42 @@ struct gtm_thread
   // Must be called from serial mode. Does not call set_abi_disp().
   void set_default_dispatch(abi_dispatch* disp);
 
+  // [transmem] In quiesce.cc
+  void quiesce (gtm_word priv_time);
+  static void quiesce_wake ();
+  static void bury (gtm_thread *tx);
+  static void reap_threads ();
+  // Wake committers blocked in quiesce().  Must be called after this
+  // thread's shared_state changed, with a seq_cst fence in between.
+  static void quiesce_notify ()
+  {
+    if (unlikely (quiesce_waiters.load (memory_order_relaxed) != 0))
+      quiesce_wake ();
+  }
+  // [transmem] True iff committing this transaction must wait for
+  // quiescence even under a TM method that is otherwise privatization-safe:
+  // freed memory must not be reused (or unmapped) while doomed transactions
+  // may still read it, and user commit actions may free memory, too.
+  bool needs_quiescence () const
+  {
+    return freed_memory || user_actions.size() != 0;
+  }
+  // [transmem] True iff a writer commit may skip quiescence, because the
+  // program declared that only marked transactions privatize data.
+  bool skip_quiescence () const;
+
+  // [transmem] In contention.cc
+  void cm_reset ();
+  void cm_backoff ();
+  void cm_commit ();
+  uint32_t cm_conflicts () const;
+  bool cm_take_priority ();
+  void cm_release_priority ();
+  bool cm_priority_expired () const;
+  void cm_yield ();
+  void cm_note_read (const void *, size_t);
+  bool cm_priority_conflict (const void *, size_t) const;
+
   // In method-serial.cc
   void serialirr_mode ();
 
@@ -331,6 +418,9 @@ extern void GTM_error (const char *fmt, ...)
 extern void GTM_fatal (const char *fmt, ...)
 	__attribute__((noreturn, format (printf, 1, 2)));
 
+// [transmem] The contention management policy (see contention.cc)
+extern gtm_cm_policy cm_policy;
+
 extern abi_dispatch *dispatch_serial();
 extern abi_dispatch *dispatch_serialirr();
 extern abi_dispatch *dispatch_serialirr_onwrite();
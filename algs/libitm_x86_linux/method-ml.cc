@@ -62,55 +62,35 @@ struct ml_mg : public method_group
   }
   static gtm_word inc_incarnation(gtm_word o) { return o + 1; }
 
-  // The shared time base.
-  atomic<gtm_word> time __attribute__((aligned(HW_CACHELINE_SIZE)));
+  // The shared time base.  [transmem] See timebase.h for the modes.
+  gtm_timebase time __attribute__((aligned(HW_CACHELINE_SIZE)));
 
-  // The array of ownership records.
-  atomic<gtm_word>* orecs __attribute__((aligned(HW_CACHELINE_SIZE)));
-  char tailpadding[HW_CACHELINE_SIZE - sizeof(atomic<gtm_word>*)];
-
-  // Location-to-orec mapping.  Stripes of 16B mapped to 2^19 orecs.
-  static const gtm_word L2O_ORECS = 1 << 19;
-  static const gtm_word L2O_SHIFT = 4;
-  static size_t get_orec(const void* addr)
-  {
-    return ((uintptr_t)addr >> L2O_SHIFT) & (L2O_ORECS - 1);
-  }
-  static size_t get_next_orec(size_t orec)
-  {
-    return (orec + 1) & (L2O_ORECS - 1);
-  }
-  // Returns the next orec after the region.
-  static size_t get_orec_end(const void* addr, size_t len)
-  {
-    return (((uintptr_t)addr + len + (1 << L2O_SHIFT) - 1) >> L2O_SHIFT)
-        & (L2O_ORECS - 1);
-  }
+  // [transmem] The array of ownership records, and its geometry (see
+  // orec.h).
+  gtm_orec_table table __attribute__((aligned(HW_CACHELINE_SIZE)));
+  char tailpadding[HW_CACHELINE_SIZE - sizeof(gtm_orec_table)];
 
   virtual void init()
   {
-    // We assume that an atomic<gtm_word> is backed by just a gtm_word, so
-    // starting with zeroed memory is fine.
-    orecs = (atomic<gtm_word>*) xcalloc(
-        sizeof(atomic<gtm_word>) * L2O_ORECS, true);
-    // This store is only executed while holding the serial lock, so relaxed
+    table.alloc();
+    // This is only executed while holding the serial lock, so relaxed
     // memory order is sufficient here.
-    time.store(0, memory_order_relaxed);
+    time.reset();
   }
 
   virtual void fini()
   {
-    free(orecs);
+    table.release();
   }
 
   // We only re-initialize when our time base overflows.  Thus, only reset
   // the time base and the orecs but do not re-allocate the orec array.
   virtual void reinit()
   {
-    // This store is only executed while holding the serial lock, so relaxed
+    // This is only executed while holding the serial lock, so relaxed
     // memory order is sufficient here.  Same holds for the memset.
-    time.store(0, memory_order_relaxed);
-    memset(orecs, 0, sizeof(atomic<gtm_word>) * L2O_ORECS);
+    time.reset();
+    table.clear();
   }
 };
 
@@ -142,14 +122,16 @@ protected:
     gtm_word locked_by_tx = ml_mg::set_locked(tx);
 
     // Lock all orecs that cover the region.
-    size_t orec = ml_mg::get_orec(addr);
-    size_t orec_end = ml_mg::get_orec_end(addr, len);
+    const gtm_orec_table& table = o_ml_mg.table;
+    uintptr_t stripe = table.get_stripe(addr);
+    uintptr_t stripe_end = table.get_stripe_end(addr, len);
     do
       {
+        size_t orec = table.get_orec(stripe);
         // Load the orec.  Relaxed memory order is sufficient here because
         // either we have acquired the orec or we will try to acquire it with
         // a CAS with stronger memory order.
-        gtm_word o = o_ml_mg.orecs[orec].load(memory_order_relaxed);
+        gtm_word o = table.orecs[orec].load(memory_order_relaxed);
 
         // Check whether we have acquired the orec already.
         if (likely (locked_by_tx != o))
@@ -158,7 +140,10 @@ protected:
             // equal than the orec's version to avoid masking invalidations of
             // our snapshot with our own writes.
             if (unlikely (ml_mg::is_locked(o)))
-              tx->restart(RESTART_LOCKED_WRITE);
+              {
+                table.note_conflict(orec, stripe);
+                tx->restart(RESTART_LOCKED_WRITE);
+              }
 
             if (unlikely (ml_mg::get_time(o) > snapshot))
               {
@@ -167,7 +152,7 @@ protected:
                 // transaction, we will have to extend anyway during commit.
                 // ??? Scan the read log instead, aborting if we have read
                 // from data covered by this orec before?
-                snapshot = extend(tx);
+                snapshot = extend(tx, ml_mg::get_time(o));
               }
 
             // We need acquire memory order here to synchronize with other
@@ -175,9 +160,13 @@ protected:
             // because whenever another thread reads from this CAS'
             // modification, then it will abort anyway and does not rely on
             // any further happens-before relation to be established.
-            if (unlikely (!o_ml_mg.orecs[orec].compare_exchange_strong(
+            if (unlikely (!table.orecs[orec].compare_exchange_strong(
                 o, locked_by_tx, memory_order_acquire)))
-              tx->restart(RESTART_LOCKED_WRITE);
+              {
+                table.note_conflict(orec, stripe);
+                tx->restart(RESTART_LOCKED_WRITE);
+              }
+            table.note_acquire(orec, stripe);
 
             // We use an explicit fence here to avoid having to use release
             // memory order for all subsequent data stores.  This fence will
@@ -192,12 +181,11 @@ protected:
             // numbers when we have to roll back.
             // ??? Reserve capacity early to avoid capacity checks here?
             gtm_rwlog_entry *e = tx->writelog.push();
-            e->orec = o_ml_mg.orecs + orec;
+            e->orec = table.orecs + orec;
             e->value = o;
           }
-        orec = o_ml_mg.get_next_orec(orec);
       }
-    while (orec != orec_end);
+    while (++stripe != stripe_end);
 
     // Do undo logging.  We do not know which region prior writes logged
     // (even if orecs have been acquired), so just log everything.
@@ -239,10 +227,11 @@ protected:
     return true;
   }
 
-  // Tries to extend the snapshot to a more recent time.  Returns the new
-  // snapshot time and updates TX->SHARED_STATE.  If the snapshot cannot be
-  // extended to the current global time, TX is restarted.
-  static gtm_word extend(gtm_thread *tx)
+  // Tries to extend the snapshot to a more recent time, which is at least
+  // SEEN.  Returns the new snapshot time and updates TX->SHARED_STATE.  If
+  // the snapshot cannot be extended to the current global time, TX is
+  // restarted.
+  static gtm_word extend(gtm_thread *tx, gtm_word seen)
   {
     // We read global time here, even if this isn't strictly necessary
     // because we could just return the maximum of the timestamps that
@@ -252,7 +241,7 @@ protected:
     // We need acquire memory oder because we have to synchronize with the
     // increment of global time by update transactions, whose lock
     // acquisitions we have to observe (also see trycommit()).
-    gtm_word snapshot = o_ml_mg.time.load(memory_order_acquire);
+    gtm_word snapshot = o_ml_mg.time.now_at_least(seen);
     if (!validate(tx))
       tx->restart(RESTART_VALIDATE_READ);
 
@@ -275,22 +264,24 @@ protected:
     gtm_word snapshot = tx->shared_state.load(memory_order_relaxed);
     gtm_word locked_by_tx = ml_mg::set_locked(tx);
 
-    size_t orec = ml_mg::get_orec(addr);
-    size_t orec_end = ml_mg::get_orec_end(addr, len);
+    const gtm_orec_table& table = o_ml_mg.table;
+    uintptr_t stripe = table.get_stripe(addr);
+    uintptr_t stripe_end = table.get_stripe_end(addr, len);
     do
       {
+        size_t orec = table.get_orec(stripe);
         // We need acquire memory order here so that this load will
         // synchronize with the store that releases the orec in trycommit().
         // In turn, this makes sure that subsequent data loads will read from
         // a visible sequence of side effects that starts with the most recent
         // store to the data right before the release of the orec.
-        gtm_word o = o_ml_mg.orecs[orec].load(memory_order_acquire);
+        gtm_word o = table.orecs[orec].load(memory_order_acquire);
 
         if (likely (!ml_mg::is_more_recent_or_locked(o, snapshot)))
           {
             success:
             gtm_rwlog_entry *e = tx->readlog.push();
-            e->orec = o_ml_mg.orecs + orec;
+            e->orec = table.orecs + orec;
             e->value = o;
           }
         else if (!ml_mg::is_locked(o))
@@ -298,7 +289,8 @@ protected:
             // We cannot read this part of the region because it has been
             // updated more recently than our snapshot time.  If we can extend
             // our snapshot, then we can read.
-            snapshot = extend(tx);
+            table.note_conflict(orec, stripe);
+            snapshot = extend(tx, ml_mg::get_time(o));
             goto success;
           }
         else
@@ -306,11 +298,13 @@ protected:
             // If the orec is locked by us, just skip it because we can just
             // read from it.  Otherwise, restart the transaction.
             if (o != locked_by_tx)
-              tx->restart(RESTART_LOCKED_READ);
+              {
+                table.note_conflict(orec, stripe);
+                tx->restart(RESTART_LOCKED_READ);
+              }
           }
-        orec = o_ml_mg.get_next_orec(orec);
       }
-    while (orec != orec_end);
+    while (++stripe != stripe_end);
     return &tx->readlog[log_start];
   }
 
@@ -461,7 +455,7 @@ public:
     // Read the current time, which becomes our snapshot time.
     // Use acquire memory oder so that we see the lock acquisitions by update
     // transcations that incremented the global time (see trycommit()).
-    gtm_word snapshot = o_ml_mg.time.load(memory_order_acquire);
+    gtm_word snapshot = o_ml_mg.time.now();
     // Re-initialize method group on time overflow.
     if (snapshot >= o_ml_mg.TIME_MAX)
       return RESTART_INIT_METHOD_GROUP;
@@ -492,19 +486,17 @@ public:
 
     // Get a commit time.
     // Overflow of o_ml_mg.time is prevented in begin_or_restart().
-    // We need acq_rel here because (1) the acquire part is required for our
-    // own subsequent call to validate(), and the release part is necessary to
-    // make other threads' validate() work as explained there and in extend().
-    gtm_word ct = o_ml_mg.time.fetch_add(1, memory_order_acq_rel) + 1;
+    bool unique;
+    gtm_word ct = o_ml_mg.time.commit(tx, unique);
 
     // Extend our snapshot time to at least our commit time.
     // Note that we do not need to validate if our snapshot time is right
-    // before the commit time because we are never sharing the same commit
-    // time with other transactions.
+    // before the commit time and we are not sharing the same commit time
+    // with other transactions.
     // No need to reset shared_state, which will be modified by the serial
     // lock right after our commit anyway.
     gtm_word snapshot = tx->shared_state.load(memory_order_relaxed);
-    if (snapshot < ct - 1 && !validate(tx))
+    if ((!unique || snapshot < ct - 1) && !validate(tx))
       return false;
 
     // Release orecs.
@@ -521,7 +513,11 @@ public:
 
     // Need to ensure privatization safety. Every other transaction must
     // have a snapshot time that is at least as high as our commit time
-    // (i.e., our commit must be visible to them).
+    // (i.e., our commit must be visible to them).  [transmem] If the time
+    // base does not advance on commit, advance it now so that transactions
+    // starting after us do not hold up quiescence.
+    if (!tx->skip_quiescence())
+      o_ml_mg.time.publish(ct);
     priv_time = ct;
     return true;
   }
@@ -562,8 +558,7 @@ public:
               // In contrast to the increment in trycommit(), we need release
               // for the same reason but do not need the acquire because we
               // do not validate subsequently.
-              overflow_value = ml_mg::set_time(
-                  o_ml_mg.time.fetch_add(1, memory_order_release) + 1);
+              overflow_value = ml_mg::set_time(o_ml_mg.time.tick(tx));
             i->orec->store(overflow_value, memory_order_release);
           }
       }
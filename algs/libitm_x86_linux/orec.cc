@@ -0,0 +1,190 @@
+#include "libitm_i.h"
+#include <stdio.h>
+#include <sys/mman.h>
+
+// [transmem] Ownership record tables (see orec.h)
+
+namespace GTM HIDDEN {
+
+// The default geometry is the original libitm one: 2^19 orecs covering
+// 16-byte stripes, with modular hashing.  We bound the table between 256
+// orecs and 2^28 orecs, and stripes between 8 bytes and a 4KB page.
+static const unsigned OREC_DEFAULT_BITS = 19;
+static const unsigned OREC_MIN_BITS = 8;
+static const unsigned OREC_MAX_BITS = 28;
+static const unsigned OREC_DEFAULT_SHIFT = 4;
+static const unsigned OREC_MIN_SHIFT = 3;
+static const unsigned OREC_MAX_SHIFT = 12;
+
+// The granularity of huge page mappings
+static const size_t OREC_HUGEPAGE_SIZE = 2 << 20;
+
+// The configuration from the environment, read on first use
+static struct
+{
+  bool parsed;
+  unsigned bits;
+  unsigned shift;
+  gtm_orec_hash hash;
+  bool hugepages;
+  bool profile;
+} orec_config;
+
+// Conflict counts, if profiling
+static atomic<uint64_t> orec_conflicts;
+static atomic<uint64_t> orec_false_conflicts;
+
+static const char *
+orec_hash_name (gtm_orec_hash hash)
+{
+  switch (hash)
+    {
+    case OREC_HASH_MUL: return "mul";
+    case OREC_HASH_XOR: return "xor";
+    default:            return "mod";
+    }
+}
+
+// Report the conflict counts at exit, if profiling
+static void
+orec_report ()
+{
+  uint64_t all = orec_conflicts.load (memory_order_relaxed);
+  uint64_t fc = orec_false_conflicts.load (memory_order_relaxed);
+  GTM_error ("orecs=%lu stripe=%lu hash=%s: %llu conflicts, %llu false "
+             "(%.1f%%)", 1UL << orec_config.bits, 1UL << orec_config.shift,
+             orec_hash_name (orec_config.hash), (unsigned long long) all,
+             (unsigned long long) fc, all ? 100.0 * fc / all : 0.0);
+}
+
+static bool
+parse_flag (const char *name)
+{
+  const char *env = getenv (name);
+  return env != NULL && strtol (env, NULL, 10) != 0;
+}
+
+static void
+parse_orec_config ()
+{
+  orec_config.parsed = true;
+  orec_config.bits = OREC_DEFAULT_BITS;
+  orec_config.shift = OREC_DEFAULT_SHIFT;
+  orec_config.hash = OREC_HASH_MOD;
+
+  const char *env = getenv ("ITM_ORECS");
+  if (env != NULL)
+    {
+      unsigned long n = strtoul (env, NULL, 10);
+      unsigned bits = OREC_MIN_BITS;
+      while (bits < OREC_MAX_BITS && (1UL << bits) < n)
+        bits++;
+      orec_config.bits = bits;
+    }
+
+  env = getenv ("ITM_OREC_SHIFT");
+  if (env != NULL)
+    {
+      unsigned long shift = strtoul (env, NULL, 10);
+      if (shift < OREC_MIN_SHIFT)
+        shift = OREC_MIN_SHIFT;
+      if (shift > OREC_MAX_SHIFT)
+        shift = OREC_MAX_SHIFT;
+      orec_config.shift = shift;
+    }
+
+  env = getenv ("ITM_OREC_HASH");
+  if (env != NULL)
+    {
+      if (strcmp (env, "mul") == 0)
+        orec_config.hash = OREC_HASH_MUL;
+      else if (strcmp (env, "xor") == 0)
+        orec_config.hash = OREC_HASH_XOR;
+      else if (strcmp (env, "mod") != 0)
+        GTM_error ("Unknown orec hash in environment variable "
+                   "ITM_OREC_HASH\n");
+    }
+
+  orec_config.hugepages = parse_flag ("ITM_OREC_HUGEPAGES");
+  orec_config.profile = parse_flag ("ITM_OREC_PROFILE");
+  if (orec_config.profile)
+    atexit (orec_report);
+}
+
+// Round SIZE up to whole huge pages
+static inline size_t
+orec_map_size (size_t size)
+{
+  return (size + OREC_HUGEPAGE_SIZE - 1) & ~(OREC_HUGEPAGE_SIZE - 1);
+}
+
+// Allocate SIZE bytes of zeroed memory, advising the kernel to use huge pages
+static void *
+orec_map (size_t size)
+{
+  size = orec_map_size (size);
+  void *p = mmap (NULL, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return NULL;
+#ifdef MADV_HUGEPAGE
+  madvise (p, size, MADV_HUGEPAGE);
+#endif
+  return p;
+}
+
+} // namespace GTM
+
+using namespace GTM;
+
+void
+gtm_orec_table::count_conflict (bool false_conflict)
+{
+  orec_conflicts.fetch_add (1, memory_order_relaxed);
+  if (false_conflict)
+    orec_false_conflicts.fetch_add (1, memory_order_relaxed);
+}
+
+void
+gtm_orec_table::alloc ()
+{
+  if (!orec_config.parsed)
+    parse_orec_config ();
+  bits = orec_config.bits;
+  shift = orec_config.shift;
+  hash = orec_config.hash;
+  mask = ((gtm_word) 1 << bits) - 1;
+
+  size_t size = sizeof (atomic<gtm_word>) << bits;
+  orecs = NULL;
+  if (orec_config.hugepages)
+    orecs = (atomic<gtm_word>*) orec_map (size);
+  mapped = (orecs != NULL);
+  if (!mapped)
+    orecs = (atomic<gtm_word>*) xcalloc (size, true);
+
+  owners = NULL;
+  if (orec_config.profile)
+    owners = (atomic<uintptr_t>*)
+      xcalloc (sizeof (atomic<uintptr_t>) << bits, true);
+}
+
+void
+gtm_orec_table::release ()
+{
+  if (mapped)
+    munmap (orecs, orec_map_size (sizeof (atomic<gtm_word>) << bits));
+  else
+    free (orecs);
+  free (owners);
+  orecs = NULL;
+  owners = NULL;
+}
+
+void
+gtm_orec_table::clear ()
+{
+  // The orecs are atomics, so we do not memset them
+  for (size_t i = 0, n = (size_t) 1 << bits; i < n; ++i)
+    orecs[i].store (0, memory_order_relaxed);
+}
@@ -0,0 +1,134 @@
+// -*-c++-*-
+//
+// ValidateBench: measure the cost of NOrec's value-based validation
+//
+// For each read set size (in 8-byte words), we log the reads in a
+// gtm_valuelog and then validate it repeatedly.  We report ns per validated
+// word for:
+//
+//  - entry:  the old format (one value/length/address entry per read, each
+//            checked with memcmp), for reference
+//  - scalar: the coalesced format, with the portable kernel
+//  - avx2:   the coalesced format, with the AVX2 kernel (if supported)
+//
+// We use two address patterns: sequential words (which coalesce into a single
+// run), and every other word (which cannot coalesce at all).
+
+#include "libitm_i.h"
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace GTM;
+
+/// The Linux clock_gettime is reasonably fast, has good resolution, and is
+/// not affected by TurboBoost or DVFS.
+static uint64_t getElapsedTime()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return (((uint64_t)t.tv_sec) * 1000000000ULL) + ((uint64_t)t.tv_nsec);
+}
+
+namespace {
+
+/// The old value log format: the value, then its length, then its address
+struct entry_log
+{
+    vector<gtm_word> log;
+
+    void log_read(const void* ptr, size_t len, const void* val)
+    {
+        size_t words = (len + sizeof(gtm_word) - 1) / sizeof(gtm_word);
+        gtm_word* e = log.push(words + 2);
+        memcpy(e, val, len);
+        e[words] = len;
+        e[words + 1] = (gtm_word)ptr;
+    }
+
+    bool valuecheck()
+    {
+        size_t i, n = log.size();
+        for (i = n; i-- > 0; ) {
+            void* ptr = (void*)log[i--];
+            size_t len = log[i];
+            size_t words = (len + sizeof(gtm_word) - 1) / sizeof(gtm_word);
+            i -= words;
+            if (0 != __builtin_memcmp(ptr, &log[i], len))
+                return false;
+        }
+        return true;
+    }
+};
+
+} // anon namespace
+
+/// Run the validation F ITERS times, and return ns per word
+template <class F>
+static double run(F f, long words, int iters)
+{
+    int ok = 0;
+    uint64_t start = getElapsedTime();
+    for (int i = 0; i < iters; ++i)
+        ok += f();
+    uint64_t end = getElapsedTime();
+    if (ok != iters)
+        printf("validation failed!\n");
+    return (double)(end - start) / ((double)words * iters);
+}
+
+/// Print usage
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [flags]\n", name);
+    fprintf(stderr, "    -m: largest read set, in words (default 1M)\n");
+    fprintf(stderr, "    -w: total words validated per measurement (default 64M)\n");
+    fprintf(stderr, "    -h: print help (this message)\n\n");
+}
+
+int main(int argc, char** argv)
+{
+    long maxwords = 1L << 20;
+    long total = 64L << 20;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:w:h")) != -1) {
+        switch (opt) {
+          case 'm': maxwords = strtol(optarg, NULL, 10); break;
+          case 'w': total    = strtol(optarg, NULL, 10); break;
+          case 'h': usage(argv[0]); return 0;
+        }
+    }
+
+    // the strided pattern needs twice as much memory
+    uint64_t* heap = (uint64_t*)aligned_alloc(64, maxwords * 2 * sizeof(uint64_t));
+    for (long i = 0; i < maxwords * 2; ++i)
+        heap[i] = i;
+
+    bool avx2 = avx2_available();
+    for (long words = 8; words <= maxwords; words *= 4) {
+        int iters = total / words;
+        if (iters < 1)
+            iters = 1;
+        for (int stride = 1; stride <= 2; ++stride) {
+            entry_log* old = new entry_log();
+            gtm_valuelog* vl = new gtm_valuelog();
+            for (long i = 0; i < words; ++i) {
+                old->log_read(&heap[i * stride], sizeof(uint64_t), &heap[i * stride]);
+                vl->log_read(&heap[i * stride], sizeof(uint64_t), &heap[i * stride]);
+            }
+            double e = run([&]{ return old->valuecheck(); }, words, iters);
+            double s = run([&]{ return vl->valuecheck(valuecheck_scalar); },
+                           words, iters);
+            double v = avx2
+                ? run([&]{ return vl->valuecheck(valuecheck_avx2); }, words, iters)
+                : 0;
+            printf("csv, words=%ld, pattern=%s, runs=%lu, iters=%d, "
+                   "entry_ns=%.3f, scalar_ns=%.3f, avx2_ns=%.3f\n", words,
+                   stride == 1 ? "seq" : "strided",
+                   (unsigned long)vl->runs.size(), iters, e, s, v);
+            delete old;
+            delete vl;
+        }
+    }
+    free(heap);
+}
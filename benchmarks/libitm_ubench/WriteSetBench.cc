@@ -0,0 +1,115 @@
+// -*-c++-*-
+//
+// WriteSetBench: compare the hash-based WriteSet against the original BST
+//
+// For each write set size (in cache lines), we fill the redo log with one
+// 8-byte store per word of each line, look every word up again (as a
+// read-after-write would), write the log back, and reset it.  We report the
+// average cost per store for each data structure, for both a sequential
+// address pattern (e.g., an array fill), and a random one.
+
+#include "libitm_i.h"
+#include "bst.h"
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace GTM;
+
+/// Words per 64-byte cache line
+static const int WORDS = 64 / sizeof(uint64_t);
+
+/// Sparseness of the random pattern: lines are chosen from a region this many
+/// times larger than the write set
+static const int SPREAD = 16;
+
+/// The Linux clock_gettime is reasonably fast, has good resolution, and is
+/// not affected by TurboBoost or DVFS.
+static uint64_t getElapsedTime()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return (((uint64_t)t.tv_sec) * 1000000000ULL) + ((uint64_t)t.tv_nsec);
+}
+
+/// Run TRIALS transactions' worth of redo log operations on LINES cache
+/// lines, whose addresses are in ADDRS.  Returns the total time in ns.
+template <class WS>
+static uint64_t run(WS& ws, uint64_t** addrs, int lines, int trials)
+{
+    uint64_t sum = 0;
+    uint64_t start = getElapsedTime();
+    for (int t = 0; t < trials; ++t) {
+        for (int l = 0; l < lines; ++l)
+            for (int w = 0; w < WORDS; ++w)
+                ws.insert(addrs[l] + w, (uint64_t)(t + w));
+        for (int l = 0; l < lines; ++l)
+            for (int w = 0; w < WORDS; ++w) {
+                uint64_t v = 0;
+                ws.find(addrs[l] + w, v);
+                sum += v;
+            }
+        ws.writeback();
+        ws.reset();
+    }
+    uint64_t end = getElapsedTime();
+    // keep the compiler from eliding the finds
+    if (sum == 1)
+        printf(" ");
+    return end - start;
+}
+
+/// Print usage
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [flags]\n", name);
+    fprintf(stderr, "    -m: largest write set, in cache lines (default 1024)\n");
+    fprintf(stderr, "    -s: total stores per measurement (default 1M)\n");
+    fprintf(stderr, "    -h: print help (this message)\n\n");
+}
+
+int main(int argc, char** argv)
+{
+    int maxlines = 1024;
+    long stores = 1L << 20;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:s:h")) != -1) {
+        switch (opt) {
+          case 'm': maxlines = strtol(optarg, NULL, 10); break;
+          case 's': stores   = strtol(optarg, NULL, 10); break;
+          case 'h': usage(argv[0]); return 0;
+        }
+    }
+
+    // one region for both patterns; the sequential pattern uses a prefix
+    uint64_t* heap = (uint64_t*)aligned_alloc(64, (size_t)maxlines * SPREAD * 64);
+    memset(heap, 0, (size_t)maxlines * SPREAD * 64);
+    uint64_t** seq = (uint64_t**)malloc(maxlines * sizeof(uint64_t*));
+    uint64_t** rnd = (uint64_t**)malloc(maxlines * sizeof(uint64_t*));
+    unsigned seed = 1;
+    for (int l = 0; l < maxlines; ++l) {
+        seq[l] = heap + l * WORDS;
+        // random lines may repeat, which is fine: the STM sees the same thing
+        rnd[l] = heap + (rand_r(&seed) % (maxlines * SPREAD)) * WORDS;
+    }
+
+    BST bst;
+    WriteSet ws;
+    for (int lines = 1; lines <= maxlines; lines *= 2) {
+        int trials = stores / (lines * WORDS);
+        if (trials < 1)
+            trials = 1;
+        double n = (double)trials * lines * WORDS;
+        double bst_seq = run(bst, seq, lines, trials) / n;
+        double ws_seq  = run(ws,  seq, lines, trials) / n;
+        double bst_rnd = run(bst, rnd, lines, trials) / n;
+        double ws_rnd  = run(ws,  rnd, lines, trials) / n;
+        printf("csv, lines=%d, trials=%d, bst_seq_ns=%.2f, ws_seq_ns=%.2f, "
+               "bst_rnd_ns=%.2f, ws_rnd_ns=%.2f\n", lines, trials, bst_seq,
+               ws_seq, bst_rnd, ws_rnd);
+    }
+
+    free(seq);
+    free(rnd);
+    free(heap);
+}
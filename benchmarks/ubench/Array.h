@@ -0,0 +1,80 @@
+// -*-c++-*-
+
+#pragma once
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+
+/// The Array benchmark measures the cost of the TM read and write barriers,
+/// so it does as little else as possible.  Every operation touches a run of
+/// consecutive words in a fixed array, starting at the key: lookups read
+/// them, and inserts and removes increment and decrement them.  The run
+/// length is the -O flag, so a transaction executes about that many read
+/// barriers, plus as many write barriers if it updates.  With a large key
+/// range, transactions rarely conflict, and the throughput mostly shows how
+/// fast the barriers are.
+///
+/// Like the Counter, the Array is an IntSet only in name, so that we can
+/// reuse the benchmark harness.
+class Array
+{
+    /// The number of words in the array (a power of two)
+    static const uint32_t N_WORDS = 65536;
+
+    /// the words upon which we operate
+    intptr_t words[N_WORDS];
+
+    /// add delta to each word of the run at val
+    __attribute__((transaction_safe))
+    void update(uint32_t val, intptr_t delta) {
+        uint32_t n = width;
+        for (uint32_t i = 0; i < n; ++i)
+            words[(val + i) % N_WORDS] += delta;
+    }
+
+  public:
+
+    /// the number of words that an operation touches (see ArrayBench.cc)
+    static uint32_t width;
+
+    /// Just zero the array
+    Array() {
+        for (uint32_t i = 0; i < N_WORDS; ++i)
+            words[i] = 0;
+    }
+
+    /// Read the run of words at val
+    __attribute__((transaction_safe))
+    bool lookup(int val) const {
+        uint32_t n = width;
+        intptr_t sum = 0;
+        for (uint32_t i = 0; i < n; ++i)
+            sum += words[(val + i) % N_WORDS];
+        return sum != 0;
+    }
+
+    /// Increment the run of words at val
+    __attribute__((transaction_safe))
+    bool insert(int val) {
+        update(val, 1);
+        return true;
+    }
+
+    /// Decrement the run of words at val
+    __attribute__((transaction_safe))
+    bool remove(int val) {
+        update(val, -1);
+        return true;
+    }
+
+    /// Every insert and remove changes the sum by width, so it must stay a
+    /// multiple of width
+    bool isSane() const {
+        intptr_t sum = 0;
+        for (uint32_t i = 0; i < N_WORDS; ++i)
+            sum += words[i];
+        printf("Array sum = %ld\n", (long)sum);
+        return sum % (intptr_t)width == 0;
+    }
+};
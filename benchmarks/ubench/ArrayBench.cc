@@ -0,0 +1,44 @@
+// -*-c++-*-
+//
+//  Copyright (C) 2011, 2015
+//  University of Rochester Department of Computer Science
+//    and
+//  Lehigh University Department of Computer Science and Engineering
+//
+// License: Modified BSD
+//          Please see the file LICENSE for licensing information
+
+#include "bmconfig.h"
+#include "bmharness.h"
+#include "Array.h"
+
+/// This is the array we'll manipulate in the experiment
+benchmark<Array> SET;
+
+/// This static, declared in bmconfig, needs to be defined
+Config Config::CFG;
+
+/// The run length, declared in Array.h
+uint32_t Array::width = 1;
+
+/// The run length is the number of operations per transaction
+void reparse_args() {
+    if (Config::CFG.bmname == "") Config::CFG.bmname = "Array";
+    Array::width = Config::CFG.ops;
+}
+
+/// We just call to SET functions in main
+int main(int argc, char** argv) {
+    // parse command line
+    Config::CFG.parseargs(argc, argv, "ArrayBench");
+    reparse_args();
+
+    // warm up the data structure
+    SET.warmup();
+
+    // run the tests
+    SET.launch_test();
+
+    // print results
+    Config::CFG.dump_csv();
+}
@@ -0,0 +1,101 @@
+// -*-c++-*-
+
+#pragma once
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+
+/// The Bank benchmark checks that transactions are atomic and see
+/// consistent snapshots.  It is an array of accounts whose total never
+/// changes.  Inserts and removes move one unit between two accounts that are
+/// half the array apart, in opposite directions.  Lookups sum all accounts
+/// in one long read-only transaction, and fail if the sum is wrong.  Each
+/// thread also counts its transfers, in its own cache line, so that
+/// BankBench can check that none was lost.
+///
+/// Like the Counter, the Bank is an IntSet only in name, so that we can
+/// reuse the benchmark harness.  The thread counts use thread_id from
+/// bmharness.h, so this must be included after it.
+class Bank
+{
+    /// The number of accounts (a power of two)
+    static const uint32_t N_ACCOUNTS = 1024;
+
+    /// The initial balance of each account
+    static const intptr_t BALANCE = 1000;
+
+    /// The number of transfer counts; threads beyond that share them
+    static const uint32_t N_COUNTS = 64;
+
+    /// the accounts upon which we operate
+    intptr_t accounts[N_ACCOUNTS];
+
+    /// the number of transfers of each thread, one per cache line
+    struct Count {
+        uint64_t n;
+        char pad[64 - sizeof(uint64_t)];
+    } counts[N_COUNTS];
+
+    /// move one unit from the account of from to the account of to
+    __attribute__((transaction_safe))
+    void transfer(uint32_t from, uint32_t to) {
+        accounts[from % N_ACCOUNTS] -= 1;
+        accounts[to % N_ACCOUNTS] += 1;
+        counts[thread_id % N_COUNTS].n++;
+    }
+
+    /// the sum of all accounts
+    __attribute__((transaction_safe))
+    intptr_t sum() const {
+        intptr_t s = 0;
+        for (uint32_t i = 0; i < N_ACCOUNTS; ++i)
+            s += accounts[i];
+        return s;
+    }
+
+  public:
+
+    /// Give every account the same balance
+    Bank() {
+        for (uint32_t i = 0; i < N_ACCOUNTS; ++i)
+            accounts[i] = BALANCE;
+        for (uint32_t i = 0; i < N_COUNTS; ++i)
+            counts[i].n = 0;
+    }
+
+    /// Sum all accounts, and check the total
+    __attribute__((transaction_safe))
+    bool lookup(int val) const {
+        return sum() == BALANCE * (intptr_t)N_ACCOUNTS;
+    }
+
+    /// Move a unit from the account of val to the one across from it
+    __attribute__((transaction_safe))
+    bool insert(int val) {
+        transfer(val, val + N_ACCOUNTS / 2);
+        return true;
+    }
+
+    /// Move a unit back to the account of val
+    __attribute__((transaction_safe))
+    bool remove(int val) {
+        transfer(val + N_ACCOUNTS / 2, val);
+        return true;
+    }
+
+    /// The number of transfers so far, for BankBench
+    uint64_t transfers() const {
+        uint64_t n = 0;
+        for (uint32_t i = 0; i < N_COUNTS; ++i)
+            n += counts[i].n;
+        return n;
+    }
+
+    /// The total must not have changed
+    bool isSane() const {
+        intptr_t s = sum();
+        printf("Bank sum = %ld\n", (long)s);
+        return s == BALANCE * (intptr_t)N_ACCOUNTS;
+    }
+};
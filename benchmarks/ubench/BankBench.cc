@@ -0,0 +1,51 @@
+// -*-c++-*-
+//
+//  Copyright (C) 2011, 2015
+//  University of Rochester Department of Computer Science
+//    and
+//  Lehigh University Department of Computer Science and Engineering
+//
+// License: Modified BSD
+//          Please see the file LICENSE for licensing information
+
+#include "bmconfig.h"
+#include "bmharness.h"
+#include "Bank.h"
+
+/// This is the bank we'll manipulate in the experiment.  We keep a pointer
+/// to it, so that we can count its transfers after the test.
+Bank* BANK = new Bank();
+benchmark<Bank> SET(BANK);
+
+/// This static, declared in bmconfig, needs to be defined
+Config Config::CFG;
+
+/// A helper function to update the configuration based on some custom names
+void reparse_args() {
+    if (Config::CFG.bmname == "") Config::CFG.bmname = "Bank";
+}
+
+/// We just call to SET functions in main
+int main(int argc, char** argv) {
+    // parse command line
+    Config::CFG.parseargs(argc, argv, "BankBench");
+    reparse_args();
+
+    // warm up the data structure
+    SET.warmup();
+    uint64_t before = BANK->transfers();
+
+    // run the tests
+    SET.launch_test();
+
+    // every lookup must have seen the right total, and every insert and
+    // remove must have made a transfer
+    uint64_t updates = Config::CFG.insert_hit + Config::CFG.insert_miss
+                     + Config::CFG.remove_hit + Config::CFG.remove_miss;
+    bool ok = Config::CFG.lookup_miss == 0
+           && BANK->transfers() == before + updates;
+    std::cout << "Accounting: " << (ok ? "Passed" : "Failed") << "\n";
+
+    // print results
+    Config::CFG.dump_csv();
+}
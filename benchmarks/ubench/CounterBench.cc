@@ -19,9 +19,18 @@ benchmark<Counter> SET;
 /// This static, declared in bmconfig, needs to be defined
 Config Config::CFG;
 
-/// No reparsing needed
+/// Whether to use commutative increments, declared in Counter.h
+bool Counter::commutative = false;
+
+/// Use commutative increments if requested and supported
 void reparse_args() {
     Config::CFG.bmname = "Counter";
+    if (Config::CFG.commutative) {
+        if (TMExt::addU8)
+            Counter::commutative = true;
+        else
+            std::cerr << "-A: libitm has no commutative updates\n";
+    }
 }
 
 /// We just call to SET functions in main
@@ -52,6 +52,12 @@ class HashTable
     bool remove(int val) {
         return bucket[val % N_BUCKETS].remove(val);
     }
+    uint32_t size() const {
+        uint32_t n = 0;
+        for (int i = 0; i < N_BUCKETS; i++)
+            n += bucket[i].size();
+        return n;
+    }
     bool isSane() const {
         for (int i = 0; i < N_BUCKETS; i++)
             if (!bucket[i].extendedSanityCheck(verify_hash_function, i))
@@ -12,15 +12,24 @@
 #include "bmharness.h"
 #include "Hash.h"
 
-/// This is the hash table we'll manipulate in the experiment
-benchmark<HashTable> SET;
+/// This is the hash table we will manipulate in this experiment.  We keep a
+/// pointer to it, so that we can count its elements after the test.
+HashTable* HASH = new HashTable();
+benchmark<HashTable> SET(HASH);
 
 /// This static, declared in bmconfig, needs to be defined
 Config Config::CFG;
 
-/// A helper function to update the configuration based on some custom names
+/// A helper function to update the configuration based on some custom names,
+/// and to use elastic traversals if requested and supported
 void reparse_args() {
     if (Config::CFG.bmname == "") Config::CFG.bmname = "Hash";
+    if (Config::CFG.elastic) {
+        if (TMExt::beginElastic && TMExt::elasticUnlink)
+            List::elastic = true;
+        else
+            std::cerr << "-E: libitm has no elastic traversals\n";
+    }
 }
 
 /// We just call to SET functions in main
@@ -31,10 +40,18 @@ int main(int argc, char** argv) {
 
     // warm up the data structure
     SET.warmup();
+    uint32_t before = HASH->size();
 
     // run the tests
     SET.launch_test();
 
+    // every successful insert added an element, and every successful remove
+    // took one out
+    uint32_t expect =
+        before + Config::CFG.insert_hit - Config::CFG.remove_hit;
+    std::cout << "Accounting: "
+              << (HASH->size() == expect ? "Passed" : "Failed") << "\n";
+
     // print results
     Config::CFG.dump_csv();
 }
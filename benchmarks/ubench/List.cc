@@ -11,6 +11,9 @@
 #include <climits>
 #include "List.h"
 
+// [transmem] whether to traverse elastically, set by the benchmarks
+bool List::elastic = false;
+
 // constructor just makes a sentinel for the data structure
 List::List() : sentinel(new Node()) { }
 
@@ -29,6 +32,16 @@ bool List::isSane(void) const
     return true;
 }
 
+// [transmem] count the elements
+uint32_t List::size() const
+{
+    uint32_t n = 0;
+    for (const Node* curr = sentinel->m_next; curr != NULL;
+         curr = curr->m_next)
+        ++n;
+    return n;
+}
+
 // extended sanity check, does the same as the above method, but also calls v()
 // on every item in the list
 bool List::extendedSanityCheck(verifier v, uint32_t v_param) const
@@ -49,6 +62,8 @@ bool List::extendedSanityCheck(verifier v, uint32_t v_param) const
 bool List::insert(int val)
 {
     // traverse the list to find the insertion point
+    if (elastic)
+        TMExt::beginElastic(ELASTIC_WINDOW);
     const Node* prev(sentinel);
     const Node* curr(prev->m_next);
 
@@ -57,6 +72,8 @@ bool List::insert(int val)
             break;
         prev = curr;
         curr = (prev->m_next);
+        if (elastic)
+            TMExt::elasticStep();
     }
 
     // now insert new_node between prev and curr
@@ -79,6 +96,8 @@ bool List::insert(int val)
 bool List::lookup(int val) const
 {
     bool found = false;
+    if (elastic)
+        TMExt::beginElastic(ELASTIC_WINDOW);
     const Node* curr(sentinel);
     curr = (curr->m_next);
 
@@ -86,6 +105,8 @@ bool List::lookup(int val) const
         if ((curr->m_val) >= val)
             break;
         curr = (curr->m_next);
+        if (elastic)
+            TMExt::elasticStep();
     }
 
     found = ((curr != NULL) && ((curr->m_val) == val));
@@ -119,6 +140,8 @@ int List::findmin() const
 bool List::remove(int val)
 {
     // find the node whose val matches the request
+    if (elastic)
+        TMExt::beginElastic(ELASTIC_WINDOW);
     const Node* prev(sentinel);
     const Node* curr((prev->m_next));
     while (curr != NULL) {
@@ -127,6 +150,11 @@ bool List::remove(int val)
             Node* mod_point = const_cast<Node*>(prev);
             mod_point->m_next = (curr->m_next);
 
+            // [transmem] elastic traversals at curr must see that it is gone
+            if (elastic)
+                TMExt::elasticUnlink(
+                    (void**)&const_cast<Node*>(curr)->m_next);
+
             // delete curr...
             free(const_cast<Node*>(curr));
             return true;
@@ -136,6 +164,8 @@ bool List::remove(int val)
         }
         prev = curr;
         curr = (prev->m_next);
+        if (elastic)
+            TMExt::elasticStep();
     }
     return false;
 }
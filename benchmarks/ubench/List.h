@@ -15,6 +15,8 @@
 #include <cstdlib>
 #include <cstdint>
 
+#include "tmext.h"
+
 // We construct other data structures from the List. In order to do their
 // sanity checks correctly, we might need to pass in a validation function of
 // this type
@@ -30,6 +32,12 @@ typedef bool (*verifier)(uint32_t, uint32_t);
 ///
 /// Regarding performance, Lists don't scale well with TM, because there are
 /// lots of unnecessary conflicts.  No TM algorithm can change that.
+///
+/// [transmem] With -E, traversals are elastic (see ListBench.cc): the
+/// transaction only keeps the reads of the last ELASTIC_WINDOW nodes, so
+/// that commits behind it do not abort it.  remove() then also clears the
+/// next pointer of the node it unlinks, with _ITM_elasticUnlink, so that a
+/// transaction positioned at that node still conflicts.
 class List
 {
     /// Node in a List
@@ -45,8 +53,14 @@ class List
 
     Node* sentinel;    /// the head node is a dummy node
 
+    /// the number of traversal steps whose reads an elastic traversal keeps
+    static const size_t ELASTIC_WINDOW = 2;
+
   public:
 
+    /// whether to traverse elastically (see ListBench.cc)
+    static bool elastic;
+
     List();
 
     // standard IntSet methods
@@ -58,6 +72,10 @@ class List
     bool remove(int val);
     bool isSane() const;
 
+    // the number of elements, so that the benchmarks can check that every
+    // insert and remove took effect
+    uint32_t size() const;
+
     // make sure the list is in sorted order and for each node x, v(x,
     // verifier_param) is true.  This is useful when the List is used to
     // create a Hash Table
@@ -0,0 +1,122 @@
+// -*-c++-*-
+
+#pragma once
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+
+/// The Pool benchmark tests allocation in transactions.  It is an array of
+/// slots, one per key, that each hold an item or nothing.  Inserts allocate
+/// an item for an empty slot with new, and removes free it with delete.  The
+/// benchmarks are built with -fsized-deallocation (see the Makefile), so
+/// these are libitm's sized operator delete.  Odd keys get items that are
+/// too big for the per-thread arena of the libitm builds in algs/, so that
+/// both kinds of allocation are used.
+///
+/// An insert into a full slot throws an exception and catches it.  For odd
+/// keys, the constructor of the exception throws in turn, so the exception
+/// is freed before it is thrown (_ITM_cxa_free_exception).
+///
+/// Like the Counter, the Pool is an IntSet only in name, so that we can
+/// reuse the benchmark harness.
+class Pool
+{
+    /// The number of slots (a power of two)
+    static const uint32_t N_SLOTS = 65536;
+
+    /// The items.  check lets isSane() detect items that were freed or
+    /// overwritten.
+    struct Small
+    {
+        int key;
+        int check;
+        Small(int k) : key(k), check(~k) { }
+    };
+    struct Large : Small
+    {
+        char pad[1024];
+        Large(int k) : Small(k) { }
+    };
+
+    /// The exception of a failed insert
+    struct Full
+    {
+        int key;
+        Full(int k) : key(k) {
+            if (k & 1)
+                throw k;
+        }
+    };
+
+    /// the slots upon which we operate
+    Small* slots[N_SLOTS];
+
+  public:
+
+    /// Just empty the slots
+    Pool() {
+        for (uint32_t i = 0; i < N_SLOTS; ++i)
+            slots[i] = NULL;
+    }
+
+    /// Is there an item in the slot of val?
+    __attribute__((transaction_safe))
+    bool lookup(int val) const {
+        const Small* s = slots[val % N_SLOTS];
+        return s && s->key == val;
+    }
+
+    /// Allocate an item for val, unless its slot is full
+    __attribute__((transaction_safe))
+    bool insert(int val) {
+        Small*& s = slots[val % N_SLOTS];
+        if (s) {
+            try {
+                throw Full(val);
+            }
+            catch (int) { }
+            catch (const Full&) { }
+            return false;
+        }
+        if (val & 1)
+            s = new Large(val);
+        else
+            s = new Small(val);
+        return true;
+    }
+
+    /// Free the item in the slot of val, if there is one
+    __attribute__((transaction_safe))
+    bool remove(int val) {
+        Small*& s = slots[val % N_SLOTS];
+        if (!s)
+            return false;
+        if (s->key & 1)
+            delete static_cast<Large*>(s);
+        else
+            delete s;
+        s = NULL;
+        return true;
+    }
+
+    /// The number of items, so that PoolBench can check that every insert
+    /// and remove took effect
+    uint32_t size() const {
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < N_SLOTS; ++i)
+            if (slots[i])
+                ++n;
+        return n;
+    }
+
+    /// Every item must be in its slot, and intact
+    bool isSane() const {
+        for (uint32_t i = 0; i < N_SLOTS; ++i) {
+            const Small* s = slots[i];
+            if (s && (s->key % N_SLOTS != i || s->check != ~s->key))
+                return false;
+        }
+        return true;
+    }
+};
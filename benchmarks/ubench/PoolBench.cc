@@ -0,0 +1,50 @@
+// -*-c++-*-
+//
+//  Copyright (C) 2011, 2015
+//  University of Rochester Department of Computer Science
+//    and
+//  Lehigh University Department of Computer Science and Engineering
+//
+// License: Modified BSD
+//          Please see the file LICENSE for licensing information
+
+#include "bmconfig.h"
+#include "bmharness.h"
+#include "Pool.h"
+
+/// This is the pool we'll manipulate in the experiment.  We keep a pointer
+/// to it, so that we can count its items after the test.
+Pool* POOL = new Pool();
+benchmark<Pool> SET(POOL);
+
+/// This static, declared in bmconfig, needs to be defined
+Config Config::CFG;
+
+/// A helper function to update the configuration based on some custom names
+void reparse_args() {
+    if (Config::CFG.bmname == "") Config::CFG.bmname = "Pool";
+}
+
+/// We just call to SET functions in main
+int main(int argc, char** argv) {
+    // parse command line
+    Config::CFG.parseargs(argc, argv, "PoolBench");
+    reparse_args();
+
+    // warm up the data structure
+    SET.warmup();
+    uint32_t before = POOL->size();
+
+    // run the tests
+    SET.launch_test();
+
+    // every successful insert added an item, and every successful remove
+    // freed one
+    uint32_t expect =
+        before + Config::CFG.insert_hit - Config::CFG.remove_hit;
+    std::cout << "Accounting: "
+              << (POOL->size() == expect ? "Passed" : "Failed") << "\n";
+
+    // print results
+    Config::CFG.dump_csv();
+}
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# This script compares the cost of the read and write barriers in two builds
+# of the same libitm in algs/: the default one, which calls the TM method
+# through the dispatch table, and the STATIC_DISPATCH=1 one, which calls it
+# directly (see algs/README.md).  ArrayBench executes about -O barriers per
+# transaction, so it runs with short and long transactions, read-only and
+# with updates.
+#
+# The benchmarks must be built.  Set DYNAMIC and STATIC to the folders that
+# hold libitm.so.1 of the two builds.  The library's STM is used in both, so
+# do not set ITM_DEFAULT_METHOD.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$DURATION" == "" ]; then
+    DURATION=5
+fi
+if [ "$DYNAMIC" == "" ] || [ "$STATIC" == "" ]; then
+    echo "DYNAMIC and STATIC must name the folders of the two builds"
+    exit 1
+fi
+
+echo "BITS=$BITS DYNAMIC=$DYNAMIC STATIC=$STATIC"
+
+# few and many barriers per transaction, read-only and with 20% updates
+for bench in "ArrayBench -O4 -R100" "ArrayBench -O64 -R100" \
+             "ArrayBench -O4 -R80" "ArrayBench -O64 -R80"; do
+    for p in $THREADS; do
+        for build in dynamic static; do
+            if [ "$build" == "dynamic" ]; then dir=$DYNAMIC; else dir=$STATIC; fi
+            echo -n "build=$build, "
+            LD_LIBRARY_PATH=$dir ./obj$BITS/$bench -m65536 -d$DURATION -p$p | grep csv
+        done
+    done
+done
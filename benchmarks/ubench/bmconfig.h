@@ -23,6 +23,11 @@ struct Config
     uint32_t    inspct;                 /// insert percent
     uint32_t    sets;                   /// number of sets to create
     uint32_t    ops;                    /// operations per transaction
+    bool        privhint;               /// only marked txns privatize
+    bool        commutative;            /// use commutative increments
+    bool        elastic;                /// use elastic list traversals
+    uint32_t    irrevocable;            /// irrevocable update percent
+    uint32_t    nested;                 /// nested cancel update percent
 
     /*** THESE GET UPDATED LATER ***/
     std::atomic<uint64_t> time;            /// total time the test ran
@@ -42,7 +47,10 @@ struct Config
         threads(1),    nops_after_tx(0),
         elements(256), lookpct(34),
         inspct(66),    sets(1),
-        ops(1),        time(0),
+        ops(1),        privhint(false),
+        commutative(false), elastic(false),
+        irrevocable(0),     nested(0),
+        time(0),
         running(true), txcount(0),
         lookup_hit(0), lookup_miss(0),
         insert_hit(0), insert_miss(0),
@@ -57,6 +65,9 @@ struct Config
                   << ", d=" << duration   << ", p=" << threads
                   << ", X=" << execute    << ", m=" << elements
                   << ", S=" << sets       << ", O=" << ops
+                  << ", P=" << privhint   << ", A=" << commutative
+                  << ", E=" << elastic    << ", I=" << irrevocable
+                  << ", c=" << nested
                   << ", txns=" << txcount << ", time=" << time
                   << ", throughput="
                   << (1000000000LL * txcount) / (time)
@@ -79,13 +90,18 @@ struct Config
         std::cerr << "    -B: name of benchmark\n";
         std::cerr << "    -S: number of sets to build (default 1)\n";
         std::cerr << "    -O: operations per transaction (default 1)\n";
+        std::cerr << "    -P: declare that only marked txns privatize\n";
+        std::cerr << "    -A: increment counters with _ITM_addU8\n";
+        std::cerr << "    -E: traverse lists with _ITM_elasticStep\n";
+        std::cerr << "    -I: % of ins/rmv txns that are irrevocable\n";
+        std::cerr << "    -c: % of ins/rmv txns that cancel a nested txn\n";
         std::cerr << "    -h: print help (this message)\n\n";
     }
 
     /// Parse command line arguments
     void parseargs(int argc, char** argv, std::string name) {
         int opt;
-        while ((opt = getopt(argc, argv, "N:d:p:hX:B:m:R:S:O:")) != -1) {
+        while ((opt = getopt(argc, argv, "N:d:p:hX:B:m:R:S:O:PAEI:c:")) != -1) {
             switch(opt) {
               case 'd': duration      = strtol(optarg, NULL, 10); break;
               case 'p': threads       = strtol(optarg, NULL, 10); break;
@@ -95,6 +111,11 @@ struct Config
               case 'm': elements      = strtol(optarg, NULL, 10); break;
               case 'S': sets          = strtol(optarg, NULL, 10); break;
               case 'O': ops           = strtol(optarg, NULL, 10); break;
+              case 'P': privhint      = true; break;
+              case 'A': commutative   = true; break;
+              case 'E': elastic       = true; break;
+              case 'I': irrevocable   = strtol(optarg, NULL, 10); break;
+              case 'c': nested        = strtol(optarg, NULL, 10); break;
               case 'R':
                 lookpct = strtol(optarg, NULL, 10);
                 inspct = (100 - lookpct)/2 + strtol(optarg, NULL, 10);
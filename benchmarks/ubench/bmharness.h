@@ -19,10 +19,31 @@
 #include "barrier.h"
 #include "timing.h"
 #include "bmconfig.h"
+#include "tmext.h"
 
 /// A hack for making sure each thread can easily access its ID
 thread_local int thread_id;
 
+/// [transmem] Irrevocable updates (see -I) call this.  It is not
+/// transaction-safe, so a relaxed transaction that calls it has to become
+/// irrevocable first.
+__attribute__((noinline))
+static void go_irrevocable() {
+    __asm__ __volatile__("" ::: "memory");
+}
+
+/// [transmem] Updates with -c call this to undo themselves in a nested
+/// transaction that cancels.  GCC drops __transaction_cancel in templates, so
+/// this is not in the benchmark class, and calls the undo through a pointer.
+typedef bool (*nested_op_t)(void*, int) __attribute__((transaction_safe));
+__attribute__((transaction_safe, noinline))
+static void cancel_nested(nested_op_t op, void* set, int val) {
+    __transaction_atomic {
+        op(set, val);
+        __transaction_cancel;
+    }
+}
+
 /// The benchmark class provides a standard way of doing insert/lookup/remove
 /// operations on a set of integers
 template<class SET>
@@ -56,17 +77,83 @@ class benchmark
             counts[res ? LOOKUP_T : LOOKUP_F]++;
         }
         else if (act < Config::CFG.inspct) {
+            res = update(val, true, seed);
+            counts[res ? INSERT_T : INSERT_F]++;
+        }
+        else {
+            res = update(val, false, seed);
+            counts[res ? REMOVE_T : REMOVE_F]++;
+        }
+    }
+
+    /// Insert or remove val.  [transmem] With -I or -c, the update may be
+    /// irrevocable, or may cancel a nested transaction.
+    bool update(uint32_t val, bool insert, uint32_t* seed) {
+        if (chance(seed, Config::CFG.irrevocable))
+            return update_irrevocably(val, insert);
+        if (chance(seed, Config::CFG.nested))
+            return update_nested(val, insert);
+        bool res;
+        if (insert) {
             __transaction_atomic {
                 res = set->insert(val);
             }
-            counts[res ? INSERT_T : INSERT_F]++;
         }
         else {
             __transaction_atomic {
                 res = set->remove(val);
             }
-            counts[res ? REMOVE_T : REMOVE_F]++;
         }
+        return res;
+    }
+
+    /// [transmem] True with a probability of pct percent
+    bool chance(uint32_t* seed, uint32_t pct) {
+        return pct && rand_r(seed) % 100 < pct;
+    }
+
+    /// [transmem] Insert or remove val in an irrevocable transaction (see
+    /// -I).  For even keys, the transaction is irrevocable from the start.
+    /// For odd keys, it becomes irrevocable only once the update has
+    /// succeeded, after it has accessed the set.
+    bool update_irrevocably(uint32_t val, bool insert) {
+        bool res;
+        if (val & 1) {
+            __transaction_relaxed {
+                res = insert ? set->insert(val) : set->remove(val);
+                if (res)
+                    go_irrevocable();
+            }
+        }
+        else {
+            __transaction_relaxed {
+                go_irrevocable();
+                res = insert ? set->insert(val) : set->remove(val);
+            }
+        }
+        return res;
+    }
+
+    /// [transmem] Insert or remove val, and then undo that in a nested
+    /// transaction that cancels (see -c).  Only the nested transaction is
+    /// rolled back, so the update must still take effect.
+    bool update_nested(uint32_t val, bool insert) {
+        bool res;
+        __transaction_atomic {
+            res = insert ? set->insert(val) : set->remove(val);
+            cancel_nested(insert ? remove_op : insert_op, set, val);
+        }
+        return res;
+    }
+
+    /// [transmem] The operations that cancel_nested() calls
+    __attribute__((transaction_safe))
+    static bool insert_op(void* s, int val) {
+        return static_cast<SET*>(s)->insert(val);
+    }
+    __attribute__((transaction_safe))
+    static bool remove_op(void* s, int val) {
+        return static_cast<SET*>(s)->remove(val);
     }
 
     /// This code runs some no-ops between transactions, if requested
@@ -163,6 +250,15 @@ class benchmark
             delete(thread_barrier);
         thread_barrier = new barrier(Config::CFG.threads);
 
+        // None of the sets privatize data, except by freeing nodes, which
+        // libitm handles on its own
+        if (Config::CFG.privhint) {
+            if (TMExt::setPrivatizationPolicy)
+                TMExt::setPrivatizationPolicy(1); // privatizationMarked
+            else
+                std::cerr << "-P: libitm has no privatization hint\n";
+        }
+
         // kick off the threads (this thread runs too...)
         std::thread* threads = new std::thread[Config::CFG.threads];
         for (int i = 1; i < Config::CFG.threads; ++i)
@@ -0,0 +1,55 @@
+#!/bin/bash
+
+# This file holds the result checks of the scripts that test one STM or one
+# mechanism of an STM (combining.sh, readonly.sh, ...).  Source it after
+# setting BITS, THREADS and TXNS, and the environment of the STM to test.
+#
+# check_all runs every benchmark that can check its own results, for TXNS
+# transactions per thread, with each thread count in THREADS.  Its arguments
+# are passed to every benchmark after the default flags, so they can also
+# override them.  Each run that fails prints LABEL, the run and its output,
+# and sets status to 1.
+
+status=0
+
+# check_counter <p> <flags>: every increment must be counted.  Two come from
+# the warmup, and the counter is printed after the warmup, too, so we take
+# the last value.
+check_counter() {
+    local p=$1
+    shift
+    local expect=$((2 + p * TXNS))
+    local got=$(./obj$BITS/CounterBench -m2 "$@" -X$TXNS -p$p \
+                | sed -n 's/^Counter value = //p' | tail -1)
+    if [ "$got" != "$expect" ]; then
+        echo "$LABEL, CounterBench $*, p=$p: counter is $got, expected $expect"
+        status=1
+    fi
+}
+
+# check_bench <bench> <p> <flags>: the data structure must be sane, and the
+# accounting of the benchmarks that do it must pass
+check_bench() {
+    local bench=$1
+    local p=$2
+    shift 2
+    local out=$(./obj$BITS/$bench "$@" -X$TXNS -p$p 2>&1)
+    if ! echo "$out" | grep -q "Verification: Passed" ||
+       echo "$out" | grep -q "Accounting: Failed"; then
+        echo "$LABEL, $bench $*, p=$p: failed"
+        echo "$out"
+        status=1
+    fi
+}
+
+# check_all <flags>: run every check with each thread count
+check_all() {
+    for p in $THREADS; do
+        check_counter $p "$@"
+        for bench in "BankBench -R50" "ArrayBench -m1024 -O16" \
+                     "ListBench -m64" "TreeBench -m256" \
+                     "HashBench -m4096" "PoolBench -m256 -R20"; do
+            check_bench "$bench" $p "$@"
+        done
+    done
+}
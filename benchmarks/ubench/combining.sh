@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# This script checks the flat combining commits of NOrec (see algs/README.md).
+# It runs every benchmark of check.sh under NOrec with the default mix, and
+# with updates only, so that many small writers compete for the sequence
+# lock.  Combining only happens when a writer finds the lock held, so the
+# default thread counts go beyond the number of CPUs, where lock holders are
+# preempted.  It fails if a benchmark gives a wrong result.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at
+# algs/libitm_norec or algs/libitm_adaptive.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16 32"
+fi
+if [ "$TXNS" == "" ]; then
+    TXNS=20000
+fi
+
+export ITM_DEFAULT_METHOD=norec
+echo "BITS=$BITS ITM_DEFAULT_METHOD=$ITM_DEFAULT_METHOD"
+
+. ./check.sh
+LABEL="norec"
+check_all
+LABEL="norec, updates only"
+check_all -R0
+
+if [ $status == 0 ]; then
+    echo "Passed"
+fi
+exit $status
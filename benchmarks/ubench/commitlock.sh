@@ -0,0 +1,48 @@
+#!/bin/bash
+
+# This script checks how lazy locks its orecs at commit (see algs/README.md):
+# in sorted order, without duplicates, and with bounded waiting for orecs
+# that other committing writers hold.  It runs every benchmark of check.sh
+# under lazy with each orec table size in ORECS (ITM_ORECS), and an array
+# whose updates write 64 words each.  Small tables map many stripes of a
+# write set to the same orec, and make most commits wait for each other.  It
+# also runs them with -I, so that some writers wait for orecs of the
+# inevitable transaction.  It fails if a benchmark gives a wrong result.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at
+# algs/libitm_lazy or algs/libitm_adaptive.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$TXNS" == "" ]; then
+    TXNS=20000
+fi
+if [ "$ORECS" == "" ]; then
+    ORECS="default 64 1"
+fi
+
+export ITM_DEFAULT_METHOD=lazy
+echo "BITS=$BITS ITM_DEFAULT_METHOD=$ITM_DEFAULT_METHOD ORECS=$ORECS"
+
+. ./check.sh
+for n in $ORECS; do
+    if [ "$n" == "default" ]; then unset ITM_ORECS
+    else export ITM_ORECS=$n; fi
+    LABEL="orecs=$n"
+    check_all
+    for p in $THREADS; do
+        check_bench "ArrayBench -m64 -O64 -R0" $p
+    done
+    LABEL="orecs=$n, I=10"
+    check_all -I10
+done
+
+if [ $status == 0 ]; then
+    echo "Passed"
+fi
+exit $status
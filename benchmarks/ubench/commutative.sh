@@ -0,0 +1,29 @@
+#!/bin/bash
+
+# This script measures what commutative increments (-A) buy for
+# CounterBench.  Without -A, every transaction reads and writes the counter,
+# so concurrent transactions conflict.  With it, they call _ITM_addU8, which
+# NOrec and lazy apply at commit without reading the counter.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at one of the
+# libitm builds in algs/ (the add is a transmem extension).  Set
+# ITM_DEFAULT_METHOD to pick an STM other than the library's default.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$DURATION" == "" ]; then
+    DURATION=5
+fi
+
+echo "BITS=$BITS ITM_DEFAULT_METHOD=$ITM_DEFAULT_METHOD"
+
+for p in $THREADS; do
+    for add in "" "-A"; do
+        ./obj$BITS/CounterBench -d$DURATION -p$p $add | grep csv
+    done
+done
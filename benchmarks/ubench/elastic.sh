@@ -0,0 +1,55 @@
+#!/bin/bash
+
+# This script measures what elastic traversals (-E) buy for ListBench and
+# HashBench.  Without -E, every node that a transaction passes stays in its
+# read set, so any commit on the path aborts it.  With it, the transaction
+# only keeps the last two nodes.  Before timing, it runs a fixed number of
+# transactions with -E, and fails if a structure is not sane afterwards, or
+# if its number of elements does not match the successful inserts and
+# removes.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at one of the
+# libitm builds in algs/ (elastic traversals are a transmem extension).  Set
+# ITM_DEFAULT_METHOD to pick an STM other than the library's default.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$DURATION" == "" ]; then
+    DURATION=5
+fi
+
+echo "BITS=$BITS ITM_DEFAULT_METHOD=$ITM_DEFAULT_METHOD"
+
+# check first: short lists, where traversals often pass nodes that others
+# remove, and a hash table
+CHECK_TXNS=20000
+status=0
+for bench in "ListBench -m64" "ListBench -m256" "HashBench -m4096"; do
+    for p in $THREADS; do
+        out=$(./obj$BITS/$bench -E -R34 -X$CHECK_TXNS -p$p)
+        if ! echo "$out" | grep -q "Verification: Passed" ||
+           ! echo "$out" | grep -q "Accounting: Passed"; then
+            echo "$bench, p=$p: failed"
+            echo "$out"
+            status=1
+        fi
+    done
+done
+if [ $status != 0 ]; then
+    exit $status
+fi
+
+# a short and a long list, and a hash table with long buckets, with 1/3
+# lookups
+for bench in "ListBench -m64" "ListBench -m1024" "HashBench -m65536"; do
+    for p in $THREADS; do
+        for el in "" "-E"; do
+            ./obj$BITS/$bench -R34 -d$DURATION -p$p $el | grep csv
+        done
+    done
+done
@@ -0,0 +1,46 @@
+#!/bin/bash
+
+# This script checks the inevitable transactions of NOrec, lazy and TML (see
+# algs/README.md).  It runs every benchmark of check.sh under each method
+# with -I, so that some inserts and removes are irrevocable, some from the
+# start and some only once they have accessed the data structure.  It does
+# so with concurrent inevitable transactions, and with ITM_INEVITABLE=0,
+# where they are serial.  It fails if a benchmark gives a wrong result.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at one of the
+# libitm builds in algs/ that has the methods in METHODS (by default, NOrec
+# and lazy, which are both in algs/libitm_adaptive; use METHODS=tml with
+# algs/libitm_tml).
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$TXNS" == "" ]; then
+    TXNS=20000
+fi
+if [ "$METHODS" == "" ]; then
+    METHODS="norec lazy"
+fi
+
+echo "BITS=$BITS METHODS=$METHODS"
+
+. ./check.sh
+for m in $METHODS; do
+    export ITM_DEFAULT_METHOD=$m
+    for inev in 1 0; do
+        export ITM_INEVITABLE=$inev
+        for i in 10 100; do
+            LABEL="method=$m, inevitable=$inev, I=$i"
+            check_all -I$i
+        done
+    done
+done
+
+if [ $status == 0 ]; then
+    echo "Passed"
+fi
+exit $status
@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# This script tests the multi-version snapshot mode of lazy
+# (ITM_MULTIVERSION=1) with BankBench, under each global time base mode
+# (ITM_TIMEBASE=gv1|gv4|gv5|sharded).  Half of the transactions sum all
+# accounts in one long read-only transaction, which reads old versions when
+# writers have moved on, and the other half move units between accounts.
+# First, it runs a fixed number of transactions, and fails if a sum was
+# wrong, a transfer was lost, or the total changed.  Then it times the
+# benchmark with and without multiple versions.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at
+# algs/libitm_lazy or algs/libitm_adaptive.  We set ITM_DEFAULT_METHOD to
+# lazy.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$DURATION" == "" ]; then
+    DURATION=5
+fi
+if [ "$MODES" == "" ]; then
+    MODES="gv1 gv4 gv5 sharded"
+fi
+export ITM_DEFAULT_METHOD=lazy
+
+echo "BITS=$BITS"
+
+# check every mode first
+CHECK_TXNS=20000
+status=0
+for tb in $MODES; do
+    for p in $THREADS; do
+        out=$(ITM_MULTIVERSION=1 ITM_TIMEBASE=$tb ./obj$BITS/BankBench -R50 \
+              -X$CHECK_TXNS -p$p)
+        if ! echo "$out" | grep -q "Verification: Passed" ||
+           ! echo "$out" | grep -q "Accounting: Passed"; then
+            echo "timebase=$tb, p=$p: BankBench failed"
+            echo "$out"
+            status=1
+        fi
+    done
+done
+if [ $status != 0 ]; then
+    exit $status
+fi
+
+# mostly scans, and half scans
+for r in 90 50; do
+    for p in $THREADS; do
+        for tb in $MODES; do
+            for mv in 0 1; do
+                echo -n "timebase=$tb, multiversion=$mv, "
+                ITM_MULTIVERSION=$mv ITM_TIMEBASE=$tb ./obj$BITS/BankBench \
+                    -R$r -d$DURATION -p$p | grep csv
+            done
+        done
+    done
+done
@@ -0,0 +1,52 @@
+#!/bin/bash
+
+# This script checks the closed nesting of NOrec, lazy and TML (see
+# algs/README.md).  It runs every benchmark of check.sh under each method
+# with -c, so that some inserts and removes undo themselves in a nested
+# transaction that cancels.  Only the nested transaction may be rolled back,
+# so a check fails if the cancel undoes too much or too little.  It also
+# runs them with ITM_CM_RETRIES=1 (see priority.sh), where transactions soon
+# restart in serial-irrevocable mode, and their nested transactions have to
+# switch to serial mode to be able to cancel.  The script fails if a
+# benchmark gives a wrong result.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at one of the
+# libitm builds in algs/ that has the methods in METHODS (by default, NOrec
+# and lazy, which are both in algs/libitm_adaptive; use METHODS=tml with
+# algs/libitm_tml).  Other methods restart cancelling transactions in serial
+# mode.  algs/libitm_eager and algs/libitm_x86_linux do not support closed
+# nesting at all.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$TXNS" == "" ]; then
+    TXNS=20000
+fi
+if [ "$METHODS" == "" ]; then
+    METHODS="norec lazy"
+fi
+
+echo "BITS=$BITS METHODS=$METHODS"
+
+. ./check.sh
+for m in $METHODS; do
+    export ITM_DEFAULT_METHOD=$m
+    for n in default 1; do
+        if [ "$n" == "default" ]; then unset ITM_CM_RETRIES
+        else export ITM_CM_RETRIES=$n; fi
+        for c in 10 100; do
+            LABEL="method=$m, retries=$n, c=$c"
+            check_all -c$c
+        done
+    done
+done
+
+if [ $status == 0 ]; then
+    echo "Passed"
+fi
+exit $status
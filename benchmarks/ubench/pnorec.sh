@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# This script checks partitioned NOrec (see algs/README.md).  It runs every
+# benchmark of check.sh under pnorec with each number of partitions in
+# PARTITIONS, with the default mix and with updates only.  With one
+# partition, pnorec works like NOrec, and with more, writers that touch
+# disjoint partitions commit concurrently, and readers only revalidate when
+# a partition that they read changes.  It fails if a benchmark gives a wrong
+# result.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at
+# algs/libitm_norec.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$TXNS" == "" ]; then
+    TXNS=20000
+fi
+if [ "$PARTITIONS" == "" ]; then
+    PARTITIONS="1 2 16 64"
+fi
+
+export ITM_DEFAULT_METHOD=pnorec
+echo "BITS=$BITS ITM_DEFAULT_METHOD=$ITM_DEFAULT_METHOD PARTITIONS=$PARTITIONS"
+
+. ./check.sh
+for n in $PARTITIONS; do
+    export ITM_PNOREC_PARTITIONS=$n
+    LABEL="partitions=$n"
+    check_all
+    LABEL="partitions=$n, updates only"
+    check_all -R0
+done
+
+if [ $status == 0 ]; then
+    echo "Passed"
+fi
+exit $status
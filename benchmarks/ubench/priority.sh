@@ -0,0 +1,49 @@
+#!/bin/bash
+
+# This script checks the priority transactions of NOrec and lazy (see
+# algs/README.md).  It runs every benchmark of check.sh under each method,
+# with each contention manager, and with ITM_CM_RETRIES set to RETRIES, so
+# that transactions take the priority token after a restart or two instead
+# of after 100.  Writers that conflict with the priority transaction then
+# restart and wait for it.  It fails if a benchmark gives a wrong result.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at one of the
+# libitm builds in algs/ that has the methods in METHODS (by default, NOrec
+# and lazy, which are both in algs/libitm_adaptive).
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$TXNS" == "" ]; then
+    TXNS=20000
+fi
+if [ "$METHODS" == "" ]; then
+    METHODS="norec lazy"
+fi
+if [ "$RETRIES" == "" ]; then
+    RETRIES="1 2"
+fi
+
+echo "BITS=$BITS METHODS=$METHODS RETRIES=$RETRIES"
+
+. ./check.sh
+for m in $METHODS; do
+    export ITM_DEFAULT_METHOD=$m
+    for cm in immediate adaptive; do
+        export ITM_CM=$cm
+        for n in $RETRIES; do
+            export ITM_CM_RETRIES=$n
+            LABEL="method=$m, cm=$cm, retries=$n"
+            check_all
+        done
+    done
+done
+
+if [ $status == 0 ]; then
+    echo "Passed"
+fi
+exit $status
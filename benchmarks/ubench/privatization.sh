@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# This script measures what the privatization hint (-P) buys for ListBench
+# and TreeBench.  Without the hint, every writer commit under a
+# quiescence-based STM (ml_wt, lazy) waits for all concurrent transactions
+# to finish.  With it, only commits that free memory (here, successful
+# removes) wait.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at one of the
+# libitm builds in algs/ (the hint is a transmem extension).  Set
+# ITM_DEFAULT_METHOD to pick an STM other than the library's default.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$DURATION" == "" ]; then
+    DURATION=5
+fi
+
+echo "BITS=$BITS ITM_DEFAULT_METHOD=$ITM_DEFAULT_METHOD"
+
+# a small and a large key range for each benchmark, with 1/3 lookups
+for bench in "ListBench -m64" "ListBench -m1024" \
+             "TreeBench -m256" "TreeBench -m65536"; do
+    for p in $THREADS; do
+        for hint in "" "-P"; do
+            ./obj$BITS/$bench -R34 -d$DURATION -p$p $hint | grep csv
+        done
+    done
+done
@@ -0,0 +1,42 @@
+#!/bin/bash
+
+# This script checks the read-only fast paths of NOrec and lazy (see
+# algs/README.md).  It runs every benchmark of check.sh under each method
+# with the default mix, with mostly lookups, and with lookups only.  Failed
+# inserts and removes do not write, so their call sites alternate between the
+# read-only variant and the full method, and the Counter's lookups write, so
+# they restart the first time.  It fails if a benchmark gives a wrong result.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at one of the
+# libitm builds in algs/ that has the methods in METHODS (by default, NOrec
+# and lazy, which are both in algs/libitm_adaptive).
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$TXNS" == "" ]; then
+    TXNS=20000
+fi
+if [ "$METHODS" == "" ]; then
+    METHODS="norec lazy"
+fi
+
+echo "BITS=$BITS METHODS=$METHODS"
+
+. ./check.sh
+for m in $METHODS; do
+    export ITM_DEFAULT_METHOD=$m
+    for r in 34 90 100; do
+        LABEL="method=$m, R=$r"
+        check_all -R$r
+    done
+done
+
+if [ $status == 0 ]; then
+    echo "Passed"
+fi
+exit $status
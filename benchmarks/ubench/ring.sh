@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# This script checks RingSTM (see algs/README.md).  It runs every benchmark
+# of check.sh under ring, with the default mix and with updates only, and
+# then a long list and a large tree, whose read signatures fill up and whose
+# readers may fall behind the ring by more than its size.  It fails if a
+# benchmark gives a wrong result.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at
+# algs/libitm_norec.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$TXNS" == "" ]; then
+    TXNS=20000
+fi
+
+export ITM_DEFAULT_METHOD=ring
+echo "BITS=$BITS ITM_DEFAULT_METHOD=$ITM_DEFAULT_METHOD"
+
+. ./check.sh
+LABEL="ring"
+check_all
+LABEL="ring, updates only"
+check_all -R0
+LABEL="ring, large sets"
+for p in $THREADS; do
+    check_bench "ListBench -m1024" $p
+    check_bench "TreeBench -m65536" $p
+done
+
+if [ $status == 0 ]; then
+    echo "Passed"
+fi
+exit $status
@@ -0,0 +1,64 @@
+#!/bin/bash
+
+# This script compares the global time base modes of ml_wt and lazy
+# (ITM_TIMEBASE=gv1|gv4|gv5|sharded) on CounterBench and HashBench.  Every
+# Counter transaction conflicts, so it shows the cost of each mode when
+# commits are serialized anyway.  HashBench transactions rarely conflict, so
+# with enough threads the commit-time increment is the main shared write.
+# Before timing, it checks that each mode gives correct results, and fails
+# if one does not.
+#
+# The benchmarks must be built, and LD_LIBRARY_PATH must point at one of the
+# libitm builds in algs/ that has ml_wt or lazy.  Set ITM_DEFAULT_METHOD to
+# pick an STM other than the library's default.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$DURATION" == "" ]; then
+    DURATION=5
+fi
+if [ "$MODES" == "" ]; then
+    MODES="gv1 gv4 gv5 sharded"
+fi
+
+echo "BITS=$BITS ITM_DEFAULT_METHOD=$ITM_DEFAULT_METHOD"
+
+# check every mode first: a fixed number of counter increments must all be
+# counted (two come from the warmup), and the hash table must stay sane.  The
+# counter is printed after the warmup, too, so we take the last value.
+CHECK_TXNS=100000
+status=0
+for tb in $MODES; do
+    for p in $THREADS; do
+        expect=$((2 + p * CHECK_TXNS))
+        got=$(ITM_TIMEBASE=$tb ./obj$BITS/CounterBench -m2 -X$CHECK_TXNS -p$p \
+              | sed -n 's/^Counter value = //p' | tail -1)
+        if [ "$got" != "$expect" ]; then
+            echo "timebase=$tb, p=$p: counter is $got, expected $expect"
+            status=1
+        fi
+        if ! ITM_TIMEBASE=$tb ./obj$BITS/HashBench -m256 -R0 -X$CHECK_TXNS \
+             -p$p | grep -q "Verification: Passed"; then
+            echo "timebase=$tb, p=$p: HashBench verification failed"
+            status=1
+        fi
+    done
+done
+if [ $status != 0 ]; then
+    exit $status
+fi
+
+# write-only and mostly-read mixes for the hash
+for bench in "CounterBench" "HashBench -m256 -R0" "HashBench -m256 -R80"; do
+    for p in $THREADS; do
+        for tb in $MODES; do
+            echo -n "timebase=$tb, "
+            ITM_TIMEBASE=$tb ./obj$BITS/$bench -d$DURATION -p$p | grep csv
+        done
+    done
+done
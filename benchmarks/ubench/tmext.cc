@@ -0,0 +1,23 @@
+#include <dlfcn.h>
+#include "tmext.h"
+
+// [transmem] Look up the libitm extensions (see tmext.h).  dlsym() does not
+// ask for a symbol version, so it finds them in any libitm that has them.
+// This runs before main(), and libitm is loaded by then, since the
+// benchmarks depend on it.
+
+TMExt::setPrivatizationPolicy_t TMExt::setPrivatizationPolicy =
+    (TMExt::setPrivatizationPolicy_t)
+    dlsym(RTLD_DEFAULT, "_ITM_setPrivatizationPolicy");
+
+TMExt::addU8_t TMExt::addU8 =
+    (TMExt::addU8_t)dlsym(RTLD_DEFAULT, "_ITM_addU8");
+
+TMExt::beginElastic_t TMExt::beginElastic =
+    (TMExt::beginElastic_t)dlsym(RTLD_DEFAULT, "_ITM_beginElastic");
+
+TMExt::elasticStep_t TMExt::elasticStep =
+    (TMExt::elasticStep_t)dlsym(RTLD_DEFAULT, "_ITM_elasticStep");
+
+TMExt::elasticUnlink_t TMExt::elasticUnlink =
+    (TMExt::elasticUnlink_t)dlsym(RTLD_DEFAULT, "_ITM_elasticUnlink");
@@ -0,0 +1,45 @@
+// -*-c++-*-
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// [transmem] The libitm builds in algs/ export a few extensions (see their
+/// libitm.h) under their own symbol version, TRANSMEM_1.0.  A program that
+/// calls them directly requires that version, and the dynamic loader refuses
+/// to start it with any other libitm, such as GCC's.  So the benchmarks look
+/// them up at run time instead (see tmext.cc).  Each pointer is NULL if the
+/// libitm does not provide the extension, and the flags that need it then
+/// print a warning and are ignored.
+///
+/// The extensions use the libitm calling convention, which is regparm(2) on
+/// 32-bit x86.  Those that may be called in transactions are pure, so that
+/// calling them does not make the transaction irrevocable.
+#ifdef __i386__
+#define TMEXT_ABI __attribute__((regparm(2)))
+#define TMEXT_PURE_ABI __attribute__((regparm(2), transaction_pure))
+#else
+#define TMEXT_ABI
+#define TMEXT_PURE_ABI __attribute__((transaction_pure))
+#endif
+
+struct TMExt
+{
+    /// _ITM_setPrivatizationPolicy (see -P in bmharness.h)
+    typedef void (*setPrivatizationPolicy_t)(int) TMEXT_ABI;
+    static setPrivatizationPolicy_t setPrivatizationPolicy;
+
+    /// _ITM_addU8 (see -A in Counter.h)
+    typedef void (*addU8_t)(uint64_t*, uint64_t) TMEXT_PURE_ABI;
+    static addU8_t addU8;
+
+    /// _ITM_beginElastic, _ITM_elasticStep and _ITM_elasticUnlink (see -E
+    /// in List.h)
+    typedef void (*beginElastic_t)(size_t) TMEXT_PURE_ABI;
+    typedef void (*elasticStep_t)() TMEXT_PURE_ABI;
+    typedef void (*elasticUnlink_t)(void**) TMEXT_PURE_ABI;
+    static beginElastic_t  beginElastic;
+    static elasticStep_t   elasticStep;
+    static elasticUnlink_t elasticUnlink;
+};
@@ -0,0 +1,55 @@
+#!/bin/bash
+
+# This script compares TML (algs/libitm_tml) with NOrec (algs/libitm_norec)
+# as the share of read-only transactions grows.  A TML reader keeps no read
+# set, but every writer's commit aborts all concurrent transactions, so TML
+# should only pay off when writers are rare.  Before timing, it checks that
+# TML gives correct results with every benchmark of check.sh, also with
+# lookups only and with updates only, and fails if it does not.
+#
+# The benchmarks must be built.  Set TML and NOREC to the folders that hold
+# libitm.so.1 of the two libraries.  Each library's STM is used, so do not
+# set ITM_DEFAULT_METHOD.
+
+# default to 32 bits if no BITS provided in environment
+if [ "$BITS" == "" ]; then
+    BITS=32
+fi
+if [ "$THREADS" == "" ]; then
+    THREADS="1 2 4 8 16"
+fi
+if [ "$DURATION" == "" ]; then
+    DURATION=5
+fi
+if [ "$TXNS" == "" ]; then
+    TXNS=20000
+fi
+if [ "$TML" == "" ] || [ "$NOREC" == "" ]; then
+    echo "TML and NOREC must name the folders of the two libraries"
+    exit 1
+fi
+
+echo "BITS=$BITS TML=$TML NOREC=$NOREC"
+
+# check TML first
+. ./check.sh
+for r in 34 0 100; do
+    LABEL="lib=tml, R=$r"
+    LD_LIBRARY_PATH=$TML check_all -R$r
+done
+if [ $status != 0 ]; then
+    exit $status
+fi
+
+# a list, a tree and a hash table, from update-heavy to almost read-only
+for bench in "ListBench -m256" "TreeBench -m65536" "HashBench -m65536"; do
+    for r in 0 34 90 98 100; do
+        for p in $THREADS; do
+            for lib in tml norec; do
+                if [ "$lib" == "tml" ]; then dir=$TML; else dir=$NOREC; fi
+                echo -n "lib=$lib, "
+                LD_LIBRARY_PATH=$dir ./obj$BITS/$bench -R$r -d$DURATION -p$p | grep csv
+            done
+        done
+    done
+done